@@ -1,4 +1,7 @@
-﻿#include <stdio.h>
+﻿#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
@@ -8,6 +11,8 @@
 #include <sys/stat.h>
 #include <limits.h>
 #include <time.h>
+#include <signal.h>
+#include "runtime_commands.h"
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -22,6 +27,7 @@ typedef SOCKET sg_socket_t;
 #define sg_mkdir _mkdir
 #define sg_popen _popen
 #define sg_pclose _pclose
+#define SG_HAVE_SOCKET_HANDOFF 0
 #else
 #include <unistd.h>
 #include <fcntl.h>
@@ -29,14 +35,73 @@ typedef SOCKET sg_socket_t;
 #include <strings.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/un.h>
 typedef int sg_socket_t;
 #define SG_INVALID_SOCKET (-1)
 #define sg_close_socket close
 #define sg_mkdir(path) mkdir((path), 0755)
 #define sg_popen popen
 #define sg_pclose pclose
+#define SG_HAVE_SOCKET_HANDOFF 1
+#endif
+
+#if !defined(_WIN32) && defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#define SG_HAVE_EPOLL 1
+#define SG_HAVE_REACTOR_THREADS 1
+#define SG_HAVE_MMSG 1
+#define SG_THREAD_LOCAL __thread
+#else
+#define SG_HAVE_EPOLL 0
+#define SG_HAVE_REACTOR_THREADS 0
+#define SG_HAVE_MMSG 0
+#define SG_THREAD_LOCAL
+#endif
+
+#if SG_HAVE_EPOLL && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+#if SG_HAVE_EPOLL && defined(IORING_RECV_MULTISHOT)
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define SG_HAVE_IO_URING 1
+#else
+#define SG_HAVE_IO_URING 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SG_ATOMIC_ADD(ptr, delta) __atomic_add_fetch((ptr), (delta), __ATOMIC_RELAXED)
+#define SG_ATOMIC_SUB(ptr, delta) __atomic_sub_fetch((ptr), (delta), __ATOMIC_RELAXED)
+#define SG_ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define SG_ATOMIC_CAS(ptr, expected, desired) __atomic_compare_exchange_n((ptr), (expected), (desired), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#define SG_ATOMIC_UNREF(ptr) __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#else
+#define SG_ATOMIC_ADD(ptr, delta) (*(ptr) += (delta))
+#define SG_ATOMIC_SUB(ptr, delta) (*(ptr) -= (delta))
+#define SG_ATOMIC_LOAD(ptr) (*(ptr))
+#define SG_ATOMIC_CAS(ptr, expected, desired) (*(ptr) == *(expected) ? (*(ptr) = (desired), 1) : (*(expected) = *(ptr), 0))
+#define SG_ATOMIC_UNREF(ptr) (--*(ptr))
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SG_HAVE_BSWAP 1
+#define SG_BSWAP64(v) __builtin_bswap64(v)
+#define SG_LITTLE_ENDIAN (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#elif defined(_MSC_VER)
+#define SG_HAVE_BSWAP 1
+#define SG_BSWAP64(v) _byteswap_uint64(v)
+#define SG_LITTLE_ENDIAN 1
+#else
+#define SG_HAVE_BSWAP 0
 #endif
 
 void sengoo_print_i64(long long val) {
@@ -82,6 +147,20 @@ void* sengoo_realloc(void* ptr, long long old_size, long long old_align, long lo
 }
 
 #define SG_MAX_NET_HANDLES 2048
+#define SG_HANDLE_SLOT_BITS 20
+#define SG_HANDLE_SLOT_MASK ((1LL << SG_HANDLE_SLOT_BITS) - 1)
+#define SG_HANDLE_KIND_SHIFT SG_HANDLE_SLOT_BITS
+#define SG_HANDLE_KIND_MASK 0xFLL
+#define SG_HANDLE_REACTOR_SHIFT 24
+#define SG_HANDLE_REACTOR_MASK 0x3FLL
+#define SG_HANDLE_GENERATION_SHIFT 30
+#define SG_HANDLE_GENERATION_MASK 0x7FFFFFFFU
+#define SG_HANDLE_KIND_TCP_LISTENER 1
+#define SG_HANDLE_KIND_TCP_CONNECTION 2
+#define SG_HANDLE_KIND_UDP_SOCKET 3
+#define SG_TCP_CONN_TABLE_INITIAL 256
+#define SG_NOFILE_RESERVE 256
+#define SG_TCP_CONN_SLOT_LIMIT ((int)(SG_HANDLE_SLOT_MASK + 1))
 #define SG_EXTENSION_SYNC_PAYLOAD_MAX 32768
 #define SG_DEFAULT_EXTENSION_REGISTRY_JSON "[{\"name\":\"freekill-core\",\"enabled\":true,\"builtin\":true}]"
 #define SG_EXTENSION_BOOTSTRAP_MAX 256
@@ -92,6 +171,12 @@ void* sengoo_realloc(void* ptr, long long old_size, long long old_align, long lo
 #define SG_EXTENSION_SCRIPT_MAX 4096
 #define SG_EXTENSION_OUTPUT_MAX 2048
 #define SG_TCP_STREAM_BUFFER_MAX 65536
+#define SG_BUFFER_CLASS_COUNT 3
+#define SG_BUFFER_POOL_RETAIN_BYTES (4 * 1024 * 1024)
+#define SG_TCP_OUT_CHUNK_MIN 4096
+#define SG_TCP_OUT_IOV_MAX 64
+#define SG_TCP_CLOSE_LINGER_MS 5000
+#define SG_NOTIFY_HEADER_MAX 160
 #define SG_PACKET_TYPE_REQUEST 0x100
 #define SG_PACKET_TYPE_REPLY 0x200
 #define SG_PACKET_TYPE_NOTIFICATION 0x400
@@ -108,19 +193,90 @@ void* sengoo_realloc(void* ptr, long long old_size, long long old_align, long lo
 #define SG_AUTH_UUID_MAX 256
 #define SG_AUTH_AVATAR_MAX 128
 #define SG_AUTH_LINE_MAX 2048
+#define SG_IO_BACKEND_SCAN 0
+#define SG_IO_BACKEND_EPOLL 1
+#define SG_IO_BACKEND_URING 2
+#define SG_EPOLL_EVENT_BATCH 512
+#define SG_MAX_REACTORS ((int)(SG_HANDLE_REACTOR_MASK + 1))
+#define SG_REACTOR_WAKE_TOKEN 0
+#define SG_REACTOR_MSG_KICK 1
+#define SG_REACTOR_MSG_CLOSE 2
+#define SG_REACTOR_MSG_STOP 3
+#define SG_REACTOR_MSG_FRAME 4
+#define SG_REACTOR_MSG_DRAIN 5
+#define SG_REACTOR_MSG_STOP_ACCEPT 6
+#define SG_URING_SQ_ENTRIES 1024
+#define SG_URING_CQ_ENTRIES 8192
+#define SG_URING_BUF_COUNT 512
+#define SG_URING_BUF_SIZE 4096
+#define SG_URING_BUF_GROUP 0
+#define SG_URING_OP_SHIFT 61
+#define SG_URING_TOKEN_MASK ((1ULL << SG_URING_OP_SHIFT) - 1)
+#define SG_URING_OP_ACCEPT 1ULL
+#define SG_URING_OP_RECV 2ULL
+#define SG_URING_OP_SEND 3ULL
+#define SG_URING_SETTLE_MS 1000
+#define SG_URING_OP_POLL 4ULL
+#define SG_URING_OP_CANCEL 5ULL
+#define SG_URING_RECV_IDLE 0
+#define SG_URING_RECV_ARMED 1
+#define SG_URING_RECV_CANCELLING 2
+#define SG_ACCEPT_BUDGET_MAX 4096
+#define SG_TIMER_TICK_MS 10
+#define SG_TIMER_WHEEL_BITS 6
+#define SG_TIMER_WHEEL_SIZE (1 << SG_TIMER_WHEEL_BITS)
+#define SG_TIMER_WHEEL_MASK (SG_TIMER_WHEEL_SIZE - 1)
+#define SG_TIMER_WHEEL_LEVELS 4
+#define SG_TIMER_WHEEL_SPAN (1LL << (SG_TIMER_WHEEL_BITS * SG_TIMER_WHEEL_LEVELS))
+#define SG_TCP_TIMER_SIGNUP 0
+#define SG_TCP_TIMER_IDLE 1
+#define SG_TCP_TIMER_LINGER 2
+#define SG_TCP_TIMER_COUNT 3
+#define SG_FILE_CACHE_RECHECK_MS 1000
+#define SG_ADMISSION_TABLE_BITS 12
+#define SG_ADMISSION_TABLE_SIZE (1 << SG_ADMISSION_TABLE_BITS)
+#define SG_ADMISSION_PROBE_MAX 8
+#define SG_ADMISSION_LOG_INTERVAL_MS 1000
+#define SG_HANDOFF_MAGIC 0x464b5550u
+#define SG_CBOR_FIELD_MAX 9
+#define SG_HANDOFF_POLL_INTERVAL_MS 200
+#define SG_CONSOLE_CLOSE_WAIT_MS 4500
+#define SG_CONSOLE_CLOSE_DRAIN_MS 3000
+#define SG_CBOR_DOC_MAX_DEPTH 16
+#define SG_CBOR_DOC_MAX_NODES 4096
+#define SG_CBOR_ARENA_BLOCK_MIN 64
+#define SG_CBOR_ARENA_BLOCK_MAX 1024
+#define SG_CBOR_NODE_INT 1
+#define SG_CBOR_NODE_BYTES 2
+#define SG_CBOR_NODE_TEXT 3
+#define SG_CBOR_NODE_ARRAY 4
+#define SG_CBOR_NODE_MAP 5
+#define SG_CBOR_NODE_TAG 6
+#define SG_CBOR_NODE_FLOAT 7
+#define SG_CBOR_NODE_BOOL 8
+#define SG_CBOR_NODE_NULL 9
+#define SG_CBOR_NODE_UNDEFINED 10
+#define SG_CBOR_NODE_SIMPLE 11
+#define SG_UDP_BATCH_MAX 64
+#define SG_UDP_REPLY_MAX 2304
+#define SG_UDP_REPLY_DETECT 1
+#define SG_UDP_REPLY_DETAIL 2
+#define SG_UDP_REPLY_ECHO 3
 
 typedef struct {
     long long handle;
     sg_socket_t socket;
     int used;
+    unsigned int generation;
+    int next_free;
 } sg_socket_entry;
 
 typedef struct {
-    int used;
-    long long handle;
-    size_t len;
-    unsigned char data[SG_TCP_STREAM_BUFFER_MAX];
-} sg_tcp_stream_state;
+    int kind;
+    int free_head;
+    int high_water;
+    sg_socket_entry entries[SG_MAX_NET_HANDLES];
+} sg_socket_table;
 
 typedef struct {
     long long request_id;
@@ -137,16 +293,236 @@ typedef struct {
 } sg_cbor_wire_packet;
 
 typedef struct {
-    int used;
+    int field;
+    int field_count;
+    size_t offset;
+    size_t need;
+    long long ints[4];
+    int string_major[2];
+    size_t string_at[2];
+    size_t string_len[2];
+} sg_wire_parse_state;
+
+typedef struct {
+    int payload_major;
+    const unsigned char* payload_ptr;
+    size_t payload_len;
+    int close_after_reply;
+} sg_command_reply;
+
+typedef struct sg_cbor_node {
+    int kind;
+    long long int_value;
+    double float_value;
+    unsigned long long tag;
+    const unsigned char* ptr;
+    size_t len;
+    struct sg_cbor_node* child;
+    struct sg_cbor_node* next;
+} sg_cbor_node;
+
+typedef struct sg_cbor_arena_block {
+    struct sg_cbor_arena_block* next;
+    size_t used;
+    size_t cap;
+    sg_cbor_node nodes[];
+} sg_cbor_arena_block;
+
+typedef struct {
+    sg_cbor_node* inline_nodes;
+    size_t inline_used;
+    size_t inline_cap;
+    sg_cbor_arena_block* blocks;
+    size_t node_count;
+    size_t max_nodes;
+} sg_cbor_arena;
+
+typedef struct {
+    const unsigned char* data;
+    size_t len;
+    size_t idx;
+    sg_cbor_arena* arena;
+} sg_cbor_doc_reader;
+
+typedef struct {
+    long long refs;
+    size_t len;
+    unsigned char data[];
+} sg_frame;
+
+typedef struct sg_out_chunk {
+    struct sg_out_chunk* next;
+    sg_frame* frame;
+    unsigned char* base;
+    size_t offset;
+    size_t len;
+    size_t cap;
+    unsigned char data[];
+} sg_out_chunk;
+
+typedef struct sg_timer {
+    struct sg_timer* next;
+    struct sg_timer** pprev;
+    long long expires_tick;
+    long long owner;
+    int kind;
+} sg_timer;
+
+typedef struct {
+    sg_timer* slots[SG_TIMER_WHEEL_LEVELS][SG_TIMER_WHEEL_SIZE];
+    long long current_tick;
+    long long next_tick;
+    int next_tick_valid;
+    int count;
+} sg_timer_wheel;
+
+typedef struct {
+    long long player_id;
+    char player_name[SG_AUTH_NAME_MAX];
+    long long login_seq;
+    long long accepted_at_ms;
+    long long last_activity_ms;
+    sg_timer timers[SG_TCP_TIMER_COUNT];
+} sg_tcp_conn_cold;
+
+typedef struct {
     long long handle;
+    sg_socket_t socket;
+    size_t stream_head;
+    size_t stream_tail;
+    size_t stream_cap;
+    unsigned char* stream_data;
+    int stream_class;
+    sg_wire_parse_state parse;
+    sg_out_chunk* out_head;
+    sg_out_chunk* out_tail;
+    size_t out_bytes;
+    int cork_depth;
+    int read_paused;
+    int close_after_flush;
+    int recv_state;
+    int send_inflight;
+    int flush_queued;
+    int input_pending;
+    int pending_queued;
+    int write_shut;
+    long long budget_tick;
+    int budget_frames;
+    size_t budget_bytes;
+    unsigned int starved_ticks;
     int network_delay_sent;
     int setup_received;
     int auth_passed;
+    sg_tcp_conn_cold cold;
+} sg_tcp_conn;
+
+typedef struct sg_pool_buffer {
+    struct sg_pool_buffer* next;
+} sg_pool_buffer;
+
+typedef struct {
+    sg_pool_buffer* free_list;
+    int free_count;
+    int borrowed_count;
+    int peak_borrowed;
+    long long borrow_total;
+    long long alloc_total;
+} sg_buffer_class;
+
+typedef struct {
+    sg_tcp_conn* conn;
+    unsigned int generation;
+    int next_free;
+} sg_tcp_conn_slot;
+
+typedef struct {
+    sg_tcp_conn_slot* slots;
+    int capacity;
+    int high_water;
+    int free_head;
+    int active_count;
+} sg_tcp_conn_table;
+
+typedef struct sg_reactor_msg {
+    struct sg_reactor_msg* next;
+    int type;
+    long long handle;
     long long player_id;
     char player_name[SG_AUTH_NAME_MAX];
-    long long accepted_at_ms;
-    long long last_activity_ms;
-} sg_auth_state;
+    sg_frame* frame;
+} sg_reactor_msg;
+
+#if SG_HAVE_IO_URING
+typedef struct {
+    int fd;
+    unsigned int* sq_head;
+    unsigned int* sq_tail;
+    unsigned int* sq_mask;
+    unsigned int* sq_array;
+    unsigned int sq_entries;
+    unsigned int sq_local_tail;
+    unsigned int sq_unsubmitted;
+    struct io_uring_sqe* sqes;
+    unsigned int* cq_head;
+    unsigned int* cq_tail;
+    unsigned int* cq_mask;
+    struct io_uring_cqe* cqes;
+    void* ring_map;
+    size_t ring_map_size;
+    void* sqe_map;
+    size_t sqe_map_size;
+    struct io_uring_buf_ring* buf_ring;
+    size_t buf_ring_size;
+    unsigned char* buf_base;
+    unsigned short buf_tail;
+    long long* flush_handles;
+    int flush_count;
+    int flush_cap;
+} sg_uring;
+#endif
+
+typedef struct {
+    int index;
+    sg_tcp_conn_table connections;
+    sg_buffer_class buffer_pool[SG_BUFFER_CLASS_COUNT];
+    long long buffer_pool_stats_last_ms;
+    long long buffer_pool_stats_last_borrow_total;
+    long long broadcast_count;
+    long long broadcast_bytes;
+    long long broadcast_queued;
+    long long broadcast_forwarded;
+    long long command_counts[SG_COMMAND_COUNT];
+    size_t out_queued_bytes;
+    sg_timer_wheel timers;
+    long long tick_seq;
+    long long* pending_handles;
+    int pending_count;
+    int pending_cap;
+    long long listener_handle;
+    long long accept_budget;
+    int stopping;
+    int draining;
+    int accept_stopped;
+    long long closed_on_stop;
+    int send_orphans;
+#if SG_HAVE_EPOLL
+    int epoll_fd;
+    struct epoll_event epoll_events[SG_EPOLL_EVENT_BATCH];
+    int epoll_ready_count;
+    int epoll_ready_pending;
+#endif
+#if SG_HAVE_IO_URING
+    sg_uring uring;
+#endif
+#if SG_HAVE_REACTOR_THREADS
+    int wake_fd;
+    pthread_mutex_t mailbox_lock;
+    sg_reactor_msg* mailbox_head;
+    sg_reactor_msg* mailbox_tail;
+    pthread_t thread;
+    int thread_started;
+#endif
+} sg_reactor;
 
 typedef struct {
     char name[SG_AUTH_NAME_MAX];
@@ -180,14 +556,131 @@ typedef struct {
     char hash[SG_EXTENSION_HASH_MAX];
 } sg_extension_bootstrap_entry;
 
-static sg_socket_entry g_tcp_listeners[SG_MAX_NET_HANDLES];
-static sg_socket_entry g_tcp_connections[SG_MAX_NET_HANDLES];
-static sg_socket_entry g_udp_sockets[SG_MAX_NET_HANDLES];
-static sg_tcp_stream_state g_tcp_streams[SG_MAX_NET_HANDLES];
-static sg_auth_state g_auth_states[SG_MAX_NET_HANDLES];
-static long long g_next_handle = 1000000;
+typedef struct {
+    char* recv_data;
+    size_t recv_slot_cap;
+    int recv_slot_count;
+    int batch_size;
+    char reply_data[SG_UDP_BATCH_MAX][SG_UDP_REPLY_MAX];
+    const char* reply_ptr[SG_UDP_BATCH_MAX];
+    int reply_len[SG_UDP_BATCH_MAX];
+    struct sockaddr_in peers[SG_UDP_BATCH_MAX];
+#if SG_HAVE_MMSG
+    struct iovec recv_iov[SG_UDP_BATCH_MAX];
+    struct mmsghdr recv_msgs[SG_UDP_BATCH_MAX];
+    struct iovec send_iov[SG_UDP_BATCH_MAX];
+    struct mmsghdr send_msgs[SG_UDP_BATCH_MAX];
+#endif
+    long long batch_total;
+    long long recv_total;
+    long long reply_total;
+    long long drop_total;
+    int peak_batch;
+} sg_udp_batch;
+
+typedef struct {
+    int ready;
+    size_t prefix_len;
+    char prefix[1792];
+} sg_udp_detail_cache;
+
+typedef struct {
+    char path[1024];
+    long long checked_ms;
+    long long mtime;
+    long long size;
+    char* data;
+    size_t len;
+    unsigned long long version;
+} sg_file_cache;
+
+typedef struct {
+    uint32_t ip;
+    int tokens_milli;
+    long long refill_ms;
+} sg_admission_entry;
+
+typedef struct {
+    int ready;
+    int ip_rate;
+    int ip_burst;
+    int global_rate;
+    int global_burst;
+    int limit_loopback;
+    long long global_tokens_milli;
+    long long global_refill_ms;
+    long long rejected_ip;
+    long long rejected_global;
+    long long rejected_logged;
+    long long last_log_ms;
+    sg_admission_entry entries[SG_ADMISSION_TABLE_SIZE];
+} sg_admission_table;
+
+typedef struct {
+    uint32_t magic;
+    int32_t port;
+    int32_t tcp_count;
+    int32_t udp_port;
+} sg_handoff_header;
+
+typedef struct {
+    int ready;
+    int enabled;
+    int inherit_attempted;
+    int handed_off;
+    char path[108];
+    sg_socket_t control;
+    long long next_poll_ms;
+    sg_socket_t peer;
+    int peer_stage;
+    long long peer_deadline_ms;
+    size_t request_got;
+    sg_handoff_header request;
+    long long port;
+    long long udp_handle;
+    long long udp_port;
+    int inherited_tcp_count;
+    int inherited_tcp_next;
+    sg_socket_t inherited_tcp[SG_MAX_REACTORS];
+    sg_socket_t inherited_udp;
+    int inherited_udp_port;
+} sg_handoff_state;
+
+static sg_socket_table g_tcp_listeners = { SG_HANDLE_KIND_TCP_LISTENER, 0, 0, { { 0 } } };
+static sg_socket_table g_udp_sockets = { SG_HANDLE_KIND_UDP_SOCKET, 0, 0, { { 0 } } };
+static const size_t g_buffer_class_sizes[SG_BUFFER_CLASS_COUNT] = { 4096, 16384, SG_TCP_STREAM_BUFFER_MAX };
+static sg_reactor g_reactors[SG_MAX_REACTORS];
+static sg_udp_batch g_udp_batch;
+static sg_udp_detail_cache g_udp_detail_cache;
+static sg_file_cache g_ban_ip_file_cache;
+static sg_file_cache g_temp_ban_ip_file_cache;
+static sg_file_cache g_ban_uuid_file_cache;
+static sg_file_cache g_rsa_public_key_cache;
+static sg_admission_table g_admission;
+static sg_handoff_state g_handoff;
+static sg_frame* g_network_delay_frame = NULL;
+static unsigned long long g_network_delay_frame_version = 0;
+static int g_reactor_count = 1;
+static SG_THREAD_LOCAL sg_reactor* g_reactor = &g_reactors[0];
+static int g_tcp_active_total = 0;
+static long long g_login_seq = 0;
+static int g_tcp_peak_total = 0;
+static int g_tcp_capacity = 0;
+static int g_tcp_send_limits_ready = 0;
+static size_t g_tcp_send_high_watermark = 0;
+static size_t g_tcp_send_low_watermark = 0;
+static size_t g_tcp_send_budget = 0;
+static int g_tcp_input_limits_ready = 0;
+static int g_tcp_frames_per_tick = 0;
+static size_t g_tcp_read_bytes_per_tick = 0;
 static int g_net_init_logged = 0;
+static volatile sig_atomic_t g_shutdown_requested = 0;
+static volatile sig_atomic_t g_shutdown_console_close = 0;
+#ifdef _WIN32
+static HANDLE g_shutdown_done_event = NULL;
+#endif
 static char g_extension_sync_payload[SG_EXTENSION_SYNC_PAYLOAD_MAX];
+static sg_frame* g_extension_sync_frame = NULL;
 static sg_extension_bootstrap_entry g_extension_bootstrap_entries[SG_EXTENSION_BOOTSTRAP_MAX];
 static unsigned int g_extension_bootstrap_generation = 0;
 static int g_extension_bootstrap_lua_missing_logged = 0;
@@ -200,7 +693,21 @@ static int g_extension_shutdown_hooks_emitted = 0;
 static int g_auth_whitelist_missing_logged = 0;
 static int g_auth_ban_words_missing_logged = 0;
 static int g_auth_rsa_decrypt_error_logged = 0;
+static int g_io_backend = SG_IO_BACKEND_SCAN;
+static int g_io_backend_ready = 0;
+#if SG_HAVE_REACTOR_THREADS
+static pthread_mutex_t g_runtime_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 static size_t sg_build_update_package_summary(unsigned char* out, size_t out_cap);
+static void sg_poller_remove(sg_socket_t s);
+static int sg_would_block(void);
+static int sg_tcp_idle_timeout_ms(void);
+static int sg_parse_positive_env_i32(const char* key, int fallback);
+static void sg_admission_init(void);
+static void sg_reactor_stop_accept(void);
+#if SG_HAVE_IO_URING
+static void sg_uring_update_recv(sg_tcp_conn* conn);
+#endif
 
 static void sg_logf(const char* level, const char* module, const char* fmt, ...) {
     char timestamp[32];
@@ -255,4158 +762,7809 @@ static long long sg_monotonic_ms(void) {
 #endif
 }
 
-static sg_tcp_stream_state* sg_tcp_stream_find(long long handle) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (g_tcp_streams[i].used && g_tcp_streams[i].handle == handle) {
-            return &g_tcp_streams[i];
-        }
+static int sg_handle_slot(long long handle) {
+    if (handle <= 0) {
+        return -1;
     }
-    return NULL;
+    return (int)(handle & SG_HANDLE_SLOT_MASK);
 }
 
-static int sg_tcp_stream_attach(long long handle) {
-    sg_tcp_stream_state* existing = sg_tcp_stream_find(handle);
-    if (existing != NULL) {
-        existing->len = 0;
-        return 1;
-    }
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (!g_tcp_streams[i].used) {
-            g_tcp_streams[i].used = 1;
-            g_tcp_streams[i].handle = handle;
-            g_tcp_streams[i].len = 0;
-            return 1;
-        }
+static int sg_handle_reactor(long long handle) {
+    if (handle <= 0) {
+        return -1;
     }
-    return 0;
+    return (int)((handle >> SG_HANDLE_REACTOR_SHIFT) & SG_HANDLE_REACTOR_MASK);
 }
 
-static void sg_tcp_stream_detach(long long handle) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (g_tcp_streams[i].used && g_tcp_streams[i].handle == handle) {
-            g_tcp_streams[i].used = 0;
-            g_tcp_streams[i].handle = 0;
-            g_tcp_streams[i].len = 0;
-            return;
-        }
+static int sg_handle_is_tcp_connection(long long handle) {
+    return handle > 0 &&
+        ((handle >> SG_HANDLE_KIND_SHIFT) & SG_HANDLE_KIND_MASK) == SG_HANDLE_KIND_TCP_CONNECTION &&
+        ((handle >> SG_HANDLE_GENERATION_SHIFT) & SG_HANDLE_GENERATION_MASK) != 0;
+}
+
+static long long sg_handle_encode(int kind, int reactor, int slot, unsigned int generation) {
+    return ((long long)generation << SG_HANDLE_GENERATION_SHIFT)
+        | (((long long)reactor & SG_HANDLE_REACTOR_MASK) << SG_HANDLE_REACTOR_SHIFT)
+        | (((long long)kind & SG_HANDLE_KIND_MASK) << SG_HANDLE_KIND_SHIFT)
+        | (long long)slot;
+}
+
+static int sg_store_socket(sg_socket_table* table, sg_socket_t s, long long* out_handle) {
+    int slot = -1;
+    if (table->free_head > 0) {
+        slot = table->free_head - 1;
+        table->free_head = table->entries[slot].next_free;
+    } else if (table->high_water < SG_MAX_NET_HANDLES) {
+        slot = table->high_water;
+        table->high_water += 1;
+    } else {
+        return 0;
+    }
+    sg_socket_entry* entry = &table->entries[slot];
+    entry->generation = (entry->generation + 1) & SG_HANDLE_GENERATION_MASK;
+    if (entry->generation == 0) {
+        entry->generation = 1;
     }
+    entry->used = 1;
+    entry->next_free = 0;
+    entry->handle = sg_handle_encode(table->kind, 0, slot, entry->generation);
+    entry->socket = s;
+    *out_handle = entry->handle;
+    return 1;
 }
 
-static sg_auth_state* sg_auth_state_find(long long handle) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (g_auth_states[i].used && g_auth_states[i].handle == handle) {
-            return &g_auth_states[i];
-        }
+static sg_socket_entry* sg_find_socket(sg_socket_table* table, long long handle) {
+    int slot = sg_handle_slot(handle);
+    if (slot < 0 || slot >= SG_MAX_NET_HANDLES) {
+        return NULL;
     }
-    return NULL;
+    sg_socket_entry* entry = &table->entries[slot];
+    if (!entry->used || entry->handle != handle) {
+        return NULL;
+    }
+    return entry;
 }
 
-static int sg_auth_state_attach(long long handle) {
-    long long now_ms = sg_monotonic_ms();
-    sg_auth_state* existing = sg_auth_state_find(handle);
-    if (existing != NULL) {
-        existing->network_delay_sent = 0;
-        existing->setup_received = 0;
-        existing->auth_passed = 0;
-        existing->player_id = 0;
-        existing->player_name[0] = '\0';
-        existing->accepted_at_ms = now_ms;
-        existing->last_activity_ms = now_ms;
-        return 1;
+static int sg_remove_socket(sg_socket_table* table, long long handle, int close_now) {
+    sg_socket_entry* entry = sg_find_socket(table, handle);
+    if (entry == NULL) {
+        return 0;
     }
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (!g_auth_states[i].used) {
-            g_auth_states[i].used = 1;
-            g_auth_states[i].handle = handle;
-            g_auth_states[i].network_delay_sent = 0;
-            g_auth_states[i].setup_received = 0;
-            g_auth_states[i].auth_passed = 0;
-            g_auth_states[i].player_id = 0;
-            g_auth_states[i].player_name[0] = '\0';
-            g_auth_states[i].accepted_at_ms = now_ms;
-            g_auth_states[i].last_activity_ms = now_ms;
-            return 1;
-        }
+    sg_socket_t s = entry->socket;
+    entry->used = 0;
+    entry->handle = 0;
+    entry->socket = SG_INVALID_SOCKET;
+    entry->next_free = table->free_head;
+    table->free_head = (int)(entry - table->entries) + 1;
+    if (close_now && s != SG_INVALID_SOCKET) {
+        sg_poller_remove(s);
+        sg_close_socket(s);
     }
-    return 0;
+    return 1;
 }
 
-static void sg_auth_state_detach(long long handle) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (g_auth_states[i].used && g_auth_states[i].handle == handle) {
-            g_auth_states[i].used = 0;
-            g_auth_states[i].handle = 0;
-            g_auth_states[i].network_delay_sent = 0;
-            g_auth_states[i].setup_received = 0;
-            g_auth_states[i].auth_passed = 0;
-            g_auth_states[i].player_id = 0;
-            g_auth_states[i].player_name[0] = '\0';
-            g_auth_states[i].accepted_at_ms = 0;
-            g_auth_states[i].last_activity_ms = 0;
-            return;
+static int sg_buffer_class_for(size_t need) {
+    for (int i = 0; i < SG_BUFFER_CLASS_COUNT; i++) {
+        if (need <= g_buffer_class_sizes[i]) {
+            return i;
         }
     }
+    return -1;
 }
 
-static int sg_send_all(sg_socket_t socket, const unsigned char* data, size_t len) {
-    size_t sent_total = 0;
-    while (sent_total < len) {
-        int sent = send(socket, (const char*)(data + sent_total), (int)(len - sent_total), 0);
-        if (sent <= 0) {
-            return 0;
+static unsigned char* sg_buffer_pool_borrow(int class_index) {
+    sg_buffer_class* pool = &g_reactor->buffer_pool[class_index];
+    unsigned char* buffer = NULL;
+    if (pool->free_list != NULL) {
+        sg_pool_buffer* node = pool->free_list;
+        pool->free_list = node->next;
+        pool->free_count -= 1;
+        buffer = (unsigned char*)node;
+    } else {
+        buffer = (unsigned char*)malloc(g_buffer_class_sizes[class_index]);
+        if (buffer == NULL) {
+            return NULL;
         }
-        sent_total += (size_t)sent;
+        pool->alloc_total += 1;
     }
-    return 1;
+    pool->borrowed_count += 1;
+    pool->borrow_total += 1;
+    if (pool->borrowed_count > pool->peak_borrowed) {
+        pool->peak_borrowed = pool->borrowed_count;
+    }
+    return buffer;
 }
 
-static int sg_cbor_read_length_by_ai(const unsigned char* data, size_t len, size_t* idx, int ai, unsigned long long* out) {
-    if (data == NULL || idx == NULL || out == NULL) {
-        return -1;
+static void sg_buffer_pool_release(int class_index, unsigned char* buffer) {
+    if (buffer == NULL || class_index < 0 || class_index >= SG_BUFFER_CLASS_COUNT) {
+        return;
     }
-    if (ai < 24) {
-        *out = (unsigned long long)ai;
-        return 1;
+    sg_buffer_class* pool = &g_reactor->buffer_pool[class_index];
+    pool->borrowed_count -= 1;
+    if ((size_t)(pool->free_count + 1) * g_buffer_class_sizes[class_index] > SG_BUFFER_POOL_RETAIN_BYTES) {
+        free(buffer);
+        return;
     }
-    if (ai == 24) {
-        if (*idx + 1 > len) {
-            return 0;
-        }
-        *out = (unsigned long long)data[*idx];
-        *idx += 1;
+    sg_pool_buffer* node = (sg_pool_buffer*)buffer;
+    node->next = pool->free_list;
+    pool->free_list = node;
+    pool->free_count += 1;
+}
+
+static int sg_tcp_conn_reserve(sg_tcp_conn* conn, size_t need) {
+    if (need <= conn->stream_cap) {
         return 1;
     }
-    if (ai == 25) {
-        if (*idx + 2 > len) {
-            return 0;
-        }
-        *out = ((unsigned long long)data[*idx] << 8) | (unsigned long long)data[*idx + 1];
-        *idx += 2;
-        return 1;
+    int class_index = sg_buffer_class_for(need);
+    if (class_index < 0) {
+        return 0;
     }
-    if (ai == 26) {
-        if (*idx + 4 > len) {
-            return 0;
-        }
-        *out =
-            ((unsigned long long)data[*idx] << 24) |
-            ((unsigned long long)data[*idx + 1] << 16) |
-            ((unsigned long long)data[*idx + 2] << 8) |
-            (unsigned long long)data[*idx + 3];
-        *idx += 4;
+    unsigned char* buffer = sg_buffer_pool_borrow(class_index);
+    if (buffer == NULL) {
+        return 0;
+    }
+    size_t buffered = conn->stream_tail - conn->stream_head;
+    if (buffered > 0) {
+        memcpy(buffer, conn->stream_data + conn->stream_head, buffered);
+    }
+    sg_buffer_pool_release(conn->stream_class, conn->stream_data);
+    conn->stream_head = 0;
+    conn->stream_tail = buffered;
+    conn->stream_data = buffer;
+    conn->stream_cap = g_buffer_class_sizes[class_index];
+    conn->stream_class = class_index;
+    return 1;
+}
+
+static int sg_tcp_conn_make_room(sg_tcp_conn* conn, size_t incoming) {
+    if (conn->stream_data != NULL && conn->stream_tail + incoming <= conn->stream_cap) {
         return 1;
     }
-    if (ai == 27) {
-        if (*idx + 8 > len) {
-            return 0;
+    size_t buffered = conn->stream_tail - conn->stream_head;
+    if (conn->stream_head > 0) {
+        memmove(conn->stream_data, conn->stream_data + conn->stream_head, buffered);
+        conn->stream_head = 0;
+        conn->stream_tail = buffered;
+        if (buffered + incoming <= conn->stream_cap) {
+            return 1;
         }
-        *out =
-            ((unsigned long long)data[*idx] << 56) |
-            ((unsigned long long)data[*idx + 1] << 48) |
-            ((unsigned long long)data[*idx + 2] << 40) |
-            ((unsigned long long)data[*idx + 3] << 32) |
-            ((unsigned long long)data[*idx + 4] << 24) |
-            ((unsigned long long)data[*idx + 5] << 16) |
-            ((unsigned long long)data[*idx + 6] << 8) |
-            (unsigned long long)data[*idx + 7];
-        *idx += 8;
-        return 1;
     }
-    return -1;
+    return sg_tcp_conn_reserve(conn, buffered + incoming);
 }
 
-static int sg_cbor_read_signed_integer(const unsigned char* data, size_t len, size_t* idx, long long* out) {
-    if (data == NULL || idx == NULL || out == NULL) {
-        return -1;
+static void sg_tcp_conn_release_buffer(sg_tcp_conn* conn) {
+    if (conn->stream_data == NULL || conn->stream_tail > conn->stream_head) {
+        return;
     }
-    if (*idx >= len) {
+    sg_buffer_pool_release(conn->stream_class, conn->stream_data);
+    conn->stream_data = NULL;
+    conn->stream_cap = 0;
+    conn->stream_class = -1;
+}
+
+static int sg_tcp_conn_table_reserve(sg_tcp_conn_table* table, int next_capacity) {
+    int capacity = table->capacity;
+    if (next_capacity > SG_TCP_CONN_SLOT_LIMIT) {
+        next_capacity = SG_TCP_CONN_SLOT_LIMIT;
+    }
+    if (next_capacity <= capacity) {
         return 0;
     }
-    unsigned char head = data[*idx];
-    int major = (head >> 5) & 0x07;
-    int ai = head & 0x1f;
-    if (major != 0 && major != 1) {
-        return -1;
+    sg_tcp_conn_slot* slots = (sg_tcp_conn_slot*)realloc(table->slots, (size_t)next_capacity * sizeof(sg_tcp_conn_slot));
+    if (slots == NULL) {
+        return 0;
     }
-    *idx += 1;
-    unsigned long long uval = 0;
-    int len_rc = sg_cbor_read_length_by_ai(data, len, idx, ai, &uval);
-    if (len_rc <= 0) {
-        return len_rc;
+    memset(slots + capacity, 0, (size_t)(next_capacity - capacity) * sizeof(sg_tcp_conn_slot));
+    table->slots = slots;
+    table->capacity = next_capacity;
+    return 1;
+}
+
+static int sg_tcp_conn_table_grow(void) {
+    int capacity = g_reactor->connections.capacity;
+    return sg_tcp_conn_table_reserve(&g_reactor->connections, capacity > 0 ? capacity * 2 : SG_TCP_CONN_TABLE_INITIAL);
+}
+
+static void sg_timer_wheel_link(sg_timer_wheel* wheel, sg_timer* timer) {
+    long long delta = timer->expires_tick - wheel->current_tick;
+    if (delta < 0) {
+        delta = 0;
+        timer->expires_tick = wheel->current_tick;
+    } else if (delta >= SG_TIMER_WHEEL_SPAN) {
+        delta = SG_TIMER_WHEEL_SPAN - 1;
+        timer->expires_tick = wheel->current_tick + delta;
     }
-    if (uval > (unsigned long long)LLONG_MAX) {
-        return -1;
+    int level = 0;
+    while (level < SG_TIMER_WHEEL_LEVELS - 1 && delta >= (1LL << (SG_TIMER_WHEEL_BITS * (level + 1)))) {
+        level += 1;
     }
-    if (major == 0) {
-        *out = (long long)uval;
-    } else {
-        *out = -1 - (long long)uval;
+    int index = (int)((timer->expires_tick >> (SG_TIMER_WHEEL_BITS * level)) & SG_TIMER_WHEEL_MASK);
+    sg_timer** head = &wheel->slots[level][index];
+    timer->next = *head;
+    if (*head != NULL) {
+        (*head)->pprev = &timer->next;
     }
-    return 1;
+    *head = timer;
+    timer->pprev = head;
 }
 
-static int sg_cbor_read_bytes_like(
-    const unsigned char* data,
-    size_t len,
-    size_t* idx,
-    int* out_major,
-    const unsigned char** out_ptr,
-    size_t* out_len
-) {
-    if (data == NULL || idx == NULL || out_major == NULL || out_ptr == NULL || out_len == NULL) {
-        return -1;
-    }
-    if (*idx >= len) {
-        return 0;
+static void sg_timer_cancel(sg_timer* timer) {
+    if (timer->pprev == NULL) {
+        return;
     }
-    unsigned char head = data[*idx];
-    int major = (head >> 5) & 0x07;
-    int ai = head & 0x1f;
-    if (major != 2 && major != 3) {
-        return -1;
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
     }
-    *idx += 1;
-    unsigned long long blen = 0;
-    int len_rc = sg_cbor_read_length_by_ai(data, len, idx, ai, &blen);
-    if (len_rc <= 0) {
-        return len_rc;
+    timer->next = NULL;
+    timer->pprev = NULL;
+    g_reactor->timers.count -= 1;
+    g_reactor->timers.next_tick_valid = 0;
+}
+
+static void sg_timer_arm(sg_timer* timer, long long owner, int kind, long long expires_ms) {
+    sg_timer_wheel* wheel = &g_reactor->timers;
+    sg_timer_cancel(timer);
+    if (wheel->count == 0) {
+        long long now_tick = sg_monotonic_ms() / SG_TIMER_TICK_MS;
+        if (now_tick > wheel->current_tick) {
+            wheel->current_tick = now_tick;
+        }
     }
-    if (blen > (unsigned long long)(len - *idx)) {
-        return 0;
+    timer->owner = owner;
+    timer->kind = kind;
+    timer->expires_tick = (expires_ms + SG_TIMER_TICK_MS - 1) / SG_TIMER_TICK_MS;
+    sg_timer_wheel_link(wheel, timer);
+    wheel->count += 1;
+    if (wheel->next_tick_valid && timer->expires_tick < wheel->next_tick) {
+        wheel->next_tick = timer->expires_tick;
     }
-    *out_major = major;
-    *out_ptr = data + *idx;
-    *out_len = (size_t)blen;
-    *idx += (size_t)blen;
-    return 1;
 }
 
-static int sg_cbor_parse_wire_packet(
-    const unsigned char* data,
-    size_t len,
-    sg_cbor_wire_packet* out,
-    size_t* consumed
-) {
-    if (data == NULL || out == NULL || consumed == NULL) {
-        return -1;
-    }
-    if (len == 0) {
+static long long sg_timer_wheel_next_tick(sg_timer_wheel* wheel) {
+    if (wheel->count == 0) {
         return 0;
     }
+    if (wheel->next_tick_valid) {
+        return wheel->next_tick;
+    }
+    long long best = 0;
+    for (int level = 0; level < SG_TIMER_WHEEL_LEVELS; level++) {
+        int shift = SG_TIMER_WHEEL_BITS * level;
+        long long window = wheel->current_tick >> shift;
+        long long low_mask = (1LL << shift) - 1;
+        for (int k = 0; k <= SG_TIMER_WHEEL_SIZE; k++) {
+            long long candidate_window = window + k;
+            if (wheel->slots[level][candidate_window & SG_TIMER_WHEEL_MASK] == NULL) {
+                continue;
+            }
+            long long tick = candidate_window << shift;
+            if (level > 0 && k == 0 && (wheel->current_tick & low_mask) != 0) {
+                continue;
+            }
+            if (tick < wheel->current_tick) {
+                tick = wheel->current_tick;
+            }
+            if (best == 0 || tick < best) {
+                best = tick;
+            }
+            break;
+        }
+    }
+    wheel->next_tick = best;
+    wheel->next_tick_valid = 1;
+    return best;
+}
 
-    size_t idx = 0;
-    unsigned char head = data[idx];
-    int major = (head >> 5) & 0x07;
-    int ai = head & 0x1f;
-    if (major != 4) {
-        return -1;
+static long long sg_timer_wheel_next_expiry_ms(void) {
+    long long tick = sg_timer_wheel_next_tick(&g_reactor->timers);
+    return tick > 0 ? tick * SG_TIMER_TICK_MS : 0;
+}
+
+static void sg_timer_wheel_cascade(sg_timer_wheel* wheel) {
+    for (int level = 1; level < SG_TIMER_WHEEL_LEVELS; level++) {
+        int shift = SG_TIMER_WHEEL_BITS * level;
+        if ((wheel->current_tick & ((1LL << shift) - 1)) != 0) {
+            break;
+        }
+        int index = (int)((wheel->current_tick >> shift) & SG_TIMER_WHEEL_MASK);
+        sg_timer* list = wheel->slots[level][index];
+        wheel->slots[level][index] = NULL;
+        while (list != NULL) {
+            sg_timer* next = list->next;
+            sg_timer_wheel_link(wheel, list);
+            list = next;
+        }
     }
-    idx += 1;
+}
 
-    unsigned long long field_count = 0;
-    int len_rc = sg_cbor_read_length_by_ai(data, len, &idx, ai, &field_count);
-    if (len_rc <= 0) {
-        return len_rc;
+static sg_timer* sg_timer_wheel_pop_expired(long long now_ms) {
+    sg_timer_wheel* wheel = &g_reactor->timers;
+    long long target_tick = now_ms / SG_TIMER_TICK_MS;
+    while (wheel->count > 0 && wheel->current_tick <= target_tick) {
+        int index = (int)(wheel->current_tick & SG_TIMER_WHEEL_MASK);
+        sg_timer* timer = wheel->slots[0][index];
+        if (timer != NULL) {
+            sg_timer_cancel(timer);
+            return timer;
+        }
+        long long next_tick = sg_timer_wheel_next_tick(wheel);
+        if (next_tick > wheel->current_tick + 1) {
+            wheel->current_tick = (next_tick <= target_tick ? next_tick : target_tick + 1);
+        } else {
+            wheel->current_tick += 1;
+        }
+        wheel->next_tick_valid = 0;
+        sg_timer_wheel_cascade(wheel);
     }
-    if (field_count != 4 && field_count != 6) {
-        return -1;
+    if (wheel->count == 0 && wheel->current_tick <= target_tick) {
+        wheel->current_tick = target_tick + 1;
     }
+    return NULL;
+}
 
-    long long request_id = 0;
-    long long packet_type = 0;
-    long long timeout = 0;
-    long long timestamp = 0;
-    int command_major = 0;
-    int payload_major = 0;
-    const unsigned char* command_ptr = NULL;
-    const unsigned char* payload_ptr = NULL;
-    size_t command_len = 0;
-    size_t payload_len = 0;
+static void sg_tcp_conn_cancel_timers(sg_tcp_conn* conn) {
+    for (int i = 0; i < SG_TCP_TIMER_COUNT; i++) {
+        sg_timer_cancel(&conn->cold.timers[i]);
+    }
+}
 
-    int rc = sg_cbor_read_signed_integer(data, len, &idx, &request_id);
-    if (rc <= 0) {
-        return rc;
+static sg_tcp_conn* sg_tcp_conn_open(sg_socket_t s) {
+    if (g_reactor->connections.free_head == 0 &&
+        g_reactor->connections.high_water >= g_reactor->connections.capacity &&
+        !sg_tcp_conn_table_grow()) {
+        return NULL;
     }
-    rc = sg_cbor_read_signed_integer(data, len, &idx, &packet_type);
-    if (rc <= 0) {
-        return rc;
+    sg_tcp_conn* conn = (sg_tcp_conn*)malloc(sizeof(sg_tcp_conn));
+    if (conn == NULL) {
+        return NULL;
     }
-    rc = sg_cbor_read_bytes_like(data, len, &idx, &command_major, &command_ptr, &command_len);
-    if (rc <= 0) {
-        return rc;
+
+    int slot = 0;
+    if (g_reactor->connections.free_head > 0) {
+        slot = g_reactor->connections.free_head - 1;
+        g_reactor->connections.free_head = g_reactor->connections.slots[slot].next_free;
+    } else {
+        slot = g_reactor->connections.high_water;
+        g_reactor->connections.high_water += 1;
     }
-    rc = sg_cbor_read_bytes_like(data, len, &idx, &payload_major, &payload_ptr, &payload_len);
-    if (rc <= 0) {
-        return rc;
+    sg_tcp_conn_slot* entry = &g_reactor->connections.slots[slot];
+    entry->generation = (entry->generation + 1) & SG_HANDLE_GENERATION_MASK;
+    if (entry->generation == 0) {
+        entry->generation = 1;
     }
-
-    if (field_count == 6) {
-        rc = sg_cbor_read_signed_integer(data, len, &idx, &timeout);
-        if (rc <= 0) {
-            return rc;
-        }
-        rc = sg_cbor_read_signed_integer(data, len, &idx, &timestamp);
-        if (rc <= 0) {
-            return rc;
-        }
+    entry->next_free = 0;
+    entry->conn = conn;
+    g_reactor->connections.active_count += 1;
+    int active_total = SG_ATOMIC_ADD(&g_tcp_active_total, 1);
+    int peak_total = SG_ATOMIC_LOAD(&g_tcp_peak_total);
+    while (active_total > peak_total && !SG_ATOMIC_CAS(&g_tcp_peak_total, &peak_total, active_total)) {
     }
 
-    out->request_id = request_id;
-    out->packet_type = packet_type;
-    out->command_major = command_major;
-    out->command_ptr = command_ptr;
-    out->command_len = command_len;
-    out->payload_major = payload_major;
-    out->payload_ptr = payload_ptr;
-    out->payload_len = payload_len;
-    out->field_count = (int)field_count;
-    out->timeout = timeout;
-    out->timestamp = timestamp;
-    *consumed = idx;
-    return 1;
-}
-
-static int sg_cbor_write_type_and_len(unsigned char* out, size_t out_cap, size_t* idx, int major, unsigned long long len_value) {
-    if (out == NULL || idx == NULL || major < 0 || major > 7) {
-        return 0;
+    long long now_ms = sg_monotonic_ms();
+    memset(conn, 0, sizeof(sg_tcp_conn));
+    conn->handle = sg_handle_encode(SG_HANDLE_KIND_TCP_CONNECTION, g_reactor->index, slot, entry->generation);
+    conn->socket = s;
+    conn->stream_class = -1;
+    conn->cold.accepted_at_ms = now_ms;
+    conn->cold.last_activity_ms = now_ms;
+    return conn;
+}
+
+static sg_tcp_conn* sg_tcp_conn_find(long long handle) {
+    int slot = sg_handle_slot(handle);
+    if (slot < 0 || slot >= g_reactor->connections.high_water || sg_handle_reactor(handle) != g_reactor->index) {
+        return NULL;
     }
-    if (len_value < 24ULL) {
-        if (*idx + 1 > out_cap) {
-            return 0;
-        }
-        out[*idx] = (unsigned char)((major << 5) | (int)len_value);
-        *idx += 1;
-        return 1;
+    sg_tcp_conn* conn = g_reactor->connections.slots[slot].conn;
+    if (conn == NULL || conn->handle != handle) {
+        return NULL;
     }
-    if (len_value <= 0xffULL) {
-        if (*idx + 2 > out_cap) {
-            return 0;
-        }
-        out[*idx] = (unsigned char)((major << 5) | 24);
-        out[*idx + 1] = (unsigned char)len_value;
-        *idx += 2;
-        return 1;
+    return conn;
+}
+
+static sg_tcp_conn* sg_tcp_conn_at(int slot) {
+    if (slot < 0 || slot >= g_reactor->connections.high_water) {
+        return NULL;
     }
-    if (len_value <= 0xffffULL) {
-        if (*idx + 3 > out_cap) {
+    return g_reactor->connections.slots[slot].conn;
+}
+
+#if SG_HAVE_IO_URING
+static int sg_uring_enter(sg_uring* ring, unsigned int to_submit, unsigned int min_complete, unsigned int flags, void* arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int sg_uring_submit(sg_uring* ring) {
+    while (ring->sq_unsubmitted > 0) {
+        int rc = sg_uring_enter(ring, ring->sq_unsubmitted, 0, 0, NULL, 0);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EBUSY) {
+                sg_logf("WARN", "NET", "io_uring submit failed err=%d", errno);
+            }
             return 0;
         }
-        out[*idx] = (unsigned char)((major << 5) | 25);
-        out[*idx + 1] = (unsigned char)(len_value >> 8);
-        out[*idx + 2] = (unsigned char)(len_value);
-        *idx += 3;
-        return 1;
-    }
-    if (len_value <= 0xffffffffULL) {
-        if (*idx + 5 > out_cap) {
-            return 0;
+        if (rc == 0) {
+            break;
         }
-        out[*idx] = (unsigned char)((major << 5) | 26);
-        out[*idx + 1] = (unsigned char)(len_value >> 24);
-        out[*idx + 2] = (unsigned char)(len_value >> 16);
-        out[*idx + 3] = (unsigned char)(len_value >> 8);
-        out[*idx + 4] = (unsigned char)(len_value);
-        *idx += 5;
-        return 1;
-    }
-    if (*idx + 9 > out_cap) {
-        return 0;
+        ring->sq_unsubmitted -= (unsigned int)rc;
     }
-    out[*idx] = (unsigned char)((major << 5) | 27);
-    out[*idx + 1] = (unsigned char)(len_value >> 56);
-    out[*idx + 2] = (unsigned char)(len_value >> 48);
-    out[*idx + 3] = (unsigned char)(len_value >> 40);
-    out[*idx + 4] = (unsigned char)(len_value >> 32);
-    out[*idx + 5] = (unsigned char)(len_value >> 24);
-    out[*idx + 6] = (unsigned char)(len_value >> 16);
-    out[*idx + 7] = (unsigned char)(len_value >> 8);
-    out[*idx + 8] = (unsigned char)(len_value);
-    *idx += 9;
     return 1;
 }
 
-static int sg_cbor_write_signed_integer(unsigned char* out, size_t out_cap, size_t* idx, long long value) {
-    if (value >= 0) {
-        return sg_cbor_write_type_and_len(out, out_cap, idx, 0, (unsigned long long)value);
+static struct io_uring_sqe* sg_uring_sqe(sg_uring* ring) {
+    unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local_tail - head >= ring->sq_entries) {
+        sg_uring_submit(ring);
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sq_local_tail - head >= ring->sq_entries) {
+            sg_logf("WARN", "NET", "io_uring submission queue full entries=%u", ring->sq_entries);
+            return NULL;
+        }
     }
-    return sg_cbor_write_type_and_len(out, out_cap, idx, 1, (unsigned long long)(-1 - value));
+    unsigned int index = ring->sq_local_tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local_tail += 1;
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    ring->sq_unsubmitted += 1;
+    return sqe;
 }
 
-static int sg_cbor_write_bytes_like(
-    unsigned char* out,
-    size_t out_cap,
-    size_t* idx,
-    int major,
-    const unsigned char* data,
-    size_t data_len
-) {
-    if (major != 2 && major != 3) {
-        major = 2;
-    }
-    if (!sg_cbor_write_type_and_len(out, out_cap, idx, major, (unsigned long long)data_len)) {
-        return 0;
+static void sg_uring_cancel(sg_uring* ring, unsigned long long user_data) {
+    struct io_uring_sqe* sqe = sg_uring_sqe(ring);
+    if (sqe == NULL) {
+        return;
     }
-    if (*idx + data_len > out_cap) {
-        return 0;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = SG_URING_OP_CANCEL << SG_URING_OP_SHIFT;
+}
+
+static void sg_uring_cancel_conn(sg_tcp_conn* conn) {
+    sg_uring* ring = &g_reactor->uring;
+    if (conn->recv_state == SG_URING_RECV_ARMED) {
+        sg_uring_cancel(ring, (SG_URING_OP_RECV << SG_URING_OP_SHIFT) | ((unsigned long long)conn->handle & SG_URING_TOKEN_MASK));
+        conn->recv_state = SG_URING_RECV_CANCELLING;
     }
-    if (data_len > 0 && data != NULL) {
-        memcpy(out + *idx, data, data_len);
+    if (conn->send_inflight) {
+        sg_uring_cancel(ring, (SG_URING_OP_SEND << SG_URING_OP_SHIFT) | (unsigned long long)(uintptr_t)conn);
     }
-    *idx += data_len;
-    return 1;
 }
 
-static void sg_packet_token(const unsigned char* src, size_t src_len, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
+static void sg_uring_queue_flush(sg_tcp_conn* conn) {
+    if (conn->flush_queued) {
         return;
     }
-    size_t limit = src_len;
-    if (limit > out_cap - 1) {
-        limit = out_cap - 1;
-    }
-    for (size_t i = 0; i < limit; i++) {
-        unsigned char ch = src[i];
-        if (ch >= 32 && ch <= 126) {
-            out[i] = (char)ch;
-        } else {
-            out[i] = '.';
+    sg_uring* ring = &g_reactor->uring;
+    if (ring->flush_count == ring->flush_cap) {
+        int next_cap = (ring->flush_cap > 0 ? ring->flush_cap * 2 : 256);
+        long long* handles = (long long*)realloc(ring->flush_handles, (size_t)next_cap * sizeof(long long));
+        if (handles == NULL) {
+            sg_logf("WARN", "NET", "io_uring flush list grow failed handle=%lld", conn->handle);
+            return;
         }
+        ring->flush_handles = handles;
+        ring->flush_cap = next_cap;
     }
-    out[limit] = '\0';
+    ring->flush_handles[ring->flush_count] = conn->handle;
+    ring->flush_count += 1;
+    conn->flush_queued = 1;
+}
+#else
+static void sg_uring_cancel_conn(sg_tcp_conn* conn) {
+    (void)conn;
 }
 
-static void sg_copy_token_to_cstr(const unsigned char* src, size_t src_len, char* dst, size_t dst_cap) {
-    if (dst == NULL || dst_cap == 0) {
-        return;
+static void sg_uring_queue_flush(sg_tcp_conn* conn) {
+    (void)conn;
+}
+#endif
+
+static sg_frame* sg_frame_alloc(size_t len) {
+    sg_frame* frame = (sg_frame*)malloc(sizeof(sg_frame) + (len > 0 ? len : 1));
+    if (frame == NULL) {
+        return NULL;
     }
-    size_t copy_len = src_len;
-    if (copy_len > dst_cap - 1) {
-        copy_len = dst_cap - 1;
+    frame->refs = 1;
+    frame->len = len;
+    return frame;
+}
+
+static sg_frame* sg_frame_from_bytes(const unsigned char* data, size_t len) {
+    sg_frame* frame = sg_frame_alloc(len);
+    if (frame != NULL && len > 0) {
+        memcpy(frame->data, data, len);
     }
-    if (copy_len > 0 && src != NULL) {
-        memcpy(dst, src, copy_len);
+    return frame;
+}
+
+static sg_frame* sg_frame_retain(sg_frame* frame) {
+    if (frame != NULL) {
+        SG_ATOMIC_ADD(&frame->refs, 1);
     }
-    dst[copy_len] = '\0';
+    return frame;
 }
 
-static int sg_packet_command_equals(const sg_cbor_wire_packet* packet, const char* text) {
-    if (packet == NULL || text == NULL || packet->command_ptr == NULL) {
-        return 0;
+static void sg_frame_release(sg_frame* frame) {
+    if (frame != NULL && SG_ATOMIC_UNREF(&frame->refs) == 0) {
+        free(frame);
     }
-    size_t want = strlen(text);
-    if (want != packet->command_len) {
-        return 0;
+}
+
+static void sg_out_chunk_free(sg_out_chunk* chunk) {
+    sg_frame_release(chunk->frame);
+    free(chunk);
+}
+
+static void sg_tcp_conn_free_output(sg_tcp_conn* conn) {
+    while (conn->out_head != NULL) {
+        sg_out_chunk* chunk = conn->out_head;
+        conn->out_head = chunk->next;
+        sg_out_chunk_free(chunk);
     }
-    return memcmp(packet->command_ptr, text, want) == 0;
+    conn->out_tail = NULL;
 }
 
-static int sg_parse_setup_payload(const unsigned char* payload, size_t payload_len, sg_setup_fields* out) {
-    if (payload == NULL || out == NULL || payload_len == 0) {
+static int sg_tcp_conn_close(long long handle) {
+    sg_tcp_conn* conn = sg_tcp_conn_find(handle);
+    if (conn == NULL) {
         return 0;
     }
-    memset(out, 0, sizeof(*out));
+    int slot = sg_handle_slot(handle);
+    sg_tcp_conn_slot* entry = &g_reactor->connections.slots[slot];
+    entry->conn = NULL;
+    entry->next_free = g_reactor->connections.free_head;
+    g_reactor->connections.free_head = slot + 1;
+    g_reactor->connections.active_count -= 1;
+    SG_ATOMIC_SUB(&g_tcp_active_total, 1);
+    sg_tcp_conn_cancel_timers(conn);
+    if (conn->starved_ticks > 0) {
+        sg_logf("INFO", "NET", "tcp input budget starved handle=%lld ticks=%u", handle, conn->starved_ticks);
+    }
+    if (conn->socket != SG_INVALID_SOCKET) {
+        if (g_io_backend == SG_IO_BACKEND_URING) {
+            sg_uring_cancel_conn(conn);
+        } else {
+            sg_poller_remove(conn->socket);
+        }
+        sg_close_socket(conn->socket);
+        conn->socket = SG_INVALID_SOCKET;
+    }
+    SG_ATOMIC_SUB(&g_reactor->out_queued_bytes, conn->out_bytes);
+    conn->out_bytes = 0;
+    conn->stream_head = 0;
+    conn->stream_tail = 0;
+    sg_tcp_conn_release_buffer(conn);
+    if (conn->send_inflight) {
+        conn->handle = 0;
+        g_reactor->send_orphans += 1;
+        return 1;
+    }
+    sg_tcp_conn_free_output(conn);
+    free(conn);
+    return 1;
+}
 
-    size_t idx = 0;
-    if (idx >= payload_len) {
+static void sg_runtime_lock(void) {
+#if SG_HAVE_REACTOR_THREADS
+    pthread_mutex_lock(&g_runtime_shared_lock);
+#endif
+}
+
+static void sg_runtime_unlock(void) {
+#if SG_HAVE_REACTOR_THREADS
+    pthread_mutex_unlock(&g_runtime_shared_lock);
+#endif
+}
+
+static int sg_reactor_post(int index, int type, long long handle, long long player_id, const char* player_name, sg_frame* frame) {
+#if SG_HAVE_REACTOR_THREADS
+    if (index < 0 || index >= g_reactor_count) {
         return 0;
     }
-    unsigned char head = payload[idx];
-    int major = (head >> 5) & 0x07;
-    int ai = head & 0x1f;
-    if (major != 4) {
+    sg_reactor* target = &g_reactors[index];
+    sg_reactor_msg* msg = (sg_reactor_msg*)malloc(sizeof(sg_reactor_msg));
+    if (msg == NULL) {
         return 0;
     }
-    idx += 1;
-    unsigned long long field_count = 0;
-    int len_rc = sg_cbor_read_length_by_ai(payload, payload_len, &idx, ai, &field_count);
-    if (len_rc <= 0 || field_count < 5ULL) {
-        return 0;
+    msg->next = NULL;
+    msg->type = type;
+    msg->handle = handle;
+    msg->player_id = player_id;
+    snprintf(msg->player_name, sizeof(msg->player_name), "%s", (player_name == NULL ? "" : player_name));
+    msg->frame = sg_frame_retain(frame);
+    pthread_mutex_lock(&target->mailbox_lock);
+    if (target->mailbox_tail != NULL) {
+        target->mailbox_tail->next = msg;
+    } else {
+        target->mailbox_head = msg;
     }
+    target->mailbox_tail = msg;
+    pthread_mutex_unlock(&target->mailbox_lock);
+    uint64_t signal_value = 1;
+    ssize_t written = write(target->wake_fd, &signal_value, sizeof(signal_value));
+    (void)written;
+    return 1;
+#else
+    (void)index;
+    (void)type;
+    (void)handle;
+    (void)player_id;
+    (void)player_name;
+    (void)frame;
+    return 0;
+#endif
+}
 
-    const unsigned char* field_ptr = NULL;
-    size_t field_len = 0;
-    int field_major = 0;
-    for (int i = 0; i < 5; i++) {
-        int rc = sg_cbor_read_bytes_like(payload, payload_len, &idx, &field_major, &field_ptr, &field_len);
-        if (rc <= 0) {
+static int sg_send_all(sg_socket_t socket, const unsigned char* data, size_t len) {
+    size_t sent_total = 0;
+    while (sent_total < len) {
+        int sent = send(socket, (const char*)(data + sent_total), (int)(len - sent_total), 0);
+        if (sent <= 0) {
             return 0;
         }
-        if (i == 0) {
-            sg_copy_token_to_cstr(field_ptr, field_len, out->name, sizeof(out->name));
-        } else if (i == 1) {
-            out->password_major = field_major;
-            if (field_len > sizeof(out->password_raw)) {
-                return 0;
-            }
-            if (field_len > 0) {
-                memcpy(out->password_raw, field_ptr, field_len);
-            }
-            out->password_raw_len = field_len;
-            sg_copy_token_to_cstr(field_ptr, field_len, out->password, sizeof(out->password));
-        } else if (i == 2) {
-            sg_copy_token_to_cstr(field_ptr, field_len, out->md5, sizeof(out->md5));
-        } else if (i == 3) {
-            sg_copy_token_to_cstr(field_ptr, field_len, out->version, sizeof(out->version));
-        } else if (i == 4) {
-            sg_copy_token_to_cstr(field_ptr, field_len, out->uuid, sizeof(out->uuid));
-        }
+        sent_total += (size_t)sent;
     }
-    return out->name[0] != '\0' && out->version[0] != '\0';
+    return 1;
 }
 
-static int sg_parse_version_triplet(const char* version_text, int* major_out, int* minor_out, int* patch_out) {
-    if (version_text == NULL || major_out == NULL || minor_out == NULL || patch_out == NULL) {
-        return 0;
-    }
-    const char* p = version_text;
-    if (*p == 'v' || *p == 'V') {
-        p += 1;
-    }
-    char* end = NULL;
-    long major = strtol(p, &end, 10);
-    if (end == p || *end != '.') {
-        return 0;
-    }
-    p = end + 1;
-    long minor = strtol(p, &end, 10);
-    if (end == p || *end != '.') {
-        return 0;
+static void sg_tcp_send_limits_init(void) {
+    if (g_tcp_send_limits_ready) {
+        return;
     }
-    p = end + 1;
-    long patch = strtol(p, &end, 10);
-    if (end == p) {
-        return 0;
+    g_tcp_send_limits_ready = 1;
+    g_tcp_send_budget = (size_t)sg_parse_positive_env_i32("SENGOO_TCP_SEND_BUDGET_BYTES", 4 * 1024 * 1024);
+    g_tcp_send_high_watermark = (size_t)sg_parse_positive_env_i32("SENGOO_TCP_SEND_HIGH_WATERMARK", 256 * 1024);
+    g_tcp_send_low_watermark = (size_t)sg_parse_positive_env_i32("SENGOO_TCP_SEND_LOW_WATERMARK", 64 * 1024);
+    if (g_tcp_send_high_watermark > g_tcp_send_budget) {
+        g_tcp_send_high_watermark = g_tcp_send_budget;
     }
-    if (major < 0 || minor < 0 || patch < 0 || major > 1000 || minor > 1000 || patch > 1000000) {
-        return 0;
+    if (g_tcp_send_low_watermark >= g_tcp_send_high_watermark) {
+        g_tcp_send_low_watermark = g_tcp_send_high_watermark / 2;
     }
-    *major_out = (int)major;
-    *minor_out = (int)minor;
-    *patch_out = (int)patch;
-    return 1;
 }
 
-static int sg_is_supported_client_version(const char* version_text) {
-    int major = 0;
-    int minor = 0;
-    int patch = 0;
-    if (!sg_parse_version_triplet(version_text, &major, &minor, &patch)) {
-        return 0;
-    }
-    if (major != 0) {
-        return 0;
+static void sg_tcp_input_limits_init(void) {
+    if (g_tcp_input_limits_ready) {
+        return;
     }
-    if (minor != 5) {
-        return 0;
+    g_tcp_input_limits_ready = 1;
+    g_tcp_frames_per_tick = sg_parse_positive_env_i32("SENGOO_TCP_FRAMES_PER_TICK", 32);
+    g_tcp_read_bytes_per_tick = (size_t)sg_parse_positive_env_i32("SENGOO_TCP_READ_BYTES_PER_TICK", 64 * 1024);
+}
+
+static void sg_tcp_conn_budget_refresh(sg_tcp_conn* conn) {
+    if (conn->budget_tick != g_reactor->tick_seq) {
+        conn->budget_tick = g_reactor->tick_seq;
+        conn->budget_frames = 0;
+        conn->budget_bytes = 0;
     }
-    return patch >= 19;
 }
 
-static int sg_build_server_notify_packet(
-    unsigned char* out,
-    size_t out_cap,
-    const char* command,
-    const unsigned char* payload,
-    size_t payload_len,
-    int payload_major,
-    size_t* out_len
-) {
-    if (out == NULL || out_cap == 0 || command == NULL || out_len == NULL) {
+static int sg_tcp_conn_queue_pending(sg_tcp_conn* conn) {
+    if (conn->pending_queued) {
         return 0;
     }
-    size_t idx = 0;
-    size_t command_len = strlen(command);
-    int ok = 1;
-    ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 4, 4);
-    ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, -2);
-    ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, SG_PACKET_TYPE_SERVER_NOTIFY);
-    ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 2, (const unsigned char*)command, command_len);
-    ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, payload_major, payload, payload_len);
-    if (!ok) {
-        return 0;
+    if (g_reactor->pending_count == g_reactor->pending_cap) {
+        int next_cap = (g_reactor->pending_cap > 0 ? g_reactor->pending_cap * 2 : 256);
+        long long* handles = (long long*)realloc(g_reactor->pending_handles, (size_t)next_cap * sizeof(long long));
+        if (handles == NULL) {
+            sg_logf("WARN", "NET", "tcp pending list grow failed handle=%lld", conn->handle);
+            return 0;
+        }
+        g_reactor->pending_handles = handles;
+        g_reactor->pending_cap = next_cap;
     }
-    *out_len = idx;
+    g_reactor->pending_handles[g_reactor->pending_count] = conn->handle;
+    g_reactor->pending_count += 1;
+    conn->pending_queued = 1;
     return 1;
 }
 
-static int sg_send_server_notification(
-    sg_socket_t socket,
-    const char* command,
-    const unsigned char* payload,
-    size_t payload_len,
-    int payload_major
-) {
-    unsigned char frame[SG_AUTH_PUBLIC_KEY_MAX + 512];
-    size_t frame_len = 0;
-    if (!sg_build_server_notify_packet(frame, sizeof(frame), command, payload, payload_len, payload_major, &frame_len)) {
+static int sg_tcp_conn_output_fits(sg_tcp_conn* conn, size_t len) {
+    sg_tcp_send_limits_init();
+    if (conn->out_bytes + len > g_tcp_send_budget) {
+        sg_logf(
+            "WARN",
+            "NET",
+            "tcp send budget exceeded handle=%lld queued=%u incoming=%u budget=%u",
+            conn->handle,
+            (unsigned)conn->out_bytes,
+            (unsigned)len,
+            (unsigned)g_tcp_send_budget
+        );
         return 0;
     }
-    return sg_send_all(socket, frame, frame_len);
+    return 1;
 }
 
-static size_t sg_load_network_delay_payload(unsigned char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
-        return 0;
-    }
-    const char* env_path = getenv("SENGOO_RSA_PUBLIC_KEY_PATH");
-    const char* key_path = (env_path != NULL && env_path[0] != '\0') ? env_path : "server/rsa_pub";
-    FILE* fp = fopen(key_path, "rb");
-    if (fp != NULL) {
-        size_t n = fread(out, 1, out_cap, fp);
-        fclose(fp);
-        if (n > 0) {
-            return n;
-        }
-    }
-
-    const char* fallback_key = "SENGOO_FAKE_RSA_PUBLIC_KEY";
-    size_t fallback_len = strlen(fallback_key);
-    if (fallback_len > out_cap) {
-        fallback_len = out_cap;
+static void sg_tcp_conn_output_added(sg_tcp_conn* conn, size_t len) {
+    conn->out_bytes += len;
+    SG_ATOMIC_ADD(&g_reactor->out_queued_bytes, len);
+    if (!conn->read_paused && conn->out_bytes >= g_tcp_send_high_watermark) {
+        conn->read_paused = 1;
+        sg_logf("INFO", "NET", "tcp send backpressure handle=%lld queued=%u", conn->handle, (unsigned)conn->out_bytes);
     }
-    memcpy(out, fallback_key, fallback_len);
-    return fallback_len;
 }
 
-static int sg_send_network_delay_test(sg_socket_t socket) {
-    unsigned char payload[SG_AUTH_PUBLIC_KEY_MAX];
-    size_t payload_len = sg_load_network_delay_payload(payload, sizeof(payload));
-    return sg_send_server_notification(socket, "NetworkDelayTest", payload, payload_len, 2);
+static void sg_tcp_conn_output_append(sg_tcp_conn* conn, sg_out_chunk* chunk, size_t len) {
+    chunk->next = NULL;
+    if (conn->out_tail != NULL) {
+        conn->out_tail->next = chunk;
+    } else {
+        conn->out_head = chunk;
+    }
+    conn->out_tail = chunk;
+    sg_tcp_conn_output_added(conn, len);
 }
 
-static int sg_should_send_network_delay(void) {
-    const char* raw = getenv("SENGOO_AUTH_SEND_NETWORK_DELAY");
-    if (raw == NULL || raw[0] == '\0') {
-        return 1;
-    }
-    if (strcmp(raw, "0") == 0 || strcmp(raw, "FALSE") == 0 || strcmp(raw, "false") == 0) {
+static int sg_tcp_conn_enqueue(sg_tcp_conn* conn, const unsigned char* data, size_t len) {
+    if (!sg_tcp_conn_output_fits(conn, len)) {
         return 0;
     }
-    if (strcmp(raw, "OFF") == 0 || strcmp(raw, "off") == 0 || strcmp(raw, "NO") == 0 || strcmp(raw, "no") == 0) {
+    sg_out_chunk* tail = conn->out_tail;
+    if (tail != NULL && tail->frame == NULL && tail->cap - tail->len >= len) {
+        memcpy(tail->data + tail->len, data, len);
+        tail->len += len;
+        sg_tcp_conn_output_added(conn, len);
+        return 1;
+    }
+    size_t cap = (len < SG_TCP_OUT_CHUNK_MIN ? SG_TCP_OUT_CHUNK_MIN : len);
+    sg_out_chunk* chunk = (sg_out_chunk*)malloc(sizeof(sg_out_chunk) + cap);
+    if (chunk == NULL) {
         return 0;
     }
+    chunk->frame = NULL;
+    chunk->base = chunk->data;
+    chunk->offset = 0;
+    chunk->len = len;
+    chunk->cap = cap;
+    memcpy(chunk->data, data, len);
+    sg_tcp_conn_output_append(conn, chunk, len);
     return 1;
 }
 
-static int sg_send_errordlg_and_close(sg_socket_t socket, const char* msg) {
-    const char* text = (msg == NULL ? "UNKNOWN ERROR" : msg);
-    size_t msg_len = strlen(text);
-    return sg_send_server_notification(socket, "ErrorDlg", (const unsigned char*)text, msg_len, 2);
-}
-
-static int sg_send_md5_failure_and_update_package(sg_socket_t socket) {
-    const char* msg = "MD5 check failed!";
-    if (!sg_send_server_notification(socket, "ErrorMsg", (const unsigned char*)msg, strlen(msg), 2)) {
+static int sg_tcp_conn_enqueue_frame(sg_tcp_conn* conn, sg_frame* frame, size_t offset) {
+    size_t len = frame->len - offset;
+    if (!sg_tcp_conn_output_fits(conn, len)) {
         return 0;
     }
-    unsigned char summary_payload[SG_EXTENSION_SYNC_PAYLOAD_MAX];
-    size_t summary_len = sg_build_update_package_summary(summary_payload, sizeof(summary_payload));
-    if (summary_len == 0) {
-        summary_payload[0] = 0x80;
-        summary_len = 1;
+    sg_out_chunk* chunk = (sg_out_chunk*)malloc(sizeof(sg_out_chunk));
+    if (chunk == NULL) {
+        return 0;
     }
-    return sg_send_server_notification(socket, "UpdatePackage", summary_payload, summary_len, 2);
+    chunk->frame = sg_frame_retain(frame);
+    chunk->base = frame->data;
+    chunk->offset = offset;
+    chunk->len = frame->len;
+    chunk->cap = frame->len;
+    sg_tcp_conn_output_append(conn, chunk, len);
+    return 1;
 }
 
-static int sg_should_enforce_md5(void) {
-    const char* raw = getenv("SENGOO_AUTH_ENFORCE_MD5");
-    if (raw == NULL || raw[0] == '\0') {
+static int sg_tcp_conn_send(sg_tcp_conn* conn, const unsigned char* data, size_t len) {
+    if (conn == NULL) {
         return 0;
     }
-    if (strcmp(raw, "1") == 0 || strcmp(raw, "TRUE") == 0 || strcmp(raw, "true") == 0) {
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        if (len == 0) {
+            return 1;
+        }
+        if (!sg_tcp_conn_enqueue(conn, data, len)) {
+            return 0;
+        }
+        sg_uring_queue_flush(conn);
         return 1;
     }
-    if (strcmp(raw, "ON") == 0 || strcmp(raw, "on") == 0 || strcmp(raw, "YES") == 0 || strcmp(raw, "yes") == 0) {
+    if (conn->out_head == NULL && conn->cork_depth == 0) {
+        size_t sent_total = 0;
+        while (sent_total < len) {
+            int sent = send(conn->socket, (const char*)(data + sent_total), (int)(len - sent_total), 0);
+            if (sent > 0) {
+                sent_total += (size_t)sent;
+                continue;
+            }
+            if (sent < 0 && sg_would_block()) {
+                break;
+            }
+            return 0;
+        }
+        data += sent_total;
+        len -= sent_total;
+    }
+    if (len == 0) {
         return 1;
     }
-    return 0;
+    return sg_tcp_conn_enqueue(conn, data, len);
 }
 
-static int sg_md5_matches_expected(const char* incoming_md5) {
-    const char* expected = getenv("SENGOO_SERVER_MD5");
-    if (expected == NULL || expected[0] == '\0') {
-        return 1;
-    }
-    if (incoming_md5 == NULL) {
+static int sg_tcp_conn_send_frame(sg_tcp_conn* conn, sg_frame* frame) {
+    if (conn == NULL || frame == NULL) {
         return 0;
     }
-    return strcmp(incoming_md5, expected) == 0;
-}
-
-static void sg_trim_ascii_inplace(char* text) {
-    if (text == NULL) {
-        return;
+    if (frame->len == 0) {
+        return 1;
     }
-    size_t len = strlen(text);
-    while (len > 0) {
-        unsigned char ch = (unsigned char)text[len - 1];
-        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
-            text[len - 1] = '\0';
-            len -= 1;
-        } else {
-            break;
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        if (!sg_tcp_conn_enqueue_frame(conn, frame, 0)) {
+            return 0;
         }
+        sg_uring_queue_flush(conn);
+        return 1;
     }
-    size_t start = 0;
-    while (text[start] == ' ' || text[start] == '\t') {
-        start += 1;
+    size_t sent_total = 0;
+    if (conn->out_head == NULL && conn->cork_depth == 0) {
+        while (sent_total < frame->len) {
+            int sent = send(conn->socket, (const char*)(frame->data + sent_total), (int)(frame->len - sent_total), 0);
+            if (sent > 0) {
+                sent_total += (size_t)sent;
+                continue;
+            }
+            if (sent < 0 && sg_would_block()) {
+                break;
+            }
+            return 0;
+        }
     }
-    if (start > 0) {
-        memmove(text, text + start, strlen(text + start) + 1);
+    if (sent_total == frame->len) {
+        return 1;
     }
+    return sg_tcp_conn_enqueue_frame(conn, frame, sent_total);
 }
 
-static int sg_file_contains_token_line(const char* path, const char* token) {
-    if (path == NULL || path[0] == '\0' || token == NULL || token[0] == '\0') {
-        return 0;
-    }
-    FILE* fp = fopen(path, "rb");
-    if (fp == NULL) {
-        return 0;
-    }
-
-    char line[512];
-    int matched = 0;
-    while (fgets(line, (int)sizeof(line), fp) != NULL) {
-        sg_trim_ascii_inplace(line);
-        if (line[0] == '\0' || line[0] == '#') {
-            continue;
-        }
-        if (strcmp(line, token) == 0) {
-            matched = 1;
+static void sg_tcp_conn_consume_output(sg_tcp_conn* conn, size_t sent) {
+    conn->out_bytes -= sent;
+    SG_ATOMIC_SUB(&g_reactor->out_queued_bytes, sent);
+    while (sent > 0 && conn->out_head != NULL) {
+        sg_out_chunk* chunk = conn->out_head;
+        size_t pending = chunk->len - chunk->offset;
+        if (sent < pending) {
+            chunk->offset += sent;
             break;
         }
+        sent -= pending;
+        conn->out_head = chunk->next;
+        if (conn->out_head == NULL) {
+            conn->out_tail = NULL;
+        }
+        sg_out_chunk_free(chunk);
     }
-
-    fclose(fp);
-    return matched;
 }
 
-static long long sg_parse_i64_cstr(const char* text, long long fallback) {
-    if (text == NULL || text[0] == '\0') {
-        return fallback;
-    }
-    char* end = NULL;
-    long long value = strtoll(text, &end, 10);
-    if (end == text || *end != '\0') {
-        return fallback;
+static int sg_tcp_conn_flush(sg_tcp_conn* conn) {
+    while (conn->out_head != NULL) {
+        size_t sent = 0;
+#ifdef _WIN32
+        WSABUF iov[SG_TCP_OUT_IOV_MAX];
+        DWORD count = 0;
+        for (sg_out_chunk* chunk = conn->out_head; chunk != NULL && count < SG_TCP_OUT_IOV_MAX; chunk = chunk->next) {
+            iov[count].buf = (char*)(chunk->base + chunk->offset);
+            iov[count].len = (ULONG)(chunk->len - chunk->offset);
+            count += 1;
+        }
+        DWORD sent_bytes = 0;
+        if (WSASend(conn->socket, iov, count, &sent_bytes, 0, NULL, NULL) != 0) {
+            return sg_would_block() ? 1 : 0;
+        }
+        sent = (size_t)sent_bytes;
+#else
+        struct iovec iov[SG_TCP_OUT_IOV_MAX];
+        int count = 0;
+        for (sg_out_chunk* chunk = conn->out_head; chunk != NULL && count < SG_TCP_OUT_IOV_MAX; chunk = chunk->next) {
+            iov[count].iov_base = chunk->base + chunk->offset;
+            iov[count].iov_len = chunk->len - chunk->offset;
+            count += 1;
+        }
+        ssize_t rc = writev(conn->socket, iov, count);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return sg_would_block() ? 1 : 0;
+        }
+        sent = (size_t)rc;
+#endif
+        sg_tcp_conn_consume_output(conn, sent);
     }
-    return value;
+    return 1;
 }
 
-static int sg_parse_bool_env(const char* key, int fallback) {
-    const char* raw = getenv(key);
-    if (raw == NULL || raw[0] == '\0') {
-        return fallback;
+static int sg_cbor_read_length_by_ai(const unsigned char* data, size_t len, size_t* idx, int ai, unsigned long long* out) {
+    if (data == NULL || idx == NULL || out == NULL) {
+        return -1;
     }
-    if (strcmp(raw, "1") == 0 || strcmp(raw, "TRUE") == 0 || strcmp(raw, "true") == 0) {
+    if (ai < 24) {
+        *out = (unsigned long long)ai;
         return 1;
     }
-    if (strcmp(raw, "ON") == 0 || strcmp(raw, "on") == 0 || strcmp(raw, "YES") == 0 || strcmp(raw, "yes") == 0) {
+    if (ai == 24) {
+        if (*idx + 1 > len) {
+            return 0;
+        }
+        *out = (unsigned long long)data[*idx];
+        *idx += 1;
         return 1;
     }
-    if (strcmp(raw, "0") == 0 || strcmp(raw, "FALSE") == 0 || strcmp(raw, "false") == 0) {
-        return 0;
-    }
-    if (strcmp(raw, "OFF") == 0 || strcmp(raw, "off") == 0 || strcmp(raw, "NO") == 0 || strcmp(raw, "no") == 0) {
-        return 0;
+    if (ai == 25) {
+        if (*idx + 2 > len) {
+            return 0;
+        }
+        *out = ((unsigned long long)data[*idx] << 8) | (unsigned long long)data[*idx + 1];
+        *idx += 2;
+        return 1;
     }
-    return fallback;
-}
-
-static int sg_pipe_split_fields(char* line, char* fields[], int max_fields) {
-    if (line == NULL || fields == NULL || max_fields <= 0) {
-        return 0;
+    if (ai == 26) {
+        if (*idx + 4 > len) {
+            return 0;
+        }
+        *out =
+            ((unsigned long long)data[*idx] << 24) |
+            ((unsigned long long)data[*idx + 1] << 16) |
+            ((unsigned long long)data[*idx + 2] << 8) |
+            (unsigned long long)data[*idx + 3];
+        *idx += 4;
+        return 1;
     }
-    int count = 0;
-    char* p = line;
-    while (*p != '\0' && count < max_fields) {
-        fields[count++] = p;
-        char* sep = strchr(p, '|');
-        if (sep == NULL) {
-            break;
+    if (ai == 27) {
+        if (*idx + 8 > len) {
+            return 0;
         }
-        *sep = '\0';
-        p = sep + 1;
+        *out =
+            ((unsigned long long)data[*idx] << 56) |
+            ((unsigned long long)data[*idx + 1] << 48) |
+            ((unsigned long long)data[*idx + 2] << 40) |
+            ((unsigned long long)data[*idx + 3] << 32) |
+            ((unsigned long long)data[*idx + 4] << 24) |
+            ((unsigned long long)data[*idx + 5] << 16) |
+            ((unsigned long long)data[*idx + 6] << 8) |
+            (unsigned long long)data[*idx + 7];
+        *idx += 8;
+        return 1;
     }
-    return count;
+    return -1;
 }
 
-static const char* sg_auth_user_file_path(void) {
-    const char* raw = getenv("SENGOO_AUTH_USER_FILE");
-    if (raw == NULL || raw[0] == '\0') {
-        return "server/users.auth.tsv";
+static int sg_cbor_read_signed_integer(const unsigned char* data, size_t len, size_t* idx, long long* out) {
+    if (data == NULL || idx == NULL || out == NULL) {
+        return -1;
     }
-    return raw;
-}
-
-static const char* sg_auth_uuid_binding_file_path(void) {
-    const char* raw = getenv("SENGOO_AUTH_UUID_BINDING_FILE");
-    if (raw == NULL || raw[0] == '\0') {
-        return ".tmp/runtime_host/auth_uuid_bindings.tsv";
+    if (*idx >= len) {
+        return 0;
     }
-    return raw;
-}
-
-static int sg_auth_userdb_enabled(void) {
-    return sg_parse_bool_env("SENGOO_AUTH_USERDB_ENABLE", 0);
-}
-
-static int sg_auth_userdb_autoregister_enabled(void) {
-    return sg_parse_bool_env("SENGOO_AUTH_USERDB_AUTO_REGISTER", 1);
-}
-
-static int sg_auth_max_players_per_device(void) {
-    int value = 50;
-    const char* raw = getenv("SENGOO_AUTH_MAX_PLAYERS_PER_DEVICE");
-    if (raw != NULL && raw[0] != '\0') {
-        char* end = NULL;
-        long parsed = strtol(raw, &end, 10);
-        if (end != raw && *end == '\0' && parsed > 0 && parsed <= 10000) {
-            value = (int)parsed;
-        }
+    unsigned char head = data[*idx];
+    int major = (head >> 5) & 0x07;
+    int ai = head & 0x1f;
+    if (major != 0 && major != 1) {
+        return -1;
     }
-    if (value < 1) {
-        value = 1;
-    } else if (value > 10000) {
-        value = 10000;
+    *idx += 1;
+    unsigned long long uval = 0;
+    int len_rc = sg_cbor_read_length_by_ai(data, len, idx, ai, &uval);
+    if (len_rc <= 0) {
+        return len_rc;
     }
-    return value;
+    if (uval > (unsigned long long)LLONG_MAX) {
+        return -1;
+    }
+    if (major == 0) {
+        *out = (long long)uval;
+    } else {
+        *out = -1 - (long long)uval;
+    }
+    return 1;
 }
 
-static int sg_is_valid_user_name_token(const char* name) {
-    if (name == NULL || name[0] == '\0') {
-        return 0;
+static int sg_cbor_read_bytes_like(
+    const unsigned char* data,
+    size_t len,
+    size_t* idx,
+    int* out_major,
+    const unsigned char** out_ptr,
+    size_t* out_len
+) {
+    if (data == NULL || idx == NULL || out_major == NULL || out_ptr == NULL || out_len == NULL) {
+        return -1;
     }
-    size_t len = strlen(name);
-    if (len == 0 || len > 64) {
+    if (*idx >= len) {
         return 0;
     }
-    for (size_t i = 0; i < len; i++) {
-        unsigned char ch = (unsigned char)name[i];
-        if (ch < 32 || ch == 127 || ch == '|') {
-            return 0;
-        }
+    unsigned char head = data[*idx];
+    int major = (head >> 5) & 0x07;
+    int ai = head & 0x1f;
+    if (major != 2 && major != 3) {
+        return -1;
+    }
+    *idx += 1;
+    unsigned long long blen = 0;
+    int len_rc = sg_cbor_read_length_by_ai(data, len, idx, ai, &blen);
+    if (len_rc <= 0) {
+        return len_rc;
     }
+    if (blen > (unsigned long long)(len - *idx)) {
+        return 0;
+    }
+    *out_major = major;
+    *out_ptr = data + *idx;
+    *out_len = (size_t)blen;
+    *idx += (size_t)blen;
     return 1;
 }
 
-static const char* sg_auth_whitelist_file_path(void) {
-    const char* raw = getenv("SENGOO_AUTH_WHITELIST_FILE");
-    if (raw == NULL || raw[0] == '\0') {
-        return NULL;
+static void sg_cbor_arena_init(sg_cbor_arena* arena, sg_cbor_node* inline_nodes, size_t inline_cap, size_t max_nodes) {
+    memset(arena, 0, sizeof(*arena));
+    arena->inline_nodes = inline_nodes;
+    arena->inline_cap = inline_nodes != NULL ? inline_cap : 0;
+    arena->max_nodes = max_nodes > 0 ? max_nodes : SG_CBOR_DOC_MAX_NODES;
+}
+
+static void sg_cbor_arena_release(sg_cbor_arena* arena) {
+    if (arena == NULL) {
+        return;
     }
-    return raw;
+    sg_cbor_arena_block* block = arena->blocks;
+    while (block != NULL) {
+        sg_cbor_arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->inline_used = 0;
+    arena->node_count = 0;
 }
 
-static const char* sg_auth_ban_words_file_path(void) {
-    const char* raw = getenv("SENGOO_BAN_WORDS_FILE");
-    if (raw == NULL || raw[0] == '\0') {
+static sg_cbor_node* sg_cbor_arena_node(sg_cbor_arena* arena) {
+    if (arena->node_count >= arena->max_nodes) {
         return NULL;
     }
-    return raw;
+    sg_cbor_node* node = NULL;
+    if (arena->inline_used < arena->inline_cap) {
+        node = &arena->inline_nodes[arena->inline_used++];
+    } else {
+        sg_cbor_arena_block* block = arena->blocks;
+        if (block == NULL || block->used >= block->cap) {
+            size_t cap = block != NULL ? block->cap * 2 : SG_CBOR_ARENA_BLOCK_MIN;
+            if (cap > SG_CBOR_ARENA_BLOCK_MAX) {
+                cap = SG_CBOR_ARENA_BLOCK_MAX;
+            }
+            if (cap > arena->max_nodes - arena->node_count) {
+                cap = arena->max_nodes - arena->node_count;
+            }
+            sg_cbor_arena_block* grown =
+                (sg_cbor_arena_block*)malloc(sizeof(sg_cbor_arena_block) + cap * sizeof(sg_cbor_node));
+            if (grown == NULL) {
+                return NULL;
+            }
+            grown->next = block;
+            grown->used = 0;
+            grown->cap = cap;
+            arena->blocks = grown;
+            block = grown;
+        }
+        node = &block->nodes[block->used++];
+    }
+    arena->node_count += 1;
+    memset(node, 0, sizeof(*node));
+    return node;
 }
 
-static int sg_ascii_case_contains(const char* text, const char* token) {
-    if (text == NULL || token == NULL || token[0] == '\0') {
-        return 0;
+static double sg_cbor_half_to_double(unsigned int half) {
+    unsigned int sign = (half >> 15) & 0x1u;
+    unsigned int exp = (half >> 10) & 0x1fu;
+    unsigned int mant = half & 0x3ffu;
+    if (exp == 0) {
+        double value = (double)mant / 16777216.0;
+        return sign ? -value : value;
     }
-    size_t text_len = strlen(text);
-    size_t token_len = strlen(token);
-    if (token_len == 0 || token_len > text_len) {
-        return 0;
+    uint32_t bits = (uint32_t)sign << 31;
+    if (exp == 31) {
+        bits |= 0x7f800000u | ((uint32_t)mant << 13);
+    } else {
+        bits |= ((uint32_t)(exp + 112) << 23) | ((uint32_t)mant << 13);
     }
+    float value = 0.0f;
+    memcpy(&value, &bits, sizeof(value));
+    return (double)value;
+}
 
-    for (size_t i = 0; i + token_len <= text_len; i++) {
-        size_t j = 0;
-        while (j < token_len) {
-            unsigned char lhs = (unsigned char)text[i + j];
-            unsigned char rhs = (unsigned char)token[j];
-            if (tolower(lhs) != tolower(rhs)) {
+static int sg_cbor_doc_read_item(sg_cbor_doc_reader* reader, int depth, sg_cbor_node** out);
+
+static int sg_cbor_doc_read_children(sg_cbor_doc_reader* reader, sg_cbor_node* parent, int depth, int ai, unsigned long long count) {
+    sg_cbor_node** tail = &parent->child;
+    size_t items = 0;
+    for (;;) {
+        if (ai == 31) {
+            if (reader->idx >= reader->len) {
+                return 0;
+            }
+            if (reader->data[reader->idx] == 0xff) {
+                reader->idx += 1;
                 break;
             }
-            j += 1;
+        } else if ((unsigned long long)items >= count) {
+            break;
         }
-        if (j == token_len) {
-            return 1;
+        int rc = sg_cbor_doc_read_item(reader, depth + 1, tail);
+        if (rc <= 0) {
+            return rc;
         }
+        tail = &(*tail)->next;
+        items += 1;
     }
-    return 0;
+    if (parent->kind == SG_CBOR_NODE_MAP) {
+        if ((items & 1u) != 0) {
+            return -1;
+        }
+        items /= 2;
+    }
+    parent->len = items;
+    return 1;
 }
 
-static int sg_ascii_case_equal(const char* lhs, const char* rhs) {
-    if (lhs == NULL || rhs == NULL) {
-        return 0;
+static int sg_cbor_doc_read_item(sg_cbor_doc_reader* reader, int depth, sg_cbor_node** out) {
+    if (depth > SG_CBOR_DOC_MAX_DEPTH) {
+        return -1;
     }
-    size_t lhs_len = strlen(lhs);
-    size_t rhs_len = strlen(rhs);
-    if (lhs_len != rhs_len) {
+    if (reader->idx >= reader->len) {
         return 0;
     }
-    for (size_t i = 0; i < lhs_len; i++) {
-        unsigned char a = (unsigned char)lhs[i];
-        unsigned char b = (unsigned char)rhs[i];
-        if (tolower(a) != tolower(b)) {
-            return 0;
-        }
+    unsigned char head = reader->data[reader->idx];
+    int major = (head >> 5) & 0x07;
+    int ai = head & 0x1f;
+    sg_cbor_node* node = sg_cbor_arena_node(reader->arena);
+    if (node == NULL) {
+        return -1;
     }
-    return 1;
-}
+    *out = node;
+    reader->idx += 1;
 
-static int sg_name_in_whitelist(const char* name) {
-    const char* path = sg_auth_whitelist_file_path();
-    if (path == NULL || path[0] == '\0') {
+    if (major == 7) {
+        if (ai < 20 || ai == 24) {
+            unsigned long long simple = (unsigned long long)ai;
+            if (ai == 24) {
+                int len_rc = sg_cbor_read_length_by_ai(reader->data, reader->len, &reader->idx, ai, &simple);
+                if (len_rc <= 0) {
+                    return len_rc;
+                }
+                if (simple < 32) {
+                    return -1;
+                }
+            }
+            node->kind = SG_CBOR_NODE_SIMPLE;
+            node->int_value = (long long)simple;
+        } else if (ai == 20 || ai == 21) {
+            node->kind = SG_CBOR_NODE_BOOL;
+            node->int_value = ai == 21;
+        } else if (ai == 22) {
+            node->kind = SG_CBOR_NODE_NULL;
+        } else if (ai == 23) {
+            node->kind = SG_CBOR_NODE_UNDEFINED;
+        } else if (ai >= 25 && ai <= 27) {
+            unsigned long long bits = 0;
+            int len_rc = sg_cbor_read_length_by_ai(reader->data, reader->len, &reader->idx, ai, &bits);
+            if (len_rc <= 0) {
+                return len_rc;
+            }
+            node->kind = SG_CBOR_NODE_FLOAT;
+            if (ai == 25) {
+                node->float_value = sg_cbor_half_to_double((unsigned int)bits);
+            } else if (ai == 26) {
+                uint32_t raw = (uint32_t)bits;
+                float value = 0.0f;
+                memcpy(&value, &raw, sizeof(value));
+                node->float_value = (double)value;
+            } else {
+                uint64_t raw = (uint64_t)bits;
+                memcpy(&node->float_value, &raw, sizeof(node->float_value));
+            }
+        } else {
+            return -1;
+        }
         return 1;
     }
 
-    FILE* fp = fopen(path, "rb");
-    if (fp == NULL) {
-        if (!g_auth_whitelist_missing_logged) {
-            g_auth_whitelist_missing_logged = 1;
-            sg_logf("WARN", "AUTH", "whitelist file missing path=%s", path);
+    if (ai == 31) {
+        if (major != 4 && major != 5) {
+            return -1;
         }
-        return 1;
+        node->kind = major == 4 ? SG_CBOR_NODE_ARRAY : SG_CBOR_NODE_MAP;
+        return sg_cbor_doc_read_children(reader, node, depth, ai, 0);
     }
 
-    int found = 0;
-    char line[SG_AUTH_LINE_MAX];
-    while (fgets(line, (int)sizeof(line), fp) != NULL) {
-        sg_trim_ascii_inplace(line);
-        if (line[0] == '\0' || line[0] == '#') {
-            continue;
-        }
-        if (strcmp(line, name) == 0) {
-            found = 1;
-            break;
-        }
+    unsigned long long arg = 0;
+    int len_rc = sg_cbor_read_length_by_ai(reader->data, reader->len, &reader->idx, ai, &arg);
+    if (len_rc <= 0) {
+        return len_rc;
+    }
+    size_t remaining = reader->len - reader->idx;
+    switch (major) {
+        case 0:
+        case 1:
+            if (arg > (unsigned long long)LLONG_MAX) {
+                return -1;
+            }
+            node->kind = SG_CBOR_NODE_INT;
+            node->int_value = major == 0 ? (long long)arg : -1 - (long long)arg;
+            return 1;
+        case 2:
+        case 3:
+            if (arg > (unsigned long long)remaining) {
+                return 0;
+            }
+            node->kind = major == 2 ? SG_CBOR_NODE_BYTES : SG_CBOR_NODE_TEXT;
+            node->ptr = reader->data + reader->idx;
+            node->len = (size_t)arg;
+            reader->idx += (size_t)arg;
+            return 1;
+        case 4:
+        case 5:
+            if (arg > (unsigned long long)remaining || (major == 5 && arg > (unsigned long long)(remaining / 2))) {
+                return 0;
+            }
+            node->kind = major == 4 ? SG_CBOR_NODE_ARRAY : SG_CBOR_NODE_MAP;
+            return sg_cbor_doc_read_children(reader, node, depth, ai, major == 5 ? arg * 2 : arg);
+        case 6:
+            node->kind = SG_CBOR_NODE_TAG;
+            node->tag = arg;
+            node->len = 1;
+            return sg_cbor_doc_read_item(reader, depth + 1, &node->child);
+        default:
+            return -1;
     }
-    fclose(fp);
-    return found;
 }
 
-static int sg_name_contains_ban_word(const char* name) {
-    const char* path = sg_auth_ban_words_file_path();
-    if (path == NULL || path[0] == '\0') {
-        return 0;
+static int sg_cbor_doc_parse_array_prefix(
+    sg_cbor_arena* arena,
+    const unsigned char* data,
+    size_t len,
+    size_t max_items,
+    sg_cbor_node** out_root
+) {
+    if (arena == NULL || data == NULL || out_root == NULL || len == 0) {
+        return -1;
     }
-
-    FILE* fp = fopen(path, "rb");
-    if (fp == NULL) {
-        if (!g_auth_ban_words_missing_logged) {
-            g_auth_ban_words_missing_logged = 1;
-            sg_logf("WARN", "AUTH", "ban words file missing path=%s", path);
-        }
-        return 0;
+    *out_root = NULL;
+    if (((data[0] >> 5) & 0x07) != 4) {
+        return -1;
     }
-
-    int matched = 0;
-    char line[SG_AUTH_LINE_MAX];
-    while (fgets(line, (int)sizeof(line), fp) != NULL) {
-        sg_trim_ascii_inplace(line);
-        if (line[0] == '\0' || line[0] == '#') {
-            continue;
+    sg_cbor_doc_reader reader;
+    reader.data = data;
+    reader.len = len;
+    reader.idx = 1;
+    reader.arena = arena;
+    int ai = data[0] & 0x1f;
+    unsigned long long count = 0;
+    if (ai != 31) {
+        int len_rc = sg_cbor_read_length_by_ai(data, len, &reader.idx, ai, &count);
+        if (len_rc <= 0) {
+            return len_rc;
         }
-        if (sg_ascii_case_contains(name, line)) {
-            matched = 1;
+    }
+    sg_cbor_node* root = sg_cbor_arena_node(arena);
+    if (root == NULL) {
+        return -1;
+    }
+    root->kind = SG_CBOR_NODE_ARRAY;
+    sg_cbor_node** tail = &root->child;
+    size_t items = 0;
+    while (items < max_items) {
+        if (ai == 31) {
+            if (reader.idx >= len) {
+                return 0;
+            }
+            if (data[reader.idx] == 0xff) {
+                break;
+            }
+        } else if ((unsigned long long)items >= count) {
             break;
         }
+        int rc = sg_cbor_doc_read_item(&reader, 1, tail);
+        if (rc <= 0) {
+            return rc;
+        }
+        tail = &(*tail)->next;
+        items += 1;
     }
-    fclose(fp);
-    return matched;
+    root->len = items;
+    *out_root = root;
+    return 1;
 }
 
-static int sg_validate_user_name_policy(const char* name, char* out_error, size_t out_error_cap) {
-    if (!sg_is_valid_user_name_token(name)) {
-        snprintf(out_error, out_error_cap, "%s", "invalid user name");
-        return 0;
+static int sg_cbor_parse_wire_packet(
+    const unsigned char* data,
+    size_t len,
+    sg_cbor_wire_packet* out,
+    size_t* consumed
+) {
+    if (data == NULL || out == NULL || consumed == NULL) {
+        return -1;
     }
-    if (sg_name_contains_ban_word(name)) {
-        snprintf(out_error, out_error_cap, "%s", "invalid user name");
+    if (len == 0) {
         return 0;
     }
-    if (!sg_name_in_whitelist(name)) {
-        snprintf(out_error, out_error_cap, "%s", "user name not in whitelist");
-        return 0;
+
+    size_t idx = 0;
+    unsigned char head = data[idx];
+    int major = (head >> 5) & 0x07;
+    int ai = head & 0x1f;
+    if (major != 4) {
+        return -1;
     }
-    return 1;
-}
+    idx += 1;
 
-static uint32_t sg_rotr32(uint32_t value, uint32_t bits) {
-    return (value >> bits) | (value << (32U - bits));
-}
+    unsigned long long field_count = 0;
+    int len_rc = sg_cbor_read_length_by_ai(data, len, &idx, ai, &field_count);
+    if (len_rc <= 0) {
+        return len_rc;
+    }
+    if (field_count != 4 && field_count != 6) {
+        return -1;
+    }
 
-static int sg_is_hex_string(const char* text, size_t exact_len) {
-    if (text == NULL) {
-        return 0;
+    long long request_id = 0;
+    long long packet_type = 0;
+    long long timeout = 0;
+    long long timestamp = 0;
+    int command_major = 0;
+    int payload_major = 0;
+    const unsigned char* command_ptr = NULL;
+    const unsigned char* payload_ptr = NULL;
+    size_t command_len = 0;
+    size_t payload_len = 0;
+
+    int rc = sg_cbor_read_signed_integer(data, len, &idx, &request_id);
+    if (rc <= 0) {
+        return rc;
     }
-    size_t len = strlen(text);
-    if (len != exact_len) {
-        return 0;
+    rc = sg_cbor_read_signed_integer(data, len, &idx, &packet_type);
+    if (rc <= 0) {
+        return rc;
     }
-    for (size_t i = 0; i < len; i++) {
-        unsigned char ch = (unsigned char)text[i];
-        int is_digit = (ch >= '0' && ch <= '9');
-        int is_lower = (ch >= 'a' && ch <= 'f');
-        int is_upper = (ch >= 'A' && ch <= 'F');
-        if (!is_digit && !is_lower && !is_upper) {
-            return 0;
+    rc = sg_cbor_read_bytes_like(data, len, &idx, &command_major, &command_ptr, &command_len);
+    if (rc <= 0) {
+        return rc;
+    }
+    rc = sg_cbor_read_bytes_like(data, len, &idx, &payload_major, &payload_ptr, &payload_len);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    if (field_count == 6) {
+        rc = sg_cbor_read_signed_integer(data, len, &idx, &timeout);
+        if (rc <= 0) {
+            return rc;
+        }
+        rc = sg_cbor_read_signed_integer(data, len, &idx, &timestamp);
+        if (rc <= 0) {
+            return rc;
         }
     }
+
+    out->request_id = request_id;
+    out->packet_type = packet_type;
+    out->command_major = command_major;
+    out->command_ptr = command_ptr;
+    out->command_len = command_len;
+    out->payload_major = payload_major;
+    out->payload_ptr = payload_ptr;
+    out->payload_len = payload_len;
+    out->field_count = (int)field_count;
+    out->timeout = timeout;
+    out->timestamp = timestamp;
+    *consumed = idx;
     return 1;
 }
 
-static void sg_bytes_to_hex_lower(const unsigned char* data, size_t len, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
-        return;
-    }
-    out[0] = '\0';
-    if (data == NULL || len == 0) {
-        return;
-    }
-    static const char* k_hex = "0123456789abcdef";
-    size_t max_bytes = (out_cap - 1) / 2;
-    if (len > max_bytes) {
-        len = max_bytes;
-    }
-    for (size_t i = 0; i < len; i++) {
-        unsigned char b = data[i];
-        out[i * 2] = k_hex[(b >> 4) & 0x0f];
-        out[i * 2 + 1] = k_hex[b & 0x0f];
+static uint64_t sg_load_be64(const unsigned char* p) {
+#if SG_HAVE_BSWAP
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return SG_LITTLE_ENDIAN ? SG_BSWAP64(v) : v;
+#else
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | (uint64_t)p[i];
     }
-    out[len * 2] = '\0';
+    return v;
+#endif
 }
 
-static void sg_sha256_transform(uint32_t state[8], const unsigned char block[64]) {
-    static const uint32_t k[64] = {
-        0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
-        0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
-        0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
-        0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
-        0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
-        0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
-        0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
-        0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U
-    };
+static unsigned sg_cbor_fast_extra(unsigned head) {
+    unsigned ai = head & 0x1f;
+    return ai < 24 ? 0u : (1u << (ai & 3));
+}
 
-    uint32_t w[64];
-    for (size_t i = 0; i < 16; i++) {
-        size_t off = i * 4;
-        w[i] =
-            ((uint32_t)block[off] << 24) |
-            ((uint32_t)block[off + 1] << 16) |
-            ((uint32_t)block[off + 2] << 8) |
-            ((uint32_t)block[off + 3]);
+static unsigned long long sg_cbor_fast_arg(const unsigned char* p, unsigned head, unsigned extra) {
+    unsigned long long wide = (unsigned long long)sg_load_be64(p + 1);
+    unsigned long long immediate = (unsigned long long)(head & 0x1f);
+    return extra == 0 ? immediate : wide >> ((64 - 8 * extra) & 63);
+}
+
+static int sg_cbor_fast_signed(const unsigned char** cursor, long long* out) {
+    const unsigned char* p = *cursor;
+    unsigned head = p[0];
+    if (head >= 0x40 || (head & 0x1c) == 0x1c) {
+        return -1;
     }
-    for (size_t i = 16; i < 64; i++) {
-        uint32_t s0 = sg_rotr32(w[i - 15], 7) ^ sg_rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
-        uint32_t s1 = sg_rotr32(w[i - 2], 17) ^ sg_rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
-        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    unsigned extra = sg_cbor_fast_extra(head);
+    unsigned long long uval = sg_cbor_fast_arg(p, head, extra);
+    if (uval > (unsigned long long)LLONG_MAX) {
+        return -1;
     }
+    *out = (head < 0x20 ? (long long)uval : -1 - (long long)uval);
+    *cursor = p + 1 + extra;
+    return 1;
+}
 
-    uint32_t a = state[0];
-    uint32_t b = state[1];
-    uint32_t c = state[2];
-    uint32_t d = state[3];
-    uint32_t e = state[4];
-    uint32_t f = state[5];
-    uint32_t g = state[6];
-    uint32_t h = state[7];
-
-    for (size_t i = 0; i < 64; i++) {
-        uint32_t s1 = sg_rotr32(e, 6) ^ sg_rotr32(e, 11) ^ sg_rotr32(e, 25);
-        uint32_t ch = (e & f) ^ ((~e) & g);
-        uint32_t temp1 = h + s1 + ch + k[i] + w[i];
-        uint32_t s0 = sg_rotr32(a, 2) ^ sg_rotr32(a, 13) ^ sg_rotr32(a, 22);
-        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
-        uint32_t temp2 = s0 + maj;
-
-        h = g;
-        g = f;
-        f = e;
-        e = d + temp1;
-        d = c;
-        c = b;
-        b = a;
-        a = temp1 + temp2;
+static int sg_cbor_fast_bytes_like(
+    const unsigned char** cursor,
+    const unsigned char* end,
+    int* out_major,
+    const unsigned char** out_ptr,
+    size_t* out_len
+) {
+    const unsigned char* p = *cursor;
+    unsigned head = p[0];
+    if (head - 0x40u >= 0x40u || (head & 0x1c) == 0x1c) {
+        return -1;
     }
-
-    state[0] += a;
-    state[1] += b;
-    state[2] += c;
-    state[3] += d;
-    state[4] += e;
-    state[5] += f;
-    state[6] += g;
-    state[7] += h;
+    unsigned extra = sg_cbor_fast_extra(head);
+    unsigned long long blen = sg_cbor_fast_arg(p, head, extra);
+    p += 1 + extra;
+    if (blen > (unsigned long long)(end - p)) {
+        return 0;
+    }
+    *out_major = (int)(head >> 5);
+    *out_ptr = p;
+    *out_len = (size_t)blen;
+    *cursor = p + (size_t)blen;
+    return 1;
 }
 
-static void sg_sha256_digest_bytes(const unsigned char* data, size_t len, unsigned char out[32]) {
-    uint32_t state[8] = {
-        0x6a09e667U,
-        0xbb67ae85U,
-        0x3c6ef372U,
-        0xa54ff53aU,
-        0x510e527fU,
-        0x9b05688cU,
-        0x1f83d9abU,
-        0x5be0cd19U
-    };
-
-    size_t offset = 0;
-    while (offset + 64 <= len) {
-        sg_sha256_transform(state, data + offset);
-        offset += 64;
+static int sg_cbor_parse_wire_packet_fast(
+    const unsigned char* data,
+    size_t len,
+    sg_cbor_wire_packet* out,
+    size_t* consumed,
+    sg_wire_parse_state* resume
+) {
+    if (data == NULL || out == NULL || consumed == NULL || len < 1 + 2 * SG_CBOR_FIELD_MAX) {
+        return sg_cbor_parse_wire_packet(data, len, out, consumed);
+    }
+    int field_count = (data[0] == 0x84 ? 4 : (data[0] == 0x86 ? 6 : 0));
+    if (field_count == 0) {
+        return sg_cbor_parse_wire_packet(data, len, out, consumed);
     }
 
-    unsigned char tail[128];
-    size_t rem = len - offset;
-    if (rem > 0) {
-        memcpy(tail, data + offset, rem);
+    const unsigned char* end = data + len;
+    const unsigned char* p = data + 1;
+    long long ints[4] = { 0, 0, 0, 0 };
+    if (sg_cbor_fast_signed(&p, &ints[0]) <= 0 || sg_cbor_fast_signed(&p, &ints[1]) <= 0) {
+        return -1;
     }
-    tail[rem] = 0x80;
-    size_t pad_base = rem + 1;
-    size_t pad_len = (pad_base + 8 <= 64) ? (64 - pad_base - 8) : (128 - pad_base - 8);
-    if (pad_len > 0) {
-        memset(tail + pad_base, 0, pad_len);
+
+    int majors[2] = { 0, 0 };
+    const unsigned char* ptrs[2] = { NULL, NULL };
+    size_t lens[2] = { 0, 0 };
+    int field = 3;
+    const unsigned char* field_start = p;
+    int rc = 1;
+    for (int i = 0; i < 2 && rc > 0; i++, field++) {
+        field_start = p;
+        if (end - p >= SG_CBOR_FIELD_MAX) {
+            rc = sg_cbor_fast_bytes_like(&p, end, &majors[i], &ptrs[i], &lens[i]);
+        } else {
+            size_t idx = (size_t)(p - data);
+            rc = sg_cbor_read_bytes_like(data, len, &idx, &majors[i], &ptrs[i], &lens[i]);
+            p = data + idx;
+        }
     }
-    size_t len_pos = pad_base + pad_len;
-    uint64_t bit_len = (uint64_t)len * 8ULL;
-    tail[len_pos + 0] = (unsigned char)(bit_len >> 56);
-    tail[len_pos + 1] = (unsigned char)(bit_len >> 48);
-    tail[len_pos + 2] = (unsigned char)(bit_len >> 40);
-    tail[len_pos + 3] = (unsigned char)(bit_len >> 32);
-    tail[len_pos + 4] = (unsigned char)(bit_len >> 24);
-    tail[len_pos + 5] = (unsigned char)(bit_len >> 16);
-    tail[len_pos + 6] = (unsigned char)(bit_len >> 8);
-    tail[len_pos + 7] = (unsigned char)(bit_len);
-
-    size_t total_tail = len_pos + 8;
-    for (size_t i = 0; i < total_tail; i += 64) {
-        sg_sha256_transform(state, tail + i);
+    if (rc > 0 && field_count == 6) {
+        if (end - p >= 2 * SG_CBOR_FIELD_MAX) {
+            rc = sg_cbor_fast_signed(&p, &ints[2]);
+            if (rc > 0) {
+                rc = sg_cbor_fast_signed(&p, &ints[3]);
+            }
+            field += 2;
+        } else {
+            for (int i = 2; i < 4 && rc > 0; i++, field++) {
+                field_start = p;
+                size_t idx = (size_t)(p - data);
+                rc = sg_cbor_read_signed_integer(data, len, &idx, &ints[i]);
+                p = data + idx;
+            }
+        }
     }
-
-    for (size_t i = 0; i < 8; i++) {
-        out[i * 4 + 0] = (unsigned char)(state[i] >> 24);
-        out[i * 4 + 1] = (unsigned char)(state[i] >> 16);
-        out[i * 4 + 2] = (unsigned char)(state[i] >> 8);
-        out[i * 4 + 3] = (unsigned char)(state[i]);
+    if (rc < 0) {
+        return rc;
+    }
+    if (rc == 0) {
+        if (resume != NULL) {
+            field -= 1;
+            resume->field = field;
+            resume->field_count = field_count;
+            resume->offset = (size_t)(field_start - data);
+            resume->need = 0;
+            memcpy(resume->ints, ints, sizeof(resume->ints));
+            for (int i = 0; i < 2 && 3 + i < field; i++) {
+                resume->string_major[i] = majors[i];
+                resume->string_at[i] = (size_t)(ptrs[i] - data);
+                resume->string_len[i] = lens[i];
+            }
+        }
+        return 0;
     }
+
+    out->request_id = ints[0];
+    out->packet_type = ints[1];
+    out->command_major = majors[0];
+    out->command_ptr = ptrs[0];
+    out->command_len = lens[0];
+    out->payload_major = majors[1];
+    out->payload_ptr = ptrs[1];
+    out->payload_len = lens[1];
+    out->field_count = field_count;
+    out->timeout = ints[2];
+    out->timestamp = ints[3];
+    *consumed = (size_t)(p - data);
+    return 1;
 }
 
-static int sg_sha256_password_with_salt_hex(const char* password, const char* salt, char* out_hex, size_t out_hex_cap) {
-    if (password == NULL || salt == NULL || out_hex == NULL || out_hex_cap < 65) {
+static int sg_wire_parser_step(
+    sg_wire_parse_state* state,
+    const unsigned char* data,
+    size_t len,
+    sg_cbor_wire_packet* out,
+    size_t* consumed
+) {
+    if (len < state->need) {
         return 0;
     }
-    size_t pass_len = strlen(password);
-    size_t salt_len = strlen(salt);
-    if (salt_len == 0 || salt_len > 31) {
-        return 0;
+    if (state->field == 0 && len >= 1 + 2 * SG_CBOR_FIELD_MAX && (data[0] == 0x84 || data[0] == 0x86)) {
+        int fast_rc = sg_cbor_parse_wire_packet_fast(data, len, out, consumed, state);
+        if (fast_rc != 0) {
+            memset(state, 0, sizeof(*state));
+            return fast_rc;
+        }
     }
-    if (pass_len + salt_len > 4096) {
+
+    size_t idx = state->offset;
+    int rc = 1;
+    while (state->field == 0 || state->field <= state->field_count) {
+        size_t start = idx;
+        size_t need = 0;
+        int field = state->field;
+        if (field == 0) {
+            unsigned long long count = 0;
+            rc = (idx < len ? 1 : 0);
+            if (rc > 0 && ((data[idx] >> 5) & 0x07) != 4) {
+                rc = -1;
+            }
+            if (rc > 0) {
+                idx += 1;
+                rc = sg_cbor_read_length_by_ai(data, len, &idx, data[start] & 0x1f, &count);
+            }
+            if (rc > 0 && count != 4 && count != 6) {
+                rc = -1;
+            }
+            state->field_count = (int)count;
+        } else if (field == 3 || field == 4) {
+            unsigned long long blen = 0;
+            int major = 0;
+            rc = (idx < len ? 1 : 0);
+            if (rc > 0) {
+                major = (data[idx] >> 5) & 0x07;
+                rc = (major == 2 || major == 3 ? 1 : -1);
+            }
+            if (rc > 0) {
+                idx += 1;
+                rc = sg_cbor_read_length_by_ai(data, len, &idx, data[start] & 0x1f, &blen);
+            }
+            if (rc > 0 && blen > (unsigned long long)(len - idx)) {
+                need = (blen > (unsigned long long)(SIZE_MAX - idx) ? SIZE_MAX : idx + (size_t)blen);
+                rc = 0;
+            }
+            if (rc > 0) {
+                state->string_major[field - 3] = major;
+                state->string_at[field - 3] = idx;
+                state->string_len[field - 3] = (size_t)blen;
+                idx += (size_t)blen;
+            }
+        } else {
+            rc = sg_cbor_read_signed_integer(data, len, &idx, &state->ints[field < 3 ? field - 1 : field - 3]);
+        }
+        if (rc < 0) {
+            memset(state, 0, sizeof(*state));
+            return -1;
+        }
+        if (rc == 0) {
+            if (need == 0) {
+                need = start + 1 + (start < len ? (size_t)sg_cbor_fast_extra(data[start]) : 0);
+            }
+            state->offset = start;
+            state->need = need;
+            return 0;
+        }
+        state->field += 1;
+        state->offset = idx;
+    }
+
+    out->request_id = state->ints[0];
+    out->packet_type = state->ints[1];
+    out->command_major = state->string_major[0];
+    out->command_ptr = data + state->string_at[0];
+    out->command_len = state->string_len[0];
+    out->payload_major = state->string_major[1];
+    out->payload_ptr = data + state->string_at[1];
+    out->payload_len = state->string_len[1];
+    out->field_count = state->field_count;
+    out->timeout = state->ints[2];
+    out->timestamp = state->ints[3];
+    *consumed = idx;
+    memset(state, 0, sizeof(*state));
+    return 1;
+}
+
+static int sg_cbor_write_type_and_len(unsigned char* out, size_t out_cap, size_t* idx, int major, unsigned long long len_value) {
+    if (out == NULL || idx == NULL || major < 0 || major > 7) {
         return 0;
     }
-    unsigned char* input = (unsigned char*)malloc(pass_len + salt_len);
-    if (input == NULL) {
+    if (len_value < 24ULL) {
+        if (*idx + 1 > out_cap) {
+            return 0;
+        }
+        out[*idx] = (unsigned char)((major << 5) | (int)len_value);
+        *idx += 1;
+        return 1;
+    }
+    if (len_value <= 0xffULL) {
+        if (*idx + 2 > out_cap) {
+            return 0;
+        }
+        out[*idx] = (unsigned char)((major << 5) | 24);
+        out[*idx + 1] = (unsigned char)len_value;
+        *idx += 2;
+        return 1;
+    }
+    if (len_value <= 0xffffULL) {
+        if (*idx + 3 > out_cap) {
+            return 0;
+        }
+        out[*idx] = (unsigned char)((major << 5) | 25);
+        out[*idx + 1] = (unsigned char)(len_value >> 8);
+        out[*idx + 2] = (unsigned char)(len_value);
+        *idx += 3;
+        return 1;
+    }
+    if (len_value <= 0xffffffffULL) {
+        if (*idx + 5 > out_cap) {
+            return 0;
+        }
+        out[*idx] = (unsigned char)((major << 5) | 26);
+        out[*idx + 1] = (unsigned char)(len_value >> 24);
+        out[*idx + 2] = (unsigned char)(len_value >> 16);
+        out[*idx + 3] = (unsigned char)(len_value >> 8);
+        out[*idx + 4] = (unsigned char)(len_value);
+        *idx += 5;
+        return 1;
+    }
+    if (*idx + 9 > out_cap) {
         return 0;
     }
-    memcpy(input, password, pass_len);
-    memcpy(input + pass_len, salt, salt_len);
-
-    unsigned char digest[32];
-    sg_sha256_digest_bytes(input, pass_len + salt_len, digest);
-    free(input);
-
-    sg_bytes_to_hex_lower(digest, sizeof(digest), out_hex, out_hex_cap);
-    return out_hex[0] != '\0';
+    out[*idx] = (unsigned char)((major << 5) | 27);
+    out[*idx + 1] = (unsigned char)(len_value >> 56);
+    out[*idx + 2] = (unsigned char)(len_value >> 48);
+    out[*idx + 3] = (unsigned char)(len_value >> 40);
+    out[*idx + 4] = (unsigned char)(len_value >> 32);
+    out[*idx + 5] = (unsigned char)(len_value >> 24);
+    out[*idx + 6] = (unsigned char)(len_value >> 16);
+    out[*idx + 7] = (unsigned char)(len_value >> 8);
+    out[*idx + 8] = (unsigned char)(len_value);
+    *idx += 9;
+    return 1;
 }
 
-static int sg_generate_salt_hex8(char* out, size_t out_cap) {
-    if (out == NULL || out_cap < 9) {
-        return 0;
-    }
-    static int seeded = 0;
-    if (!seeded) {
-        unsigned int seed = (unsigned int)time(NULL);
-        seed ^= (unsigned int)(sg_monotonic_ms() & 0xffffffffU);
-        srand(seed);
-        seeded = 1;
+static int sg_cbor_write_signed_integer(unsigned char* out, size_t out_cap, size_t* idx, long long value) {
+    if (value >= 0) {
+        return sg_cbor_write_type_and_len(out, out_cap, idx, 0, (unsigned long long)value);
     }
-    unsigned int value = (((unsigned int)rand()) << 16) ^ (unsigned int)rand();
-    int written = snprintf(out, out_cap, "%08x", value);
-    return written == 8;
+    return sg_cbor_write_type_and_len(out, out_cap, idx, 1, (unsigned long long)(-1 - value));
 }
 
-static int sg_parse_inline_sha256_password(
-    const char* stored_password,
-    char* out_salt,
-    size_t out_salt_cap,
-    char* out_hash,
-    size_t out_hash_cap
+static int sg_cbor_write_bytes_like(
+    unsigned char* out,
+    size_t out_cap,
+    size_t* idx,
+    int major,
+    const unsigned char* data,
+    size_t data_len
 ) {
-    if (stored_password == NULL || out_salt == NULL || out_hash == NULL || out_salt_cap == 0 || out_hash_cap == 0) {
-        return 0;
+    if (major != 2 && major != 3) {
+        major = 2;
     }
-    out_salt[0] = '\0';
-    out_hash[0] = '\0';
-    if (strncmp(stored_password, "sha256:", 7) != 0) {
+    if (!sg_cbor_write_type_and_len(out, out_cap, idx, major, (unsigned long long)data_len)) {
         return 0;
     }
-    const char* salt = stored_password + 7;
-    const char* sep = strchr(salt, ':');
-    if (sep == NULL || sep == salt) {
+    if (*idx + data_len > out_cap) {
         return 0;
     }
-    size_t salt_len = (size_t)(sep - salt);
-    const char* hash = sep + 1;
-    if (salt_len + 1 > out_salt_cap || strlen(hash) + 1 > out_hash_cap) {
-        return 0;
+    if (data_len > 0 && data != NULL) {
+        memcpy(out + *idx, data, data_len);
     }
-    memcpy(out_salt, salt, salt_len);
-    out_salt[salt_len] = '\0';
-    snprintf(out_hash, out_hash_cap, "%s", hash);
-    return sg_is_hex_string(out_hash, 64);
+    *idx += data_len;
+    return 1;
 }
 
-static int sg_parse_user_record_line(const char* line_text, sg_auth_user_record* out, long long* max_id) {
-    if (line_text == NULL || out == NULL) {
-        return 0;
+static void sg_packet_token(const unsigned char* src, size_t src_len, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return;
     }
-    char line[SG_AUTH_LINE_MAX];
-    snprintf(line, sizeof(line), "%s", line_text);
-    sg_trim_ascii_inplace(line);
-    if (line[0] == '\0' || line[0] == '#') {
-        return 0;
+    size_t limit = src_len;
+    if (limit > out_cap - 1) {
+        limit = out_cap - 1;
     }
-
-    char* fields[8];
-    int field_count = sg_pipe_split_fields(line, fields, 8);
-    if (field_count < 6) {
-        return 0;
+    for (size_t i = 0; i < limit; i++) {
+        unsigned char ch = src[i];
+        if (ch >= 32 && ch <= 126) {
+            out[i] = (char)ch;
+        } else {
+            out[i] = '.';
+        }
     }
+    out[limit] = '\0';
+}
 
-    long long id = sg_parse_i64_cstr(fields[0], 0);
-    if (id <= 0) {
-        return 0;
+static void sg_copy_token_to_cstr(const unsigned char* src, size_t src_len, char* dst, size_t dst_cap) {
+    if (dst == NULL || dst_cap == 0) {
+        return;
     }
-    if (max_id != NULL && id > *max_id) {
-        *max_id = id;
+    size_t copy_len = src_len;
+    if (copy_len > dst_cap - 1) {
+        copy_len = dst_cap - 1;
+    }
+    if (copy_len > 0 && src != NULL) {
+        memcpy(dst, src, copy_len);
     }
+    dst[copy_len] = '\0';
+}
 
-    out->found = 1;
-    out->id = id;
-    snprintf(out->name, sizeof(out->name), "%s", fields[1]);
-    snprintf(out->password, sizeof(out->password), "%s", fields[2]);
-    out->salt[0] = '\0';
-    if (field_count >= 7 && fields[6] != NULL && fields[6][0] != '\0') {
-        snprintf(out->salt, sizeof(out->salt), "%s", fields[6]);
+static int sg_command_lookup(const unsigned char* name, size_t len) {
+    if (name == NULL || len == 0 || len > 255) {
+        return SG_COMMAND_UNKNOWN;
     }
-    snprintf(out->avatar, sizeof(out->avatar), "%s", fields[3]);
-    out->banned = (int)sg_parse_i64_cstr(fields[4], 0);
-    out->ban_expire_epoch = sg_parse_i64_cstr(fields[5], 0);
-    if (out->avatar[0] == '\0') {
-        snprintf(out->avatar, sizeof(out->avatar), "%s", "liubei");
+    uint32_t h = SG_COMMAND_HASH_SEED;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint32_t)name[i]) * 16777619u;
     }
-    return 1;
+    h ^= h >> 15;
+    int id = (int)g_command_hash_slots[h & (SG_COMMAND_HASH_SLOTS - 1)];
+    if (id == SG_COMMAND_UNKNOWN || g_command_name_lengths[id] != len || memcmp(g_command_names[id], name, len) != 0) {
+        return SG_COMMAND_UNKNOWN;
+    }
+    return id;
 }
 
-static int sg_load_auth_user_record(const char* user_file, const char* user_name, sg_auth_user_record* out, long long* max_id) {
-    if (out == NULL || user_name == NULL) {
+static int sg_parse_setup_payload(const unsigned char* payload, size_t payload_len, sg_setup_fields* out) {
+    if (payload == NULL || out == NULL || payload_len == 0) {
         return 0;
     }
     memset(out, 0, sizeof(*out));
-    if (max_id != NULL) {
-        *max_id = 0;
-    }
-    FILE* fp = fopen(user_file, "rb");
-    if (fp == NULL) {
-        return 1;
-    }
 
-    char line[SG_AUTH_LINE_MAX];
-    while (fgets(line, (int)sizeof(line), fp) != NULL) {
-        sg_auth_user_record record;
-        memset(&record, 0, sizeof(record));
-        if (!sg_parse_user_record_line(line, &record, max_id)) {
-            continue;
+    sg_cbor_node nodes[16];
+    sg_cbor_arena arena;
+    sg_cbor_arena_init(&arena, nodes, sizeof(nodes) / sizeof(nodes[0]), 256);
+    sg_cbor_node* root = NULL;
+    int ok = sg_cbor_doc_parse_array_prefix(&arena, payload, payload_len, 5, &root) > 0 &&
+        root->kind == SG_CBOR_NODE_ARRAY &&
+        root->len >= 5;
+
+    const sg_cbor_node* field = ok ? root->child : NULL;
+    for (int i = 0; ok && i < 5; i++, field = field->next) {
+        if (field->kind != SG_CBOR_NODE_BYTES && field->kind != SG_CBOR_NODE_TEXT) {
+            ok = 0;
+            break;
         }
-        if (strcmp(record.name, user_name) == 0) {
-            *out = record;
+        if (i == 0) {
+            sg_copy_token_to_cstr(field->ptr, field->len, out->name, sizeof(out->name));
+        } else if (i == 1) {
+            out->password_major = field->kind == SG_CBOR_NODE_TEXT ? 3 : 2;
+            if (field->len > sizeof(out->password_raw)) {
+                ok = 0;
+                break;
+            }
+            if (field->len > 0) {
+                memcpy(out->password_raw, field->ptr, field->len);
+            }
+            out->password_raw_len = field->len;
+            sg_copy_token_to_cstr(field->ptr, field->len, out->password, sizeof(out->password));
+        } else if (i == 2) {
+            sg_copy_token_to_cstr(field->ptr, field->len, out->md5, sizeof(out->md5));
+        } else if (i == 3) {
+            sg_copy_token_to_cstr(field->ptr, field->len, out->version, sizeof(out->version));
+        } else if (i == 4) {
+            sg_copy_token_to_cstr(field->ptr, field->len, out->uuid, sizeof(out->uuid));
         }
     }
-    fclose(fp);
-    return 1;
+    sg_cbor_arena_release(&arena);
+    return ok && out->name[0] != '\0' && out->version[0] != '\0';
 }
 
-static int sg_count_uuid_bindings(const char* binding_file, const char* uuid) {
-    if (binding_file == NULL || uuid == NULL || uuid[0] == '\0') {
+static int sg_parse_version_triplet(const char* version_text, int* major_out, int* minor_out, int* patch_out) {
+    if (version_text == NULL || major_out == NULL || minor_out == NULL || patch_out == NULL) {
         return 0;
     }
-    FILE* fp = fopen(binding_file, "rb");
-    if (fp == NULL) {
+    const char* p = version_text;
+    if (*p == 'v' || *p == 'V') {
+        p += 1;
+    }
+    char* end = NULL;
+    long major = strtol(p, &end, 10);
+    if (end == p || *end != '.') {
         return 0;
     }
-
-    int count = 0;
-    char line[SG_AUTH_LINE_MAX];
-    while (fgets(line, (int)sizeof(line), fp) != NULL) {
-        sg_trim_ascii_inplace(line);
-        if (line[0] == '\0' || line[0] == '#') {
-            continue;
-        }
-        char* sep = strchr(line, '|');
-        if (sep == NULL) {
-            continue;
-        }
-        *sep = '\0';
-        if (strcmp(line, uuid) == 0) {
-            count += 1;
-        }
+    p = end + 1;
+    long minor = strtol(p, &end, 10);
+    if (end == p || *end != '.') {
+        return 0;
     }
-    fclose(fp);
-    return count;
+    p = end + 1;
+    long patch = strtol(p, &end, 10);
+    if (end == p) {
+        return 0;
+    }
+    if (major < 0 || minor < 0 || patch < 0 || major > 1000 || minor > 1000 || patch > 1000000) {
+        return 0;
+    }
+    *major_out = (int)major;
+    *minor_out = (int)minor;
+    *patch_out = (int)patch;
+    return 1;
 }
 
-static int sg_append_auth_line(const char* path, const char* line) {
-    if (path == NULL || path[0] == '\0' || line == NULL) {
+static int sg_is_supported_client_version(const char* version_text) {
+    int major = 0;
+    int minor = 0;
+    int patch = 0;
+    if (!sg_parse_version_triplet(version_text, &major, &minor, &patch)) {
         return 0;
     }
-
-    if (strncmp(path, ".tmp/runtime_host/", 18) == 0) {
-        sg_mkdir(".tmp");
-        sg_mkdir(".tmp/runtime_host");
+    if (major != 0) {
+        return 0;
     }
-
-    FILE* fp = fopen(path, "ab");
-    if (fp == NULL) {
+    if (minor != 5) {
         return 0;
     }
-    size_t line_len = strlen(line);
-    size_t wrote_line = fwrite(line, 1, line_len, fp);
-    size_t wrote_nl = fwrite("\n", 1, 1, fp);
-    fclose(fp);
-    return wrote_line == line_len && wrote_nl == 1;
+    return patch >= 19;
 }
 
-static int sg_format_user_record_line(
-    const sg_auth_user_record* record,
-    int banned,
-    long long ban_expire_epoch,
-    char* out,
-    size_t out_cap
+static int sg_build_server_notify_header(
+    unsigned char* out,
+    size_t out_cap,
+    const char* command,
+    size_t payload_len,
+    int payload_major,
+    size_t* out_len
 ) {
-    if (record == NULL || out == NULL || out_cap == 0) {
+    if (out == NULL || out_cap == 0 || command == NULL || out_len == NULL) {
         return 0;
     }
-    int written = 0;
-    if (record->salt[0] != '\0') {
-        written = snprintf(
-            out,
-            out_cap,
-            "%lld|%s|%s|%s|%d|%lld|%s",
-            record->id,
-            record->name,
-            record->password,
-            record->avatar,
-            banned,
-            ban_expire_epoch,
-            record->salt
-        );
-    } else {
-        written = snprintf(
-            out,
-            out_cap,
-            "%lld|%s|%s|%s|%d|%lld",
-            record->id,
-            record->name,
-            record->password,
-            record->avatar,
-            banned,
-            ban_expire_epoch
-        );
+    if (payload_major != 2 && payload_major != 3) {
+        payload_major = 2;
     }
-    return written > 0 && written < (int)out_cap;
+    size_t idx = 0;
+    size_t command_len = strlen(command);
+    int ok = 1;
+    ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 4, 4);
+    ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, -2);
+    ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, SG_PACKET_TYPE_SERVER_NOTIFY);
+    ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 2, (const unsigned char*)command, command_len);
+    ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, payload_major, (unsigned long long)payload_len);
+    if (!ok) {
+        return 0;
+    }
+    *out_len = idx;
+    return 1;
 }
 
-static int sg_rewrite_user_ban_status(
-    const char* user_file,
-    const sg_auth_user_record* target,
-    int banned,
-    long long ban_expire_epoch
-) {
-    if (user_file == NULL || user_file[0] == '\0' || target == NULL || target->id <= 0 || target->name[0] == '\0') {
-        return 0;
+static sg_frame* sg_frame_server_notification(const char* command, const unsigned char* payload, size_t payload_len, int payload_major) {
+    unsigned char header[SG_NOTIFY_HEADER_MAX];
+    size_t header_len = 0;
+    if (!sg_build_server_notify_header(header, sizeof(header), command, payload_len, payload_major, &header_len)) {
+        return NULL;
     }
-    FILE* in = fopen(user_file, "rb");
-    if (in == NULL) {
-        return 0;
+    sg_frame* frame = sg_frame_alloc(header_len + payload_len);
+    if (frame == NULL) {
+        return NULL;
     }
+    memcpy(frame->data, header, header_len);
+    if (payload_len > 0) {
+        memcpy(frame->data + header_len, payload, payload_len);
+    }
+    return frame;
+}
 
-    char tmp_file[SG_AUTH_LINE_MAX];
-    int tmp_len = snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", user_file);
-    if (tmp_len <= 0 || tmp_len >= (int)sizeof(tmp_file)) {
-        fclose(in);
+static int sg_build_server_notify_packet(
+    unsigned char* out,
+    size_t out_cap,
+    const char* command,
+    const unsigned char* payload,
+    size_t payload_len,
+    int payload_major,
+    size_t* out_len
+) {
+    if (out == NULL || out_cap == 0 || command == NULL || out_len == NULL) {
         return 0;
     }
-    FILE* out = fopen(tmp_file, "wb");
-    if (out == NULL) {
-        fclose(in);
+    size_t idx = 0;
+    size_t command_len = strlen(command);
+    int ok = 1;
+    ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 4, 4);
+    ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, -2);
+    ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, SG_PACKET_TYPE_SERVER_NOTIFY);
+    ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 2, (const unsigned char*)command, command_len);
+    ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, payload_major, payload, payload_len);
+    if (!ok) {
         return 0;
     }
+    *out_len = idx;
+    return 1;
+}
 
-    int updated = 0;
-    char raw_line[SG_AUTH_LINE_MAX];
-    while (fgets(raw_line, (int)sizeof(raw_line), in) != NULL) {
-        char parse_line[SG_AUTH_LINE_MAX];
-        snprintf(parse_line, sizeof(parse_line), "%s", raw_line);
-        sg_auth_user_record parsed;
-        memset(&parsed, 0, sizeof(parsed));
-        if (sg_parse_user_record_line(parse_line, &parsed, NULL) &&
-            parsed.id == target->id &&
-            strcmp(parsed.name, target->name) == 0) {
-            char rewritten[SG_AUTH_LINE_MAX];
-            if (sg_format_user_record_line(target, banned, ban_expire_epoch, rewritten, sizeof(rewritten))) {
-                fwrite(rewritten, 1, strlen(rewritten), out);
-                fwrite("\n", 1, 1, out);
-                updated = 1;
-                continue;
-            }
-        }
-        fwrite(raw_line, 1, strlen(raw_line), out);
-    }
-
-    fclose(in);
-    fclose(out);
+static void sg_tcp_conn_cork(sg_tcp_conn* conn) {
+    conn->cork_depth += 1;
+}
 
-    if (!updated) {
-        remove(tmp_file);
-        return 0;
+static int sg_tcp_conn_uncork(sg_tcp_conn* conn) {
+    if (conn->cork_depth > 0) {
+        conn->cork_depth -= 1;
     }
-
-    if (remove(user_file) != 0) {
-        remove(tmp_file);
-        return 0;
+    if (conn->cork_depth > 0 || conn->out_head == NULL) {
+        return 1;
     }
-    if (rename(tmp_file, user_file) != 0) {
-        return 0;
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        sg_uring_queue_flush(conn);
+        return 1;
     }
-    return 1;
+    return sg_tcp_conn_flush(conn);
 }
 
-static int sg_format_ban_expire_local(long long epoch_sec, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0 || epoch_sec <= 0) {
+static int sg_tcp_conn_finish_flushed(long long handle) {
+    sg_tcp_conn* conn = sg_tcp_conn_find(handle);
+    if (conn == NULL) {
         return 0;
     }
-    time_t t = (time_t)epoch_sec;
-    struct tm tm_value;
-#ifdef _WIN32
-    if (localtime_s(&tm_value, &t) != 0) {
-        return 0;
+    if (!g_reactor->draining || conn->write_shut) {
+        return sg_tcp_conn_close(handle);
     }
+#ifdef _WIN32
+    shutdown(conn->socket, SD_SEND);
 #else
-    if (localtime_r(&t, &tm_value) == NULL) {
-        return 0;
+    shutdown(conn->socket, SHUT_WR);
+#endif
+    conn->write_shut = 1;
+    conn->read_paused = 0;
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        sg_uring_update_recv(conn);
+        return 1;
     }
 #endif
-    int written = snprintf(
-        out,
-        out_cap,
-        "%04d-%02d-%02d %02d:%02d:%02d.",
-        tm_value.tm_year + 1900,
-        tm_value.tm_mon + 1,
-        tm_value.tm_mday,
-        tm_value.tm_hour,
-        tm_value.tm_min,
-        tm_value.tm_sec
-    );
-    return written > 0 && written < (int)out_cap;
+    sg_tcp_conn_queue_pending(conn);
+    return 1;
 }
 
-static int sg_password_bytes_are_printable(const unsigned char* data, size_t len) {
-    if (data == NULL) {
+static int sg_tcp_conn_close_after_flush(long long handle) {
+    sg_tcp_conn* conn = sg_tcp_conn_find(handle);
+    if (conn == NULL) {
         return 0;
     }
-    for (size_t i = 0; i < len; i++) {
-        unsigned char ch = data[i];
-        if (ch < 32 || ch > 126) {
-            return 0;
-        }
+    if (conn->out_head == NULL) {
+        return sg_tcp_conn_finish_flushed(handle);
     }
+    conn->close_after_flush = 1;
+    conn->read_paused = 1;
+    sg_timer_arm(&conn->cold.timers[SG_TCP_TIMER_LINGER], handle, SG_TCP_TIMER_LINGER, sg_monotonic_ms() + SG_TCP_CLOSE_LINGER_MS);
     return 1;
 }
 
-static void sg_password_bytes_to_hex(const unsigned char* data, size_t len, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
-        return;
+static long long sg_tcp_connection_flush(long long conn_handle) {
+    sg_tcp_conn* conn = sg_tcp_conn_find(conn_handle);
+    if (conn == NULL) {
+        return -2;
     }
-    out[0] = '\0';
-    if (data == NULL || len == 0) {
-        return;
-    }
-    static const char* k_hex = "0123456789abcdef";
-    size_t max_bytes = (out_cap - 1) / 2;
-    if (len > max_bytes) {
-        len = max_bytes;
-    }
-    for (size_t i = 0; i < len; i++) {
-        unsigned char b = data[i];
-        out[i * 2] = k_hex[(b >> 4) & 0x0f];
-        out[i * 2 + 1] = k_hex[b & 0x0f];
+    if (!sg_tcp_conn_flush(conn)) {
+        int err = sg_last_socket_error();
+        sg_tcp_conn_close(conn_handle);
+        sg_logf("WARN", "NET", "tcp send failed handle=%lld err=%d", conn_handle, err);
+        return -4;
     }
-    out[len * 2] = '\0';
-}
-
-static int sg_auth_rsa_decrypt_enabled(void) {
-    return sg_parse_bool_env("SENGOO_AUTH_RSA_DECRYPT_ENABLE", 0);
-}
-
-static const char* sg_auth_rsa_private_key_path(void) {
-    const char* raw = getenv("SENGOO_AUTH_RSA_PRIVATE_KEY_PATH");
-    if (raw == NULL || raw[0] == '\0') {
-        return "server/rsa";
+    if (conn->close_after_flush) {
+        if (conn->out_head == NULL && !conn->write_shut) {
+            sg_tcp_conn_finish_flushed(conn_handle);
+            return (sg_tcp_conn_find(conn_handle) == NULL ? -5 : 0);
+        }
+        return 0;
     }
-    return raw;
-}
-
-static const char* sg_auth_openssl_exe(void) {
-    const char* raw = getenv("SENGOO_AUTH_OPENSSL_EXE");
-    if (raw == NULL || raw[0] == '\0') {
-        return "openssl";
+    if (conn->read_paused && conn->out_bytes <= g_tcp_send_low_watermark) {
+        conn->read_paused = 0;
+        sg_logf("INFO", "NET", "tcp send backpressure released handle=%lld queued=%u", conn_handle, (unsigned)conn->out_bytes);
+        return 1;
     }
-    return raw;
+    return 0;
 }
 
-static int sg_try_decrypt_password_with_openssl(
-    const unsigned char* encrypted_bytes,
-    size_t encrypted_len,
-    char* out,
-    size_t out_cap
+static int sg_send_server_notification(
+    sg_tcp_conn* conn,
+    const char* command,
+    const unsigned char* payload,
+    size_t payload_len,
+    int payload_major
 ) {
-    if (out == NULL || out_cap == 0) {
+    unsigned char header[SG_NOTIFY_HEADER_MAX];
+    size_t header_len = 0;
+    if (conn == NULL || !sg_build_server_notify_header(header, sizeof(header), command, payload_len, payload_major, &header_len)) {
         return 0;
     }
-    out[0] = '\0';
-    if (encrypted_bytes == NULL || encrypted_len == 0 || encrypted_len > 8192) {
-        return 0;
-    }
-    if (!sg_auth_rsa_decrypt_enabled()) {
+    if (!sg_tcp_conn_output_fits(conn, header_len + payload_len)) {
         return 0;
     }
-
-    const char* openssl_exe = sg_auth_openssl_exe();
-    const char* private_key = sg_auth_rsa_private_key_path();
-    if (openssl_exe == NULL || openssl_exe[0] == '\0' || private_key == NULL || private_key[0] == '\0') {
-        return 0;
+    sg_tcp_conn_cork(conn);
+    int ok = sg_tcp_conn_send(conn, header, header_len);
+    if (ok && payload_len > 0) {
+        ok = sg_tcp_conn_send(conn, payload, payload_len);
     }
+    return sg_tcp_conn_uncork(conn) && ok;
+}
 
-    sg_mkdir(".tmp");
-    sg_mkdir(".tmp/runtime_host");
+static void sg_file_cache_reset(sg_file_cache* cache, const char* path) {
+    free(cache->data);
+    cache->data = NULL;
+    cache->len = 0;
+    cache->mtime = 0;
+    cache->size = 0;
+    cache->version += 1;
+    snprintf(cache->path, sizeof(cache->path), "%s", path);
+}
 
-    long long stamp = sg_monotonic_ms();
-    char in_path[SG_AUTH_LINE_MAX];
-    char out_path[SG_AUTH_LINE_MAX];
-    int in_len = snprintf(in_path, sizeof(in_path), ".tmp/runtime_host/auth_pw_in_%lld.bin", stamp);
-    int out_len = snprintf(out_path, sizeof(out_path), ".tmp/runtime_host/auth_pw_out_%lld.bin", stamp);
-    if (in_len <= 0 || in_len >= (int)sizeof(in_path) || out_len <= 0 || out_len >= (int)sizeof(out_path)) {
-        return 0;
+static int sg_file_cache_refresh(sg_file_cache* cache, const char* path) {
+    long long now_ms = sg_monotonic_ms();
+    int same_path = (strcmp(cache->path, path) == 0);
+    if (same_path && cache->checked_ms > 0 && now_ms - cache->checked_ms < SG_FILE_CACHE_RECHECK_MS) {
+        return cache->data != NULL;
     }
+    cache->checked_ms = now_ms;
 
-    FILE* in_fp = fopen(in_path, "wb");
-    if (in_fp == NULL) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        sg_file_cache_reset(cache, path);
         return 0;
     }
-    size_t wrote = fwrite(encrypted_bytes, 1, encrypted_len, in_fp);
-    fclose(in_fp);
-    if (wrote != encrypted_len) {
-        remove(in_path);
-        return 0;
+    if (same_path && cache->data != NULL && cache->mtime == (long long)st.st_mtime && cache->size == (long long)st.st_size) {
+        return 1;
     }
 
-    char cmd[SG_EXTENSION_CMD_MAX];
-#ifdef _WIN32
-    int cmd_len = snprintf(
-        cmd,
-        sizeof(cmd),
-        "\"%s\" pkeyutl -decrypt -inkey \"%s\" -in \"%s\" -out \"%s\" >nul 2>&1",
-        openssl_exe,
-        private_key,
-        in_path,
-        out_path
-    );
-#else
-    int cmd_len = snprintf(
-        cmd,
-        sizeof(cmd),
-        "\"%s\" pkeyutl -decrypt -inkey \"%s\" -in \"%s\" -out \"%s\" >/dev/null 2>&1",
-        openssl_exe,
-        private_key,
-        in_path,
-        out_path
-    );
-#endif
-    if (cmd_len <= 0 || cmd_len >= (int)sizeof(cmd)) {
-        remove(in_path);
+    sg_file_cache_reset(cache, path);
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
         return 0;
     }
-
-    int rc = system(cmd);
-    remove(in_path);
-    if (rc != 0) {
-        remove(out_path);
+    size_t cap = (st.st_size > 0 ? (size_t)st.st_size : 0);
+    char* data = (char*)malloc(cap + 1);
+    if (data == NULL) {
+        fclose(fp);
         return 0;
     }
+    size_t n = fread(data, 1, cap, fp);
+    fclose(fp);
+    data[n] = '\0';
+    cache->data = data;
+    cache->len = n;
+    cache->mtime = (long long)st.st_mtime;
+    cache->size = (long long)st.st_size;
+    return 1;
+}
 
-    FILE* out_fp = fopen(out_path, "rb");
-    if (out_fp == NULL) {
-        remove(out_path);
-        return 0;
-    }
-    unsigned char tmp[SG_AUTH_PASSWORD_MAX];
-    size_t n = fread(tmp, 1, sizeof(tmp), out_fp);
-    fclose(out_fp);
-    remove(out_path);
-    if (n == 0) {
-        return 0;
+static sg_frame* sg_network_delay_frame(void) {
+    const char* env_path = getenv("SENGOO_RSA_PUBLIC_KEY_PATH");
+    const char* key_path = (env_path != NULL && env_path[0] != '\0') ? env_path : "server/rsa_pub";
+    sg_runtime_lock();
+    int have_key = sg_file_cache_refresh(&g_rsa_public_key_cache, key_path) && g_rsa_public_key_cache.len > 0;
+    unsigned long long version = (have_key ? g_rsa_public_key_cache.version : 0);
+    if (g_network_delay_frame == NULL || g_network_delay_frame_version != version) {
+        const char* key = "SENGOO_FAKE_RSA_PUBLIC_KEY";
+        size_t key_len = strlen(key);
+        if (have_key) {
+            key = g_rsa_public_key_cache.data;
+            key_len = g_rsa_public_key_cache.len;
+        }
+        if (key_len > SG_AUTH_PUBLIC_KEY_MAX) {
+            key_len = SG_AUTH_PUBLIC_KEY_MAX;
+        }
+        sg_frame* frame = sg_frame_server_notification("NetworkDelayTest", (const unsigned char*)key, key_len, 2);
+        if (frame != NULL) {
+            sg_frame_release(g_network_delay_frame);
+            g_network_delay_frame = frame;
+            g_network_delay_frame_version = version;
+        }
     }
+    sg_frame* frame = sg_frame_retain(g_network_delay_frame);
+    sg_runtime_unlock();
+    return frame;
+}
 
-    size_t text_len = 0;
-    while (text_len < n && tmp[text_len] != '\0') {
-        text_len += 1;
+static int sg_send_network_delay_test(sg_tcp_conn* conn) {
+    sg_frame* frame = sg_network_delay_frame();
+    int ok = sg_tcp_conn_send_frame(conn, frame);
+    sg_frame_release(frame);
+    return ok;
+}
+
+static int sg_should_send_network_delay(void) {
+    const char* raw = getenv("SENGOO_AUTH_SEND_NETWORK_DELAY");
+    if (raw == NULL || raw[0] == '\0') {
+        return 1;
     }
-    if (text_len == 0) {
-        text_len = n;
+    if (strcmp(raw, "0") == 0 || strcmp(raw, "FALSE") == 0 || strcmp(raw, "false") == 0) {
+        return 0;
     }
-    if (text_len > out_cap - 1) {
-        text_len = out_cap - 1;
+    if (strcmp(raw, "OFF") == 0 || strcmp(raw, "off") == 0 || strcmp(raw, "NO") == 0 || strcmp(raw, "no") == 0) {
+        return 0;
     }
-    memcpy(out, tmp, text_len);
-    out[text_len] = '\0';
-    return text_len > 0;
+    return 1;
 }
 
-static int sg_should_strip_password_prefix32(void) {
-    return sg_parse_bool_env("SENGOO_AUTH_PASSWORD_STRIP32", 1);
+static int sg_send_errordlg_and_close(sg_tcp_conn* conn, const char* msg) {
+    const char* text = (msg == NULL ? "UNKNOWN ERROR" : msg);
+    size_t msg_len = strlen(text);
+    return sg_send_server_notification(conn, "ErrorDlg", (const unsigned char*)text, msg_len, 2);
 }
 
-static int sg_make_password_text_candidate(const sg_setup_fields* setup, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
-        return 0;
-    }
-    out[0] = '\0';
-    if (setup == NULL || setup->password_raw_len == 0) {
+static int sg_send_errordlg_raw(sg_socket_t socket, const char* msg) {
+    const char* text = (msg == NULL ? "UNKNOWN ERROR" : msg);
+    unsigned char frame[SG_AUTH_LINE_MAX];
+    size_t frame_len = 0;
+    if (!sg_build_server_notify_packet(frame, sizeof(frame), "ErrorDlg", (const unsigned char*)text, strlen(text), 2, &frame_len)) {
         return 0;
     }
-    if (!sg_password_bytes_are_printable(setup->password_raw, setup->password_raw_len)) {
+    return sg_send_all(socket, frame, frame_len);
+}
+
+static int sg_send_md5_failure_and_update_package(sg_tcp_conn* conn) {
+    const char* msg = "MD5 check failed!";
+    if (!sg_send_server_notification(conn, "ErrorMsg", (const unsigned char*)msg, strlen(msg), 2)) {
         return 0;
     }
-    size_t copy_len = setup->password_raw_len;
-    if (copy_len > out_cap - 1) {
-        copy_len = out_cap - 1;
+    unsigned char summary_payload[SG_EXTENSION_SYNC_PAYLOAD_MAX];
+    size_t summary_len = sg_build_update_package_summary(summary_payload, sizeof(summary_payload));
+    if (summary_len == 0) {
+        summary_payload[0] = 0x80;
+        summary_len = 1;
     }
-    memcpy(out, setup->password_raw, copy_len);
-    out[copy_len] = '\0';
-    return 1;
+    return sg_send_server_notification(conn, "UpdatePackage", summary_payload, summary_len, 2);
 }
 
-static int sg_password_matches_record(
-    const char* stored_password,
-    const char* candidate_text,
-    const char* stripped_text,
-    const char* candidate_hex
-) {
-    if (stored_password == NULL) {
+static int sg_should_enforce_md5(void) {
+    const char* raw = getenv("SENGOO_AUTH_ENFORCE_MD5");
+    if (raw == NULL || raw[0] == '\0') {
         return 0;
     }
-    if (strncmp(stored_password, "hex:", 4) == 0) {
-        const char* expect_hex = stored_password + 4;
-        if (candidate_hex == NULL || candidate_hex[0] == '\0') {
-            return 0;
-        }
-        return strcmp(expect_hex, candidate_hex) == 0;
-    }
-    if (candidate_text != NULL && candidate_text[0] != '\0' && strcmp(stored_password, candidate_text) == 0) {
+    if (strcmp(raw, "1") == 0 || strcmp(raw, "TRUE") == 0 || strcmp(raw, "true") == 0) {
         return 1;
     }
-    if (stripped_text != NULL && stripped_text[0] != '\0' && strcmp(stored_password, stripped_text) == 0) {
+    if (strcmp(raw, "ON") == 0 || strcmp(raw, "on") == 0 || strcmp(raw, "YES") == 0 || strcmp(raw, "yes") == 0) {
         return 1;
     }
     return 0;
 }
 
-static int sg_password_matches_salted_sha256(
-    const char* stored_hash_hex,
-    const char* salt,
-    const char* candidate_text,
-    const char* stripped_text
-) {
-    if (stored_hash_hex == NULL || salt == NULL || stored_hash_hex[0] == '\0' || salt[0] == '\0') {
-        return 0;
+static int sg_md5_matches_expected(const char* incoming_md5) {
+    const char* expected = getenv("SENGOO_SERVER_MD5");
+    if (expected == NULL || expected[0] == '\0') {
+        return 1;
     }
-    if (!sg_is_hex_string(stored_hash_hex, 64)) {
+    if (incoming_md5 == NULL) {
         return 0;
     }
-    char digest_hex[65];
-    digest_hex[0] = '\0';
-    if (candidate_text != NULL && candidate_text[0] != '\0') {
-        if (sg_sha256_password_with_salt_hex(candidate_text, salt, digest_hex, sizeof(digest_hex)) &&
-            sg_ascii_case_equal(stored_hash_hex, digest_hex)) {
-            return 1;
-        }
+    return strcmp(incoming_md5, expected) == 0;
+}
+
+static void sg_trim_ascii_inplace(char* text) {
+    if (text == NULL) {
+        return;
     }
-    if (stripped_text != NULL && stripped_text[0] != '\0') {
-        if (sg_sha256_password_with_salt_hex(stripped_text, salt, digest_hex, sizeof(digest_hex)) &&
-            sg_ascii_case_equal(stored_hash_hex, digest_hex)) {
-            return 1;
+    size_t len = strlen(text);
+    while (len > 0) {
+        unsigned char ch = (unsigned char)text[len - 1];
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+            text[len - 1] = '\0';
+            len -= 1;
+        } else {
+            break;
         }
     }
-    return 0;
+    size_t start = 0;
+    while (text[start] == ' ' || text[start] == '\t') {
+        start += 1;
+    }
+    if (start > 0) {
+        memmove(text, text + start, strlen(text + start) + 1);
+    }
 }
 
-static int sg_check_userdb_credentials(
-    const sg_setup_fields* setup,
-    long long* out_player_id,
-    char* out_avatar,
-    size_t out_avatar_cap,
-    char* out_error,
-    size_t out_error_cap
-) {
-    if (out_player_id != NULL) {
-        *out_player_id = 0;
-    }
-    if (out_avatar != NULL && out_avatar_cap > 0) {
-        out_avatar[0] = '\0';
-    }
-    if (out_error != NULL && out_error_cap > 0) {
-        out_error[0] = '\0';
-    }
-    if (setup == NULL) {
-        return 0;
-    }
-    if (!sg_validate_user_name_policy(setup->name, out_error, out_error_cap)) {
-        return 0;
-    }
-    if (!sg_auth_userdb_enabled()) {
-        return 1;
-    }
-    char candidate_password[SG_AUTH_PASSWORD_MAX];
-    char stripped_password[SG_AUTH_PASSWORD_MAX];
-    char candidate_password_hex[SG_AUTH_PASSWORD_MAX * 2 + 1];
-    candidate_password[0] = '\0';
-    stripped_password[0] = '\0';
-    candidate_password_hex[0] = '\0';
-
-    int has_text_password = sg_make_password_text_candidate(setup, candidate_password, sizeof(candidate_password));
-    if (!has_text_password && setup->password[0] != '\0') {
-        snprintf(candidate_password, sizeof(candidate_password), "%s", setup->password);
-        has_text_password = 1;
-    }
-    if (!has_text_password && setup->password_raw_len > 0) {
-        if (sg_try_decrypt_password_with_openssl(
-            setup->password_raw,
-            setup->password_raw_len,
-            candidate_password,
-            sizeof(candidate_password)
-        )) {
-            has_text_password = 1;
-        } else if (sg_auth_rsa_decrypt_enabled() && !g_auth_rsa_decrypt_error_logged) {
-            g_auth_rsa_decrypt_error_logged = 1;
-            sg_logf("WARN", "AUTH", "rsa password decrypt failed, fallback to raw password mode");
-        }
-    }
-    if (setup->password_raw_len > 0) {
-        sg_password_bytes_to_hex(setup->password_raw, setup->password_raw_len, candidate_password_hex, sizeof(candidate_password_hex));
-    }
-    if (has_text_password && sg_should_strip_password_prefix32()) {
-        size_t pass_len = strlen(candidate_password);
-        if (pass_len > 32) {
-            snprintf(stripped_password, sizeof(stripped_password), "%s", candidate_password + 32);
-        }
-    }
-
-    if (!has_text_password && candidate_password_hex[0] == '\0') {
-        snprintf(out_error, out_error_cap, "%s", "unknown password error");
-        return 0;
-    }
-
-    const char* user_file = sg_auth_user_file_path();
-    sg_auth_user_record record;
-    long long max_id = 0;
-    if (!sg_load_auth_user_record(user_file, setup->name, &record, &max_id)) {
-        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+static int sg_file_contains_token_line(sg_file_cache* cache, const char* path, const char* token) {
+    if (path == NULL || path[0] == '\0' || token == NULL || token[0] == '\0') {
         return 0;
     }
 
-    if (record.found) {
-        if (record.banned) {
-            long long now_sec = (long long)time(NULL);
-            if (record.ban_expire_epoch > 0 && record.ban_expire_epoch > now_sec) {
-                char expire_text[64];
-                if (sg_format_ban_expire_local(record.ban_expire_epoch, expire_text, sizeof(expire_text))) {
-                    snprintf(out_error, out_error_cap, "[\"you have been banned! expire at %%1\", \"%s\"]", expire_text);
-                } else {
-                    snprintf(out_error, out_error_cap, "%s", "you have been banned!");
-                }
-                return 0;
+    int matched = 0;
+    sg_runtime_lock();
+    if (sg_file_cache_refresh(cache, path)) {
+        const char* cursor = cache->data;
+        const char* end = cache->data + cache->len;
+        char line[512];
+        while (cursor < end && !matched) {
+            const char* eol = (const char*)memchr(cursor, '\n', (size_t)(end - cursor));
+            if (eol == NULL) {
+                eol = end;
             }
-            if (record.ban_expire_epoch <= 0 || record.ban_expire_epoch > now_sec) {
-                snprintf(out_error, out_error_cap, "%s", "you have been banned!");
-                return 0;
+            size_t line_len = (size_t)(eol - cursor);
+            if (line_len > sizeof(line) - 1) {
+                line_len = sizeof(line) - 1;
             }
-            if (record.ban_expire_epoch > 0 && record.ban_expire_epoch <= now_sec) {
-                (void)sg_rewrite_user_ban_status(user_file, &record, 0, 0);
-                record.banned = 0;
-                record.ban_expire_epoch = 0;
+            memcpy(line, cursor, line_len);
+            line[line_len] = '\0';
+            cursor = eol + 1;
+            sg_trim_ascii_inplace(line);
+            if (line[0] == '\0' || line[0] == '#') {
+                continue;
             }
-        }
-        int matched = 0;
-        if (record.salt[0] != '\0') {
-            matched = sg_password_matches_salted_sha256(
-                record.password,
-                record.salt,
-                candidate_password,
-                stripped_password
-            );
-        } else {
-            char inline_salt[32];
-            char inline_hash[96];
-            inline_salt[0] = '\0';
-            inline_hash[0] = '\0';
-            if (sg_parse_inline_sha256_password(record.password, inline_salt, sizeof(inline_salt), inline_hash, sizeof(inline_hash))) {
-                matched = sg_password_matches_salted_sha256(
-                    inline_hash,
-                    inline_salt,
-                    candidate_password,
-                    stripped_password
-                );
-            } else {
-                matched = sg_password_matches_record(
-                    record.password,
-                    candidate_password,
-                    stripped_password,
-                    candidate_password_hex
-                );
+            if (strcmp(line, token) == 0) {
+                matched = 1;
             }
         }
-        if (!matched) {
-            snprintf(out_error, out_error_cap, "%s", "username or password error");
-            return 0;
-        }
-        if (out_player_id != NULL) {
-            *out_player_id = record.id;
-        }
-        if (out_avatar != NULL && out_avatar_cap > 0) {
-            snprintf(out_avatar, out_avatar_cap, "%s", record.avatar);
-        }
-        return 1;
     }
+    sg_runtime_unlock();
+    return matched;
+}
 
-    if (!sg_auth_userdb_autoregister_enabled()) {
-        snprintf(out_error, out_error_cap, "%s", "username or password error");
-        return 0;
+static long long sg_parse_i64_cstr(const char* text, long long fallback) {
+    if (text == NULL || text[0] == '\0') {
+        return fallback;
     }
-
-    int max_per_device = sg_auth_max_players_per_device();
-    const char* binding_file = sg_auth_uuid_binding_file_path();
-    if (setup->uuid[0] != '\0' && sg_count_uuid_bindings(binding_file, setup->uuid) >= max_per_device) {
-        snprintf(out_error, out_error_cap, "%s", "cannot register more new users on this device");
-        return 0;
+    char* end = NULL;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || *end != '\0') {
+        return fallback;
     }
+    return value;
+}
 
-    long long new_id = (max_id > 0 ? max_id + 1 : 1);
-    const char* default_avatar = getenv("SENGOO_DEFAULT_AVATAR");
-    if (default_avatar == NULL || default_avatar[0] == '\0') {
-        default_avatar = "liubei";
+static int sg_parse_bool_env(const char* key, int fallback) {
+    const char* raw = getenv(key);
+    if (raw == NULL || raw[0] == '\0') {
+        return fallback;
     }
-    const char* store_password = candidate_password;
-    if (stripped_password[0] != '\0') {
-        store_password = stripped_password;
+    if (strcmp(raw, "1") == 0 || strcmp(raw, "TRUE") == 0 || strcmp(raw, "true") == 0) {
+        return 1;
     }
-    if (store_password == NULL || store_password[0] == '\0') {
-        snprintf(out_error, out_error_cap, "%s", "unknown password error");
-        return 0;
+    if (strcmp(raw, "ON") == 0 || strcmp(raw, "on") == 0 || strcmp(raw, "YES") == 0 || strcmp(raw, "yes") == 0) {
+        return 1;
     }
-
-    char salt_hex[16];
-    char password_hash_hex[65];
-    salt_hex[0] = '\0';
-    password_hash_hex[0] = '\0';
-    if (!sg_generate_salt_hex8(salt_hex, sizeof(salt_hex)) ||
-        !sg_sha256_password_with_salt_hex(store_password, salt_hex, password_hash_hex, sizeof(password_hash_hex))) {
-        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+    if (strcmp(raw, "0") == 0 || strcmp(raw, "FALSE") == 0 || strcmp(raw, "false") == 0) {
         return 0;
     }
-
-    char user_line[SG_AUTH_LINE_MAX];
-    int user_line_len = snprintf(
-        user_line,
-        sizeof(user_line),
-        "%lld|%s|%s|%s|0|0|%s",
-        new_id,
-        setup->name,
-        password_hash_hex,
-        default_avatar,
-        salt_hex
-    );
-    if (user_line_len <= 0 || user_line_len >= (int)sizeof(user_line)) {
-        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+    if (strcmp(raw, "OFF") == 0 || strcmp(raw, "off") == 0 || strcmp(raw, "NO") == 0 || strcmp(raw, "no") == 0) {
         return 0;
     }
-    if (!sg_append_auth_line(user_file, user_line)) {
-        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+    return fallback;
+}
+
+static int sg_pipe_split_fields(char* line, char* fields[], int max_fields) {
+    if (line == NULL || fields == NULL || max_fields <= 0) {
         return 0;
     }
-
-    if (setup->uuid[0] != '\0') {
-        char bind_line[SG_AUTH_LINE_MAX];
-        int bind_len = snprintf(bind_line, sizeof(bind_line), "%s|%s", setup->uuid, setup->name);
-        if (bind_len > 0 && bind_len < (int)sizeof(bind_line)) {
-            (void)sg_append_auth_line(binding_file, bind_line);
+    int count = 0;
+    char* p = line;
+    while (*p != '\0' && count < max_fields) {
+        fields[count++] = p;
+        char* sep = strchr(p, '|');
+        if (sep == NULL) {
+            break;
         }
+        *sep = '\0';
+        p = sep + 1;
     }
+    return count;
+}
 
-    if (out_player_id != NULL) {
-        *out_player_id = new_id;
+static const char* sg_auth_user_file_path(void) {
+    const char* raw = getenv("SENGOO_AUTH_USER_FILE");
+    if (raw == NULL || raw[0] == '\0') {
+        return "server/users.auth.tsv";
     }
-    if (out_avatar != NULL && out_avatar_cap > 0) {
-        snprintf(out_avatar, out_avatar_cap, "%s", default_avatar);
+    return raw;
+}
+
+static const char* sg_auth_uuid_binding_file_path(void) {
+    const char* raw = getenv("SENGOO_AUTH_UUID_BINDING_FILE");
+    if (raw == NULL || raw[0] == '\0') {
+        return ".tmp/runtime_host/auth_uuid_bindings.tsv";
     }
-    return 1;
+    return raw;
 }
 
-static int sg_is_ip_banned(const char* ip) {
-    const char* path = getenv("SENGOO_BAN_IP_FILE");
-    return sg_file_contains_token_line(path, ip);
+static int sg_auth_userdb_enabled(void) {
+    return sg_parse_bool_env("SENGOO_AUTH_USERDB_ENABLE", 0);
 }
 
-static int sg_is_ip_temp_banned(const char* ip) {
-    const char* path = getenv("SENGOO_TEMP_BAN_IP_FILE");
-    return sg_file_contains_token_line(path, ip);
+static int sg_auth_userdb_autoregister_enabled(void) {
+    return sg_parse_bool_env("SENGOO_AUTH_USERDB_AUTO_REGISTER", 1);
 }
 
-static int sg_is_uuid_banned(const char* uuid) {
-    const char* path = getenv("SENGOO_BAN_UUID_FILE");
-    return sg_file_contains_token_line(path, uuid);
+static int sg_auth_max_players_per_device(void) {
+    int value = 50;
+    const char* raw = getenv("SENGOO_AUTH_MAX_PLAYERS_PER_DEVICE");
+    if (raw != NULL && raw[0] != '\0') {
+        char* end = NULL;
+        long parsed = strtol(raw, &end, 10);
+        if (end != raw && *end == '\0' && parsed > 0 && parsed <= 10000) {
+            value = (int)parsed;
+        }
+    }
+    if (value < 1) {
+        value = 1;
+    } else if (value > 10000) {
+        value = 10000;
+    }
+    return value;
 }
 
-static long long sg_now_unix_ms(void) {
-#ifdef _WIN32
-    FILETIME ft;
-    GetSystemTimeAsFileTime(&ft);
-    ULARGE_INTEGER uli;
-    uli.LowPart = ft.dwLowDateTime;
-    uli.HighPart = ft.dwHighDateTime;
-    unsigned long long unix_100ns = uli.QuadPart - 116444736000000000ULL;
-    return (long long)(unix_100ns / 10000ULL);
-#else
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    return (long long)ts.tv_sec * 1000LL + (long long)(ts.tv_nsec / 1000000L);
-#endif
-}
-
-static sg_socket_entry* sg_find_tcp_connection_entry(long long handle) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (g_tcp_connections[i].used && g_tcp_connections[i].handle == handle) {
-            return &g_tcp_connections[i];
+static int sg_is_valid_user_name_token(const char* name) {
+    if (name == NULL || name[0] == '\0') {
+        return 0;
+    }
+    size_t len = strlen(name);
+    if (len == 0 || len > 64) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)name[i];
+        if (ch < 32 || ch == 127 || ch == '|') {
+            return 0;
         }
     }
-    return NULL;
+    return 1;
 }
 
-static int sg_force_close_tcp_connection(long long handle) {
-    sg_socket_entry* entry = sg_find_tcp_connection_entry(handle);
-    if (entry != NULL) {
-        sg_socket_t s = entry->socket;
-        entry->used = 0;
-        entry->handle = 0;
-        entry->socket = SG_INVALID_SOCKET;
-        if (s != SG_INVALID_SOCKET) {
-            sg_close_socket(s);
-        }
+static const char* sg_auth_whitelist_file_path(void) {
+    const char* raw = getenv("SENGOO_AUTH_WHITELIST_FILE");
+    if (raw == NULL || raw[0] == '\0') {
+        return NULL;
     }
-    sg_tcp_stream_detach(handle);
-    sg_auth_state_detach(handle);
-    return entry != NULL;
+    return raw;
 }
 
-static int sg_kick_duplicate_online_sessions(long long current_handle, long long player_id, const char* player_name) {
-    long long targets[SG_MAX_NET_HANDLES];
-    int target_count = 0;
-    int has_name = (player_name != NULL && player_name[0] != '\0');
+static const char* sg_auth_ban_words_file_path(void) {
+    const char* raw = getenv("SENGOO_BAN_WORDS_FILE");
+    if (raw == NULL || raw[0] == '\0') {
+        return NULL;
+    }
+    return raw;
+}
 
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        sg_auth_state* state = &g_auth_states[i];
-        if (!state->used || !state->auth_passed || state->handle == current_handle) {
-            continue;
-        }
-        int same_player = (player_id > 0 && state->player_id > 0 && state->player_id == player_id);
-        int same_name = (has_name && state->player_name[0] != '\0' && strcmp(state->player_name, player_name) == 0);
-        if (!same_player && !same_name) {
-            continue;
-        }
-        if (target_count < SG_MAX_NET_HANDLES) {
-            targets[target_count++] = state->handle;
-        }
+static int sg_ascii_case_contains(const char* text, const char* token) {
+    if (text == NULL || token == NULL || token[0] == '\0') {
+        return 0;
+    }
+    size_t text_len = strlen(text);
+    size_t token_len = strlen(token);
+    if (token_len == 0 || token_len > text_len) {
+        return 0;
     }
 
-    int kicked = 0;
-    for (int i = 0; i < target_count; i++) {
-        long long handle = targets[i];
-        sg_socket_entry* entry = sg_find_tcp_connection_entry(handle);
-        if (entry != NULL) {
-            (void)sg_send_errordlg_and_close(entry->socket, "others logged in again with this name");
+    for (size_t i = 0; i + token_len <= text_len; i++) {
+        size_t j = 0;
+        while (j < token_len) {
+            unsigned char lhs = (unsigned char)text[i + j];
+            unsigned char rhs = (unsigned char)token[j];
+            if (tolower(lhs) != tolower(rhs)) {
+                break;
+            }
+            j += 1;
         }
-        if (sg_force_close_tcp_connection(handle)) {
-            kicked += 1;
+        if (j == token_len) {
+            return 1;
         }
     }
-    return kicked;
+    return 0;
 }
 
-static int sg_send_post_setup_packets(
-    sg_socket_t socket,
-    const sg_setup_fields* setup,
-    long long resolved_player_id,
-    const char* resolved_avatar
-) {
-    if (setup == NULL) {
+static int sg_ascii_case_equal(const char* lhs, const char* rhs) {
+    if (lhs == NULL || rhs == NULL) {
         return 0;
     }
-    const char* avatar = resolved_avatar;
-    if (avatar == NULL || avatar[0] == '\0') {
-        avatar = getenv("SENGOO_DEFAULT_AVATAR");
+    size_t lhs_len = strlen(lhs);
+    size_t rhs_len = strlen(rhs);
+    if (lhs_len != rhs_len) {
+        return 0;
     }
-    if (avatar == NULL || avatar[0] == '\0') {
-        avatar = "liubei";
+    for (size_t i = 0; i < lhs_len; i++) {
+        unsigned char a = (unsigned char)lhs[i];
+        unsigned char b = (unsigned char)rhs[i];
+        if (tolower(a) != tolower(b)) {
+            return 0;
+        }
     }
-    long long player_id = resolved_player_id;
-    if (player_id <= 0) {
-        player_id = 1;
-        const char* player_id_raw = getenv("SENGOO_DEFAULT_PLAYER_ID");
-        if (player_id_raw != NULL && player_id_raw[0] != '\0') {
-            long parsed = strtol(player_id_raw, NULL, 10);
-            if (parsed > 0) {
-                player_id = (long long)parsed;
-            }
+    return 1;
+}
+
+static int sg_name_in_whitelist(const char* name) {
+    const char* path = sg_auth_whitelist_file_path();
+    if (path == NULL || path[0] == '\0') {
+        return 1;
+    }
+
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        if (!g_auth_whitelist_missing_logged) {
+            g_auth_whitelist_missing_logged = 1;
+            sg_logf("WARN", "AUTH", "whitelist file missing path=%s", path);
         }
+        return 1;
     }
-    unsigned char setup_payload[SG_AUTH_NAME_MAX + 256];
-    size_t setup_payload_len = 0;
-    {
-        size_t idx = 0;
-        int ok = 1;
-        ok = ok && sg_cbor_write_type_and_len(setup_payload, sizeof(setup_payload), &idx, 4, 4);
-        ok = ok && sg_cbor_write_signed_integer(setup_payload, sizeof(setup_payload), &idx, player_id);
-        ok = ok && sg_cbor_write_bytes_like(setup_payload, sizeof(setup_payload), &idx, 2, (const unsigned char*)setup->name, strlen(setup->name));
-        ok = ok && sg_cbor_write_bytes_like(setup_payload, sizeof(setup_payload), &idx, 2, (const unsigned char*)avatar, strlen(avatar));
-        ok = ok && sg_cbor_write_signed_integer(setup_payload, sizeof(setup_payload), &idx, sg_now_unix_ms());
-        if (!ok) {
-            return 0;
+
+    int found = 0;
+    char line[SG_AUTH_LINE_MAX];
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        sg_trim_ascii_inplace(line);
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (strcmp(line, name) == 0) {
+            found = 1;
+            break;
         }
-        setup_payload_len = idx;
     }
-    if (!sg_send_server_notification(socket, "Setup", setup_payload, setup_payload_len, 2)) {
+    fclose(fp);
+    return found;
+}
+
+static int sg_name_contains_ban_word(const char* name) {
+    const char* path = sg_auth_ban_words_file_path();
+    if (path == NULL || path[0] == '\0') {
         return 0;
     }
 
-    unsigned char settings_payload[512];
-    size_t settings_len = 0;
-    {
-        size_t idx = 0;
-        const char* motd = getenv("SENGOO_MOTD");
-        if (motd == NULL) {
-            motd = "";
-        }
-        int ok = 1;
-        ok = ok && sg_cbor_write_type_and_len(settings_payload, sizeof(settings_payload), &idx, 4, 3);
-        ok = ok && sg_cbor_write_bytes_like(settings_payload, sizeof(settings_payload), &idx, 2, (const unsigned char*)motd, strlen(motd));
-        ok = ok && sg_cbor_write_type_and_len(settings_payload, sizeof(settings_payload), &idx, 4, 0);
-        ok = ok && sg_cbor_write_type_and_len(settings_payload, sizeof(settings_payload), &idx, 4, 0);
-        if (!ok) {
-            return 0;
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        if (!g_auth_ban_words_missing_logged) {
+            g_auth_ban_words_missing_logged = 1;
+            sg_logf("WARN", "AUTH", "ban words file missing path=%s", path);
         }
-        settings_len = idx;
-    }
-    if (!sg_send_server_notification(socket, "SetServerSettings", settings_payload, settings_len, 2)) {
         return 0;
     }
 
-    unsigned char game_time_payload[64];
-    size_t game_time_len = 0;
-    {
-        size_t idx = 0;
-        int ok = 1;
-        ok = ok && sg_cbor_write_type_and_len(game_time_payload, sizeof(game_time_payload), &idx, 4, 2);
-        ok = ok && sg_cbor_write_signed_integer(game_time_payload, sizeof(game_time_payload), &idx, player_id);
-        ok = ok && sg_cbor_write_signed_integer(game_time_payload, sizeof(game_time_payload), &idx, 0);
-        if (!ok) {
-            return 0;
+    int matched = 0;
+    char line[SG_AUTH_LINE_MAX];
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        sg_trim_ascii_inplace(line);
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (sg_ascii_case_contains(name, line)) {
+            matched = 1;
+            break;
         }
-        game_time_len = idx;
     }
-    return sg_send_server_notification(socket, "AddTotalGameTime", game_time_payload, game_time_len, 2);
+    fclose(fp);
+    return matched;
 }
 
-static int sg_handle_auth_setup_packet(long long conn_handle, sg_socket_t socket, const sg_cbor_wire_packet* packet, sg_auth_state* auth_state) {
-    if (packet == NULL || auth_state == NULL) {
-        return -1;
+static int sg_validate_user_name_policy(const char* name, char* out_error, size_t out_error_cap) {
+    if (!sg_is_valid_user_name_token(name)) {
+        snprintf(out_error, out_error_cap, "%s", "invalid user name");
+        return 0;
     }
-    if (packet->request_id != -2) {
-        sg_send_errordlg_and_close(socket, "INVALID SETUP STRING");
-        return -2;
+    if (sg_name_contains_ban_word(name)) {
+        snprintf(out_error, out_error_cap, "%s", "invalid user name");
+        return 0;
     }
-    if ((packet->packet_type & SG_PACKET_TYPE_NOTIFICATION) == 0 ||
-        (packet->packet_type & SG_PACKET_SRC_CLIENT) == 0 ||
-        (packet->packet_type & SG_PACKET_DEST_SERVER) == 0) {
-        sg_send_errordlg_and_close(socket, "INVALID SETUP STRING");
-        return -2;
+    if (!sg_name_in_whitelist(name)) {
+        snprintf(out_error, out_error_cap, "%s", "user name not in whitelist");
+        return 0;
     }
+    return 1;
+}
 
-    sg_setup_fields setup;
-    if (!sg_parse_setup_payload(packet->payload_ptr, packet->payload_len, &setup)) {
-        sg_send_errordlg_and_close(socket, "INVALID SETUP STRING");
-        return -2;
-    }
-    auth_state->setup_received = 1;
+static uint32_t sg_rotr32(uint32_t value, uint32_t bits) {
+    return (value >> bits) | (value << (32U - bits));
+}
 
-    if (!sg_is_supported_client_version(setup.version)) {
-        const char* msg = "[\"server supports version %1, please update\",\"0.5.19+\"]";
-        sg_send_errordlg_and_close(socket, msg);
-        return -2;
+static int sg_is_hex_string(const char* text, size_t exact_len) {
+    if (text == NULL) {
+        return 0;
     }
-
-    if (sg_is_uuid_banned(setup.uuid)) {
-        sg_send_errordlg_and_close(socket, "you have been banned!");
-        return -2;
+    size_t len = strlen(text);
+    if (len != exact_len) {
+        return 0;
     }
-
-    if (sg_should_enforce_md5() && !sg_md5_matches_expected(setup.md5)) {
-        sg_send_md5_failure_and_update_package(socket);
-        return -2;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)text[i];
+        int is_digit = (ch >= '0' && ch <= '9');
+        int is_lower = (ch >= 'a' && ch <= 'f');
+        int is_upper = (ch >= 'A' && ch <= 'F');
+        if (!is_digit && !is_lower && !is_upper) {
+            return 0;
+        }
     }
+    return 1;
+}
 
-    long long resolved_player_id = 0;
-    char resolved_avatar[SG_AUTH_AVATAR_MAX];
-    char auth_error[256];
-    resolved_avatar[0] = '\0';
-    auth_error[0] = '\0';
-    if (!sg_check_userdb_credentials(
-        &setup,
-        &resolved_player_id,
-        resolved_avatar,
-        sizeof(resolved_avatar),
-        auth_error,
-        sizeof(auth_error)
-    )) {
+static void sg_bytes_to_hex_lower(const unsigned char* data, size_t len, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return;
+    }
+    out[0] = '\0';
+    if (data == NULL || len == 0) {
+        return;
+    }
+    static const char* k_hex = "0123456789abcdef";
+    size_t max_bytes = (out_cap - 1) / 2;
+    if (len > max_bytes) {
+        len = max_bytes;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char b = data[i];
+        out[i * 2] = k_hex[(b >> 4) & 0x0f];
+        out[i * 2 + 1] = k_hex[b & 0x0f];
+    }
+    out[len * 2] = '\0';
+}
+
+static void sg_sha256_transform(uint32_t state[8], const unsigned char block[64]) {
+    static const uint32_t k[64] = {
+        0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+        0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+        0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+        0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+        0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+        0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+        0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+        0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U
+    };
+
+    uint32_t w[64];
+    for (size_t i = 0; i < 16; i++) {
+        size_t off = i * 4;
+        w[i] =
+            ((uint32_t)block[off] << 24) |
+            ((uint32_t)block[off + 1] << 16) |
+            ((uint32_t)block[off + 2] << 8) |
+            ((uint32_t)block[off + 3]);
+    }
+    for (size_t i = 16; i < 64; i++) {
+        uint32_t s0 = sg_rotr32(w[i - 15], 7) ^ sg_rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = sg_rotr32(w[i - 2], 17) ^ sg_rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    uint32_t f = state[5];
+    uint32_t g = state[6];
+    uint32_t h = state[7];
+
+    for (size_t i = 0; i < 64; i++) {
+        uint32_t s1 = sg_rotr32(e, 6) ^ sg_rotr32(e, 11) ^ sg_rotr32(e, 25);
+        uint32_t ch = (e & f) ^ ((~e) & g);
+        uint32_t temp1 = h + s1 + ch + k[i] + w[i];
+        uint32_t s0 = sg_rotr32(a, 2) ^ sg_rotr32(a, 13) ^ sg_rotr32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+static void sg_sha256_digest_bytes(const unsigned char* data, size_t len, unsigned char out[32]) {
+    uint32_t state[8] = {
+        0x6a09e667U,
+        0xbb67ae85U,
+        0x3c6ef372U,
+        0xa54ff53aU,
+        0x510e527fU,
+        0x9b05688cU,
+        0x1f83d9abU,
+        0x5be0cd19U
+    };
+
+    size_t offset = 0;
+    while (offset + 64 <= len) {
+        sg_sha256_transform(state, data + offset);
+        offset += 64;
+    }
+
+    unsigned char tail[128];
+    size_t rem = len - offset;
+    if (rem > 0) {
+        memcpy(tail, data + offset, rem);
+    }
+    tail[rem] = 0x80;
+    size_t pad_base = rem + 1;
+    size_t pad_len = (pad_base + 8 <= 64) ? (64 - pad_base - 8) : (128 - pad_base - 8);
+    if (pad_len > 0) {
+        memset(tail + pad_base, 0, pad_len);
+    }
+    size_t len_pos = pad_base + pad_len;
+    uint64_t bit_len = (uint64_t)len * 8ULL;
+    tail[len_pos + 0] = (unsigned char)(bit_len >> 56);
+    tail[len_pos + 1] = (unsigned char)(bit_len >> 48);
+    tail[len_pos + 2] = (unsigned char)(bit_len >> 40);
+    tail[len_pos + 3] = (unsigned char)(bit_len >> 32);
+    tail[len_pos + 4] = (unsigned char)(bit_len >> 24);
+    tail[len_pos + 5] = (unsigned char)(bit_len >> 16);
+    tail[len_pos + 6] = (unsigned char)(bit_len >> 8);
+    tail[len_pos + 7] = (unsigned char)(bit_len);
+
+    size_t total_tail = len_pos + 8;
+    for (size_t i = 0; i < total_tail; i += 64) {
+        sg_sha256_transform(state, tail + i);
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        out[i * 4 + 0] = (unsigned char)(state[i] >> 24);
+        out[i * 4 + 1] = (unsigned char)(state[i] >> 16);
+        out[i * 4 + 2] = (unsigned char)(state[i] >> 8);
+        out[i * 4 + 3] = (unsigned char)(state[i]);
+    }
+}
+
+static int sg_sha256_password_with_salt_hex(const char* password, const char* salt, char* out_hex, size_t out_hex_cap) {
+    if (password == NULL || salt == NULL || out_hex == NULL || out_hex_cap < 65) {
+        return 0;
+    }
+    size_t pass_len = strlen(password);
+    size_t salt_len = strlen(salt);
+    if (salt_len == 0 || salt_len > 31) {
+        return 0;
+    }
+    if (pass_len + salt_len > 4096) {
+        return 0;
+    }
+    unsigned char* input = (unsigned char*)malloc(pass_len + salt_len);
+    if (input == NULL) {
+        return 0;
+    }
+    memcpy(input, password, pass_len);
+    memcpy(input + pass_len, salt, salt_len);
+
+    unsigned char digest[32];
+    sg_sha256_digest_bytes(input, pass_len + salt_len, digest);
+    free(input);
+
+    sg_bytes_to_hex_lower(digest, sizeof(digest), out_hex, out_hex_cap);
+    return out_hex[0] != '\0';
+}
+
+static int sg_generate_salt_hex8(char* out, size_t out_cap) {
+    if (out == NULL || out_cap < 9) {
+        return 0;
+    }
+    static int seeded = 0;
+    if (!seeded) {
+        unsigned int seed = (unsigned int)time(NULL);
+        seed ^= (unsigned int)(sg_monotonic_ms() & 0xffffffffU);
+        srand(seed);
+        seeded = 1;
+    }
+    unsigned int value = (((unsigned int)rand()) << 16) ^ (unsigned int)rand();
+    int written = snprintf(out, out_cap, "%08x", value);
+    return written == 8;
+}
+
+static int sg_parse_inline_sha256_password(
+    const char* stored_password,
+    char* out_salt,
+    size_t out_salt_cap,
+    char* out_hash,
+    size_t out_hash_cap
+) {
+    if (stored_password == NULL || out_salt == NULL || out_hash == NULL || out_salt_cap == 0 || out_hash_cap == 0) {
+        return 0;
+    }
+    out_salt[0] = '\0';
+    out_hash[0] = '\0';
+    if (strncmp(stored_password, "sha256:", 7) != 0) {
+        return 0;
+    }
+    const char* salt = stored_password + 7;
+    const char* sep = strchr(salt, ':');
+    if (sep == NULL || sep == salt) {
+        return 0;
+    }
+    size_t salt_len = (size_t)(sep - salt);
+    const char* hash = sep + 1;
+    if (salt_len + 1 > out_salt_cap || strlen(hash) + 1 > out_hash_cap) {
+        return 0;
+    }
+    memcpy(out_salt, salt, salt_len);
+    out_salt[salt_len] = '\0';
+    snprintf(out_hash, out_hash_cap, "%s", hash);
+    return sg_is_hex_string(out_hash, 64);
+}
+
+static int sg_parse_user_record_line(const char* line_text, sg_auth_user_record* out, long long* max_id) {
+    if (line_text == NULL || out == NULL) {
+        return 0;
+    }
+    char line[SG_AUTH_LINE_MAX];
+    snprintf(line, sizeof(line), "%s", line_text);
+    sg_trim_ascii_inplace(line);
+    if (line[0] == '\0' || line[0] == '#') {
+        return 0;
+    }
+
+    char* fields[8];
+    int field_count = sg_pipe_split_fields(line, fields, 8);
+    if (field_count < 6) {
+        return 0;
+    }
+
+    long long id = sg_parse_i64_cstr(fields[0], 0);
+    if (id <= 0) {
+        return 0;
+    }
+    if (max_id != NULL && id > *max_id) {
+        *max_id = id;
+    }
+
+    out->found = 1;
+    out->id = id;
+    snprintf(out->name, sizeof(out->name), "%s", fields[1]);
+    snprintf(out->password, sizeof(out->password), "%s", fields[2]);
+    out->salt[0] = '\0';
+    if (field_count >= 7 && fields[6] != NULL && fields[6][0] != '\0') {
+        snprintf(out->salt, sizeof(out->salt), "%s", fields[6]);
+    }
+    snprintf(out->avatar, sizeof(out->avatar), "%s", fields[3]);
+    out->banned = (int)sg_parse_i64_cstr(fields[4], 0);
+    out->ban_expire_epoch = sg_parse_i64_cstr(fields[5], 0);
+    if (out->avatar[0] == '\0') {
+        snprintf(out->avatar, sizeof(out->avatar), "%s", "liubei");
+    }
+    return 1;
+}
+
+static int sg_load_auth_user_record(const char* user_file, const char* user_name, sg_auth_user_record* out, long long* max_id) {
+    if (out == NULL || user_name == NULL) {
+        return 0;
+    }
+    memset(out, 0, sizeof(*out));
+    if (max_id != NULL) {
+        *max_id = 0;
+    }
+    FILE* fp = fopen(user_file, "rb");
+    if (fp == NULL) {
+        return 1;
+    }
+
+    char line[SG_AUTH_LINE_MAX];
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        sg_auth_user_record record;
+        memset(&record, 0, sizeof(record));
+        if (!sg_parse_user_record_line(line, &record, max_id)) {
+            continue;
+        }
+        if (strcmp(record.name, user_name) == 0) {
+            *out = record;
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+static int sg_count_uuid_bindings(const char* binding_file, const char* uuid) {
+    if (binding_file == NULL || uuid == NULL || uuid[0] == '\0') {
+        return 0;
+    }
+    FILE* fp = fopen(binding_file, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+
+    int count = 0;
+    char line[SG_AUTH_LINE_MAX];
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        sg_trim_ascii_inplace(line);
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        char* sep = strchr(line, '|');
+        if (sep == NULL) {
+            continue;
+        }
+        *sep = '\0';
+        if (strcmp(line, uuid) == 0) {
+            count += 1;
+        }
+    }
+    fclose(fp);
+    return count;
+}
+
+static int sg_append_auth_line(const char* path, const char* line) {
+    if (path == NULL || path[0] == '\0' || line == NULL) {
+        return 0;
+    }
+
+    if (strncmp(path, ".tmp/runtime_host/", 18) == 0) {
+        sg_mkdir(".tmp");
+        sg_mkdir(".tmp/runtime_host");
+    }
+
+    FILE* fp = fopen(path, "ab");
+    if (fp == NULL) {
+        return 0;
+    }
+    size_t line_len = strlen(line);
+    size_t wrote_line = fwrite(line, 1, line_len, fp);
+    size_t wrote_nl = fwrite("\n", 1, 1, fp);
+    fclose(fp);
+    return wrote_line == line_len && wrote_nl == 1;
+}
+
+static int sg_format_user_record_line(
+    const sg_auth_user_record* record,
+    int banned,
+    long long ban_expire_epoch,
+    char* out,
+    size_t out_cap
+) {
+    if (record == NULL || out == NULL || out_cap == 0) {
+        return 0;
+    }
+    int written = 0;
+    if (record->salt[0] != '\0') {
+        written = snprintf(
+            out,
+            out_cap,
+            "%lld|%s|%s|%s|%d|%lld|%s",
+            record->id,
+            record->name,
+            record->password,
+            record->avatar,
+            banned,
+            ban_expire_epoch,
+            record->salt
+        );
+    } else {
+        written = snprintf(
+            out,
+            out_cap,
+            "%lld|%s|%s|%s|%d|%lld",
+            record->id,
+            record->name,
+            record->password,
+            record->avatar,
+            banned,
+            ban_expire_epoch
+        );
+    }
+    return written > 0 && written < (int)out_cap;
+}
+
+static int sg_rewrite_user_ban_status(
+    const char* user_file,
+    const sg_auth_user_record* target,
+    int banned,
+    long long ban_expire_epoch
+) {
+    if (user_file == NULL || user_file[0] == '\0' || target == NULL || target->id <= 0 || target->name[0] == '\0') {
+        return 0;
+    }
+    FILE* in = fopen(user_file, "rb");
+    if (in == NULL) {
+        return 0;
+    }
+
+    char tmp_file[SG_AUTH_LINE_MAX];
+    int tmp_len = snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", user_file);
+    if (tmp_len <= 0 || tmp_len >= (int)sizeof(tmp_file)) {
+        fclose(in);
+        return 0;
+    }
+    FILE* out = fopen(tmp_file, "wb");
+    if (out == NULL) {
+        fclose(in);
+        return 0;
+    }
+
+    int updated = 0;
+    char raw_line[SG_AUTH_LINE_MAX];
+    while (fgets(raw_line, (int)sizeof(raw_line), in) != NULL) {
+        char parse_line[SG_AUTH_LINE_MAX];
+        snprintf(parse_line, sizeof(parse_line), "%s", raw_line);
+        sg_auth_user_record parsed;
+        memset(&parsed, 0, sizeof(parsed));
+        if (sg_parse_user_record_line(parse_line, &parsed, NULL) &&
+            parsed.id == target->id &&
+            strcmp(parsed.name, target->name) == 0) {
+            char rewritten[SG_AUTH_LINE_MAX];
+            if (sg_format_user_record_line(target, banned, ban_expire_epoch, rewritten, sizeof(rewritten))) {
+                fwrite(rewritten, 1, strlen(rewritten), out);
+                fwrite("\n", 1, 1, out);
+                updated = 1;
+                continue;
+            }
+        }
+        fwrite(raw_line, 1, strlen(raw_line), out);
+    }
+
+    fclose(in);
+    fclose(out);
+
+    if (!updated) {
+        remove(tmp_file);
+        return 0;
+    }
+
+    if (remove(user_file) != 0) {
+        remove(tmp_file);
+        return 0;
+    }
+    if (rename(tmp_file, user_file) != 0) {
+        return 0;
+    }
+    return 1;
+}
+
+static int sg_format_ban_expire_local(long long epoch_sec, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0 || epoch_sec <= 0) {
+        return 0;
+    }
+    time_t t = (time_t)epoch_sec;
+    struct tm tm_value;
+#ifdef _WIN32
+    if (localtime_s(&tm_value, &t) != 0) {
+        return 0;
+    }
+#else
+    if (localtime_r(&t, &tm_value) == NULL) {
+        return 0;
+    }
+#endif
+    int written = snprintf(
+        out,
+        out_cap,
+        "%04d-%02d-%02d %02d:%02d:%02d.",
+        tm_value.tm_year + 1900,
+        tm_value.tm_mon + 1,
+        tm_value.tm_mday,
+        tm_value.tm_hour,
+        tm_value.tm_min,
+        tm_value.tm_sec
+    );
+    return written > 0 && written < (int)out_cap;
+}
+
+static int sg_password_bytes_are_printable(const unsigned char* data, size_t len) {
+    if (data == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = data[i];
+        if (ch < 32 || ch > 126) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void sg_password_bytes_to_hex(const unsigned char* data, size_t len, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return;
+    }
+    out[0] = '\0';
+    if (data == NULL || len == 0) {
+        return;
+    }
+    static const char* k_hex = "0123456789abcdef";
+    size_t max_bytes = (out_cap - 1) / 2;
+    if (len > max_bytes) {
+        len = max_bytes;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char b = data[i];
+        out[i * 2] = k_hex[(b >> 4) & 0x0f];
+        out[i * 2 + 1] = k_hex[b & 0x0f];
+    }
+    out[len * 2] = '\0';
+}
+
+static int sg_auth_rsa_decrypt_enabled(void) {
+    return sg_parse_bool_env("SENGOO_AUTH_RSA_DECRYPT_ENABLE", 0);
+}
+
+static const char* sg_auth_rsa_private_key_path(void) {
+    const char* raw = getenv("SENGOO_AUTH_RSA_PRIVATE_KEY_PATH");
+    if (raw == NULL || raw[0] == '\0') {
+        return "server/rsa";
+    }
+    return raw;
+}
+
+static const char* sg_auth_openssl_exe(void) {
+    const char* raw = getenv("SENGOO_AUTH_OPENSSL_EXE");
+    if (raw == NULL || raw[0] == '\0') {
+        return "openssl";
+    }
+    return raw;
+}
+
+static int sg_try_decrypt_password_with_openssl(
+    const unsigned char* encrypted_bytes,
+    size_t encrypted_len,
+    char* out,
+    size_t out_cap
+) {
+    if (out == NULL || out_cap == 0) {
+        return 0;
+    }
+    out[0] = '\0';
+    if (encrypted_bytes == NULL || encrypted_len == 0 || encrypted_len > 8192) {
+        return 0;
+    }
+    if (!sg_auth_rsa_decrypt_enabled()) {
+        return 0;
+    }
+
+    const char* openssl_exe = sg_auth_openssl_exe();
+    const char* private_key = sg_auth_rsa_private_key_path();
+    if (openssl_exe == NULL || openssl_exe[0] == '\0' || private_key == NULL || private_key[0] == '\0') {
+        return 0;
+    }
+
+    sg_mkdir(".tmp");
+    sg_mkdir(".tmp/runtime_host");
+
+    long long stamp = sg_monotonic_ms();
+    char in_path[SG_AUTH_LINE_MAX];
+    char out_path[SG_AUTH_LINE_MAX];
+    int in_len = snprintf(in_path, sizeof(in_path), ".tmp/runtime_host/auth_pw_in_%lld.bin", stamp);
+    int out_len = snprintf(out_path, sizeof(out_path), ".tmp/runtime_host/auth_pw_out_%lld.bin", stamp);
+    if (in_len <= 0 || in_len >= (int)sizeof(in_path) || out_len <= 0 || out_len >= (int)sizeof(out_path)) {
+        return 0;
+    }
+
+    FILE* in_fp = fopen(in_path, "wb");
+    if (in_fp == NULL) {
+        return 0;
+    }
+    size_t wrote = fwrite(encrypted_bytes, 1, encrypted_len, in_fp);
+    fclose(in_fp);
+    if (wrote != encrypted_len) {
+        remove(in_path);
+        return 0;
+    }
+
+    char cmd[SG_EXTENSION_CMD_MAX];
+#ifdef _WIN32
+    int cmd_len = snprintf(
+        cmd,
+        sizeof(cmd),
+        "\"%s\" pkeyutl -decrypt -inkey \"%s\" -in \"%s\" -out \"%s\" >nul 2>&1",
+        openssl_exe,
+        private_key,
+        in_path,
+        out_path
+    );
+#else
+    int cmd_len = snprintf(
+        cmd,
+        sizeof(cmd),
+        "\"%s\" pkeyutl -decrypt -inkey \"%s\" -in \"%s\" -out \"%s\" >/dev/null 2>&1",
+        openssl_exe,
+        private_key,
+        in_path,
+        out_path
+    );
+#endif
+    if (cmd_len <= 0 || cmd_len >= (int)sizeof(cmd)) {
+        remove(in_path);
+        return 0;
+    }
+
+    int rc = system(cmd);
+    remove(in_path);
+    if (rc != 0) {
+        remove(out_path);
+        return 0;
+    }
+
+    FILE* out_fp = fopen(out_path, "rb");
+    if (out_fp == NULL) {
+        remove(out_path);
+        return 0;
+    }
+    unsigned char tmp[SG_AUTH_PASSWORD_MAX];
+    size_t n = fread(tmp, 1, sizeof(tmp), out_fp);
+    fclose(out_fp);
+    remove(out_path);
+    if (n == 0) {
+        return 0;
+    }
+
+    size_t text_len = 0;
+    while (text_len < n && tmp[text_len] != '\0') {
+        text_len += 1;
+    }
+    if (text_len == 0) {
+        text_len = n;
+    }
+    if (text_len > out_cap - 1) {
+        text_len = out_cap - 1;
+    }
+    memcpy(out, tmp, text_len);
+    out[text_len] = '\0';
+    return text_len > 0;
+}
+
+static int sg_should_strip_password_prefix32(void) {
+    return sg_parse_bool_env("SENGOO_AUTH_PASSWORD_STRIP32", 1);
+}
+
+static int sg_make_password_text_candidate(const sg_setup_fields* setup, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return 0;
+    }
+    out[0] = '\0';
+    if (setup == NULL || setup->password_raw_len == 0) {
+        return 0;
+    }
+    if (!sg_password_bytes_are_printable(setup->password_raw, setup->password_raw_len)) {
+        return 0;
+    }
+    size_t copy_len = setup->password_raw_len;
+    if (copy_len > out_cap - 1) {
+        copy_len = out_cap - 1;
+    }
+    memcpy(out, setup->password_raw, copy_len);
+    out[copy_len] = '\0';
+    return 1;
+}
+
+static int sg_password_matches_record(
+    const char* stored_password,
+    const char* candidate_text,
+    const char* stripped_text,
+    const char* candidate_hex
+) {
+    if (stored_password == NULL) {
+        return 0;
+    }
+    if (strncmp(stored_password, "hex:", 4) == 0) {
+        const char* expect_hex = stored_password + 4;
+        if (candidate_hex == NULL || candidate_hex[0] == '\0') {
+            return 0;
+        }
+        return strcmp(expect_hex, candidate_hex) == 0;
+    }
+    if (candidate_text != NULL && candidate_text[0] != '\0' && strcmp(stored_password, candidate_text) == 0) {
+        return 1;
+    }
+    if (stripped_text != NULL && stripped_text[0] != '\0' && strcmp(stored_password, stripped_text) == 0) {
+        return 1;
+    }
+    return 0;
+}
+
+static int sg_password_matches_salted_sha256(
+    const char* stored_hash_hex,
+    const char* salt,
+    const char* candidate_text,
+    const char* stripped_text
+) {
+    if (stored_hash_hex == NULL || salt == NULL || stored_hash_hex[0] == '\0' || salt[0] == '\0') {
+        return 0;
+    }
+    if (!sg_is_hex_string(stored_hash_hex, 64)) {
+        return 0;
+    }
+    char digest_hex[65];
+    digest_hex[0] = '\0';
+    if (candidate_text != NULL && candidate_text[0] != '\0') {
+        if (sg_sha256_password_with_salt_hex(candidate_text, salt, digest_hex, sizeof(digest_hex)) &&
+            sg_ascii_case_equal(stored_hash_hex, digest_hex)) {
+            return 1;
+        }
+    }
+    if (stripped_text != NULL && stripped_text[0] != '\0') {
+        if (sg_sha256_password_with_salt_hex(stripped_text, salt, digest_hex, sizeof(digest_hex)) &&
+            sg_ascii_case_equal(stored_hash_hex, digest_hex)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int sg_check_userdb_credentials(
+    const sg_setup_fields* setup,
+    long long* out_player_id,
+    char* out_avatar,
+    size_t out_avatar_cap,
+    char* out_error,
+    size_t out_error_cap
+) {
+    if (out_player_id != NULL) {
+        *out_player_id = 0;
+    }
+    if (out_avatar != NULL && out_avatar_cap > 0) {
+        out_avatar[0] = '\0';
+    }
+    if (out_error != NULL && out_error_cap > 0) {
+        out_error[0] = '\0';
+    }
+    if (setup == NULL) {
+        return 0;
+    }
+    if (!sg_validate_user_name_policy(setup->name, out_error, out_error_cap)) {
+        return 0;
+    }
+    if (!sg_auth_userdb_enabled()) {
+        return 1;
+    }
+    char candidate_password[SG_AUTH_PASSWORD_MAX];
+    char stripped_password[SG_AUTH_PASSWORD_MAX];
+    char candidate_password_hex[SG_AUTH_PASSWORD_MAX * 2 + 1];
+    candidate_password[0] = '\0';
+    stripped_password[0] = '\0';
+    candidate_password_hex[0] = '\0';
+
+    int has_text_password = sg_make_password_text_candidate(setup, candidate_password, sizeof(candidate_password));
+    if (!has_text_password && setup->password[0] != '\0') {
+        snprintf(candidate_password, sizeof(candidate_password), "%s", setup->password);
+        has_text_password = 1;
+    }
+    if (!has_text_password && setup->password_raw_len > 0) {
+        if (sg_try_decrypt_password_with_openssl(
+            setup->password_raw,
+            setup->password_raw_len,
+            candidate_password,
+            sizeof(candidate_password)
+        )) {
+            has_text_password = 1;
+        } else if (sg_auth_rsa_decrypt_enabled() && !g_auth_rsa_decrypt_error_logged) {
+            g_auth_rsa_decrypt_error_logged = 1;
+            sg_logf("WARN", "AUTH", "rsa password decrypt failed, fallback to raw password mode");
+        }
+    }
+    if (setup->password_raw_len > 0) {
+        sg_password_bytes_to_hex(setup->password_raw, setup->password_raw_len, candidate_password_hex, sizeof(candidate_password_hex));
+    }
+    if (has_text_password && sg_should_strip_password_prefix32()) {
+        size_t pass_len = strlen(candidate_password);
+        if (pass_len > 32) {
+            snprintf(stripped_password, sizeof(stripped_password), "%s", candidate_password + 32);
+        }
+    }
+
+    if (!has_text_password && candidate_password_hex[0] == '\0') {
+        snprintf(out_error, out_error_cap, "%s", "unknown password error");
+        return 0;
+    }
+
+    const char* user_file = sg_auth_user_file_path();
+    sg_auth_user_record record;
+    long long max_id = 0;
+    if (!sg_load_auth_user_record(user_file, setup->name, &record, &max_id)) {
+        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+        return 0;
+    }
+
+    if (record.found) {
+        if (record.banned) {
+            long long now_sec = (long long)time(NULL);
+            if (record.ban_expire_epoch > 0 && record.ban_expire_epoch > now_sec) {
+                char expire_text[64];
+                if (sg_format_ban_expire_local(record.ban_expire_epoch, expire_text, sizeof(expire_text))) {
+                    snprintf(out_error, out_error_cap, "[\"you have been banned! expire at %%1\", \"%s\"]", expire_text);
+                } else {
+                    snprintf(out_error, out_error_cap, "%s", "you have been banned!");
+                }
+                return 0;
+            }
+            if (record.ban_expire_epoch <= 0 || record.ban_expire_epoch > now_sec) {
+                snprintf(out_error, out_error_cap, "%s", "you have been banned!");
+                return 0;
+            }
+            if (record.ban_expire_epoch > 0 && record.ban_expire_epoch <= now_sec) {
+                (void)sg_rewrite_user_ban_status(user_file, &record, 0, 0);
+                record.banned = 0;
+                record.ban_expire_epoch = 0;
+            }
+        }
+        int matched = 0;
+        if (record.salt[0] != '\0') {
+            matched = sg_password_matches_salted_sha256(
+                record.password,
+                record.salt,
+                candidate_password,
+                stripped_password
+            );
+        } else {
+            char inline_salt[32];
+            char inline_hash[96];
+            inline_salt[0] = '\0';
+            inline_hash[0] = '\0';
+            if (sg_parse_inline_sha256_password(record.password, inline_salt, sizeof(inline_salt), inline_hash, sizeof(inline_hash))) {
+                matched = sg_password_matches_salted_sha256(
+                    inline_hash,
+                    inline_salt,
+                    candidate_password,
+                    stripped_password
+                );
+            } else {
+                matched = sg_password_matches_record(
+                    record.password,
+                    candidate_password,
+                    stripped_password,
+                    candidate_password_hex
+                );
+            }
+        }
+        if (!matched) {
+            snprintf(out_error, out_error_cap, "%s", "username or password error");
+            return 0;
+        }
+        if (out_player_id != NULL) {
+            *out_player_id = record.id;
+        }
+        if (out_avatar != NULL && out_avatar_cap > 0) {
+            snprintf(out_avatar, out_avatar_cap, "%s", record.avatar);
+        }
+        return 1;
+    }
+
+    if (!sg_auth_userdb_autoregister_enabled()) {
+        snprintf(out_error, out_error_cap, "%s", "username or password error");
+        return 0;
+    }
+
+    int max_per_device = sg_auth_max_players_per_device();
+    const char* binding_file = sg_auth_uuid_binding_file_path();
+    if (setup->uuid[0] != '\0' && sg_count_uuid_bindings(binding_file, setup->uuid) >= max_per_device) {
+        snprintf(out_error, out_error_cap, "%s", "cannot register more new users on this device");
+        return 0;
+    }
+
+    long long new_id = (max_id > 0 ? max_id + 1 : 1);
+    const char* default_avatar = getenv("SENGOO_DEFAULT_AVATAR");
+    if (default_avatar == NULL || default_avatar[0] == '\0') {
+        default_avatar = "liubei";
+    }
+    const char* store_password = candidate_password;
+    if (stripped_password[0] != '\0') {
+        store_password = stripped_password;
+    }
+    if (store_password == NULL || store_password[0] == '\0') {
+        snprintf(out_error, out_error_cap, "%s", "unknown password error");
+        return 0;
+    }
+
+    char salt_hex[16];
+    char password_hash_hex[65];
+    salt_hex[0] = '\0';
+    password_hash_hex[0] = '\0';
+    if (!sg_generate_salt_hex8(salt_hex, sizeof(salt_hex)) ||
+        !sg_sha256_password_with_salt_hex(store_password, salt_hex, password_hash_hex, sizeof(password_hash_hex))) {
+        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+        return 0;
+    }
+
+    char user_line[SG_AUTH_LINE_MAX];
+    int user_line_len = snprintf(
+        user_line,
+        sizeof(user_line),
+        "%lld|%s|%s|%s|0|0|%s",
+        new_id,
+        setup->name,
+        password_hash_hex,
+        default_avatar,
+        salt_hex
+    );
+    if (user_line_len <= 0 || user_line_len >= (int)sizeof(user_line)) {
+        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+        return 0;
+    }
+    if (!sg_append_auth_line(user_file, user_line)) {
+        snprintf(out_error, out_error_cap, "%s", "server internal auth storage error");
+        return 0;
+    }
+
+    if (setup->uuid[0] != '\0') {
+        char bind_line[SG_AUTH_LINE_MAX];
+        int bind_len = snprintf(bind_line, sizeof(bind_line), "%s|%s", setup->uuid, setup->name);
+        if (bind_len > 0 && bind_len < (int)sizeof(bind_line)) {
+            (void)sg_append_auth_line(binding_file, bind_line);
+        }
+    }
+
+    if (out_player_id != NULL) {
+        *out_player_id = new_id;
+    }
+    if (out_avatar != NULL && out_avatar_cap > 0) {
+        snprintf(out_avatar, out_avatar_cap, "%s", default_avatar);
+    }
+    return 1;
+}
+
+static int sg_is_ip_banned(const char* ip) {
+    const char* path = getenv("SENGOO_BAN_IP_FILE");
+    return sg_file_contains_token_line(&g_ban_ip_file_cache, path, ip);
+}
+
+static int sg_is_ip_temp_banned(const char* ip) {
+    const char* path = getenv("SENGOO_TEMP_BAN_IP_FILE");
+    return sg_file_contains_token_line(&g_temp_ban_ip_file_cache, path, ip);
+}
+
+static int sg_is_uuid_banned(const char* uuid) {
+    const char* path = getenv("SENGOO_BAN_UUID_FILE");
+    return sg_file_contains_token_line(&g_ban_uuid_file_cache, path, uuid);
+}
+
+static long long sg_now_unix_ms(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    ULARGE_INTEGER uli;
+    uli.LowPart = ft.dwLowDateTime;
+    uli.HighPart = ft.dwHighDateTime;
+    unsigned long long unix_100ns = uli.QuadPart - 116444736000000000ULL;
+    return (long long)(unix_100ns / 10000ULL);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000LL + (long long)(ts.tv_nsec / 1000000L);
+#endif
+}
+
+static int sg_kick_duplicate_local_sessions(long long login_seq, long long player_id, const char* player_name) {
+    int has_name = (player_name != NULL && player_name[0] != '\0');
+    int kicked = 0;
+
+    for (int i = 0; i < g_reactor->connections.high_water; i++) {
+        sg_tcp_conn* conn = sg_tcp_conn_at(i);
+        if (conn == NULL || !conn->auth_passed || conn->close_after_flush || conn->cold.login_seq >= login_seq) {
+            continue;
+        }
+        int same_player = (player_id > 0 && conn->cold.player_id > 0 && conn->cold.player_id == player_id);
+        int same_name = (has_name && conn->cold.player_name[0] != '\0' && strcmp(conn->cold.player_name, player_name) == 0);
+        if (!same_player && !same_name) {
+            continue;
+        }
+        (void)sg_send_errordlg_and_close(conn, "others logged in again with this name");
+        if (sg_tcp_conn_close_after_flush(conn->handle)) {
+            kicked += 1;
+        }
+    }
+    return kicked;
+}
+
+static int sg_kick_duplicate_online_sessions(long long login_seq, long long player_id, const char* player_name) {
+    for (int i = 0; i < g_reactor_count; i++) {
+        if (i != g_reactor->index) {
+            sg_reactor_post(i, SG_REACTOR_MSG_KICK, login_seq, player_id, player_name, NULL);
+        }
+    }
+    return sg_kick_duplicate_local_sessions(login_seq, player_id, player_name);
+}
+
+static int sg_send_post_setup_packets(
+    sg_tcp_conn* conn,
+    const sg_setup_fields* setup,
+    long long resolved_player_id,
+    const char* resolved_avatar
+) {
+    if (setup == NULL) {
+        return 0;
+    }
+    const char* avatar = resolved_avatar;
+    if (avatar == NULL || avatar[0] == '\0') {
+        avatar = getenv("SENGOO_DEFAULT_AVATAR");
+    }
+    if (avatar == NULL || avatar[0] == '\0') {
+        avatar = "liubei";
+    }
+    long long player_id = resolved_player_id;
+    if (player_id <= 0) {
+        player_id = 1;
+        const char* player_id_raw = getenv("SENGOO_DEFAULT_PLAYER_ID");
+        if (player_id_raw != NULL && player_id_raw[0] != '\0') {
+            long parsed = strtol(player_id_raw, NULL, 10);
+            if (parsed > 0) {
+                player_id = (long long)parsed;
+            }
+        }
+    }
+    unsigned char setup_payload[SG_AUTH_NAME_MAX + 256];
+    size_t setup_payload_len = 0;
+    {
+        size_t idx = 0;
+        int ok = 1;
+        ok = ok && sg_cbor_write_type_and_len(setup_payload, sizeof(setup_payload), &idx, 4, 4);
+        ok = ok && sg_cbor_write_signed_integer(setup_payload, sizeof(setup_payload), &idx, player_id);
+        ok = ok && sg_cbor_write_bytes_like(setup_payload, sizeof(setup_payload), &idx, 2, (const unsigned char*)setup->name, strlen(setup->name));
+        ok = ok && sg_cbor_write_bytes_like(setup_payload, sizeof(setup_payload), &idx, 2, (const unsigned char*)avatar, strlen(avatar));
+        ok = ok && sg_cbor_write_signed_integer(setup_payload, sizeof(setup_payload), &idx, sg_now_unix_ms());
+        if (!ok) {
+            return 0;
+        }
+        setup_payload_len = idx;
+    }
+    if (!sg_send_server_notification(conn, "Setup", setup_payload, setup_payload_len, 2)) {
+        return 0;
+    }
+
+    unsigned char settings_payload[512];
+    size_t settings_len = 0;
+    {
+        size_t idx = 0;
+        const char* motd = getenv("SENGOO_MOTD");
+        if (motd == NULL) {
+            motd = "";
+        }
+        int ok = 1;
+        ok = ok && sg_cbor_write_type_and_len(settings_payload, sizeof(settings_payload), &idx, 4, 3);
+        ok = ok && sg_cbor_write_bytes_like(settings_payload, sizeof(settings_payload), &idx, 2, (const unsigned char*)motd, strlen(motd));
+        ok = ok && sg_cbor_write_type_and_len(settings_payload, sizeof(settings_payload), &idx, 4, 0);
+        ok = ok && sg_cbor_write_type_and_len(settings_payload, sizeof(settings_payload), &idx, 4, 0);
+        if (!ok) {
+            return 0;
+        }
+        settings_len = idx;
+    }
+    if (!sg_send_server_notification(conn, "SetServerSettings", settings_payload, settings_len, 2)) {
+        return 0;
+    }
+
+    unsigned char game_time_payload[64];
+    size_t game_time_len = 0;
+    {
+        size_t idx = 0;
+        int ok = 1;
+        ok = ok && sg_cbor_write_type_and_len(game_time_payload, sizeof(game_time_payload), &idx, 4, 2);
+        ok = ok && sg_cbor_write_signed_integer(game_time_payload, sizeof(game_time_payload), &idx, player_id);
+        ok = ok && sg_cbor_write_signed_integer(game_time_payload, sizeof(game_time_payload), &idx, 0);
+        if (!ok) {
+            return 0;
+        }
+        game_time_len = idx;
+    }
+    return sg_send_server_notification(conn, "AddTotalGameTime", game_time_payload, game_time_len, 2);
+}
+
+static int sg_handle_auth_setup_packet(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet) {
+    if (packet == NULL || conn == NULL) {
+        return -1;
+    }
+    if (packet->request_id != -2) {
+        sg_send_errordlg_and_close(conn, "INVALID SETUP STRING");
+        return -2;
+    }
+    if ((packet->packet_type & SG_PACKET_TYPE_NOTIFICATION) == 0 ||
+        (packet->packet_type & SG_PACKET_SRC_CLIENT) == 0 ||
+        (packet->packet_type & SG_PACKET_DEST_SERVER) == 0) {
+        sg_send_errordlg_and_close(conn, "INVALID SETUP STRING");
+        return -2;
+    }
+
+    sg_setup_fields setup;
+    if (!sg_parse_setup_payload(packet->payload_ptr, packet->payload_len, &setup)) {
+        sg_send_errordlg_and_close(conn, "INVALID SETUP STRING");
+        return -2;
+    }
+    conn->setup_received = 1;
+
+    if (!sg_is_supported_client_version(setup.version)) {
+        const char* msg = "[\"server supports version %1, please update\",\"0.5.19+\"]";
+        sg_send_errordlg_and_close(conn, msg);
+        return -2;
+    }
+
+    if (sg_is_uuid_banned(setup.uuid)) {
+        sg_send_errordlg_and_close(conn, "you have been banned!");
+        return -2;
+    }
+
+    if (sg_should_enforce_md5() && !sg_md5_matches_expected(setup.md5)) {
+        sg_send_md5_failure_and_update_package(conn);
+        return -2;
+    }
+
+    long long resolved_player_id = 0;
+    char resolved_avatar[SG_AUTH_AVATAR_MAX];
+    char auth_error[256];
+    resolved_avatar[0] = '\0';
+    auth_error[0] = '\0';
+    sg_runtime_lock();
+    int credentials_ok = sg_check_userdb_credentials(
+        &setup,
+        &resolved_player_id,
+        resolved_avatar,
+        sizeof(resolved_avatar),
+        auth_error,
+        sizeof(auth_error)
+    );
+    sg_runtime_unlock();
+    if (!credentials_ok) {
         const char* msg = (auth_error[0] == '\0' ? "username or password error" : auth_error);
-        sg_send_errordlg_and_close(socket, msg);
+        sg_send_errordlg_and_close(conn, msg);
+        return -2;
+    }
+
+    conn->auth_passed = 1;
+    conn->cold.player_id = resolved_player_id;
+    snprintf(conn->cold.player_name, sizeof(conn->cold.player_name), "%s", setup.name);
+    conn->cold.login_seq = SG_ATOMIC_ADD(&g_login_seq, 1);
+    int kicked_duplicate = sg_kick_duplicate_online_sessions(conn->cold.login_seq, resolved_player_id, setup.name);
+    if (kicked_duplicate > 0) {
+        sg_logf(
+            "INFO",
+            "AUTH",
+            "duplicate session kicked name=%s player_id=%lld kicked=%d",
+            setup.name,
+            resolved_player_id,
+            kicked_duplicate
+        );
+    }
+
+    sg_timer_cancel(&conn->cold.timers[SG_TCP_TIMER_SIGNUP]);
+    int idle_timeout_ms = sg_tcp_idle_timeout_ms();
+    if (idle_timeout_ms > 0) {
+        sg_timer_arm(&conn->cold.timers[SG_TCP_TIMER_IDLE], conn->handle, SG_TCP_TIMER_IDLE, conn->cold.last_activity_ms + idle_timeout_ms);
+    }
+    if (!sg_send_post_setup_packets(conn, &setup, resolved_player_id, resolved_avatar)) {
+        return -1;
+    }
+    sg_logf(
+        "INFO",
+        "AUTH",
+        "setup accepted name=%s version=%s uuid=%s player_id=%lld userdb=%d",
+        setup.name,
+        setup.version,
+        setup.uuid,
+        (resolved_player_id > 0 ? resolved_player_id : -1),
+        sg_auth_userdb_enabled()
+    );
+    return 1;
+}
+
+static int sg_command_ping_request(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet, sg_command_reply* reply) {
+    (void)conn;
+    (void)packet;
+    reply->payload_major = 2;
+    reply->payload_ptr = (const unsigned char*)"PONG";
+    reply->payload_len = 4;
+    return 1;
+}
+
+static int sg_command_bye_request(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet, sg_command_reply* reply) {
+    (void)conn;
+    (void)packet;
+    reply->payload_major = 2;
+    reply->payload_ptr = (const unsigned char*)"Goodbye";
+    reply->payload_len = 7;
+    reply->close_after_reply = 1;
+    return 1;
+}
+
+static int sg_command_bye_notify(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet) {
+    (void)conn;
+    sg_logf("INFO", "PROTO", "client bye notification req=%lld", packet->request_id);
+    return -2;
+}
+
+static int sg_command_setup_notify(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet) {
+    (void)conn;
+    sg_logf("INFO", "AUTH", "duplicate setup ignored req=%lld", packet->request_id);
+    return 1;
+}
+
+typedef int (*sg_command_request_fn)(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet, sg_command_reply* reply);
+typedef int (*sg_command_notify_fn)(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet);
+
+typedef struct {
+    sg_command_request_fn on_request;
+    sg_command_notify_fn on_notify;
+} sg_command_handler;
+
+static const sg_command_handler g_command_handlers[SG_COMMAND_COUNT] = {
+    [SG_COMMAND_SETUP] = { NULL, sg_command_setup_notify },
+    [SG_COMMAND_PING] = { sg_command_ping_request, NULL },
+    [SG_COMMAND_BYE] = { sg_command_bye_request, sg_command_bye_notify },
+};
+
+static const char* sg_command_label(const sg_cbor_wire_packet* packet, int command_id, char* out, size_t out_cap) {
+    if (command_id != SG_COMMAND_UNKNOWN) {
+        return g_command_names[command_id];
+    }
+    sg_packet_token(packet->command_ptr, packet->command_len, out, out_cap);
+    return out;
+}
+
+static int sg_handle_cbor_wire_packet(sg_tcp_conn* conn, const sg_cbor_wire_packet* packet) {
+    if (conn == NULL || packet == NULL) {
+        return -1;
+    }
+    conn->cold.last_activity_ms = sg_monotonic_ms();
+
+    int command_id = sg_command_lookup(packet->command_ptr, packet->command_len);
+    SG_ATOMIC_ADD(&g_reactor->command_counts[command_id], 1);
+    const sg_command_handler* handler = &g_command_handlers[command_id];
+    char command_tag[96];
+    int is_setup_notification =
+        ((packet->packet_type & SG_PACKET_TYPE_NOTIFICATION) != 0) &&
+        command_id == SG_COMMAND_SETUP;
+
+    if (!conn->auth_passed) {
+        if (is_setup_notification) {
+            return sg_handle_auth_setup_packet(conn, packet);
+        }
+        sg_logf(
+            "WARN",
+            "AUTH",
+            "pre-auth packet rejected req=%lld type=%lld cmd=%s",
+            packet->request_id,
+            packet->packet_type,
+            sg_command_label(packet, command_id, command_tag, sizeof(command_tag))
+        );
+        sg_send_errordlg_and_close(conn, "INVALID SETUP STRING");
         return -2;
     }
 
-    int kicked_duplicate = sg_kick_duplicate_online_sessions(conn_handle, resolved_player_id, setup.name);
-    if (kicked_duplicate > 0) {
+    if ((packet->packet_type & SG_PACKET_TYPE_REQUEST) != 0) {
+        sg_command_reply reply;
+        reply.payload_major = packet->payload_major;
+        reply.payload_ptr = packet->payload_ptr;
+        reply.payload_len = packet->payload_len;
+        reply.close_after_reply = 0;
+        int reply_field_count = (packet->field_count >= 6 ? 6 : 4);
+        if (handler->on_request != NULL) {
+            int handler_rc = handler->on_request(conn, packet, &reply);
+            if (handler_rc <= 0) {
+                return handler_rc;
+            }
+        }
+
+        long long reply_type = (packet->packet_type & ~((long long)SG_PACKET_TYPE_REQUEST)) | SG_PACKET_TYPE_REPLY;
+        size_t out_cap = 128 + packet->command_len + reply.payload_len;
+        unsigned char* out = (unsigned char*)malloc(out_cap);
+        if (out == NULL) {
+            return -1;
+        }
+        size_t idx = 0;
+        int ok = 1;
+        ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 4, (unsigned long long)reply_field_count);
+        ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, packet->request_id);
+        ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, reply_type);
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, packet->command_major, packet->command_ptr, packet->command_len);
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, reply.payload_major, reply.payload_ptr, reply.payload_len);
+        if (ok && reply_field_count >= 6) {
+            ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, packet->timeout);
+            ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, packet->timestamp);
+        }
+
+        if (!ok || !sg_tcp_conn_send(conn, out, idx)) {
+            free(out);
+            return -1;
+        }
+        sg_logf(
+            "INFO",
+            "PROTO",
+            "cbor request handled req=%lld type=%lld cmd=%s payload=%u fields=%d",
+            packet->request_id,
+            packet->packet_type,
+            sg_command_label(packet, command_id, command_tag, sizeof(command_tag)),
+            (unsigned)reply.payload_len,
+            reply_field_count
+        );
+        free(out);
+        if (reply.close_after_reply) {
+            return -2;
+        }
+        return 1;
+    }
+
+    if ((packet->packet_type & SG_PACKET_TYPE_NOTIFICATION) != 0) {
+        if (handler->on_notify != NULL) {
+            return handler->on_notify(conn, packet);
+        }
+        sg_logf(
+            "INFO",
+            "PROTO",
+            "cbor notification req=%lld type=%lld cmd=%s payload=%u",
+            packet->request_id,
+            packet->packet_type,
+            sg_command_label(packet, command_id, command_tag, sizeof(command_tag)),
+            (unsigned)packet->payload_len
+        );
+        return 1;
+    }
+
+    if ((packet->packet_type & SG_PACKET_TYPE_REPLY) != 0) {
+        sg_logf(
+            "INFO",
+            "PROTO",
+            "client reply packet ignored req=%lld type=%lld cmd=%s payload=%u",
+            packet->request_id,
+            packet->packet_type,
+            sg_command_label(packet, command_id, command_tag, sizeof(command_tag)),
+            (unsigned)packet->payload_len
+        );
+        return 1;
+    }
+
+    return -1;
+}
+
+static int sg_read_file_text(const char* path, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0 || path == NULL || path[0] == '\0') {
+        return 0;
+    }
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    size_t n = fread(out, 1, out_cap - 1, fp);
+    out[n] = '\0';
+    fclose(fp);
+    if (n == 0) {
+        return 0;
+    }
+    return 1;
+}
+
+static void sg_strip_utf8_bom(char* text) {
+    if (text == NULL) {
+        return;
+    }
+    unsigned char* p = (unsigned char*)text;
+    if (p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+        size_t len = strlen(text);
+        if (len >= 3) {
+            memmove(text, text + 3, len - 2);
+        }
+    }
+}
+
+static int sg_path_exists(const char* path) {
+    if (path == NULL || path[0] == '\0') {
+        return 0;
+    }
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    fclose(fp);
+    return 1;
+}
+
+static const char* sg_trim_leading_whitespace(const char* text) {
+    if (text == NULL) {
+        return "";
+    }
+    const unsigned char* p = (const unsigned char*)text;
+    if (p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+        p += 3;
+    }
+    while (*p != '\0' && isspace(*p)) {
+        p += 1;
+    }
+    return (const char*)p;
+}
+
+static int sg_registry_json_is_empty(const char* json) {
+    const char* p = sg_trim_leading_whitespace(json);
+    if (*p == '\0') {
+        return 1;
+    }
+    if (*p != '[') {
+        return 0;
+    }
+    p += 1;
+    p = sg_trim_leading_whitespace(p);
+    if (*p != ']') {
+        return 0;
+    }
+    p += 1;
+    p = sg_trim_leading_whitespace(p);
+    return *p == '\0';
+}
+
+static void sg_trim_trailing_whitespace(char* text) {
+    if (text == NULL) {
+        return;
+    }
+    size_t len = strlen(text);
+    while (len > 0) {
+        char ch = text[len - 1];
+        if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
+            text[len - 1] = '\0';
+            len -= 1;
+        } else {
+            break;
+        }
+    }
+}
+
+static unsigned long sg_hash_text(const char* text) {
+    const unsigned char* p = (const unsigned char*)(text == NULL ? "" : text);
+    unsigned long h = 5381UL;
+    while (*p != 0) {
+        h = ((h << 5) + h) + (unsigned long)(*p);
+        p += 1;
+    }
+    return h;
+}
+
+static int sg_str_ieq(const char* a, const char* b) {
+    if (a == NULL || b == NULL) {
+        return 0;
+    }
+#ifdef _WIN32
+    return _stricmp(a, b) == 0;
+#else
+    return strcasecmp(a, b) == 0;
+#endif
+}
+
+static int sg_extension_bootstrap_enabled(void) {
+    const char* raw = getenv("SENGOO_EXTENSION_BOOTSTRAP");
+    if (raw == NULL || raw[0] == '\0') {
+        return 1;
+    }
+    if (sg_str_ieq(raw, "0") || sg_str_ieq(raw, "false") || sg_str_ieq(raw, "off") || sg_str_ieq(raw, "no")) {
+        return 0;
+    }
+    return 1;
+}
+
+static int sg_extension_sync_refresh_interval_ms(void) {
+    const char* raw = getenv("SENGOO_EXTENSION_REFRESH_MS");
+    if (raw == NULL || raw[0] == '\0') {
+        return 3000;
+    }
+    char* end = NULL;
+    long value = strtol(raw, &end, 10);
+    if (end == raw || *end != '\0' || value <= 0) {
+        return 3000;
+    }
+    if (value < 200) {
+        value = 200;
+    } else if (value > 600000) {
+        value = 600000;
+    }
+    return (int)value;
+}
+
+static const char* sg_default_core_entry_path(char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return "";
+    }
+    const char* env_path = getenv("SENGOO_EXTENSION_CORE_ENTRY");
+    if (env_path != NULL && env_path[0] != '\0') {
+        snprintf(out, out_cap, "%s", env_path);
+        return out;
+    }
+
+    const char* nested = "packages/packages/freekill-core/lua/server/rpc/entry.lua";
+    const char* root = "packages/freekill-core/lua/server/rpc/entry.lua";
+    if (sg_path_exists(nested)) {
+        snprintf(out, out_cap, "%s", nested);
+    } else {
+        snprintf(out, out_cap, "%s", root);
+    }
+    return out;
+}
+
+static const char* sg_extension_bootstrap_lua_exe(void) {
+    const char* raw = getenv("SENGOO_LUA_EXE");
+    if (raw == NULL || raw[0] == '\0') {
+        return "lua5.4";
+    }
+    return raw;
+}
+
+static int sg_extension_bootstrap_check_lua_runtime(void) {
+    if (g_extension_bootstrap_lua_checked) {
+        return g_extension_bootstrap_lua_available;
+    }
+    g_extension_bootstrap_lua_checked = 1;
+    g_extension_bootstrap_lua_available = 0;
+
+    const char* lua_exe = sg_extension_bootstrap_lua_exe();
+    if (lua_exe == NULL || lua_exe[0] == '\0') {
+        return 0;
+    }
+
+    if (strchr(lua_exe, '\\') != NULL || strchr(lua_exe, '/') != NULL || strchr(lua_exe, ':') != NULL) {
+        g_extension_bootstrap_lua_available = sg_path_exists(lua_exe);
+    } else {
+        char check_cmd[SG_EXTENSION_CMD_MAX];
+#ifdef _WIN32
+        int check_len = snprintf(check_cmd, sizeof(check_cmd), "where %s >nul 2>&1", lua_exe);
+#else
+        int check_len = snprintf(check_cmd, sizeof(check_cmd), "command -v %s >/dev/null 2>&1", lua_exe);
+#endif
+        if (check_len > 0 && check_len < (int)sizeof(check_cmd)) {
+            int check_rc = system(check_cmd);
+            g_extension_bootstrap_lua_available = (check_rc == 0);
+        }
+    }
+
+    if (!g_extension_bootstrap_lua_available && !g_extension_bootstrap_lua_missing_logged) {
+        g_extension_bootstrap_lua_missing_logged = 1;
+        sg_logf("WARN", "EXT", "lua runtime unavailable exe=%s", lua_exe);
+    }
+    return g_extension_bootstrap_lua_available;
+}
+
+static int sg_ensure_runtime_tmp_dirs(void) {
+    if (sg_mkdir(".tmp") != 0 && errno != EEXIST) {
+        return 0;
+    }
+    if (sg_mkdir(".tmp/runtime_host") != 0 && errno != EEXIST) {
+        return 0;
+    }
+    return 1;
+}
+
+static const char* sg_find_substr_in_range(const char* begin, const char* end, const char* needle) {
+    if (begin == NULL || end == NULL || needle == NULL) {
+        return NULL;
+    }
+    size_t needle_len = strlen(needle);
+    if (needle_len == 0 || begin >= end) {
+        return NULL;
+    }
+    const char* p = begin;
+    while (p + needle_len <= end) {
+        if (memcmp(p, needle, needle_len) == 0) {
+            return p;
+        }
+        p += 1;
+    }
+    return NULL;
+}
+
+static int sg_extract_json_string_field(
+    const char* obj_begin,
+    const char* obj_end,
+    const char* field_name,
+    char* out,
+    size_t out_cap
+) {
+    if (obj_begin == NULL || obj_end == NULL || field_name == NULL || out == NULL || out_cap == 0 || obj_begin >= obj_end) {
+        return 0;
+    }
+    out[0] = '\0';
+
+    char key_pattern[128];
+    int key_len = snprintf(key_pattern, sizeof(key_pattern), "\"%s\"", field_name);
+    if (key_len <= 0 || key_len >= (int)sizeof(key_pattern)) {
+        return 0;
+    }
+
+    const char* key = sg_find_substr_in_range(obj_begin, obj_end, key_pattern);
+    if (key == NULL) {
+        return 0;
+    }
+    const char* p = key + key_len;
+    while (p < obj_end && isspace((unsigned char)*p)) {
+        p += 1;
+    }
+    if (p >= obj_end || *p != ':') {
+        return 0;
+    }
+    p += 1;
+    while (p < obj_end && isspace((unsigned char)*p)) {
+        p += 1;
+    }
+    if (p >= obj_end || *p != '"') {
+        return 0;
+    }
+    p += 1;
+
+    size_t out_len = 0;
+    int escaped = 0;
+    while (p < obj_end) {
+        char ch = *p;
+        if (!escaped) {
+            if (ch == '\\') {
+                escaped = 1;
+            } else if (ch == '"') {
+                out[out_len] = '\0';
+                return 1;
+            } else {
+                if (out_len + 1 < out_cap) {
+                    out[out_len++] = ch;
+                }
+            }
+        } else {
+            char decoded = ch;
+            if (ch == 'n') decoded = '\n';
+            else if (ch == 'r') decoded = '\r';
+            else if (ch == 't') decoded = '\t';
+            else if (ch == '\\') decoded = '\\';
+            else if (ch == '"') decoded = '"';
+            else if (ch == '/') decoded = '/';
+            if (out_len + 1 < out_cap) {
+                out[out_len++] = decoded;
+            }
+            escaped = 0;
+        }
+        p += 1;
+    }
+    out[out_len] = '\0';
+    return 0;
+}
+
+static int sg_extract_registry_json(const char* payload, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return 0;
+    }
+    out[0] = '\0';
+    if (payload[0] == '\0') {
+        return 0;
+    }
+
+    const char* marker = "\"registry\":";
+    const char* p = strstr(payload, marker);
+    if (p == NULL) {
+        return 0;
+    }
+    p += strlen(marker);
+    while (*p != '\0' && isspace((unsigned char)*p)) {
+        p += 1;
+    }
+    if (*p != '[') {
+        return 0;
+    }
+
+    const char* start = p;
+    int depth = 0;
+    int in_string = 0;
+    int escaped = 0;
+    while (*p != '\0') {
+        char ch = *p;
+        if (in_string) {
+            if (escaped) {
+                escaped = 0;
+            } else if (ch == '\\') {
+                escaped = 1;
+            } else if (ch == '"') {
+                in_string = 0;
+            }
+        } else {
+            if (ch == '"') {
+                in_string = 1;
+            } else if (ch == '[') {
+                depth += 1;
+            } else if (ch == ']') {
+                depth -= 1;
+                if (depth == 0) {
+                    size_t len = (size_t)(p - start + 1);
+                    if (len >= out_cap) {
+                        len = out_cap - 1;
+                    }
+                    memcpy(out, start, len);
+                    out[len] = '\0';
+                    return 1;
+                }
+                if (depth < 0) {
+                    break;
+                }
+            }
+        }
+        p += 1;
+    }
+
+    return 0;
+}
+
+static int sg_extract_registry_json_from_sync_payload(char* out, size_t out_cap) {
+    sg_runtime_lock();
+    int ok = sg_extract_registry_json(g_extension_sync_payload, out, out_cap);
+    sg_runtime_unlock();
+    return ok;
+}
+
+static int sg_json_object_is_enabled(const char* obj_begin, const char* obj_end) {
+    if (obj_begin == NULL || obj_end == NULL || obj_begin >= obj_end) {
+        return 1;
+    }
+    const char* key = sg_find_substr_in_range(obj_begin, obj_end, "\"enabled\"");
+    if (key == NULL) {
+        return 1;
+    }
+    const char* p = key + strlen("\"enabled\"");
+    while (p < obj_end && isspace((unsigned char)*p)) {
+        p += 1;
+    }
+    if (p >= obj_end || *p != ':') {
+        return 1;
+    }
+    p += 1;
+    while (p < obj_end && isspace((unsigned char)*p)) {
+        p += 1;
+    }
+    if (p + 5 <= obj_end && memcmp(p, "false", 5) == 0) {
+        return 0;
+    }
+    return 1;
+}
+
+static size_t sg_build_update_package_summary(unsigned char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return 0;
+    }
+
+    typedef struct {
+        char name[SG_EXTENSION_NAME_MAX];
+        char hash[SG_EXTENSION_HASH_MAX];
+        char url[SG_EXTENSION_ENTRY_MAX];
+    } sg_update_summary_entry;
+
+    sg_update_summary_entry entries[SG_EXTENSION_BOOTSTRAP_MAX];
+    int entry_count = 0;
+
+    char registry_json[SG_EXTENSION_SYNC_PAYLOAD_MAX];
+    registry_json[0] = '\0';
+    if (!sg_extract_registry_json_from_sync_payload(registry_json, sizeof(registry_json))) {
+        out[0] = 0x80;
+        return 1;
+    }
+
+    const char* cursor = registry_json;
+    while (cursor != NULL && *cursor != '\0' && entry_count < SG_EXTENSION_BOOTSTRAP_MAX) {
+        const char* obj_begin = strchr(cursor, '{');
+        if (obj_begin == NULL) {
+            break;
+        }
+        const char* obj_end = strchr(obj_begin, '}');
+        if (obj_end == NULL) {
+            break;
+        }
+
+        if (!sg_json_object_is_enabled(obj_begin, obj_end + 1)) {
+            cursor = obj_end + 1;
+            continue;
+        }
+
+        char name[SG_EXTENSION_NAME_MAX];
+        char hash[SG_EXTENSION_HASH_MAX];
+        char url[SG_EXTENSION_ENTRY_MAX];
+        name[0] = '\0';
+        hash[0] = '\0';
+        url[0] = '\0';
+
+        int has_name = sg_extract_json_string_field(obj_begin, obj_end + 1, "name", name, sizeof(name));
+        (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "hash", hash, sizeof(hash));
+        if (!sg_extract_json_string_field(obj_begin, obj_end + 1, "url", url, sizeof(url))) {
+            (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "entry", url, sizeof(url));
+        }
+
+        if (has_name && name[0] != '\0') {
+            sg_update_summary_entry* item = &entries[entry_count];
+            snprintf(item->name, sizeof(item->name), "%s", name);
+            snprintf(item->hash, sizeof(item->hash), "%s", hash);
+            snprintf(item->url, sizeof(item->url), "%s", url);
+            entry_count += 1;
+        }
+
+        cursor = obj_end + 1;
+    }
+
+    size_t idx = 0;
+    int ok = 1;
+    ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 4, (unsigned long long)entry_count);
+    for (int i = 0; i < entry_count && ok; i++) {
+        sg_update_summary_entry* item = &entries[i];
+        ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 5, 3);
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)"name", 4);
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)item->name, strlen(item->name));
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)"hash", 4);
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)item->hash, strlen(item->hash));
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)"url", 3);
+        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)item->url, strlen(item->url));
+    }
+
+    if (!ok || idx == 0) {
+        out[0] = 0x80;
+        return 1;
+    }
+    return idx;
+}
+
+static void sg_sanitize_filename_token(const char* input, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
+        return;
+    }
+    out[0] = '\0';
+    if (input == NULL || input[0] == '\0') {
+        snprintf(out, out_cap, "unknown");
+        return;
+    }
+    size_t j = 0;
+    for (size_t i = 0; input[i] != '\0' && j + 1 < out_cap; i++) {
+        unsigned char c = (unsigned char)input[i];
+        if (isalnum(c) || c == '-' || c == '_') {
+            out[j++] = (char)c;
+        } else {
+            out[j++] = '_';
+        }
+    }
+    out[j] = '\0';
+    if (j == 0) {
+        snprintf(out, out_cap, "unknown");
+    }
+}
+
+static int sg_write_text_file(const char* path, const char* content) {
+    if (path == NULL || content == NULL) {
+        return 0;
+    }
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    size_t n = fwrite(content, 1, strlen(content), fp);
+    fclose(fp);
+    return n == strlen(content);
+}
+
+static int sg_run_command_capture(const char* command, char* output, size_t output_cap) {
+    if (command == NULL || command[0] == '\0' || output == NULL || output_cap == 0) {
+        return -1;
+    }
+    output[0] = '\0';
+    FILE* pipe = sg_popen(command, "r");
+    if (pipe == NULL) {
+        return -1;
+    }
+    size_t used = 0;
+    char chunk[256];
+    while (fgets(chunk, (int)sizeof(chunk), pipe) != NULL) {
+        size_t chunk_len = strlen(chunk);
+        if (used + chunk_len + 1 < output_cap) {
+            memcpy(output + used, chunk, chunk_len);
+            used += chunk_len;
+            output[used] = '\0';
+        }
+    }
+    int exit_code = sg_pclose(pipe);
+    sg_trim_trailing_whitespace(output);
+    return exit_code;
+}
+
+static int sg_find_extension_bootstrap_slot(const char* name, int* found_existing) {
+    int first_free = -1;
+    if (found_existing != NULL) {
+        *found_existing = 0;
+    }
+    for (int i = 0; i < SG_EXTENSION_BOOTSTRAP_MAX; i++) {
+        if (!g_extension_bootstrap_entries[i].used) {
+            if (first_free < 0) {
+                first_free = i;
+            }
+            continue;
+        }
+        if (strcmp(g_extension_bootstrap_entries[i].name, name) == 0) {
+            if (found_existing != NULL) {
+                *found_existing = 1;
+            }
+            return i;
+        }
+    }
+    return first_free;
+}
+
+static int sg_bootstrap_extension(const char* name, const char* entry_path, const char* hash) {
+    const char* lua_exe = sg_extension_bootstrap_lua_exe();
+    if (!sg_extension_bootstrap_check_lua_runtime()) {
+        return 0;
+    }
+    if (!sg_ensure_runtime_tmp_dirs()) {
+        sg_logf("WARN", "EXT", "extension bootstrap skipped mkdir failed");
+        return 0;
+    }
+
+    char safe_name[SG_EXTENSION_NAME_MAX];
+    sg_sanitize_filename_token(name, safe_name, sizeof(safe_name));
+
+    char script_path[SG_EXTENSION_SCRIPT_MAX];
+    snprintf(script_path, sizeof(script_path), ".tmp/runtime_host/ext_bootstrap_%s.lua", safe_name);
+
+    char lua_script[SG_EXTENSION_SCRIPT_MAX];
+    int script_len = snprintf(
+        lua_script,
+        sizeof(lua_script),
+        "local entry = [=[%s]=]\n"
+        "local ext_name = [=[%s]=]\n"
+        "local function _sg_norm(p) return (string.gsub(p, '\\\\', '/')) end\n"
+        "local function _sg_is_abs(p) return (string.match(p, '^%%a:[/\\\\]') ~= nil) or string.sub(p, 1, 1) == '/' end\n"
+        "local function _sg_parent(p)\n"
+        "  local n = _sg_norm(p)\n"
+        "  local parent = string.match(n, '^(.*)/[^/]+$')\n"
+        "  if parent == nil or parent == '' then return '.' end\n"
+        "  return parent\n"
+        "end\n"
+        "local function _sg_root(p)\n"
+        "  local n = _sg_norm(p)\n"
+        "  local root = string.gsub(n, '/lua/server/rpc/entry%%.lua$', '')\n"
+        "  if root ~= n then return root end\n"
+        "  root = string.gsub(n, '/lua/init%%.lua$', '')\n"
+        "  if root ~= n then return root end\n"
+        "  return _sg_parent(n)\n"
+        "end\n"
+        "local package_root = _sg_root(entry)\n"
+        "local function _sg_join(root, rel)\n"
+        "  if string.sub(root, -1) == '/' then return root .. rel end\n"
+        "  return root .. '/' .. rel\n"
+        "end\n"
+        "local _orig_dofile = dofile\n"
+        "dofile = function(path)\n"
+        "  if type(path) == 'string' and path ~= '' and not _sg_is_abs(path) then\n"
+        "    return _orig_dofile(_sg_join(package_root, path))\n"
+        "  end\n"
+        "  return _orig_dofile(path)\n"
+        "end\n"
+        "package.path = package.path .. ';'\n"
+        "  .. _sg_join(package_root, '?.lua') .. ';'\n"
+        "  .. _sg_join(package_root, '?/init.lua') .. ';'\n"
+        "  .. _sg_join(package_root, 'lua/lib/?.lua') .. ';'\n"
+        "  .. _sg_join(package_root, 'lua/?.lua') .. ';'\n"
+        "  .. _sg_join(package_root, 'lua/?/init.lua')\n"
+        "local chunk, load_err = loadfile(entry)\n"
+        "if type(chunk) ~= 'function' then io.stderr:write(tostring(load_err)); os.exit(21) end\n"
+        "local ok, mod = pcall(chunk, 'sengoo_bootstrap')\n"
+        "if not ok then io.stderr:write(tostring(mod)); os.exit(21) end\n"
+        "local init_fn = nil\n"
+        "if type(mod) == 'table' then init_fn = mod.on_server_start or mod.bootstrap or mod.init end\n"
+        "if type(init_fn) == 'function' then\n"
+        "  local call_ok, ret = pcall(init_fn)\n"
+        "  if not call_ok then io.stderr:write(tostring(ret)); os.exit(22) end\n"
+        "  if ret ~= nil then io.write(tostring(ret)) end\n"
+        "end\n"
+        "io.write('EXT_BOOTSTRAP_OK:' .. ext_name)\n",
+        entry_path,
+        name
+    );
+    if (script_len <= 0 || script_len >= (int)sizeof(lua_script)) {
+        sg_logf("WARN", "EXT", "extension bootstrap script too large name=%s", name);
+        return 0;
+    }
+    if (!sg_write_text_file(script_path, lua_script)) {
+        sg_logf("WARN", "EXT", "extension bootstrap script write failed name=%s path=%s", name, script_path);
+        return 0;
+    }
+
+    char command[SG_EXTENSION_CMD_MAX];
+#ifdef _WIN32
+    int command_len = snprintf(command, sizeof(command), "cmd /c \"\"%s\" \"%s\" 2>&1\"", lua_exe, script_path);
+#else
+    int command_len = snprintf(command, sizeof(command), "\"%s\" \"%s\" 2>&1", lua_exe, script_path);
+#endif
+    if (command_len <= 0 || command_len >= (int)sizeof(command)) {
+        remove(script_path);
+        sg_logf("WARN", "EXT", "extension bootstrap command too large name=%s", name);
+        return 0;
+    }
+
+    char output[SG_EXTENSION_OUTPUT_MAX];
+    int exit_code = sg_run_command_capture(command, output, sizeof(output));
+    remove(script_path);
+
+    if (exit_code != 0) {
+        sg_logf(
+            "WARN",
+            "EXT",
+            "extension bootstrap failed name=%s exit=%d hash=%s output=%s",
+            name,
+            exit_code,
+            (hash == NULL ? "" : hash),
+            (output[0] == '\0' ? "<empty>" : output)
+        );
+        return 0;
+    }
+
+    sg_logf(
+        "INFO",
+        "EXT",
+        "extension bootstrap loaded name=%s hash=%s output=%s",
+        name,
+        (hash == NULL ? "" : hash),
+        (output[0] == '\0' ? "<empty>" : output)
+    );
+    return 1;
+}
+
+static int sg_run_extension_hook_once(
+    const char* name,
+    const char* entry_path,
+    const char* hash,
+    const char* hook_name
+) {
+    if (name == NULL || name[0] == '\0' || entry_path == NULL || entry_path[0] == '\0' || hook_name == NULL || hook_name[0] == '\0') {
+        return 0;
+    }
+    if (!sg_extension_bootstrap_check_lua_runtime()) {
+        return 0;
+    }
+    if (!sg_ensure_runtime_tmp_dirs()) {
+        return 0;
+    }
+
+    const char* lua_exe = sg_extension_bootstrap_lua_exe();
+    char safe_name[SG_EXTENSION_NAME_MAX];
+    char safe_hook[SG_EXTENSION_NAME_MAX];
+    sg_sanitize_filename_token(name, safe_name, sizeof(safe_name));
+    sg_sanitize_filename_token(hook_name, safe_hook, sizeof(safe_hook));
+
+    char script_path[SG_EXTENSION_SCRIPT_MAX];
+    snprintf(script_path, sizeof(script_path), ".tmp/runtime_host/ext_hook_%s_%s.lua", safe_name, safe_hook);
+
+    char lua_script[SG_EXTENSION_SCRIPT_MAX];
+    int script_len = snprintf(
+        lua_script,
+        sizeof(lua_script),
+        "local entry = [=[%s]=]\n"
+        "local ext_name = [=[%s]=]\n"
+        "local hook_name = [=[%s]=]\n"
+        "local function _sg_norm(p) return (string.gsub(p, '\\\\', '/')) end\n"
+        "local function _sg_is_abs(p) return (string.match(p, '^%%a:[/\\\\]') ~= nil) or string.sub(p, 1, 1) == '/' end\n"
+        "local function _sg_parent(p)\n"
+        "  local n = _sg_norm(p)\n"
+        "  local parent = string.match(n, '^(.*)/[^/]+$')\n"
+        "  if parent == nil or parent == '' then return '.' end\n"
+        "  return parent\n"
+        "end\n"
+        "local function _sg_root(p)\n"
+        "  local n = _sg_norm(p)\n"
+        "  local root = string.gsub(n, '/lua/server/rpc/entry%%.lua$', '')\n"
+        "  if root ~= n then return root end\n"
+        "  root = string.gsub(n, '/lua/init%%.lua$', '')\n"
+        "  if root ~= n then return root end\n"
+        "  return _sg_parent(n)\n"
+        "end\n"
+        "local package_root = _sg_root(entry)\n"
+        "local function _sg_join(root, rel)\n"
+        "  if string.sub(root, -1) == '/' then return root .. rel end\n"
+        "  return root .. '/' .. rel\n"
+        "end\n"
+        "local _orig_dofile = dofile\n"
+        "dofile = function(path)\n"
+        "  if type(path) == 'string' and path ~= '' and not _sg_is_abs(path) then\n"
+        "    return _orig_dofile(_sg_join(package_root, path))\n"
+        "  end\n"
+        "  return _orig_dofile(path)\n"
+        "end\n"
+        "package.path = package.path .. ';'\n"
+        "  .. _sg_join(package_root, '?.lua') .. ';'\n"
+        "  .. _sg_join(package_root, '?/init.lua') .. ';'\n"
+        "  .. _sg_join(package_root, 'lua/lib/?.lua') .. ';'\n"
+        "  .. _sg_join(package_root, 'lua/?.lua') .. ';'\n"
+        "  .. _sg_join(package_root, 'lua/?/init.lua')\n"
+        "local chunk, load_err = loadfile(entry)\n"
+        "if type(chunk) ~= 'function' then io.stderr:write(tostring(load_err)); os.exit(31) end\n"
+        "local ok, mod = pcall(chunk, 'sengoo_hook')\n"
+        "if not ok then io.stderr:write(tostring(mod)); os.exit(31) end\n"
+        "local hook_fn = nil\n"
+        "if type(mod) == 'table' then hook_fn = mod[hook_name] end\n"
+        "if type(hook_fn) ~= 'function' and type(_G[hook_name]) == 'function' then hook_fn = _G[hook_name] end\n"
+        "if type(hook_fn) == 'function' then\n"
+        "  local call_ok, ret = pcall(hook_fn)\n"
+        "  if not call_ok then io.stderr:write(tostring(ret)); os.exit(32) end\n"
+        "  if ret ~= nil then io.write(tostring(ret)) end\n"
+        "  io.write(' EXT_HOOK_OK:' .. hook_name .. ':' .. ext_name)\n"
+        "else\n"
+        "  io.write('EXT_HOOK_SKIP:' .. hook_name .. ':' .. ext_name)\n"
+        "end\n",
+        entry_path,
+        name,
+        hook_name
+    );
+    if (script_len <= 0 || script_len >= (int)sizeof(lua_script)) {
+        sg_logf("WARN", "EXT", "extension hook script too large name=%s hook=%s", name, hook_name);
+        return 0;
+    }
+    if (!sg_write_text_file(script_path, lua_script)) {
+        sg_logf("WARN", "EXT", "extension hook script write failed name=%s hook=%s path=%s", name, hook_name, script_path);
+        return 0;
+    }
+
+    char command[SG_EXTENSION_CMD_MAX];
+#ifdef _WIN32
+    int command_len = snprintf(command, sizeof(command), "cmd /c \"\"%s\" \"%s\" 2>&1\"", lua_exe, script_path);
+#else
+    int command_len = snprintf(command, sizeof(command), "\"%s\" \"%s\" 2>&1", lua_exe, script_path);
+#endif
+    if (command_len <= 0 || command_len >= (int)sizeof(command)) {
+        remove(script_path);
+        sg_logf("WARN", "EXT", "extension hook command too large name=%s hook=%s", name, hook_name);
+        return 0;
+    }
+
+    char output[SG_EXTENSION_OUTPUT_MAX];
+    int exit_code = sg_run_command_capture(command, output, sizeof(output));
+    remove(script_path);
+    if (exit_code != 0) {
         sg_logf(
-            "INFO",
-            "AUTH",
-            "duplicate session kicked name=%s player_id=%lld kicked=%d",
-            setup.name,
-            resolved_player_id,
-            kicked_duplicate
+            "WARN",
+            "EXT",
+            "extension hook failed name=%s hook=%s exit=%d hash=%s output=%s",
+            name,
+            hook_name,
+            exit_code,
+            (hash == NULL ? "" : hash),
+            (output[0] == '\0' ? "<empty>" : output)
         );
+        return 0;
     }
 
-    auth_state->auth_passed = 1;
-    auth_state->player_id = resolved_player_id;
-    snprintf(auth_state->player_name, sizeof(auth_state->player_name), "%s", setup.name);
-    if (!sg_send_post_setup_packets(socket, &setup, resolved_player_id, resolved_avatar)) {
-        return -1;
+    if (strstr(output, "EXT_HOOK_SKIP:") == output) {
+        sg_logf("INFO", "EXT", "extension hook skipped name=%s hook=%s", name, hook_name);
+    } else {
+        sg_logf(
+            "INFO",
+            "EXT",
+            "extension hook executed name=%s hook=%s hash=%s output=%s",
+            name,
+            hook_name,
+            (hash == NULL ? "" : hash),
+            (output[0] == '\0' ? "<empty>" : output)
+        );
     }
-    sg_logf(
-        "INFO",
-        "AUTH",
-        "setup accepted name=%s version=%s uuid=%s player_id=%lld userdb=%d",
-        setup.name,
-        setup.version,
-        setup.uuid,
-        (resolved_player_id > 0 ? resolved_player_id : -1),
-        sg_auth_userdb_enabled()
-    );
     return 1;
 }
 
-static int sg_handle_cbor_wire_packet(long long conn_handle, sg_socket_t socket, const sg_cbor_wire_packet* packet) {
-    if (packet == NULL) {
-        return -1;
+static void sg_emit_extension_shutdown_hooks(void) {
+    if (g_extension_shutdown_hooks_emitted) {
+        return;
     }
-    sg_auth_state* auth_state = sg_auth_state_find(conn_handle);
-    if (auth_state == NULL && !sg_auth_state_attach(conn_handle)) {
-        return -1;
+    g_extension_shutdown_hooks_emitted = 1;
+    if (!sg_extension_bootstrap_enabled()) {
+        return;
     }
-    auth_state = sg_auth_state_find(conn_handle);
-    if (auth_state == NULL) {
-        return -1;
+
+    int discovered = 0;
+    int executed = 0;
+    for (int i = 0; i < SG_EXTENSION_BOOTSTRAP_MAX; i++) {
+        sg_extension_bootstrap_entry* item = &g_extension_bootstrap_entries[i];
+        if (!item->used || !item->loaded || item->entry[0] == '\0') {
+            continue;
+        }
+        discovered += 1;
+        if (sg_run_extension_hook_once(item->name, item->entry, item->hash, "on_server_stop")) {
+            executed += 1;
+        }
     }
-    auth_state->last_activity_ms = sg_monotonic_ms();
 
-    char command_tag[96];
-    sg_packet_token(packet->command_ptr, packet->command_len, command_tag, sizeof(command_tag));
-    int is_setup_notification =
-        ((packet->packet_type & SG_PACKET_TYPE_NOTIFICATION) != 0) &&
-        sg_packet_command_equals(packet, "Setup");
+    if (discovered > 0) {
+        sg_logf("INFO", "EXT", "extension shutdown hook summary discovered=%d executed=%d", discovered, executed);
+    }
+}
 
-    if (!auth_state->auth_passed) {
-        if (is_setup_notification) {
-            return sg_handle_auth_setup_packet(conn_handle, socket, packet, auth_state);
-        }
-        sg_logf(
-            "WARN",
-            "AUTH",
-            "pre-auth packet rejected req=%lld type=%lld cmd=%s",
-            packet->request_id,
-            packet->packet_type,
-            command_tag
-        );
-        sg_send_errordlg_and_close(socket, "INVALID SETUP STRING");
-        return -2;
+static void sg_sync_extension_bootstrap(const char* registry_json) {
+    if (!sg_extension_bootstrap_enabled() || registry_json == NULL || registry_json[0] == '\0') {
+        return;
     }
 
-    if ((packet->packet_type & SG_PACKET_TYPE_REQUEST) != 0) {
-        int close_after_reply = 0;
-        int reply_payload_major = packet->payload_major;
-        const unsigned char* reply_payload_ptr = packet->payload_ptr;
-        size_t reply_payload_len = packet->payload_len;
-        int reply_field_count = (packet->field_count >= 6 ? 6 : 4);
-        unsigned char reply_payload_local[256];
-
-        if (sg_packet_command_equals(packet, "ping")) {
-            const char* pong = "PONG";
-            size_t pong_len = strlen(pong);
-            if (pong_len < sizeof(reply_payload_local)) {
-                memcpy(reply_payload_local, pong, pong_len);
-                reply_payload_major = 2;
-                reply_payload_ptr = reply_payload_local;
-                reply_payload_len = pong_len;
-            }
-        } else if (sg_packet_command_equals(packet, "bye")) {
-            const char* goodbye = "Goodbye";
-            size_t goodbye_len = strlen(goodbye);
-            if (goodbye_len < sizeof(reply_payload_local)) {
-                memcpy(reply_payload_local, goodbye, goodbye_len);
-                reply_payload_major = 2;
-                reply_payload_ptr = reply_payload_local;
-                reply_payload_len = goodbye_len;
-                close_after_reply = 1;
-            }
-        }
+    g_extension_bootstrap_generation += 1;
+    if (g_extension_bootstrap_generation == 0) {
+        g_extension_bootstrap_generation = 1;
+    }
+    unsigned int generation = g_extension_bootstrap_generation;
 
-        long long reply_type = (packet->packet_type & ~((long long)SG_PACKET_TYPE_REQUEST)) | SG_PACKET_TYPE_REPLY;
-        size_t out_cap = 128 + packet->command_len + reply_payload_len;
-        unsigned char* out = (unsigned char*)malloc(out_cap);
-        if (out == NULL) {
-            return -1;
+    int discovered_count = 0;
+    int loaded_count = 0;
+    int reload_count = 0;
+    int changed_any = 0;
+    int lua_runtime_available = sg_extension_bootstrap_check_lua_runtime();
+
+    const char* cursor = registry_json;
+    while (cursor != NULL && *cursor != '\0') {
+        const char* obj_begin = strchr(cursor, '{');
+        if (obj_begin == NULL) {
+            break;
         }
-        size_t idx = 0;
-        int ok = 1;
-        ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 4, (unsigned long long)reply_field_count);
-        ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, packet->request_id);
-        ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, reply_type);
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, packet->command_major, packet->command_ptr, packet->command_len);
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, reply_payload_major, reply_payload_ptr, reply_payload_len);
-        if (ok && reply_field_count >= 6) {
-            ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, packet->timeout);
-            ok = ok && sg_cbor_write_signed_integer(out, out_cap, &idx, packet->timestamp);
+        const char* obj_end = strchr(obj_begin, '}');
+        if (obj_end == NULL) {
+            break;
         }
 
-        if (!ok || !sg_send_all(socket, out, idx)) {
-            free(out);
-            return -1;
+        char name[SG_EXTENSION_NAME_MAX];
+        char entry[SG_EXTENSION_ENTRY_MAX];
+        char hash[SG_EXTENSION_HASH_MAX];
+        name[0] = '\0';
+        entry[0] = '\0';
+        hash[0] = '\0';
+
+        int has_name = sg_extract_json_string_field(obj_begin, obj_end + 1, "name", name, sizeof(name));
+        (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "entry", entry, sizeof(entry));
+        (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "hash", hash, sizeof(hash));
+
+        if (has_name && entry[0] == '\0' && strcmp(name, "freekill-core") == 0) {
+            char core_entry_buf[SG_EXTENSION_ENTRY_MAX];
+            const char* core_entry = sg_default_core_entry_path(core_entry_buf, sizeof(core_entry_buf));
+            snprintf(entry, sizeof(entry), "%s", core_entry);
         }
-        sg_logf(
-            "INFO",
-            "PROTO",
-            "cbor request handled req=%lld type=%lld cmd=%s payload=%u fields=%d",
-            packet->request_id,
-            packet->packet_type,
-            command_tag,
-            (unsigned)reply_payload_len,
-            reply_field_count
-        );
-        free(out);
-        if (close_after_reply) {
-            return -2;
+
+        if (has_name && entry[0] != '\0') {
+            discovered_count += 1;
+            int found_existing = 0;
+            int slot = sg_find_extension_bootstrap_slot(name, &found_existing);
+            if (slot >= 0) {
+                sg_extension_bootstrap_entry* item = &g_extension_bootstrap_entries[slot];
+                int changed = (!found_existing)
+                    || strcmp(item->entry, entry) != 0
+                    || strcmp(item->hash, hash) != 0
+                    || (!item->loaded && lua_runtime_available);
+
+                if (!found_existing) {
+                    memset(item, 0, sizeof(*item));
+                    item->used = 1;
+                    snprintf(item->name, sizeof(item->name), "%s", name);
+                }
+
+                if (changed) {
+                    changed_any = 1;
+                    if (item->loaded) {
+                        reload_count += 1;
+                    }
+                    item->loaded = sg_bootstrap_extension(name, entry, hash);
+                    item->last_exit_code = (item->loaded ? 0 : 1);
+                    snprintf(item->entry, sizeof(item->entry), "%s", entry);
+                    snprintf(item->hash, sizeof(item->hash), "%s", hash);
+                }
+                item->generation = generation;
+                if (item->loaded) {
+                    loaded_count += 1;
+                }
+            }
         }
-        return 1;
+
+        cursor = obj_end + 1;
     }
 
-    if ((packet->packet_type & SG_PACKET_TYPE_NOTIFICATION) != 0) {
-        if (is_setup_notification) {
-            sg_logf("INFO", "AUTH", "duplicate setup ignored req=%lld", packet->request_id);
-            return 1;
+    for (int i = 0; i < SG_EXTENSION_BOOTSTRAP_MAX; i++) {
+        sg_extension_bootstrap_entry* item = &g_extension_bootstrap_entries[i];
+        if (!item->used) {
+            continue;
         }
-        if (sg_packet_command_equals(packet, "bye")) {
-            sg_logf("INFO", "PROTO", "client bye notification req=%lld", packet->request_id);
-            return -2;
+        if (item->generation != generation) {
+            if (item->loaded) {
+                sg_logf("INFO", "EXT", "extension bootstrap unloaded name=%s", item->name);
+            }
+            changed_any = 1;
+            memset(item, 0, sizeof(*item));
         }
+    }
+
+    if ((discovered_count > 0 && (changed_any || !g_extension_bootstrap_synced_once)) || (changed_any && discovered_count == 0)) {
         sg_logf(
             "INFO",
-            "PROTO",
-            "cbor notification req=%lld type=%lld cmd=%s payload=%u",
-            packet->request_id,
-            packet->packet_type,
-            command_tag,
-            (unsigned)packet->payload_len
+            "EXT",
+            "extension bootstrap sync discovered=%d loaded=%d reloaded=%d",
+            discovered_count,
+            loaded_count,
+            reload_count
         );
-        return 1;
+    }
+    g_extension_bootstrap_synced_once = 1;
+}
+
+static int sg_should_send_extension_sync_on_accept(void) {
+    return sg_parse_bool_env("SENGOO_EXTENSION_SYNC_ON_ACCEPT", 0);
+}
+
+static void sg_fill_registry_fallback(char* registry_json, size_t cap) {
+    char core_entry_buf[SG_EXTENSION_ENTRY_MAX];
+    const char* core_entry_path = sg_default_core_entry_path(core_entry_buf, sizeof(core_entry_buf));
+    if (sg_path_exists(core_entry_path)) {
+        snprintf(registry_json, cap, "%s", SG_DEFAULT_EXTENSION_REGISTRY_JSON);
+        sg_logf("INFO", "EXT", "extension registry fallback=freekill-core source=%s", core_entry_path);
+        return;
+    }
+    snprintf(registry_json, cap, "[]");
+    sg_logf("WARN", "EXT", "extension registry fallback empty-list; core entry missing path=%s", core_entry_path);
+}
+
+static void sg_prepare_extension_sync_payload(void) {
+    const char* registry_path = getenv("SENGOO_EXTENSION_REGISTRY");
+    if (registry_path == NULL || registry_path[0] == '\0') {
+        registry_path = "packages/packages.registry.json";
+    }
+
+    char registry_json[SG_EXTENSION_SYNC_PAYLOAD_MAX - 128];
+    registry_json[0] = '\0';
+    int read_ok = sg_read_file_text(registry_path, registry_json, sizeof(registry_json));
+    if (!read_ok) {
+        sg_logf("WARN", "EXT", "extension registry missing or unreadable path=%s", registry_path);
+        sg_fill_registry_fallback(registry_json, sizeof(registry_json));
+    }
+    sg_strip_utf8_bom(registry_json);
+    sg_trim_trailing_whitespace(registry_json);
+    if (sg_registry_json_is_empty(registry_json)) {
+        sg_fill_registry_fallback(registry_json, sizeof(registry_json));
+    }
+    sg_sync_extension_bootstrap(registry_json);
+
+    char payload[SG_EXTENSION_SYNC_PAYLOAD_MAX];
+    int payload_len = snprintf(
+        payload,
+        sizeof(payload),
+        "{\"event\":\"extension_sync\",\"registry\":%s}\n",
+        registry_json
+    );
+    if (payload_len <= 0 || payload_len >= (int)sizeof(payload)) {
+        payload_len = snprintf(payload, sizeof(payload), "{\"event\":\"extension_sync\",\"registry\":[]}\n");
+        sg_logf("WARN", "EXT", "extension registry payload overflow; fallback to empty list");
     }
 
-    if ((packet->packet_type & SG_PACKET_TYPE_REPLY) != 0) {
-        sg_logf(
-            "INFO",
-            "PROTO",
-            "client reply packet ignored req=%lld type=%lld cmd=%s payload=%u",
-            packet->request_id,
-            packet->packet_type,
-            command_tag,
-            (unsigned)packet->payload_len
-        );
-        return 1;
+    unsigned long fingerprint = sg_hash_text(payload);
+    if (fingerprint == g_extension_sync_payload_fingerprint && g_extension_sync_frame != NULL) {
+        return;
+    }
+    sg_frame* frame = sg_frame_from_bytes((const unsigned char*)payload, (size_t)payload_len);
+    if (frame == NULL) {
+        sg_logf("WARN", "EXT", "extension sync frame alloc failed");
+        return;
     }
+    sg_runtime_lock();
+    sg_frame* previous = g_extension_sync_frame;
+    memcpy(g_extension_sync_payload, payload, (size_t)payload_len + 1);
+    g_extension_sync_frame = frame;
+    g_extension_sync_payload_fingerprint = fingerprint;
+    sg_runtime_unlock();
+    sg_frame_release(previous);
+    sg_logf("INFO", "EXT", "extension sync payload ready bytes=%d from=%s", payload_len, registry_path);
+}
 
-    return -1;
+static void sg_tick_extension_sync_refresh(void) {
+    int interval_ms = sg_extension_sync_refresh_interval_ms();
+    long long now_ms = sg_monotonic_ms();
+    if (g_extension_sync_refresh_last_ms > 0 && now_ms - g_extension_sync_refresh_last_ms < (long long)interval_ms) {
+        return;
+    }
+    g_extension_sync_refresh_last_ms = now_ms;
+    sg_prepare_extension_sync_payload();
 }
 
-static int sg_read_file_text(const char* path, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0 || path == NULL || path[0] == '\0') {
+static long long sg_send_extension_sync_payload(sg_tcp_conn* conn) {
+    if (!sg_should_send_extension_sync_on_accept()) {
         return 0;
     }
-    FILE* fp = fopen(path, "rb");
-    if (fp == NULL) {
+    sg_runtime_lock();
+    sg_frame* frame = sg_frame_retain(g_extension_sync_frame);
+    sg_runtime_unlock();
+    if (frame == NULL) {
         return 0;
     }
-    size_t n = fread(out, 1, out_cap - 1, fp);
-    out[n] = '\0';
-    fclose(fp);
-    if (n == 0) {
-        return 0;
+    size_t len = (frame != NULL ? frame->len : 0);
+    int sent = sg_tcp_conn_send_frame(conn, frame);
+    sg_frame_release(frame);
+    if (!sent) {
+        sg_logf("WARN", "EXT", "extension sync send failed len=%u err=%d", (unsigned)len, sg_last_socket_error());
+        return -1;
+    }
+    return (long long)len;
+}
+
+#ifdef _WIN32
+static BOOL WINAPI sg_on_shutdown_console_event(DWORD event) {
+    if (event == CTRL_CLOSE_EVENT) {
+        g_shutdown_console_close = 1;
+        g_shutdown_requested = 1;
+        if (g_shutdown_done_event != NULL) {
+            WaitForSingleObject(g_shutdown_done_event, SG_CONSOLE_CLOSE_WAIT_MS);
+        }
+        return TRUE;
+    }
+    if (event == CTRL_C_EVENT || event == CTRL_BREAK_EVENT) {
+        if (g_shutdown_requested) {
+            return FALSE;
+        }
+        g_shutdown_requested = 1;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void sg_install_shutdown_handlers(void) {
+    if (g_shutdown_done_event == NULL) {
+        g_shutdown_done_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    }
+    SetConsoleCtrlHandler(sg_on_shutdown_console_event, TRUE);
+}
+
+static int sg_net_init(void) {
+    static volatile LONG initialized = 0;
+    LONG prev = InterlockedCompareExchange(&initialized, 1, 0);
+    if (prev == 0) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+            InterlockedExchange(&initialized, 0);
+            return 0;
+        }
+        g_net_init_logged = 0;
+    }
+    if (!g_net_init_logged) {
+        sg_logf("INFO", "SERVER", "server is starting");
+        sg_install_shutdown_handlers();
+        sg_logf("INFO", "NET", "winsock initialized");
+        g_net_init_logged = 1;
     }
     return 1;
 }
 
-static void sg_strip_utf8_bom(char* text) {
-    if (text == NULL) {
+static int sg_would_block(void) {
+    int err = WSAGetLastError();
+    return err == WSAEWOULDBLOCK || err == WSAEINPROGRESS;
+}
+#else
+static void sg_on_shutdown_signal(int sig) {
+    if (g_shutdown_requested) {
+        signal(sig, SIG_DFL);
+        raise(sig);
         return;
     }
-    unsigned char* p = (unsigned char*)text;
-    if (p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
-        size_t len = strlen(text);
-        if (len >= 3) {
-            memmove(text, text + 3, len - 2);
-        }
+    g_shutdown_requested = 1;
+}
+
+static void sg_install_shutdown_handlers(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sg_on_shutdown_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+static int sg_net_init(void) {
+    if (!g_net_init_logged) {
+        signal(SIGPIPE, SIG_IGN);
+        sg_install_shutdown_handlers();
+        sg_logf("INFO", "SERVER", "server is starting");
+        sg_logf("INFO", "NET", "posix network runtime initialized");
+        g_net_init_logged = 1;
     }
+    return 1;
 }
 
-static int sg_path_exists(const char* path) {
-    if (path == NULL || path[0] == '\0') {
+static int sg_would_block(void) {
+    return errno == EWOULDBLOCK || errno == EAGAIN;
+}
+#endif
+
+static int sg_set_nonblocking(sg_socket_t s) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    if (flags < 0) {
         return 0;
     }
-    FILE* fp = fopen(path, "rb");
-    if (fp == NULL) {
-        return 0;
+    return fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static const char* sg_io_backend_name(int backend) {
+    if (backend == SG_IO_BACKEND_URING) {
+        return "io_uring";
     }
-    fclose(fp);
-    return 1;
+    if (backend == SG_IO_BACKEND_EPOLL) {
+        return "epoll";
+    }
+    return "scan";
 }
 
-static const char* sg_trim_leading_whitespace(const char* text) {
-    if (text == NULL) {
-        return "";
+#if SG_HAVE_IO_URING
+static void sg_uring_buf_recycle(sg_uring* ring, unsigned short bid) {
+    struct io_uring_buf* buf = &ring->buf_ring->bufs[ring->buf_tail & (SG_URING_BUF_COUNT - 1)];
+    buf->addr = (unsigned long long)(uintptr_t)(ring->buf_base + (size_t)bid * SG_URING_BUF_SIZE);
+    buf->len = SG_URING_BUF_SIZE;
+    buf->bid = bid;
+    ring->buf_tail += 1;
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static void sg_uring_close(sg_uring* ring) {
+    if (ring->fd >= 0) {
+        close(ring->fd);
     }
-    const unsigned char* p = (const unsigned char*)text;
-    if (p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
-        p += 3;
+    if (ring->sqe_map != NULL) {
+        munmap(ring->sqe_map, ring->sqe_map_size);
     }
-    while (*p != '\0' && isspace(*p)) {
-        p += 1;
+    if (ring->ring_map != NULL) {
+        munmap(ring->ring_map, ring->ring_map_size);
     }
-    return (const char*)p;
+    if (ring->buf_ring != NULL) {
+        munmap(ring->buf_ring, ring->buf_ring_size);
+    }
+    free(ring->buf_base);
+    free(ring->flush_handles);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
 }
 
-static int sg_registry_json_is_empty(const char* json) {
-    const char* p = sg_trim_leading_whitespace(json);
-    if (*p == '\0') {
-        return 1;
+static int sg_uring_open(sg_uring* ring) {
+    memset(ring, 0, sizeof(*ring));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = SG_URING_CQ_ENTRIES;
+    ring->fd = (int)syscall(__NR_io_uring_setup, SG_URING_SQ_ENTRIES, &params);
+    if (ring->fd < 0) {
+        sg_logf("WARN", "NET", "io_uring setup failed err=%d", errno);
+        return 0;
     }
-    if (*p != '[') {
+    unsigned int required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & required) != required) {
+        sg_logf("WARN", "NET", "io_uring kernel features missing have=0x%x need=0x%x", params.features, required);
+        sg_uring_close(ring);
         return 0;
     }
-    p += 1;
-    p = sg_trim_leading_whitespace(p);
-    if (*p != ']') {
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_map_size = (sq_size > cq_size ? sq_size : cq_size);
+    ring->ring_map = mmap(NULL, ring->ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->ring_map == MAP_FAILED) {
+        ring->ring_map = NULL;
+        sg_logf("WARN", "NET", "io_uring ring mmap failed err=%d", errno);
+        sg_uring_close(ring);
         return 0;
     }
-    p += 1;
-    p = sg_trim_leading_whitespace(p);
-    return *p == '\0';
+    ring->sqe_map_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqe_map = mmap(NULL, ring->sqe_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqe_map == MAP_FAILED) {
+        ring->sqe_map = NULL;
+        sg_logf("WARN", "NET", "io_uring sqe mmap failed err=%d", errno);
+        sg_uring_close(ring);
+        return 0;
+    }
+
+    unsigned char* base = (unsigned char*)ring->ring_map;
+    ring->sq_head = (unsigned int*)(base + params.sq_off.head);
+    ring->sq_tail = (unsigned int*)(base + params.sq_off.tail);
+    ring->sq_mask = (unsigned int*)(base + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int*)(base + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+    ring->sqes = (struct io_uring_sqe*)ring->sqe_map;
+    ring->cq_head = (unsigned int*)(base + params.cq_off.head);
+    ring->cq_tail = (unsigned int*)(base + params.cq_off.tail);
+    ring->cq_mask = (unsigned int*)(base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(base + params.cq_off.cqes);
+
+    ring->buf_ring_size = SG_URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    ring->buf_ring = (struct io_uring_buf_ring*)mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring->buf_base = (unsigned char*)malloc((size_t)SG_URING_BUF_COUNT * SG_URING_BUF_SIZE);
+    if (ring->buf_ring == MAP_FAILED || ring->buf_base == NULL) {
+        if (ring->buf_ring == MAP_FAILED) {
+            ring->buf_ring = NULL;
+        }
+        sg_logf("WARN", "NET", "io_uring buffer ring alloc failed");
+        sg_uring_close(ring);
+        return 0;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long long)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = SG_URING_BUF_COUNT;
+    reg.bgid = SG_URING_BUF_GROUP;
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        sg_logf("WARN", "NET", "io_uring buffer ring register failed err=%d", errno);
+        sg_uring_close(ring);
+        return 0;
+    }
+    for (int i = 0; i < SG_URING_BUF_COUNT; i++) {
+        sg_uring_buf_recycle(ring, (unsigned short)i);
+    }
+    return 1;
 }
 
-static void sg_trim_trailing_whitespace(char* text) {
-    if (text == NULL) {
+static int sg_uring_arm(sg_reactor* reactor, int fd, long long token) {
+    struct io_uring_sqe* sqe = sg_uring_sqe(&reactor->uring);
+    if (sqe == NULL) {
+        return 0;
+    }
+    int kind = (token == SG_REACTOR_WAKE_TOKEN ? 0 : (int)((token >> SG_HANDLE_KIND_SHIFT) & SG_HANDLE_KIND_MASK));
+    unsigned long long op = SG_URING_OP_POLL;
+    sqe->fd = fd;
+    if (kind == SG_HANDLE_KIND_TCP_LISTENER) {
+        op = SG_URING_OP_ACCEPT;
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    } else if (kind == SG_HANDLE_KIND_TCP_CONNECTION) {
+        op = SG_URING_OP_RECV;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = SG_URING_BUF_GROUP;
+        sg_tcp_conn* conn = sg_tcp_conn_find(token);
+        if (conn != NULL) {
+            conn->recv_state = SG_URING_RECV_ARMED;
+        }
+    } else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = POLLIN;
+    }
+    sqe->user_data = (op << SG_URING_OP_SHIFT) | ((unsigned long long)token & SG_URING_TOKEN_MASK);
+    return 1;
+}
+
+static void sg_uring_cancel_fd(sg_uring* ring, int fd) {
+    struct io_uring_sqe* sqe = sg_uring_sqe(ring);
+    if (sqe == NULL) {
         return;
     }
-    size_t len = strlen(text);
-    while (len > 0) {
-        char ch = text[len - 1];
-        if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
-            text[len - 1] = '\0';
-            len -= 1;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = SG_URING_OP_CANCEL << SG_URING_OP_SHIFT;
+    sg_uring_submit(ring);
+}
+#endif
+
+static void sg_poller_init(void) {
+    if (g_io_backend_ready) {
+        return;
+    }
+    g_io_backend_ready = 1;
+    g_io_backend = SG_IO_BACKEND_SCAN;
+
+    const char* raw = getenv("SENGOO_IO_BACKEND");
+    int want_scan = (raw != NULL && raw[0] != '\0' && sg_str_ieq(raw, "scan"));
+    int want_uring = (raw != NULL && raw[0] != '\0' && (sg_str_ieq(raw, "io_uring") || sg_str_ieq(raw, "uring")));
+#if SG_HAVE_EPOLL
+    if (want_uring) {
+#if SG_HAVE_IO_URING
+        if (sg_uring_open(&g_reactor->uring)) {
+            g_io_backend = SG_IO_BACKEND_URING;
         } else {
-            break;
+            sg_logf("WARN", "NET", "io_uring unavailable; fallback to epoll backend");
+        }
+#else
+        sg_logf("WARN", "NET", "io backend %s not built in; fallback to epoll backend", raw);
+#endif
+    }
+    if (!want_scan && g_io_backend == SG_IO_BACKEND_SCAN) {
+        g_reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (g_reactor->epoll_fd >= 0) {
+            g_io_backend = SG_IO_BACKEND_EPOLL;
+        } else {
+            sg_logf("WARN", "NET", "epoll create failed err=%d; fallback to scan backend", errno);
         }
     }
+#else
+    (void)want_uring;
+    if (raw != NULL && raw[0] != '\0' && !want_scan) {
+        sg_logf("WARN", "NET", "io backend %s unavailable on this platform; fallback to scan backend", raw);
+    }
+#endif
+    sg_logf("INFO", "NET", "io backend=%s", sg_io_backend_name(g_io_backend));
 }
 
-static unsigned long sg_hash_text(const char* text) {
-    const unsigned char* p = (const unsigned char*)(text == NULL ? "" : text);
-    unsigned long h = 5381UL;
-    while (*p != 0) {
-        h = ((h << 5) + h) + (unsigned long)(*p);
-        p += 1;
+static int sg_poller_add(sg_socket_t s, long long handle, int edge_triggered) {
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        return sg_uring_arm(g_reactor, s, handle);
     }
-    return h;
+#endif
+#if SG_HAVE_EPOLL
+    if (g_io_backend != SG_IO_BACKEND_EPOLL) {
+        return 1;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP | (edge_triggered ? (EPOLLET | EPOLLOUT) : 0);
+    ev.data.u64 = (uint64_t)handle;
+    return epoll_ctl(g_reactor->epoll_fd, EPOLL_CTL_ADD, s, &ev) == 0;
+#else
+    (void)s;
+    (void)handle;
+    (void)edge_triggered;
+    return 1;
+#endif
 }
 
-static int sg_str_ieq(const char* a, const char* b) {
-    if (a == NULL || b == NULL) {
-        return 0;
+static void sg_poller_remove(sg_socket_t s) {
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        if (s != SG_INVALID_SOCKET) {
+            sg_uring_cancel_fd(&g_reactor->uring, s);
+        }
+        return;
     }
-#ifdef _WIN32
-    return _stricmp(a, b) == 0;
+#endif
+#if SG_HAVE_EPOLL
+    if (g_io_backend != SG_IO_BACKEND_EPOLL || s == SG_INVALID_SOCKET) {
+        return;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    epoll_ctl(g_reactor->epoll_fd, EPOLL_CTL_DEL, s, &ev);
 #else
-    return strcasecmp(a, b) == 0;
+    (void)s;
 #endif
 }
 
-static int sg_extension_bootstrap_enabled(void) {
-    const char* raw = getenv("SENGOO_EXTENSION_BOOTSTRAP");
-    if (raw == NULL || raw[0] == '\0') {
-        return 1;
+static int sg_port_valid(long long port) {
+    return port >= 1 && port <= 65535;
+}
+
+static size_t sg_buffer_size(long long max_bytes) {
+    if (max_bytes <= 0) {
+        return 1024;
     }
-    if (sg_str_ieq(raw, "0") || sg_str_ieq(raw, "false") || sg_str_ieq(raw, "off") || sg_str_ieq(raw, "no")) {
-        return 0;
+    if (max_bytes > 65536) {
+        return 65536;
     }
-    return 1;
+    return (size_t)max_bytes;
 }
 
-static int sg_extension_sync_refresh_interval_ms(void) {
-    const char* raw = getenv("SENGOO_EXTENSION_REFRESH_MS");
+static int sg_count_active_tcp_connections(void) {
+    return SG_ATOMIC_LOAD(&g_tcp_active_total);
+}
+
+static int sg_parse_positive_env_i32(const char* key, int fallback) {
+    const char* raw = getenv(key);
     if (raw == NULL || raw[0] == '\0') {
-        return 3000;
+        return fallback;
     }
     char* end = NULL;
     long value = strtol(raw, &end, 10);
-    if (end == raw || *end != '\0' || value <= 0) {
-        return 3000;
+    if (end == raw || *end != '\0' || value <= 0 || value > 2147483647L) {
+        return fallback;
     }
-    if (value < 200) {
-        value = 200;
-    } else if (value > 600000) {
-        value = 600000;
+    return (int)value;
+}
+
+static int sg_parse_port_env_i32(const char* key, int fallback) {
+    const char* raw = getenv(key);
+    if (raw == NULL || raw[0] == '\0') {
+        return fallback;
+    }
+    char* end = NULL;
+    long value = strtol(raw, &end, 10);
+    if (end == raw || *end != '\0' || value < 1 || value > 65535) {
+        return fallback;
     }
     return (int)value;
 }
 
-static const char* sg_default_core_entry_path(char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
-        return "";
-    }
-    const char* env_path = getenv("SENGOO_EXTENSION_CORE_ENTRY");
-    if (env_path != NULL && env_path[0] != '\0') {
-        snprintf(out, out_cap, "%s", env_path);
-        return out;
-    }
+long long sengoo_runtime_tcp_port(void) {
+    int port = sg_parse_port_env_i32("SENGOO_TCP_PORT", 9527);
+    return (long long)port;
+}
+
+long long sengoo_runtime_udp_port(void) {
+    int udp_port = sg_parse_port_env_i32("SENGOO_UDP_PORT", 9528);
+    return (long long)udp_port;
+}
+
+long long sengoo_runtime_tick_sleep_ms(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_TICK_SLEEP_MS", 20);
+    return (long long)value;
+}
 
-    const char* nested = "packages/packages/freekill-core/lua/server/rpc/entry.lua";
-    const char* root = "packages/freekill-core/lua/server/rpc/entry.lua";
-    if (sg_path_exists(nested)) {
-        snprintf(out, out_cap, "%s", nested);
-    } else {
-        snprintf(out, out_cap, "%s", root);
-    }
-    return out;
+long long sengoo_runtime_busy_sleep_ms(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_BUSY_SLEEP_MS", 1);
+    return (long long)value;
 }
 
-static const char* sg_extension_bootstrap_lua_exe(void) {
-    const char* raw = getenv("SENGOO_LUA_EXE");
-    if (raw == NULL || raw[0] == '\0') {
-        return "lua5.4";
+long long sengoo_runtime_max_packet_bytes(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_MAX_PACKET_BYTES", 65536);
+    if (value < 256) {
+        value = 256;
+    } else if (value > 65536) {
+        value = 65536;
     }
-    return raw;
+    return (long long)value;
 }
 
-static int sg_extension_bootstrap_check_lua_runtime(void) {
-    if (g_extension_bootstrap_lua_checked) {
-        return g_extension_bootstrap_lua_available;
-    }
-    g_extension_bootstrap_lua_checked = 1;
-    g_extension_bootstrap_lua_available = 0;
+long long sengoo_runtime_max_error_count(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_MAX_ERROR_COUNT", 200);
+    return (long long)value;
+}
 
-    const char* lua_exe = sg_extension_bootstrap_lua_exe();
-    if (lua_exe == NULL || lua_exe[0] == '\0') {
-        return 0;
+long long sengoo_runtime_max_accept_per_tick(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_MAX_ACCEPT_PER_TICK", 16);
+    if (value < 1) {
+        value = 1;
+    } else if (value > 128) {
+        value = 128;
     }
+    return (long long)value;
+}
 
-    if (strchr(lua_exe, '\\') != NULL || strchr(lua_exe, '/') != NULL || strchr(lua_exe, ':') != NULL) {
-        g_extension_bootstrap_lua_available = sg_path_exists(lua_exe);
-    } else {
-        char check_cmd[SG_EXTENSION_CMD_MAX];
-#ifdef _WIN32
-        int check_len = snprintf(check_cmd, sizeof(check_cmd), "where %s >nul 2>&1", lua_exe);
-#else
-        int check_len = snprintf(check_cmd, sizeof(check_cmd), "command -v %s >/dev/null 2>&1", lua_exe);
-#endif
-        if (check_len > 0 && check_len < (int)sizeof(check_cmd)) {
-            int check_rc = system(check_cmd);
-            g_extension_bootstrap_lua_available = (check_rc == 0);
-        }
+static int sg_runtime_io_thread_count(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_IO_THREADS", 1);
+    if (value > SG_MAX_REACTORS) {
+        value = SG_MAX_REACTORS;
     }
+    return value;
+}
 
-    if (!g_extension_bootstrap_lua_available && !g_extension_bootstrap_lua_missing_logged) {
-        g_extension_bootstrap_lua_missing_logged = 1;
-        sg_logf("WARN", "EXT", "lua runtime unavailable exe=%s", lua_exe);
+long long sengoo_runtime_io_thread_count(void) {
+    return (long long)sg_runtime_io_thread_count();
+}
+
+long long sengoo_runtime_idle_wait_ms(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_IDLE_WAIT_MS", 1000);
+    if (value > 60000) {
+        value = 60000;
     }
-    return g_extension_bootstrap_lua_available;
+    return (long long)value;
 }
 
-static int sg_ensure_runtime_tmp_dirs(void) {
-    if (sg_mkdir(".tmp") != 0 && errno != EEXIST) {
-        return 0;
+static int sg_runtime_server_capacity(void) {
+    if (g_tcp_capacity > 0) {
+        return g_tcp_capacity;
     }
-    if (sg_mkdir(".tmp/runtime_host") != 0 && errno != EEXIST) {
-        return 0;
+    int value = sg_parse_positive_env_i32("SENGOO_SERVER_CAPACITY", 100);
+    if (value < 1) {
+        value = 1;
+    } else if (value > SG_TCP_CONN_SLOT_LIMIT) {
+        value = SG_TCP_CONN_SLOT_LIMIT;
     }
-    return 1;
+    return value;
 }
 
-static const char* sg_find_substr_in_range(const char* begin, const char* end, const char* needle) {
-    if (begin == NULL || end == NULL || needle == NULL) {
-        return NULL;
-    }
-    size_t needle_len = strlen(needle);
-    if (needle_len == 0 || begin >= end) {
-        return NULL;
+static void sg_raise_nofile_limit(int capacity) {
+#ifndef _WIN32
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        sg_logf("WARN", "NET", "nofile limit query failed err=%d", errno);
+        return;
     }
-    const char* p = begin;
-    while (p + needle_len <= end) {
-        if (memcmp(p, needle, needle_len) == 0) {
-            return p;
+    rlim_t want = (rlim_t)capacity + SG_NOFILE_RESERVE;
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < want) {
+        rlim_t before = limit.rlim_cur;
+        limit.rlim_cur = (limit.rlim_max == RLIM_INFINITY || limit.rlim_max >= want) ? want : limit.rlim_max;
+        if (limit.rlim_cur > before && setrlimit(RLIMIT_NOFILE, &limit) == 0) {
+            sg_logf("INFO", "NET", "nofile limit raised from=%llu to=%llu capacity=%d", (unsigned long long)before, (unsigned long long)limit.rlim_cur, capacity);
+        } else {
+            limit.rlim_cur = before;
         }
-        p += 1;
     }
-    return NULL;
-}
-
-static int sg_extract_json_string_field(
-    const char* obj_begin,
-    const char* obj_end,
-    const char* field_name,
-    char* out,
-    size_t out_cap
-) {
-    if (obj_begin == NULL || obj_end == NULL || field_name == NULL || out == NULL || out_cap == 0 || obj_begin >= obj_end) {
-        return 0;
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < want) {
+        sg_logf(
+            "WARN",
+            "NET",
+            "nofile limit=%llu hard=%llu below capacity=%d; accepts beyond the limit will fail",
+            (unsigned long long)limit.rlim_cur,
+            (unsigned long long)limit.rlim_max,
+            capacity
+        );
     }
-    out[0] = '\0';
+#else
+    (void)capacity;
+#endif
+}
 
-    char key_pattern[128];
-    int key_len = snprintf(key_pattern, sizeof(key_pattern), "\"%s\"", field_name);
-    if (key_len <= 0 || key_len >= (int)sizeof(key_pattern)) {
-        return 0;
-    }
+static void sg_tcp_capacity_init(int reactor_count) {
+    g_tcp_capacity = 0;
+    int capacity = sg_runtime_server_capacity();
+    g_tcp_capacity = capacity;
+    sg_raise_nofile_limit(capacity);
 
-    const char* key = sg_find_substr_in_range(obj_begin, obj_end, key_pattern);
-    if (key == NULL) {
-        return 0;
-    }
-    const char* p = key + key_len;
-    while (p < obj_end && isspace((unsigned char)*p)) {
-        p += 1;
-    }
-    if (p >= obj_end || *p != ':') {
-        return 0;
+    if (reactor_count < 1) {
+        reactor_count = 1;
     }
-    p += 1;
-    while (p < obj_end && isspace((unsigned char)*p)) {
-        p += 1;
+    int per_reactor = (capacity + reactor_count - 1) / reactor_count;
+    if (per_reactor < SG_TCP_CONN_TABLE_INITIAL) {
+        per_reactor = SG_TCP_CONN_TABLE_INITIAL;
     }
-    if (p >= obj_end || *p != '"') {
-        return 0;
+    for (int i = 0; i < reactor_count; i++) {
+        sg_tcp_conn_table_reserve(&g_reactors[i].connections, per_reactor);
     }
-    p += 1;
+    sg_logf("INFO", "NET", "tcp capacity=%d reactors=%d table_slots=%d", capacity, reactor_count, per_reactor);
+}
 
-    size_t out_len = 0;
-    int escaped = 0;
-    while (p < obj_end) {
-        char ch = *p;
-        if (!escaped) {
-            if (ch == '\\') {
-                escaped = 1;
-            } else if (ch == '"') {
-                out[out_len] = '\0';
-                return 1;
-            } else {
-                if (out_len + 1 < out_cap) {
-                    out[out_len++] = ch;
-                }
-            }
-        } else {
-            char decoded = ch;
-            if (ch == 'n') decoded = '\n';
-            else if (ch == 'r') decoded = '\r';
-            else if (ch == 't') decoded = '\t';
-            else if (ch == '\\') decoded = '\\';
-            else if (ch == '"') decoded = '"';
-            else if (ch == '/') decoded = '/';
-            if (out_len + 1 < out_cap) {
-                out[out_len++] = decoded;
-            }
-            escaped = 0;
-        }
-        p += 1;
+static int sg_auth_signup_timeout_ms(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_AUTH_SIGNUP_TIMEOUT_MS", 180000);
+    if (value < 1000) {
+        value = 1000;
+    } else if (value > 3600000) {
+        value = 3600000;
     }
-    out[out_len] = '\0';
-    return 0;
+    return value;
 }
 
-static int sg_extract_registry_json_from_sync_payload(char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
-        return 0;
+static int sg_tcp_idle_timeout_ms(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_TCP_IDLE_TIMEOUT_MS", 0);
+    if (value > 0 && value < 1000) {
+        value = 1000;
     }
-    out[0] = '\0';
-    if (g_extension_sync_payload[0] == '\0') {
-        return 0;
+    return value;
+}
+
+static const char* sg_server_detail_version(void) {
+    const char* raw = getenv("SENGOO_SERVER_VERSION");
+    if (raw == NULL || raw[0] == '\0') {
+        return "0.5.19+";
     }
+    return raw;
+}
 
-    const char* marker = "\"registry\":";
-    const char* p = strstr(g_extension_sync_payload, marker);
-    if (p == NULL) {
-        return 0;
+static const char* sg_server_detail_icon_url(void) {
+    const char* raw = getenv("SENGOO_SERVER_ICON_URL");
+    if (raw == NULL) {
+        return "";
     }
-    p += strlen(marker);
-    while (*p != '\0' && isspace((unsigned char)*p)) {
-        p += 1;
+    return raw;
+}
+
+static const char* sg_server_detail_description(void) {
+    const char* raw = getenv("SENGOO_SERVER_DESCRIPTION");
+    if (raw == NULL) {
+        return "";
     }
-    if (*p != '[') {
+    return raw;
+}
+
+static size_t sg_json_escape_copy(const char* input, char* out, size_t out_cap) {
+    if (out == NULL || out_cap == 0) {
         return 0;
     }
-
-    const char* start = p;
-    int depth = 0;
-    int in_string = 0;
-    int escaped = 0;
-    while (*p != '\0') {
-        char ch = *p;
-        if (in_string) {
-            if (escaped) {
-                escaped = 0;
-            } else if (ch == '\\') {
-                escaped = 1;
-            } else if (ch == '"') {
-                in_string = 0;
+    const char* src = (input == NULL ? "" : input);
+    size_t out_len = 0;
+    for (size_t i = 0; src[i] != '\0' && out_len + 1 < out_cap; i++) {
+        unsigned char ch = (unsigned char)src[i];
+        const char* replacement = NULL;
+        char unicode_seq[7];
+        if (ch == '"') {
+            replacement = "\\\"";
+        } else if (ch == '\\') {
+            replacement = "\\\\";
+        } else if (ch == '\n') {
+            replacement = "\\n";
+        } else if (ch == '\r') {
+            replacement = "\\r";
+        } else if (ch == '\t') {
+            replacement = "\\t";
+        } else if (ch < 0x20) {
+            snprintf(unicode_seq, sizeof(unicode_seq), "\\u%04x", (unsigned int)ch);
+            replacement = unicode_seq;
+        }
+
+        if (replacement != NULL) {
+            size_t rep_len = strlen(replacement);
+            if (out_len + rep_len >= out_cap) {
+                break;
             }
+            memcpy(out + out_len, replacement, rep_len);
+            out_len += rep_len;
         } else {
-            if (ch == '"') {
-                in_string = 1;
-            } else if (ch == '[') {
-                depth += 1;
-            } else if (ch == ']') {
-                depth -= 1;
-                if (depth == 0) {
-                    size_t len = (size_t)(p - start + 1);
-                    if (len >= out_cap) {
-                        len = out_cap - 1;
-                    }
-                    memcpy(out, start, len);
-                    out[len] = '\0';
-                    return 1;
-                }
-                if (depth < 0) {
-                    break;
-                }
-            }
+            out[out_len++] = (char)ch;
         }
-        p += 1;
     }
-
-    return 0;
+    out[out_len] = '\0';
+    return out_len;
 }
 
-static int sg_json_object_is_enabled(const char* obj_begin, const char* obj_end) {
-    if (obj_begin == NULL || obj_end == NULL || obj_begin >= obj_end) {
-        return 1;
+static void sg_udp_detail_cache_rebuild(void) {
+    sg_udp_detail_cache* cache = &g_udp_detail_cache;
+    char escaped_version[96];
+    char escaped_icon[768];
+    char escaped_description[768];
+    sg_json_escape_copy(sg_server_detail_version(), escaped_version, sizeof(escaped_version));
+    sg_json_escape_copy(sg_server_detail_icon_url(), escaped_icon, sizeof(escaped_icon));
+    sg_json_escape_copy(sg_server_detail_description(), escaped_description, sizeof(escaped_description));
+
+    int capacity = sg_runtime_server_capacity();
+    int written = snprintf(
+        cache->prefix,
+        sizeof(cache->prefix),
+        "[\"%s\",\"%s\",\"%s\",%d,",
+        escaped_version,
+        escaped_icon,
+        escaped_description,
+        capacity
+    );
+    if (written <= 0 || written >= (int)sizeof(cache->prefix)) {
+        written = 0;
     }
-    const char* key = sg_find_substr_in_range(obj_begin, obj_end, "\"enabled\"");
-    if (key == NULL) {
-        return 1;
+    cache->prefix_len = (size_t)written;
+    cache->ready = 1;
+}
+
+static size_t sg_build_udp_detail_response(const char* request, char* out, size_t out_cap) {
+    if (request == NULL || out == NULL || out_cap == 0) {
+        return 0;
     }
-    const char* p = key + strlen("\"enabled\"");
-    while (p < obj_end && isspace((unsigned char)*p)) {
-        p += 1;
+    if (strncmp(request, "fkGetDetail,", 12) != 0) {
+        return 0;
     }
-    if (p >= obj_end || *p != ':') {
-        return 1;
+    if (!g_udp_detail_cache.ready) {
+        sg_udp_detail_cache_rebuild();
     }
-    p += 1;
-    while (p < obj_end && isspace((unsigned char)*p)) {
-        p += 1;
+
+    size_t len = g_udp_detail_cache.prefix_len;
+    if (len == 0 || len + 16 >= out_cap) {
+        return 0;
     }
-    if (p + 5 <= obj_end && memcmp(p, "false", 5) == 0) {
+    memcpy(out, g_udp_detail_cache.prefix, len);
+    int written = snprintf(out + len, out_cap - len, "%d,\"", sg_count_active_tcp_connections());
+    if (written <= 0 || (size_t)written >= out_cap - len) {
         return 0;
     }
-    return 1;
-}
+    len += (size_t)written;
 
-static size_t sg_build_update_package_summary(unsigned char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
+    size_t tag_cap = out_cap - len - 2;
+    if (tag_cap > 768) {
+        tag_cap = 768;
+    }
+    len += sg_json_escape_copy(request + 12, out + len, tag_cap);
+    if (len + 3 > out_cap) {
         return 0;
     }
+    out[len++] = '"';
+    out[len++] = ']';
+    out[len] = '\0';
+    return len;
+}
 
-    typedef struct {
-        char name[SG_EXTENSION_NAME_MAX];
-        char hash[SG_EXTENSION_HASH_MAX];
-        char url[SG_EXTENSION_ENTRY_MAX];
-    } sg_update_summary_entry;
-
-    sg_update_summary_entry entries[SG_EXTENSION_BOOTSTRAP_MAX];
-    int entry_count = 0;
-
-    char registry_json[SG_EXTENSION_SYNC_PAYLOAD_MAX];
-    registry_json[0] = '\0';
-    if (!sg_extract_registry_json_from_sync_payload(registry_json, sizeof(registry_json))) {
-        out[0] = 0x80;
-        return 1;
+long long sengoo_sleep_ms(long long ms) {
+    if (ms < 0) {
+        ms = 0;
     }
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec req;
+    req.tv_sec = (time_t)(ms / 1000);
+    req.tv_nsec = (long)((ms % 1000) * 1000000L);
+    nanosleep(&req, NULL);
+#endif
+    return 1;
+}
 
-    const char* cursor = registry_json;
-    while (cursor != NULL && *cursor != '\0' && entry_count < SG_EXTENSION_BOOTSTRAP_MAX) {
-        const char* obj_begin = strchr(cursor, '{');
-        if (obj_begin == NULL) {
-            break;
-        }
-        const char* obj_end = strchr(obj_begin, '}');
-        if (obj_end == NULL) {
-            break;
-        }
-
-        if (!sg_json_object_is_enabled(obj_begin, obj_end + 1)) {
-            cursor = obj_end + 1;
-            continue;
-        }
-
-        char name[SG_EXTENSION_NAME_MAX];
-        char hash[SG_EXTENSION_HASH_MAX];
-        char url[SG_EXTENSION_ENTRY_MAX];
-        name[0] = '\0';
-        hash[0] = '\0';
-        url[0] = '\0';
-
-        int has_name = sg_extract_json_string_field(obj_begin, obj_end + 1, "name", name, sizeof(name));
-        (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "hash", hash, sizeof(hash));
-        if (!sg_extract_json_string_field(obj_begin, obj_end + 1, "url", url, sizeof(url))) {
-            (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "entry", url, sizeof(url));
-        }
-
-        if (has_name && name[0] != '\0') {
-            sg_update_summary_entry* item = &entries[entry_count];
-            snprintf(item->name, sizeof(item->name), "%s", name);
-            snprintf(item->hash, sizeof(item->hash), "%s", hash);
-            snprintf(item->url, sizeof(item->url), "%s", url);
-            entry_count += 1;
-        }
-
-        cursor = obj_end + 1;
+static sg_socket_t sg_tcp_listen_socket(long long port, int reuse_port) {
+    sg_socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == SG_INVALID_SOCKET) {
+        sg_logf("ERROR", "NET", "tcp socket create failed err=%d", sg_last_socket_error());
+        return SG_INVALID_SOCKET;
     }
 
-    size_t idx = 0;
-    int ok = 1;
-    ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 4, (unsigned long long)entry_count);
-    for (int i = 0; i < entry_count && ok; i++) {
-        sg_update_summary_entry* item = &entries[i];
-        ok = ok && sg_cbor_write_type_and_len(out, out_cap, &idx, 5, 3);
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)"name", 4);
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)item->name, strlen(item->name));
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)"hash", 4);
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)item->hash, strlen(item->hash));
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)"url", 3);
-        ok = ok && sg_cbor_write_bytes_like(out, out_cap, &idx, 3, (const unsigned char*)item->url, strlen(item->url));
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, (int)sizeof(reuse));
+#ifdef SO_REUSEPORT
+    if (reuse_port && setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (const char*)&reuse, (int)sizeof(reuse)) != 0) {
+        int err = sg_last_socket_error();
+        sg_close_socket(s);
+        sg_logf("ERROR", "NET", "tcp reuseport failed port=%lld err=%d", port, err);
+        return SG_INVALID_SOCKET;
     }
+#else
+    (void)reuse_port;
+#endif
 
-    if (!ok || idx == 0) {
-        out[0] = 0x80;
-        return 1;
-    }
-    return idx;
-}
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((unsigned short)port);
 
-static void sg_sanitize_filename_token(const char* input, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
-        return;
-    }
-    out[0] = '\0';
-    if (input == NULL || input[0] == '\0') {
-        snprintf(out, out_cap, "unknown");
-        return;
-    }
-    size_t j = 0;
-    for (size_t i = 0; input[i] != '\0' && j + 1 < out_cap; i++) {
-        unsigned char c = (unsigned char)input[i];
-        if (isalnum(c) || c == '-' || c == '_') {
-            out[j++] = (char)c;
-        } else {
-            out[j++] = '_';
-        }
-    }
-    out[j] = '\0';
-    if (j == 0) {
-        snprintf(out, out_cap, "unknown");
+    if (bind(s, (struct sockaddr*)&addr, (int)sizeof(addr)) != 0) {
+        int err = sg_last_socket_error();
+        sg_close_socket(s);
+        sg_logf("ERROR", "NET", "tcp bind failed port=%lld err=%d", port, err);
+        return SG_INVALID_SOCKET;
     }
-}
 
-static int sg_write_text_file(const char* path, const char* content) {
-    if (path == NULL || content == NULL) {
-        return 0;
+    int backlog = sg_parse_positive_env_i32("SENGOO_TCP_LISTEN_BACKLOG", 4096);
+    if (listen(s, backlog) != 0) {
+        int err = sg_last_socket_error();
+        sg_close_socket(s);
+        sg_logf("ERROR", "NET", "tcp listen failed port=%lld err=%d", port, err);
+        return SG_INVALID_SOCKET;
     }
-    FILE* fp = fopen(path, "wb");
-    if (fp == NULL) {
-        return 0;
+
+    if (!sg_set_nonblocking(s)) {
+        int err = sg_last_socket_error();
+        sg_close_socket(s);
+        sg_logf("ERROR", "NET", "tcp set nonblocking failed port=%lld err=%d", port, err);
+        return SG_INVALID_SOCKET;
     }
-    size_t n = fwrite(content, 1, strlen(content), fp);
-    fclose(fp);
-    return n == strlen(content);
+    return s;
 }
 
-static int sg_run_command_capture(const char* command, char* output, size_t output_cap) {
-    if (command == NULL || command[0] == '\0' || output == NULL || output_cap == 0) {
-        return -1;
-    }
-    output[0] = '\0';
-    FILE* pipe = sg_popen(command, "r");
-    if (pipe == NULL) {
-        return -1;
-    }
-    size_t used = 0;
-    char chunk[256];
-    while (fgets(chunk, (int)sizeof(chunk), pipe) != NULL) {
-        size_t chunk_len = strlen(chunk);
-        if (used + chunk_len + 1 < output_cap) {
-            memcpy(output + used, chunk, chunk_len);
-            used += chunk_len;
-            output[used] = '\0';
-        }
+#if SG_HAVE_REACTOR_THREADS
+static int sg_reactor_poller_open(sg_reactor* reactor) {
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        return sg_uring_open(&reactor->uring);
     }
-    int exit_code = sg_pclose(pipe);
-    sg_trim_trailing_whitespace(output);
-    return exit_code;
+#endif
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    return reactor->epoll_fd >= 0;
 }
 
-static int sg_find_extension_bootstrap_slot(const char* name, int* found_existing) {
-    int first_free = -1;
-    if (found_existing != NULL) {
-        *found_existing = 0;
+static void sg_reactor_poller_close(sg_reactor* reactor) {
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        sg_uring_close(&reactor->uring);
+        return;
     }
-    for (int i = 0; i < SG_EXTENSION_BOOTSTRAP_MAX; i++) {
-        if (!g_extension_bootstrap_entries[i].used) {
-            if (first_free < 0) {
-                first_free = i;
-            }
-            continue;
-        }
-        if (strcmp(g_extension_bootstrap_entries[i].name, name) == 0) {
-            if (found_existing != NULL) {
-                *found_existing = 1;
-            }
-            return i;
-        }
+#endif
+    close(reactor->epoll_fd);
+    reactor->epoll_fd = -1;
+}
+
+static int sg_reactor_watch(sg_reactor* reactor, int fd, long long token) {
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        return sg_uring_arm(reactor, fd, token);
     }
-    return first_free;
+#endif
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = (uint64_t)token;
+    return epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
 }
 
-static int sg_bootstrap_extension(const char* name, const char* entry_path, const char* hash) {
-    const char* lua_exe = sg_extension_bootstrap_lua_exe();
-    if (!sg_extension_bootstrap_check_lua_runtime()) {
+static int sg_reactor_open_mailbox(sg_reactor* reactor) {
+    reactor->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor->wake_fd < 0) {
         return 0;
     }
-    if (!sg_ensure_runtime_tmp_dirs()) {
-        sg_logf("WARN", "EXT", "extension bootstrap skipped mkdir failed");
+    if (!sg_reactor_watch(reactor, reactor->wake_fd, SG_REACTOR_WAKE_TOKEN)) {
+        close(reactor->wake_fd);
+        reactor->wake_fd = -1;
         return 0;
     }
+    pthread_mutex_init(&reactor->mailbox_lock, NULL);
+    reactor->mailbox_head = NULL;
+    reactor->mailbox_tail = NULL;
+    return 1;
+}
 
-    char safe_name[SG_EXTENSION_NAME_MAX];
-    sg_sanitize_filename_token(name, safe_name, sizeof(safe_name));
+static void sg_reactor_close_mailbox(sg_reactor* reactor) {
+    while (reactor->mailbox_head != NULL) {
+        sg_reactor_msg* msg = reactor->mailbox_head;
+        reactor->mailbox_head = msg->next;
+        sg_frame_release(msg->frame);
+        free(msg);
+    }
+    reactor->mailbox_tail = NULL;
+    pthread_mutex_destroy(&reactor->mailbox_lock);
+    close(reactor->wake_fd);
+    reactor->wake_fd = -1;
+}
 
-    char script_path[SG_EXTENSION_SCRIPT_MAX];
-    snprintf(script_path, sizeof(script_path), ".tmp/runtime_host/ext_bootstrap_%s.lua", safe_name);
+static void* sg_reactor_thread_main(void* arg);
+#endif
 
-    char lua_script[SG_EXTENSION_SCRIPT_MAX];
-    int script_len = snprintf(
-        lua_script,
-        sizeof(lua_script),
-        "local entry = [=[%s]=]\n"
-        "local ext_name = [=[%s]=]\n"
-        "local function _sg_norm(p) return (string.gsub(p, '\\\\', '/')) end\n"
-        "local function _sg_is_abs(p) return (string.match(p, '^%%a:[/\\\\]') ~= nil) or string.sub(p, 1, 1) == '/' end\n"
-        "local function _sg_parent(p)\n"
-        "  local n = _sg_norm(p)\n"
-        "  local parent = string.match(n, '^(.*)/[^/]+$')\n"
-        "  if parent == nil or parent == '' then return '.' end\n"
-        "  return parent\n"
-        "end\n"
-        "local function _sg_root(p)\n"
-        "  local n = _sg_norm(p)\n"
-        "  local root = string.gsub(n, '/lua/server/rpc/entry%%.lua$', '')\n"
-        "  if root ~= n then return root end\n"
-        "  root = string.gsub(n, '/lua/init%%.lua$', '')\n"
-        "  if root ~= n then return root end\n"
-        "  return _sg_parent(n)\n"
-        "end\n"
-        "local package_root = _sg_root(entry)\n"
-        "local function _sg_join(root, rel)\n"
-        "  if string.sub(root, -1) == '/' then return root .. rel end\n"
-        "  return root .. '/' .. rel\n"
-        "end\n"
-        "local _orig_dofile = dofile\n"
-        "dofile = function(path)\n"
-        "  if type(path) == 'string' and path ~= '' and not _sg_is_abs(path) then\n"
-        "    return _orig_dofile(_sg_join(package_root, path))\n"
-        "  end\n"
-        "  return _orig_dofile(path)\n"
-        "end\n"
-        "package.path = package.path .. ';'\n"
-        "  .. _sg_join(package_root, '?.lua') .. ';'\n"
-        "  .. _sg_join(package_root, '?/init.lua') .. ';'\n"
-        "  .. _sg_join(package_root, 'lua/lib/?.lua') .. ';'\n"
-        "  .. _sg_join(package_root, 'lua/?.lua') .. ';'\n"
-        "  .. _sg_join(package_root, 'lua/?/init.lua')\n"
-        "local chunk, load_err = loadfile(entry)\n"
-        "if type(chunk) ~= 'function' then io.stderr:write(tostring(load_err)); os.exit(21) end\n"
-        "local ok, mod = pcall(chunk, 'sengoo_bootstrap')\n"
-        "if not ok then io.stderr:write(tostring(mod)); os.exit(21) end\n"
-        "local init_fn = nil\n"
-        "if type(mod) == 'table' then init_fn = mod.on_server_start or mod.bootstrap or mod.init end\n"
-        "if type(init_fn) == 'function' then\n"
-        "  local call_ok, ret = pcall(init_fn)\n"
-        "  if not call_ok then io.stderr:write(tostring(ret)); os.exit(22) end\n"
-        "  if ret ~= nil then io.write(tostring(ret)) end\n"
-        "end\n"
-        "io.write('EXT_BOOTSTRAP_OK:' .. ext_name)\n",
-        entry_path,
-        name
-    );
-    if (script_len <= 0 || script_len >= (int)sizeof(lua_script)) {
-        sg_logf("WARN", "EXT", "extension bootstrap script too large name=%s", name);
-        return 0;
+static void sg_handoff_init(void) {
+    if (g_handoff.ready) {
+        return;
     }
-    if (!sg_write_text_file(script_path, lua_script)) {
-        sg_logf("WARN", "EXT", "extension bootstrap script write failed name=%s path=%s", name, script_path);
-        return 0;
+    g_handoff.ready = 1;
+    g_handoff.control = SG_INVALID_SOCKET;
+    g_handoff.peer = SG_INVALID_SOCKET;
+    g_handoff.inherited_udp = SG_INVALID_SOCKET;
+    const char* path = getenv("SENGOO_UPGRADE_SOCKET");
+    if (path == NULL || path[0] == '\0') {
+        return;
     }
-
-    char command[SG_EXTENSION_CMD_MAX];
-#ifdef _WIN32
-    int command_len = snprintf(command, sizeof(command), "cmd /c \"\"%s\" \"%s\" 2>&1\"", lua_exe, script_path);
+#if SG_HAVE_SOCKET_HANDOFF
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path) || strlen(path) >= sizeof(g_handoff.path)) {
+        sg_logf("WARN", "NET", "upgrade socket path too long path=%s", path);
+        return;
+    }
+    snprintf(g_handoff.path, sizeof(g_handoff.path), "%s", path);
+    g_handoff.enabled = 1;
 #else
-    int command_len = snprintf(command, sizeof(command), "\"%s\" \"%s\" 2>&1", lua_exe, script_path);
+    sg_logf("WARN", "NET", "upgrade socket handoff unsupported on this platform path=%s", path);
 #endif
-    if (command_len <= 0 || command_len >= (int)sizeof(command)) {
-        remove(script_path);
-        sg_logf("WARN", "EXT", "extension bootstrap command too large name=%s", name);
-        return 0;
-    }
+}
 
-    char output[SG_EXTENSION_OUTPUT_MAX];
-    int exit_code = sg_run_command_capture(command, output, sizeof(output));
-    remove(script_path);
+#if SG_HAVE_SOCKET_HANDOFF
+static void sg_handoff_address(struct sockaddr_un* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", g_handoff.path);
+}
 
-    if (exit_code != 0) {
-        sg_logf(
-            "WARN",
-            "EXT",
-            "extension bootstrap failed name=%s exit=%d hash=%s output=%s",
-            name,
-            exit_code,
-            (hash == NULL ? "" : hash),
-            (output[0] == '\0' ? "<empty>" : output)
-        );
+static int sg_handoff_timeout_ms(void) {
+    return sg_parse_positive_env_i32("SENGOO_UPGRADE_TIMEOUT_MS", 5000);
+}
+
+static void sg_handoff_set_timeouts(int s) {
+    int timeout_ms = sg_handoff_timeout_ms();
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static int sg_handoff_socket_port(int s, int type) {
+    int actual_type = 0;
+    socklen_t type_len = (socklen_t)sizeof(actual_type);
+    if (getsockopt(s, SOL_SOCKET, SO_TYPE, &actual_type, &type_len) != 0 || actual_type != type) {
         return 0;
     }
+    struct sockaddr_in addr;
+    socklen_t addr_len = (socklen_t)sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    if (getsockname(s, (struct sockaddr*)&addr, &addr_len) != 0 || addr.sin_family != AF_INET) {
+        return 0;
+    }
+    return (int)ntohs(addr.sin_port);
+}
+
+static int sg_handoff_recv(int s, sg_handoff_header* header, int* fds, int max_fds) {
+    union {
+        struct cmsghdr align;
+        char data[CMSG_SPACE(sizeof(int) * (SG_MAX_REACTORS + 1))];
+    } control;
+    struct iovec iov;
+    iov.iov_base = header;
+    iov.iov_len = sizeof(*header);
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data;
+    msg.msg_controllen = sizeof(control.data);
+#ifdef MSG_CMSG_CLOEXEC
+    ssize_t got = recvmsg(s, &msg, MSG_CMSG_CLOEXEC);
+#else
+    ssize_t got = recvmsg(s, &msg, 0);
+#endif
+    int count = 0;
+    if (got > 0) {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            int n = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            for (int i = 0; i < n; i++) {
+                int fd = -1;
+                memcpy(&fd, CMSG_DATA(cmsg) + (size_t)i * sizeof(int), sizeof(fd));
+                if (count < max_fds) {
+                    fds[count++] = fd;
+                } else {
+                    close(fd);
+                }
+            }
+        }
+    }
+    if (got != (ssize_t)sizeof(*header) || (msg.msg_flags & MSG_CTRUNC) != 0) {
+        for (int i = 0; i < count; i++) {
+            close(fds[i]);
+        }
+        return -1;
+    }
+    return count;
+}
 
+static void sg_handoff_inherit(long long port) {
+    sg_handoff_init();
+    if (!g_handoff.enabled || g_handoff.inherit_attempted) {
+        return;
+    }
+    g_handoff.inherit_attempted = 1;
+    int s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0) {
+        sg_logf("WARN", "NET", "upgrade socket create failed err=%d", errno);
+        return;
+    }
+    struct sockaddr_un addr;
+    sg_handoff_address(&addr);
+    if (connect(s, (struct sockaddr*)&addr, (socklen_t)sizeof(addr)) != 0) {
+        sg_logf("INFO", "NET", "upgrade socket has no running server path=%s err=%d", g_handoff.path, errno);
+        close(s);
+        return;
+    }
+    sg_handoff_set_timeouts(s);
+
+    sg_handoff_header request;
+    memset(&request, 0, sizeof(request));
+    request.magic = SG_HANDOFF_MAGIC;
+    request.port = (int32_t)port;
+    sg_handoff_header reply;
+    memset(&reply, 0, sizeof(reply));
+    int fds[SG_MAX_REACTORS + 1];
+    int fd_count = -1;
+    if (send(s, &request, sizeof(request), 0) == (ssize_t)sizeof(request)) {
+        fd_count = sg_handoff_recv(s, &reply, fds, SG_MAX_REACTORS + 1);
+    }
+    int valid = (fd_count > 0
+        && reply.magic == SG_HANDOFF_MAGIC
+        && reply.port == (int32_t)port
+        && reply.tcp_count > 0
+        && reply.tcp_count <= SG_MAX_REACTORS
+        && reply.tcp_count + (reply.udp_port > 0 ? 1 : 0) == fd_count);
+    for (int i = 0; valid && i < reply.tcp_count; i++) {
+        valid = (sg_handoff_socket_port(fds[i], SOCK_STREAM) == (int)port);
+    }
+    if (valid && reply.udp_port > 0) {
+        valid = (sg_handoff_socket_port(fds[reply.tcp_count], SOCK_DGRAM) == reply.udp_port);
+    }
+    char ack = 1;
+    if (valid) {
+        valid = (send(s, &ack, 1, 0) == 1);
+    }
+    close(s);
+    if (!valid) {
+        for (int i = 0; i < fd_count; i++) {
+            close(fds[i]);
+        }
+        sg_logf("WARN", "NET", "upgrade handoff rejected path=%s fds=%d err=%d; binding fresh", g_handoff.path, fd_count, errno);
+        return;
+    }
+    for (int i = 0; i < reply.tcp_count; i++) {
+        g_handoff.inherited_tcp[i] = fds[i];
+    }
+    g_handoff.inherited_tcp_count = reply.tcp_count;
+    g_handoff.inherited_tcp_next = 0;
+    if (reply.udp_port > 0) {
+        g_handoff.inherited_udp = fds[reply.tcp_count];
+        g_handoff.inherited_udp_port = reply.udp_port;
+    }
     sg_logf(
         "INFO",
-        "EXT",
-        "extension bootstrap loaded name=%s hash=%s output=%s",
-        name,
-        (hash == NULL ? "" : hash),
-        (output[0] == '\0' ? "<empty>" : output)
+        "NET",
+        "upgrade inherited listeners tcp=%d udp_port=%d path=%s",
+        reply.tcp_count,
+        reply.udp_port,
+        g_handoff.path
     );
-    return 1;
 }
 
-static int sg_run_extension_hook_once(
-    const char* name,
-    const char* entry_path,
-    const char* hash,
-    const char* hook_name
-) {
-    if (name == NULL || name[0] == '\0' || entry_path == NULL || entry_path[0] == '\0' || hook_name == NULL || hook_name[0] == '\0') {
-        return 0;
+static sg_socket_t sg_handoff_take_tcp(void) {
+    if (g_handoff.inherited_tcp_next >= g_handoff.inherited_tcp_count) {
+        return SG_INVALID_SOCKET;
     }
-    if (!sg_extension_bootstrap_check_lua_runtime()) {
-        return 0;
+    return g_handoff.inherited_tcp[g_handoff.inherited_tcp_next++];
+}
+
+static sg_socket_t sg_handoff_take_udp(long long port) {
+    sg_socket_t s = g_handoff.inherited_udp;
+    if (!g_handoff.enabled || s == SG_INVALID_SOCKET) {
+        return SG_INVALID_SOCKET;
     }
-    if (!sg_ensure_runtime_tmp_dirs()) {
-        return 0;
+    g_handoff.inherited_udp = SG_INVALID_SOCKET;
+    if (g_handoff.inherited_udp_port != (int)port) {
+        close(s);
+        return SG_INVALID_SOCKET;
     }
+    return s;
+}
 
-    const char* lua_exe = sg_extension_bootstrap_lua_exe();
-    char safe_name[SG_EXTENSION_NAME_MAX];
-    char safe_hook[SG_EXTENSION_NAME_MAX];
-    sg_sanitize_filename_token(name, safe_name, sizeof(safe_name));
-    sg_sanitize_filename_token(hook_name, safe_hook, sizeof(safe_hook));
+static void sg_handoff_release_unused(void) {
+    int unused = g_handoff.inherited_tcp_count - g_handoff.inherited_tcp_next;
+    if (unused <= 0) {
+        return;
+    }
+    while (g_handoff.inherited_tcp_next < g_handoff.inherited_tcp_count) {
+        close(g_handoff.inherited_tcp[g_handoff.inherited_tcp_next++]);
+    }
+    sg_logf("WARN", "NET", "upgrade closed %d inherited listeners beyond io reactors=%d", unused, g_reactor_count);
+}
 
-    char script_path[SG_EXTENSION_SCRIPT_MAX];
-    snprintf(script_path, sizeof(script_path), ".tmp/runtime_host/ext_hook_%s_%s.lua", safe_name, safe_hook);
+static void sg_handoff_listen(void) {
+    if (!g_handoff.enabled || g_handoff.control != SG_INVALID_SOCKET) {
+        return;
+    }
+    int s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0) {
+        sg_logf("WARN", "NET", "upgrade socket create failed err=%d", errno);
+        return;
+    }
+    struct sockaddr_un addr;
+    sg_handoff_address(&addr);
+    unlink(g_handoff.path);
+    mode_t previous_mask = umask(077);
+    int bound = (bind(s, (struct sockaddr*)&addr, (socklen_t)sizeof(addr)) == 0);
+    umask(previous_mask);
+    if (!bound || listen(s, 4) != 0 || !sg_set_nonblocking(s)) {
+        sg_logf("WARN", "NET", "upgrade socket listen failed path=%s err=%d", g_handoff.path, errno);
+        close(s);
+        return;
+    }
+    fcntl(s, F_SETFD, FD_CLOEXEC);
+    g_handoff.control = s;
+    sg_logf("INFO", "NET", "upgrade socket listening path=%s", g_handoff.path);
+}
 
-    char lua_script[SG_EXTENSION_SCRIPT_MAX];
-    int script_len = snprintf(
-        lua_script,
-        sizeof(lua_script),
-        "local entry = [=[%s]=]\n"
-        "local ext_name = [=[%s]=]\n"
-        "local hook_name = [=[%s]=]\n"
-        "local function _sg_norm(p) return (string.gsub(p, '\\\\', '/')) end\n"
-        "local function _sg_is_abs(p) return (string.match(p, '^%%a:[/\\\\]') ~= nil) or string.sub(p, 1, 1) == '/' end\n"
-        "local function _sg_parent(p)\n"
-        "  local n = _sg_norm(p)\n"
-        "  local parent = string.match(n, '^(.*)/[^/]+$')\n"
-        "  if parent == nil or parent == '' then return '.' end\n"
-        "  return parent\n"
-        "end\n"
-        "local function _sg_root(p)\n"
-        "  local n = _sg_norm(p)\n"
-        "  local root = string.gsub(n, '/lua/server/rpc/entry%%.lua$', '')\n"
-        "  if root ~= n then return root end\n"
-        "  root = string.gsub(n, '/lua/init%%.lua$', '')\n"
-        "  if root ~= n then return root end\n"
-        "  return _sg_parent(n)\n"
-        "end\n"
-        "local package_root = _sg_root(entry)\n"
-        "local function _sg_join(root, rel)\n"
-        "  if string.sub(root, -1) == '/' then return root .. rel end\n"
-        "  return root .. '/' .. rel\n"
-        "end\n"
-        "local _orig_dofile = dofile\n"
-        "dofile = function(path)\n"
-        "  if type(path) == 'string' and path ~= '' and not _sg_is_abs(path) then\n"
-        "    return _orig_dofile(_sg_join(package_root, path))\n"
-        "  end\n"
-        "  return _orig_dofile(path)\n"
-        "end\n"
-        "package.path = package.path .. ';'\n"
-        "  .. _sg_join(package_root, '?.lua') .. ';'\n"
-        "  .. _sg_join(package_root, '?/init.lua') .. ';'\n"
-        "  .. _sg_join(package_root, 'lua/lib/?.lua') .. ';'\n"
-        "  .. _sg_join(package_root, 'lua/?.lua') .. ';'\n"
-        "  .. _sg_join(package_root, 'lua/?/init.lua')\n"
-        "local chunk, load_err = loadfile(entry)\n"
-        "if type(chunk) ~= 'function' then io.stderr:write(tostring(load_err)); os.exit(31) end\n"
-        "local ok, mod = pcall(chunk, 'sengoo_hook')\n"
-        "if not ok then io.stderr:write(tostring(mod)); os.exit(31) end\n"
-        "local hook_fn = nil\n"
-        "if type(mod) == 'table' then hook_fn = mod[hook_name] end\n"
-        "if type(hook_fn) ~= 'function' and type(_G[hook_name]) == 'function' then hook_fn = _G[hook_name] end\n"
-        "if type(hook_fn) == 'function' then\n"
-        "  local call_ok, ret = pcall(hook_fn)\n"
-        "  if not call_ok then io.stderr:write(tostring(ret)); os.exit(32) end\n"
-        "  if ret ~= nil then io.write(tostring(ret)) end\n"
-        "  io.write(' EXT_HOOK_OK:' .. hook_name .. ':' .. ext_name)\n"
-        "else\n"
-        "  io.write('EXT_HOOK_SKIP:' .. hook_name .. ':' .. ext_name)\n"
-        "end\n",
-        entry_path,
-        name,
-        hook_name
-    );
-    if (script_len <= 0 || script_len >= (int)sizeof(lua_script)) {
-        sg_logf("WARN", "EXT", "extension hook script too large name=%s hook=%s", name, hook_name);
+static int sg_handoff_accept_peer(void) {
+    int peer = accept(g_handoff.control, NULL, NULL);
+    if (peer < 0) {
         return 0;
     }
-    if (!sg_write_text_file(script_path, lua_script)) {
-        sg_logf("WARN", "EXT", "extension hook script write failed name=%s hook=%s path=%s", name, hook_name, script_path);
+    fcntl(peer, F_SETFD, FD_CLOEXEC);
+    if (!sg_set_nonblocking(peer)) {
+        close(peer);
         return 0;
-    }
-
-    char command[SG_EXTENSION_CMD_MAX];
-#ifdef _WIN32
-    int command_len = snprintf(command, sizeof(command), "cmd /c \"\"%s\" \"%s\" 2>&1\"", lua_exe, script_path);
-#else
-    int command_len = snprintf(command, sizeof(command), "\"%s\" \"%s\" 2>&1", lua_exe, script_path);
-#endif
-    if (command_len <= 0 || command_len >= (int)sizeof(command)) {
-        remove(script_path);
-        sg_logf("WARN", "EXT", "extension hook command too large name=%s hook=%s", name, hook_name);
+    }
+#ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t cred_len = (socklen_t)sizeof(cred);
+    memset(&cred, 0, sizeof(cred));
+    if (getsockopt(peer, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 || cred.uid != geteuid()) {
+        sg_logf("WARN", "NET", "upgrade handoff rejected foreign peer uid=%d", (int)cred.uid);
+        close(peer);
         return 0;
     }
+#endif
+    g_handoff.peer = peer;
+    g_handoff.peer_stage = 1;
+    g_handoff.peer_deadline_ms = sg_monotonic_ms() + sg_handoff_timeout_ms();
+    g_handoff.request_got = 0;
+    memset(&g_handoff.request, 0, sizeof(g_handoff.request));
+    return 1;
+}
 
-    char output[SG_EXTENSION_OUTPUT_MAX];
-    int exit_code = sg_run_command_capture(command, output, sizeof(output));
-    remove(script_path);
-    if (exit_code != 0) {
-        sg_logf(
-            "WARN",
-            "EXT",
-            "extension hook failed name=%s hook=%s exit=%d hash=%s output=%s",
-            name,
-            hook_name,
-            exit_code,
-            (hash == NULL ? "" : hash),
-            (output[0] == '\0' ? "<empty>" : output)
-        );
-        return 0;
+static int sg_handoff_send_listeners(int peer) {
+    int fds[SG_MAX_REACTORS + 1];
+    sg_handoff_header reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = SG_HANDOFF_MAGIC;
+    reply.port = (int32_t)g_handoff.port;
+    for (int i = 0; i < g_reactor_count; i++) {
+        sg_socket_entry* listener = sg_find_socket(&g_tcp_listeners, g_reactors[i].listener_handle);
+        if (listener != NULL) {
+            fds[reply.tcp_count++] = listener->socket;
+        }
     }
+    sg_socket_entry* udp = sg_find_socket(&g_udp_sockets, g_handoff.udp_handle);
+    int fd_count = reply.tcp_count;
+    if (udp != NULL) {
+        fds[fd_count++] = udp->socket;
+        reply.udp_port = (int32_t)g_handoff.udp_port;
+    }
+    if (reply.tcp_count == 0) {
+        sg_logf("WARN", "NET", "upgrade handoff has no tcp listener to pass");
+        return 0;
+    }
+
+    union {
+        struct cmsghdr align;
+        char data[CMSG_SPACE(sizeof(int) * (SG_MAX_REACTORS + 1))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov;
+    iov.iov_base = &reply;
+    iov.iov_len = sizeof(reply);
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)fd_count);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)fd_count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * (size_t)fd_count);
+    if (sendmsg(peer, &msg, MSG_DONTWAIT) != (ssize_t)sizeof(reply)) {
+        sg_logf("WARN", "NET", "upgrade handoff send failed err=%d; keep serving", errno);
+        return 0;
+    }
+    sg_logf("INFO", "NET", "upgrade handoff sent tcp=%d udp_port=%d; awaiting ack", reply.tcp_count, (int)reply.udp_port);
+    return 1;
+}
 
-    if (strstr(output, "EXT_HOOK_SKIP:") == output) {
-        sg_logf("INFO", "EXT", "extension hook skipped name=%s hook=%s", name, hook_name);
-    } else {
-        sg_logf(
-            "INFO",
-            "EXT",
-            "extension hook executed name=%s hook=%s hash=%s output=%s",
-            name,
-            hook_name,
-            (hash == NULL ? "" : hash),
-            (output[0] == '\0' ? "<empty>" : output)
-        );
+static int sg_handoff_step(void) {
+    int peer = g_handoff.peer;
+    if (g_handoff.peer_stage == 1) {
+        while (g_handoff.request_got < sizeof(g_handoff.request)) {
+            ssize_t n = recv(
+                peer,
+                (char*)&g_handoff.request + g_handoff.request_got,
+                sizeof(g_handoff.request) - g_handoff.request_got,
+                MSG_DONTWAIT
+            );
+            if (n > 0) {
+                g_handoff.request_got += (size_t)n;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                return 0;
+            }
+            sg_logf("WARN", "NET", "upgrade handoff peer closed before request err=%d", errno);
+            return -1;
+        }
+        if (g_handoff.request.magic != SG_HANDOFF_MAGIC || g_handoff.request.port != (int32_t)g_handoff.port) {
+            sg_logf(
+                "WARN",
+                "NET",
+                "upgrade handoff rejected request port=%d expected=%lld",
+                (int)g_handoff.request.port,
+                g_handoff.port
+            );
+            return -1;
+        }
+        if (!sg_handoff_send_listeners(peer)) {
+            return -1;
+        }
+        g_handoff.peer_stage = 2;
+    }
+    char ack = 0;
+    ssize_t n = recv(peer, &ack, 1, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    if (n != 1 || ack != 1) {
+        sg_logf("WARN", "NET", "upgrade handoff aborted by successor err=%d; keep serving", errno);
+        return -1;
     }
     return 1;
 }
 
-static void sg_emit_extension_shutdown_hooks(void) {
-    if (g_extension_shutdown_hooks_emitted) {
-        return;
+static void sg_handoff_stop_accepting(void) {
+    for (int i = 0; i < g_reactor_count; i++) {
+        if (i != g_reactor->index) {
+            sg_reactor_post(i, SG_REACTOR_MSG_STOP_ACCEPT, 0, 0, NULL, NULL);
+        }
     }
-    g_extension_shutdown_hooks_emitted = 1;
-    if (!sg_extension_bootstrap_enabled()) {
+    sg_reactor_stop_accept();
+}
+
+static void sg_handoff_tick(void) {
+    if (!g_handoff.enabled || g_handoff.control == SG_INVALID_SOCKET) {
         return;
     }
-
-    int discovered = 0;
-    int executed = 0;
-    for (int i = 0; i < SG_EXTENSION_BOOTSTRAP_MAX; i++) {
-        sg_extension_bootstrap_entry* item = &g_extension_bootstrap_entries[i];
-        if (!item->used || !item->loaded || item->entry[0] == '\0') {
-            continue;
+    long long now_ms = sg_monotonic_ms();
+    if (g_handoff.peer == SG_INVALID_SOCKET) {
+        if (now_ms < g_handoff.next_poll_ms) {
+            return;
         }
-        discovered += 1;
-        if (sg_run_extension_hook_once(item->name, item->entry, item->hash, "on_server_stop")) {
-            executed += 1;
+        g_handoff.next_poll_ms = now_ms + SG_HANDOFF_POLL_INTERVAL_MS;
+        if (!sg_handoff_accept_peer()) {
+            return;
         }
     }
-
-    if (discovered > 0) {
-        sg_logf("INFO", "EXT", "extension shutdown hook summary discovered=%d executed=%d", discovered, executed);
+    int rc = sg_handoff_step();
+    if (rc == 0 && now_ms >= g_handoff.peer_deadline_ms) {
+        sg_logf("WARN", "NET", "upgrade handoff timed out stage=%d; keep serving", g_handoff.peer_stage);
+        rc = -1;
+    }
+    if (rc == 0) {
+        return;
+    }
+    close(g_handoff.peer);
+    g_handoff.peer = SG_INVALID_SOCKET;
+    g_handoff.peer_stage = 0;
+    if (rc < 0) {
+        return;
     }
+    sg_logf("INFO", "NET", "upgrade handoff completed; draining");
+    close(g_handoff.control);
+    g_handoff.control = SG_INVALID_SOCKET;
+    g_handoff.handed_off = 1;
+    sg_handoff_stop_accepting();
+    g_shutdown_requested = 1;
 }
 
-static void sg_sync_extension_bootstrap(const char* registry_json) {
-    if (!sg_extension_bootstrap_enabled() || registry_json == NULL || registry_json[0] == '\0') {
+static void sg_handoff_close(void) {
+    if (!g_handoff.enabled) {
         return;
     }
-
-    g_extension_bootstrap_generation += 1;
-    if (g_extension_bootstrap_generation == 0) {
-        g_extension_bootstrap_generation = 1;
+    if (g_handoff.peer != SG_INVALID_SOCKET) {
+        close(g_handoff.peer);
+        g_handoff.peer = SG_INVALID_SOCKET;
     }
-    unsigned int generation = g_extension_bootstrap_generation;
+    if (g_handoff.control == SG_INVALID_SOCKET) {
+        return;
+    }
+    close(g_handoff.control);
+    g_handoff.control = SG_INVALID_SOCKET;
+    unlink(g_handoff.path);
+}
+#else
+static void sg_handoff_inherit(long long port) {
+    (void)port;
+    sg_handoff_init();
+}
 
-    int discovered_count = 0;
-    int loaded_count = 0;
-    int reload_count = 0;
-    int changed_any = 0;
-    int lua_runtime_available = sg_extension_bootstrap_check_lua_runtime();
+static sg_socket_t sg_handoff_take_tcp(void) {
+    return SG_INVALID_SOCKET;
+}
 
-    const char* cursor = registry_json;
-    while (cursor != NULL && *cursor != '\0') {
-        const char* obj_begin = strchr(cursor, '{');
-        if (obj_begin == NULL) {
-            break;
-        }
-        const char* obj_end = strchr(obj_begin, '}');
-        if (obj_end == NULL) {
-            break;
-        }
+static sg_socket_t sg_handoff_take_udp(long long port) {
+    (void)port;
+    return SG_INVALID_SOCKET;
+}
 
-        char name[SG_EXTENSION_NAME_MAX];
-        char entry[SG_EXTENSION_ENTRY_MAX];
-        char hash[SG_EXTENSION_HASH_MAX];
-        name[0] = '\0';
-        entry[0] = '\0';
-        hash[0] = '\0';
+static void sg_handoff_release_unused(void) {
+}
 
-        int has_name = sg_extract_json_string_field(obj_begin, obj_end + 1, "name", name, sizeof(name));
-        (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "entry", entry, sizeof(entry));
-        (void)sg_extract_json_string_field(obj_begin, obj_end + 1, "hash", hash, sizeof(hash));
+static void sg_handoff_listen(void) {
+}
 
-        if (has_name && entry[0] == '\0' && strcmp(name, "freekill-core") == 0) {
-            char core_entry_buf[SG_EXTENSION_ENTRY_MAX];
-            const char* core_entry = sg_default_core_entry_path(core_entry_buf, sizeof(core_entry_buf));
-            snprintf(entry, sizeof(entry), "%s", core_entry);
-        }
+static void sg_handoff_tick(void) {
+}
 
-        if (has_name && entry[0] != '\0') {
-            discovered_count += 1;
-            int found_existing = 0;
-            int slot = sg_find_extension_bootstrap_slot(name, &found_existing);
-            if (slot >= 0) {
-                sg_extension_bootstrap_entry* item = &g_extension_bootstrap_entries[slot];
-                int changed = (!found_existing)
-                    || strcmp(item->entry, entry) != 0
-                    || strcmp(item->hash, hash) != 0
-                    || (!item->loaded && lua_runtime_available);
+static void sg_handoff_close(void) {
+}
+#endif
 
-                if (!found_existing) {
-                    memset(item, 0, sizeof(*item));
-                    item->used = 1;
-                    snprintf(item->name, sizeof(item->name), "%s", name);
-                }
+static void sg_reactors_start(long long port, int count) {
+#if SG_HAVE_REACTOR_THREADS
+    if (count <= 1 || g_reactor_count > 1) {
+        return;
+    }
+    sg_tcp_send_limits_init();
+    sg_tcp_input_limits_init();
+    if (!sg_reactor_open_mailbox(&g_reactors[0])) {
+        sg_logf("WARN", "NET", "reactor mailbox create failed err=%d; running single reactor", errno);
+        return;
+    }
 
-                if (changed) {
-                    changed_any = 1;
-                    if (item->loaded) {
-                        reload_count += 1;
-                    }
-                    item->loaded = sg_bootstrap_extension(name, entry, hash);
-                    item->last_exit_code = (item->loaded ? 0 : 1);
-                    snprintf(item->entry, sizeof(item->entry), "%s", entry);
-                    snprintf(item->hash, sizeof(item->hash), "%s", hash);
-                }
-                item->generation = generation;
-                if (item->loaded) {
-                    loaded_count += 1;
-                }
+    int ready = 1;
+    for (int i = 1; i < count; i++) {
+        sg_reactor* reactor = &g_reactors[i];
+        sg_tcp_conn_table connections = reactor->connections;
+        memset(reactor, 0, sizeof(*reactor));
+        reactor->connections = connections;
+        reactor->index = i;
+        if (!sg_reactor_poller_open(reactor)) {
+            sg_logf("WARN", "NET", "reactor %d poller create failed err=%d", i, errno);
+            break;
+        }
+        sg_socket_t s = sg_handoff_take_tcp();
+        if (s == SG_INVALID_SOCKET) {
+            s = sg_tcp_listen_socket(port, 1);
+        }
+        if (s == SG_INVALID_SOCKET || !sg_store_socket(&g_tcp_listeners, s, &reactor->listener_handle)) {
+            if (s != SG_INVALID_SOCKET) {
+                sg_close_socket(s);
             }
+            sg_reactor_poller_close(reactor);
+            sg_logf("WARN", "NET", "reactor %d listener setup failed port=%lld", i, port);
+            break;
         }
-
-        cursor = obj_end + 1;
-    }
-
-    for (int i = 0; i < SG_EXTENSION_BOOTSTRAP_MAX; i++) {
-        sg_extension_bootstrap_entry* item = &g_extension_bootstrap_entries[i];
-        if (!item->used) {
-            continue;
+        if (!sg_reactor_watch(reactor, s, reactor->listener_handle) || !sg_reactor_open_mailbox(reactor)) {
+            sg_logf("WARN", "NET", "reactor %d poller setup failed err=%d", i, errno);
+            sg_remove_socket(&g_tcp_listeners, reactor->listener_handle, 1);
+            sg_reactor_poller_close(reactor);
+            break;
         }
-        if (item->generation != generation) {
-            if (item->loaded) {
-                sg_logf("INFO", "EXT", "extension bootstrap unloaded name=%s", item->name);
+        ready += 1;
+    }
+
+    g_reactor_count = ready;
+    sigset_t shutdown_signals;
+    sigset_t previous_mask;
+    sigemptyset(&shutdown_signals);
+    sigaddset(&shutdown_signals, SIGINT);
+    sigaddset(&shutdown_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdown_signals, &previous_mask);
+    for (int i = 1; i < ready; i++) {
+        sg_reactor* reactor = &g_reactors[i];
+        int rc = pthread_create(&reactor->thread, NULL, sg_reactor_thread_main, reactor);
+        if (rc != 0) {
+            sg_logf("ERROR", "NET", "reactor %d thread start failed err=%d", i, rc);
+            sg_socket_entry* listener = sg_find_socket(&g_tcp_listeners, reactor->listener_handle);
+            if (listener != NULL) {
+                shutdown(listener->socket, SHUT_RDWR);
             }
-            changed_any = 1;
-            memset(item, 0, sizeof(*item));
+            continue;
         }
+        reactor->thread_started = 1;
     }
-
-    if ((discovered_count > 0 && (changed_any || !g_extension_bootstrap_synced_once)) || (changed_any && discovered_count == 0)) {
-        sg_logf(
-            "INFO",
-            "EXT",
-            "extension bootstrap sync discovered=%d loaded=%d reloaded=%d",
-            discovered_count,
-            loaded_count,
-            reload_count
-        );
+    pthread_sigmask(SIG_SETMASK, &previous_mask, NULL);
+    sg_logf("INFO", "NET", "io reactors=%d port=%lld", ready, port);
+#else
+    if (count > 1) {
+        sg_logf("WARN", "NET", "io threads=%d unsupported on this platform; running single reactor", count);
     }
-    g_extension_bootstrap_synced_once = 1;
+    (void)port;
+#endif
 }
 
-static int sg_should_send_extension_sync_on_accept(void) {
-    return sg_parse_bool_env("SENGOO_EXTENSION_SYNC_ON_ACCEPT", 0);
-}
+long long sengoo_tcp_listener_bind(long long port) {
+    if (!sg_port_valid(port)) {
+        sg_logf("ERROR", "NET", "tcp bind rejected invalid port=%lld", port);
+        return 0;
+    }
+    if (!sg_net_init()) {
+        sg_logf("ERROR", "NET", "tcp bind failed network init error");
+        return 0;
+    }
 
-static void sg_fill_registry_fallback(char* registry_json, size_t cap) {
-    char core_entry_buf[SG_EXTENSION_ENTRY_MAX];
-    const char* core_entry_path = sg_default_core_entry_path(core_entry_buf, sizeof(core_entry_buf));
-    if (sg_path_exists(core_entry_path)) {
-        snprintf(registry_json, cap, "%s", SG_DEFAULT_EXTENSION_REGISTRY_JSON);
-        sg_logf("INFO", "EXT", "extension registry fallback=freekill-core source=%s", core_entry_path);
-        return;
+    sg_poller_init();
+    sg_admission_init();
+    sg_tick_extension_sync_refresh();
+    sg_handoff_inherit(port);
+    int io_threads = sg_runtime_io_thread_count();
+    if (g_handoff.inherited_tcp_count > io_threads && g_io_backend != SG_IO_BACKEND_SCAN) {
+        sg_logf("INFO", "NET", "upgrade raises io threads=%d to serve every inherited listener", g_handoff.inherited_tcp_count);
+        io_threads = g_handoff.inherited_tcp_count;
+    }
+    if (io_threads > 1 && g_io_backend == SG_IO_BACKEND_SCAN) {
+        sg_logf("WARN", "NET", "io threads=%d require epoll or io_uring backend; running single reactor", io_threads);
+        io_threads = 1;
+    }
+    int shard_listener = (io_threads > 1 && g_reactor_count == 1);
+    if (g_tcp_capacity == 0 || shard_listener) {
+        sg_tcp_capacity_init(io_threads);
     }
-    snprintf(registry_json, cap, "[]");
-    sg_logf("WARN", "EXT", "extension registry fallback empty-list; core entry missing path=%s", core_entry_path);
-}
 
-static void sg_prepare_extension_sync_payload(void) {
-    const char* registry_path = getenv("SENGOO_EXTENSION_REGISTRY");
-    if (registry_path == NULL || registry_path[0] == '\0') {
-        registry_path = "packages/packages.registry.json";
+    sg_socket_t s = sg_handoff_take_tcp();
+    if (s == SG_INVALID_SOCKET) {
+        s = sg_tcp_listen_socket(port, shard_listener);
+    }
+    if (s == SG_INVALID_SOCKET) {
+        return 0;
     }
 
-    char registry_json[SG_EXTENSION_SYNC_PAYLOAD_MAX - 128];
-    registry_json[0] = '\0';
-    int read_ok = sg_read_file_text(registry_path, registry_json, sizeof(registry_json));
-    if (!read_ok) {
-        sg_logf("WARN", "EXT", "extension registry missing or unreadable path=%s", registry_path);
-        sg_fill_registry_fallback(registry_json, sizeof(registry_json));
+    long long handle = 0;
+    if (!sg_store_socket(&g_tcp_listeners, s, &handle)) {
+        sg_close_socket(s);
+        sg_logf("ERROR", "NET", "tcp listener table full port=%lld", port);
+        return 0;
     }
-    sg_strip_utf8_bom(registry_json);
-    sg_trim_trailing_whitespace(registry_json);
-    if (sg_registry_json_is_empty(registry_json)) {
-        sg_fill_registry_fallback(registry_json, sizeof(registry_json));
+    if (!sg_poller_add(s, handle, 0)) {
+        int err = sg_last_socket_error();
+        sg_remove_socket(&g_tcp_listeners, handle, 1);
+        sg_logf("ERROR", "NET", "tcp listener poller register failed port=%lld err=%d", port, err);
+        return 0;
     }
-    sg_sync_extension_bootstrap(registry_json);
+    g_reactor->listener_handle = handle;
+    sg_logf("INFO", "NET", "server is ready to listen on [0.0.0.0]:%lld", port);
+    sg_logf("INFO", "NET", "tcp listener bound port=%lld handle=%lld", port, handle);
+    if (shard_listener) {
+        sg_reactors_start(port, io_threads);
+    }
+    sg_handoff_release_unused();
+    g_handoff.port = port;
+    sg_handoff_listen();
+    return handle;
+}
 
-    int payload_len = snprintf(
-        g_extension_sync_payload,
-        sizeof(g_extension_sync_payload),
-        "{\"event\":\"extension_sync\",\"registry\":%s}\n",
-        registry_json
-    );
-    if (payload_len <= 0 || payload_len >= (int)sizeof(g_extension_sync_payload)) {
-        snprintf(
-            g_extension_sync_payload,
-            sizeof(g_extension_sync_payload),
-            "{\"event\":\"extension_sync\",\"registry\":[]}\n"
-        );
-        sg_logf("WARN", "EXT", "extension registry payload overflow; fallback to empty list");
+static long long sg_tcp_admit_connection(long long listener_handle, sg_socket_t conn, const struct sockaddr_in* peer, int nonblocking);
+
+static long long sg_tcp_listener_accept_one(long long listener_handle, int* would_block) {
+    *would_block = 0;
+    sg_socket_entry* listener = sg_find_socket(&g_tcp_listeners, listener_handle);
+    if (listener == NULL) {
+        sg_logf("WARN", "NET", "tcp accept invalid listener handle=%lld", listener_handle);
+        return -2;
     }
 
-    unsigned long fingerprint = sg_hash_text(g_extension_sync_payload);
-    if (fingerprint != g_extension_sync_payload_fingerprint) {
-        g_extension_sync_payload_fingerprint = fingerprint;
-        sg_logf("INFO", "EXT", "extension sync payload ready bytes=%u from=%s", (unsigned)strlen(g_extension_sync_payload), registry_path);
+    struct sockaddr_in peer_addr;
+#ifdef _WIN32
+    int peer_len = (int)sizeof(peer_addr);
+#else
+    socklen_t peer_len = (socklen_t)sizeof(peer_addr);
+#endif
+
+#if SG_HAVE_EPOLL
+    sg_socket_t conn = accept4(listener->socket, (struct sockaddr*)&peer_addr, &peer_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    int nonblocking = 1;
+#else
+    sg_socket_t conn = accept(listener->socket, (struct sockaddr*)&peer_addr, &peer_len);
+    int nonblocking = 0;
+#endif
+    if (conn == SG_INVALID_SOCKET) {
+        if (sg_would_block()) {
+            *would_block = 1;
+            return 0;
+        }
+        sg_logf("WARN", "NET", "tcp accept failed listener=%lld err=%d", listener_handle, sg_last_socket_error());
+        return -3;
     }
+    return sg_tcp_admit_connection(listener_handle, conn, &peer_addr, nonblocking);
 }
 
-static void sg_tick_extension_sync_refresh(void) {
-    int interval_ms = sg_extension_sync_refresh_interval_ms();
-    long long now_ms = sg_monotonic_ms();
-    if (g_extension_sync_refresh_last_ms > 0 && now_ms - g_extension_sync_refresh_last_ms < (long long)interval_ms) {
+long long sengoo_tcp_listener_accept(long long listener_handle) {
+    int would_block = 0;
+    return sg_tcp_listener_accept_one(listener_handle, &would_block);
+}
+
+static void sg_admission_init(void) {
+    if (g_admission.ready) {
         return;
     }
-    g_extension_sync_refresh_last_ms = now_ms;
-    sg_prepare_extension_sync_payload();
+    g_admission.ip_rate = sg_parse_positive_env_i32("SENGOO_TCP_ACCEPT_IP_RATE", 5);
+    g_admission.ip_burst = sg_parse_positive_env_i32("SENGOO_TCP_ACCEPT_IP_BURST", 20);
+    g_admission.global_rate = sg_parse_positive_env_i32("SENGOO_TCP_ACCEPT_GLOBAL_RATE", 0);
+    g_admission.global_burst = sg_parse_positive_env_i32("SENGOO_TCP_ACCEPT_GLOBAL_BURST", g_admission.global_rate);
+    g_admission.limit_loopback = sg_parse_bool_env("SENGOO_TCP_ACCEPT_LIMIT_LOOPBACK", 0);
+    g_admission.global_tokens_milli = (long long)g_admission.global_burst * 1000;
+    g_admission.global_refill_ms = sg_monotonic_ms();
+    g_admission.ready = 1;
+    sg_logf(
+        "INFO",
+        "NET",
+        "tcp admission ip_rate=%d ip_burst=%d global_rate=%d global_burst=%d limit_loopback=%d",
+        g_admission.ip_rate,
+        g_admission.ip_burst,
+        g_admission.global_rate,
+        g_admission.global_burst,
+        g_admission.limit_loopback
+    );
 }
 
-static long long sg_send_extension_sync_payload(sg_socket_t conn) {
-    if (!sg_should_send_extension_sync_on_accept()) {
-        return 0;
-    }
-    sg_prepare_extension_sync_payload();
-    const char* cursor = g_extension_sync_payload;
-    size_t remaining = strlen(g_extension_sync_payload);
-    size_t sent_total = 0;
-    while (remaining > 0) {
-        int sent = send(conn, cursor, (int)remaining, 0);
-        if (sent <= 0) {
-            int err = sg_last_socket_error();
-            sg_logf(
-                "WARN",
-                "EXT",
-                "extension sync send incomplete sent=%u remaining=%u err=%d",
-                (unsigned)sent_total,
-                (unsigned)remaining,
-                err
-            );
-            return -1;
-        }
-        sent_total += (size_t)sent;
-        cursor += sent;
-        remaining -= (size_t)sent;
+static long long sg_admission_refill(long long tokens_milli, long long* refill_ms, long long now_ms, int rate, int burst) {
+    long long cap_milli = (long long)burst * 1000;
+    long long elapsed_ms = now_ms - *refill_ms;
+    if (elapsed_ms > 0) {
+        tokens_milli += elapsed_ms * (long long)rate;
+        *refill_ms = now_ms;
     }
-    return (long long)sent_total;
+    return (tokens_milli > cap_milli ? cap_milli : tokens_milli);
 }
 
-static long long sg_next_handle(void) {
-    g_next_handle += 1;
-    if (g_next_handle <= 0) {
-        g_next_handle = 1000001;
+static sg_admission_entry* sg_admission_lookup(uint32_t ip, long long now_ms) {
+    uint32_t home = (uint32_t)(ip * 2654435761u) >> (32 - SG_ADMISSION_TABLE_BITS);
+    sg_admission_entry* reuse = NULL;
+    for (int i = 0; i < SG_ADMISSION_PROBE_MAX; i++) {
+        sg_admission_entry* entry = &g_admission.entries[(home + (uint32_t)i) & (SG_ADMISSION_TABLE_SIZE - 1)];
+        if (entry->refill_ms != 0 && entry->ip == ip) {
+            return entry;
+        }
+        if (reuse == NULL || entry->refill_ms < reuse->refill_ms) {
+            reuse = entry;
+        }
     }
-    return g_next_handle;
+    reuse->ip = ip;
+    reuse->tokens_milli = g_admission.ip_burst * 1000;
+    reuse->refill_ms = now_ms;
+    return reuse;
 }
 
-#ifdef _WIN32
-static int sg_net_init(void) {
-    static volatile LONG initialized = 0;
-    LONG prev = InterlockedCompareExchange(&initialized, 1, 0);
-    if (prev == 0) {
-        WSADATA wsa;
-        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-            InterlockedExchange(&initialized, 0);
-            return 0;
+static int sg_admission_allow(const struct sockaddr_in* peer) {
+    uint32_t ip = ntohl(peer->sin_addr.s_addr);
+    int check_ip = (g_admission.limit_loopback || (ip >> 24) != 127);
+    if (!check_ip && g_admission.global_rate <= 0) {
+        return 1;
+    }
+    long long now_ms = sg_monotonic_ms();
+    int allowed = 1;
+    sg_runtime_lock();
+    sg_admission_entry* entry = NULL;
+    long long ip_tokens = 0;
+    if (check_ip) {
+        entry = sg_admission_lookup(ip, now_ms);
+        ip_tokens = sg_admission_refill(entry->tokens_milli, &entry->refill_ms, now_ms, g_admission.ip_rate, g_admission.ip_burst);
+        entry->tokens_milli = (int)ip_tokens;
+        if (ip_tokens < 1000) {
+            g_admission.rejected_ip += 1;
+            allowed = 0;
         }
-        g_net_init_logged = 0;
     }
-    if (!g_net_init_logged) {
-        sg_logf("INFO", "SERVER", "server is starting");
-        sg_logf("INFO", "NET", "winsock initialized");
-        g_net_init_logged = 1;
+    if (allowed && g_admission.global_rate > 0) {
+        g_admission.global_tokens_milli = sg_admission_refill(
+            g_admission.global_tokens_milli,
+            &g_admission.global_refill_ms,
+            now_ms,
+            g_admission.global_rate,
+            g_admission.global_burst
+        );
+        if (g_admission.global_tokens_milli < 1000) {
+            g_admission.rejected_global += 1;
+            allowed = 0;
+        } else {
+            g_admission.global_tokens_milli -= 1000;
+        }
     }
-    return 1;
-}
-
-static int sg_would_block(void) {
-    int err = WSAGetLastError();
-    return err == WSAEWOULDBLOCK || err == WSAEINPROGRESS;
-}
+    if (allowed && entry != NULL) {
+        entry->tokens_milli -= 1000;
+    }
+    long long rejected = g_admission.rejected_ip + g_admission.rejected_global;
+    int should_log = (!allowed && now_ms - g_admission.last_log_ms >= SG_ADMISSION_LOG_INTERVAL_MS);
+    long long rejected_since_log = rejected - g_admission.rejected_logged;
+    long long rejected_ip = g_admission.rejected_ip;
+    long long rejected_global = g_admission.rejected_global;
+    if (should_log) {
+        g_admission.last_log_ms = now_ms;
+        g_admission.rejected_logged = rejected;
+    }
+    sg_runtime_unlock();
+    if (should_log) {
+        char peer_ip[64];
+        peer_ip[0] = '\0';
+#ifdef _WIN32
+        InetNtopA(AF_INET, (void*)&peer->sin_addr, peer_ip, (DWORD)sizeof(peer_ip));
 #else
-static int sg_net_init(void) {
-    if (!g_net_init_logged) {
-        sg_logf("INFO", "SERVER", "server is starting");
-        sg_logf("INFO", "NET", "posix network runtime initialized");
-        g_net_init_logged = 1;
+        inet_ntop(AF_INET, &peer->sin_addr, peer_ip, sizeof(peer_ip));
+#endif
+        sg_logf(
+            "WARN",
+            "NET",
+            "tcp admission rejected last=%s recent=%lld total_ip=%lld total_global=%lld",
+            peer_ip,
+            rejected_since_log,
+            rejected_ip,
+            rejected_global
+        );
     }
-    return 1;
-}
-
-static int sg_would_block(void) {
-    return errno == EWOULDBLOCK || errno == EAGAIN;
+    return allowed;
 }
-#endif
 
-static int sg_set_nonblocking(sg_socket_t s) {
+static long long sg_tcp_admit_connection(long long listener_handle, sg_socket_t conn, const struct sockaddr_in* peer, int nonblocking) {
+    if (!sg_admission_allow(peer)) {
+        sg_close_socket(conn);
+        return 0;
+    }
+    struct sockaddr_in peer_addr = *peer;
+    char peer_ip[64];
+    peer_ip[0] = '\0';
 #ifdef _WIN32
-    u_long mode = 1;
-    return ioctlsocket(s, FIONBIO, &mode) == 0;
+    InetNtopA(AF_INET, &peer_addr.sin_addr, peer_ip, (DWORD)sizeof(peer_ip));
 #else
-    int flags = fcntl(s, F_GETFL, 0);
-    if (flags < 0) {
+    inet_ntop(AF_INET, &peer_addr.sin_addr, peer_ip, sizeof(peer_ip));
+#endif
+    if (peer_ip[0] == '\0') {
+        strcpy(peer_ip, "unknown");
+    }
+
+    if (sg_is_ip_banned(peer_ip)) {
+        sg_send_errordlg_raw(conn, "you have been banned!");
+        sg_close_socket(conn);
+        sg_logf("INFO", "AUTH", "connection refused by ip ban %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
+        return 0;
+    }
+    if (sg_is_ip_temp_banned(peer_ip)) {
+        sg_send_errordlg_raw(conn, "you have been temporarily banned!");
+        sg_close_socket(conn);
+        sg_logf("INFO", "AUTH", "connection refused by temp ip ban %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
         return 0;
     }
-    return fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
-#endif
-}
 
-static int sg_port_valid(long long port) {
-    return port >= 1 && port <= 65535;
-}
+    int capacity = sg_runtime_server_capacity();
+    int active_count = sg_count_active_tcp_connections();
+    if (active_count >= capacity) {
+        sg_send_errordlg_raw(conn, "server is full!");
+        sg_close_socket(conn);
+        sg_logf(
+            "INFO",
+            "AUTH",
+            "connection refused by capacity %s:%d active=%d capacity=%d",
+            peer_ip,
+            (int)ntohs(peer_addr.sin_port),
+            active_count,
+            capacity
+        );
+        return 0;
+    }
 
-static size_t sg_buffer_size(long long max_bytes) {
-    if (max_bytes <= 0) {
-        return 1024;
+    if (!nonblocking && !sg_set_nonblocking(conn)) {
+        int err = sg_last_socket_error();
+        sg_close_socket(conn);
+        sg_logf("WARN", "NET", "tcp accept set nonblocking failed listener=%lld err=%d", listener_handle, err);
+        return -4;
     }
-    if (max_bytes > 65536) {
-        return 65536;
+
+    sg_tcp_conn* record = sg_tcp_conn_open(conn);
+    if (record == NULL) {
+        sg_close_socket(conn);
+        sg_logf("WARN", "NET", "tcp connection table full listener=%lld", listener_handle);
+        return -5;
+    }
+    long long handle = record->handle;
+    long long signup_expiry_ms = record->cold.accepted_at_ms + (long long)sg_auth_signup_timeout_ms();
+    sg_timer_arm(&record->cold.timers[SG_TCP_TIMER_SIGNUP], handle, SG_TCP_TIMER_SIGNUP, signup_expiry_ms);
+    if (!sg_poller_add(record->socket, handle, 1)) {
+        int err = sg_last_socket_error();
+        sg_tcp_conn_close(handle);
+        sg_logf("WARN", "NET", "tcp connection poller register failed listener=%lld conn=%lld err=%d", listener_handle, handle, err);
+        return -8;
     }
-    return (size_t)max_bytes;
-}
 
-static int sg_store_socket(sg_socket_entry* table, sg_socket_t s, long long* out_handle) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (!table[i].used) {
-            long long h = sg_next_handle();
-            table[i].used = 1;
-            table[i].handle = h;
-            table[i].socket = s;
-            *out_handle = h;
-            return 1;
+    sg_tcp_conn_cork(record);
+    long long sync_bytes = sg_send_extension_sync_payload(record);
+    if (sync_bytes > 0) {
+        sg_logf("INFO", "EXT", "extension sync -> %s:%d bytes=%lld", peer_ip, (int)ntohs(peer_addr.sin_port), sync_bytes);
+    } else if (sync_bytes < 0) {
+        sg_logf("WARN", "EXT", "extension sync send failed -> %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
+    }
+    if (sg_should_send_network_delay()) {
+        if (!sg_send_network_delay_test(record)) {
+            sg_logf("WARN", "AUTH", "network delay test send failed -> %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
+        } else {
+            sg_logf("INFO", "AUTH", "network delay test -> %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
+            record->network_delay_sent = 1;
         }
     }
-    return 0;
+    if (!sg_tcp_conn_uncork(record)) {
+        int err = sg_last_socket_error();
+        sg_tcp_conn_close(handle);
+        sg_logf("WARN", "NET", "tcp greeting send failed listener=%lld conn=%lld err=%d", listener_handle, handle, err);
+        return -4;
+    }
+
+    sg_logf(
+        "INFO",
+        "NET",
+        "client %s:%d connected (conn=%lld listener=%lld)",
+        peer_ip,
+        (int)ntohs(peer_addr.sin_port),
+        handle,
+        listener_handle
+    );
+
+    return handle;
 }
 
-static sg_socket_entry* sg_find_socket(sg_socket_entry* table, long long handle) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (table[i].used && table[i].handle == handle) {
-            return &table[i];
+static long long sg_tcp_conn_process_input(sg_tcp_conn* conn, size_t n, int stream_was_empty, int force);
+
+static long long sg_tcp_conn_discard_input(sg_tcp_conn* conn, int* would_block) {
+    long long conn_handle = conn->handle;
+    char scratch[4096];
+    int n = recv(conn->socket, scratch, (int)sizeof(scratch), 0);
+    if (n > 0) {
+        sg_tcp_conn_budget_refresh(conn);
+        conn->budget_bytes += (size_t)n;
+        return n;
+    }
+    if (n < 0 && sg_would_block()) {
+        if (would_block != NULL) {
+            *would_block = 1;
         }
+        return 0;
     }
-    return NULL;
+    sg_tcp_conn_close(conn_handle);
+    sg_logf("INFO", "NET", "tcp drained connection closed handle=%lld", conn_handle);
+    return -3;
 }
 
-static int sg_remove_socket(sg_socket_entry* table, long long handle, int close_now) {
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (table[i].used && table[i].handle == handle) {
-            sg_socket_t s = table[i].socket;
-            table[i].used = 0;
-            table[i].handle = 0;
-            table[i].socket = SG_INVALID_SOCKET;
-            if (close_now && s != SG_INVALID_SOCKET) {
-                sg_close_socket(s);
-            }
-            return 1;
+static long long sg_tcp_connection_read_once(long long conn_handle, long long max_bytes, int* would_block) {
+    if (would_block != NULL) {
+        *would_block = 0;
+    }
+    sg_tcp_conn* conn = sg_tcp_conn_find(conn_handle);
+    if (conn == NULL) {
+        sg_logf("WARN", "NET", "tcp echo invalid connection handle=%lld", conn_handle);
+        return -2;
+    }
+    if (conn->read_paused) {
+        if (would_block != NULL) {
+            *would_block = 1;
         }
+        return 0;
+    }
+    if (conn->write_shut) {
+        return sg_tcp_conn_discard_input(conn, would_block);
     }
-    return 0;
-}
 
-static int sg_count_active_tcp_connections(void) {
-    int count = 0;
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (g_tcp_connections[i].used) {
-            count += 1;
+    size_t buffered = conn->stream_tail - conn->stream_head;
+    if (buffered >= SG_TCP_STREAM_BUFFER_MAX) {
+        sg_logf("WARN", "PROTO", "tcp stream overflow handle=%lld buffered=%u", conn_handle, (unsigned)buffered);
+        sg_tcp_conn_close(conn_handle);
+        return -5;
+    }
+    size_t incoming = (conn->parse.need > buffered ? conn->parse.need - buffered : 1);
+    if (!sg_tcp_conn_make_room(conn, incoming)) {
+        sg_logf("WARN", "NET", "tcp stream buffer alloc failed handle=%lld buffered=%u", conn_handle, (unsigned)buffered);
+        sg_tcp_conn_close(conn_handle);
+        return -6;
+    }
+    size_t read_cap = sg_buffer_size(max_bytes);
+    if (read_cap > conn->stream_cap - conn->stream_tail) {
+        read_cap = conn->stream_cap - conn->stream_tail;
+    }
+
+    int n = recv(conn->socket, (char*)(conn->stream_data + conn->stream_tail), (int)read_cap, 0);
+    if (n == 0) {
+        sg_tcp_conn_close(conn_handle);
+        sg_logf("INFO", "NET", "client disconnected (conn=%lld)", conn_handle);
+        return -3;
+    }
+    if (n < 0) {
+        if (sg_would_block()) {
+            sg_tcp_conn_release_buffer(conn);
+            if (would_block != NULL) {
+                *would_block = 1;
+            }
+            return 0;
         }
+        int err = sg_last_socket_error();
+        sg_tcp_conn_close(conn_handle);
+        sg_logf("WARN", "NET", "tcp recv failed handle=%lld err=%d", conn_handle, err);
+        return -5;
     }
-    return count;
+
+    conn->stream_tail += (size_t)n;
+    sg_tcp_conn_budget_refresh(conn);
+    conn->budget_bytes += (size_t)n;
+    return sg_tcp_conn_process_input(conn, (size_t)n, buffered == 0, 0);
 }
 
-static int sg_parse_positive_env_i32(const char* key, int fallback) {
-    const char* raw = getenv(key);
-    if (raw == NULL || raw[0] == '\0') {
-        return fallback;
-    }
-    char* end = NULL;
-    long value = strtol(raw, &end, 10);
-    if (end == raw || *end != '\0' || value <= 0 || value > 2147483647L) {
-        return fallback;
+static long long sg_tcp_conn_process_input(sg_tcp_conn* conn, size_t n, int stream_was_empty, int force) {
+    long long conn_handle = conn->handle;
+    int parsed_count = 0;
+    int parse_status = 0;
+    int close_requested = 0;
+    sg_tcp_input_limits_init();
+    sg_tcp_conn_budget_refresh(conn);
+    conn->input_pending = 0;
+    sg_tcp_conn_cork(conn);
+    while (conn->stream_tail > conn->stream_head) {
+        if (!force && conn->budget_frames >= g_tcp_frames_per_tick) {
+            conn->input_pending = 1;
+            parse_status = 2;
+            break;
+        }
+        sg_cbor_wire_packet packet;
+        size_t consumed = 0;
+        size_t available = conn->stream_tail - conn->stream_head;
+        int parse_rc = sg_wire_parser_step(&conn->parse, conn->stream_data + conn->stream_head, available, &packet, &consumed);
+        if (parse_rc == 1) {
+            if (consumed == 0 || consumed > available) {
+                parse_status = -1;
+                break;
+            }
+            int handle_rc = sg_handle_cbor_wire_packet(conn, &packet);
+            if (handle_rc == -2) {
+                close_requested = 1;
+                parse_status = -2;
+                break;
+            }
+            if (handle_rc <= 0) {
+                parse_status = -1;
+                break;
+            }
+            conn->stream_head += consumed;
+            if (conn->stream_head == conn->stream_tail) {
+                conn->stream_head = 0;
+                conn->stream_tail = 0;
+            }
+            parsed_count += 1;
+            conn->budget_frames += 1;
+            continue;
+        }
+        if (parse_rc == 0 && conn->parse.need > SG_TCP_STREAM_BUFFER_MAX) {
+            sg_logf("WARN", "PROTO", "tcp frame exceeds stream buffer handle=%lld need=%llu", conn_handle, (unsigned long long)conn->parse.need);
+            sg_tcp_conn_close(conn_handle);
+            return -5;
+        }
+        if (parse_rc == 0) {
+            parse_status = 1;
+            break;
+        }
+        parse_status = -1;
+        break;
+    }
+    if (!sg_tcp_conn_uncork(conn)) {
+        int err = sg_last_socket_error();
+        sg_tcp_conn_close(conn_handle);
+        sg_logf("WARN", "NET", "tcp send failed handle=%lld err=%d", conn_handle, err);
+        return -4;
     }
-    return (int)value;
-}
 
-static int sg_parse_port_env_i32(const char* key, int fallback) {
-    const char* raw = getenv(key);
-    if (raw == NULL || raw[0] == '\0') {
-        return fallback;
+    sg_tcp_conn_release_buffer(conn);
+    if (conn->input_pending) {
+        if (sg_tcp_conn_queue_pending(conn)) {
+            conn->starved_ticks += 1;
+        }
     }
-    char* end = NULL;
-    long value = strtol(raw, &end, 10);
-    if (end == raw || *end != '\0' || value < 1 || value > 65535) {
-        return fallback;
+    if (parsed_count > 0) {
+        return (long long)n;
     }
-    return (int)value;
-}
-
-long long sengoo_runtime_tcp_port(void) {
-    int port = sg_parse_port_env_i32("SENGOO_TCP_PORT", 9527);
-    return (long long)port;
-}
-
-long long sengoo_runtime_udp_port(void) {
-    int udp_port = sg_parse_port_env_i32("SENGOO_UDP_PORT", 9528);
-    return (long long)udp_port;
-}
-
-long long sengoo_runtime_tick_sleep_ms(void) {
-    int value = sg_parse_positive_env_i32("SENGOO_TICK_SLEEP_MS", 20);
-    return (long long)value;
-}
-
-long long sengoo_runtime_busy_sleep_ms(void) {
-    int value = sg_parse_positive_env_i32("SENGOO_BUSY_SLEEP_MS", 1);
-    return (long long)value;
-}
 
-long long sengoo_runtime_max_packet_bytes(void) {
-    int value = sg_parse_positive_env_i32("SENGOO_MAX_PACKET_BYTES", 65536);
-    if (value < 256) {
-        value = 256;
-    } else if (value > 65536) {
-        value = 65536;
+    if (parse_status == 1 || parse_status == 2) {
+        return 0;
     }
-    return (long long)value;
-}
-
-long long sengoo_runtime_max_error_count(void) {
-    int value = sg_parse_positive_env_i32("SENGOO_MAX_ERROR_COUNT", 200);
-    return (long long)value;
-}
 
-long long sengoo_runtime_max_accept_per_tick(void) {
-    int value = sg_parse_positive_env_i32("SENGOO_MAX_ACCEPT_PER_TICK", 16);
-    if (value < 1) {
-        value = 1;
-    } else if (value > 128) {
-        value = 128;
+    if (close_requested || parse_status == -2) {
+        sg_tcp_conn_close_after_flush(conn_handle);
+        sg_logf("INFO", "AUTH", "connection closed by auth policy handle=%lld", conn_handle);
+        return -5;
     }
-    return (long long)value;
-}
 
-static int sg_runtime_server_capacity(void) {
-    int value = sg_parse_positive_env_i32("SENGOO_SERVER_CAPACITY", 100);
-    if (value < 1) {
-        value = 1;
-    } else if (value > SG_MAX_NET_HANDLES) {
-        value = SG_MAX_NET_HANDLES;
+    if (!stream_was_empty) {
+        sg_logf("WARN", "PROTO", "tcp stream malformed frame handle=%lld", conn_handle);
+        sg_tcp_conn_close(conn_handle);
+        return -5;
     }
-    return value;
-}
 
-static int sg_auth_signup_timeout_ms(void) {
-    int value = sg_parse_positive_env_i32("SENGOO_AUTH_SIGNUP_TIMEOUT_MS", 180000);
-    if (value < 1000) {
-        value = 1000;
-    } else if (value > 3600000) {
-        value = 3600000;
+    int echo_ok = sg_tcp_conn_send(conn, conn->stream_data, n);
+    conn->stream_head = 0;
+    conn->stream_tail = 0;
+    sg_tcp_conn_release_buffer(conn);
+    if (!echo_ok) {
+        int err = sg_last_socket_error();
+        sg_tcp_conn_close(conn_handle);
+        sg_logf("WARN", "NET", "tcp send failed handle=%lld err=%d", conn_handle, err);
+        return -4;
     }
-    return value;
-}
 
-static const char* sg_server_detail_version(void) {
-    const char* raw = getenv("SENGOO_SERVER_VERSION");
-    if (raw == NULL || raw[0] == '\0') {
-        return "0.5.19+";
-    }
-    return raw;
+    sg_logf("INFO", "NET", "tcp echo handle=%lld bytes=%d", conn_handle, (int)n);
+    return (long long)n;
 }
 
-static const char* sg_server_detail_icon_url(void) {
-    const char* raw = getenv("SENGOO_SERVER_ICON_URL");
-    if (raw == NULL) {
-        return "";
-    }
-    return raw;
+long long sengoo_tcp_connection_echo_once(long long conn_handle, long long max_bytes) {
+    return sg_tcp_connection_read_once(conn_handle, max_bytes, NULL);
 }
 
-static const char* sg_server_detail_description(void) {
-    const char* raw = getenv("SENGOO_SERVER_DESCRIPTION");
-    if (raw == NULL) {
-        return "";
+static long long sg_tcp_connection_drain(long long conn_handle, long long max_bytes) {
+    long long progress = 0;
+    sg_tcp_input_limits_init();
+    for (;;) {
+        sg_tcp_conn* conn = sg_tcp_conn_find(conn_handle);
+        if (conn == NULL) {
+            return progress;
+        }
+        if (conn->input_pending) {
+            if (sg_tcp_conn_queue_pending(conn)) {
+                conn->starved_ticks += 1;
+            }
+            return progress;
+        }
+        sg_tcp_conn_budget_refresh(conn);
+        if (conn->budget_bytes >= g_tcp_read_bytes_per_tick && !conn->read_paused) {
+            if (sg_tcp_conn_queue_pending(conn)) {
+                conn->starved_ticks += 1;
+            }
+            return progress;
+        }
+        int would_block = 0;
+        long long io_rc = sg_tcp_connection_read_once(conn_handle, max_bytes, &would_block);
+        if (io_rc < 0) {
+            return io_rc;
+        }
+        if (io_rc > 0) {
+            progress = 1;
+        }
+        if (would_block) {
+            return progress;
+        }
     }
-    return raw;
 }
 
-static size_t sg_json_escape_copy(const char* input, char* out, size_t out_cap) {
-    if (out == NULL || out_cap == 0) {
+static long long sg_tcp_connection_resume(long long conn_handle, long long max_bytes) {
+    sg_tcp_conn* conn = sg_tcp_conn_find(conn_handle);
+    if (conn == NULL) {
         return 0;
     }
-    const char* src = (input == NULL ? "" : input);
-    size_t out_len = 0;
-    for (size_t i = 0; src[i] != '\0' && out_len + 1 < out_cap; i++) {
-        unsigned char ch = (unsigned char)src[i];
-        const char* replacement = NULL;
-        char unicode_seq[7];
-        if (ch == '"') {
-            replacement = "\\\"";
-        } else if (ch == '\\') {
-            replacement = "\\\\";
-        } else if (ch == '\n') {
-            replacement = "\\n";
-        } else if (ch == '\r') {
-            replacement = "\\r";
-        } else if (ch == '\t') {
-            replacement = "\\t";
-        } else if (ch < 0x20) {
-            snprintf(unicode_seq, sizeof(unicode_seq), "\\u%04x", (unsigned int)ch);
-            replacement = unicode_seq;
+    conn->pending_queued = 0;
+    long long progress = 0;
+    if (conn->input_pending) {
+        size_t buffered = conn->stream_tail - conn->stream_head;
+        long long rc = sg_tcp_conn_process_input(conn, buffered, 0, 0);
+        if (rc < 0) {
+            return rc;
         }
-
-        if (replacement != NULL) {
-            size_t rep_len = strlen(replacement);
-            if (out_len + rep_len >= out_cap) {
-                break;
-            }
-            memcpy(out + out_len, replacement, rep_len);
-            out_len += rep_len;
-        } else {
-            out[out_len++] = (char)ch;
+        progress = (rc > 0);
+        conn = sg_tcp_conn_find(conn_handle);
+        if (conn == NULL || conn->input_pending) {
+            return progress;
         }
     }
-    out[out_len] = '\0';
-    return out_len;
+    if (g_io_backend != SG_IO_BACKEND_EPOLL) {
+        return progress;
+    }
+    long long io_rc = sg_tcp_connection_drain(conn_handle, max_bytes);
+    if (io_rc < 0) {
+        return io_rc;
+    }
+    return progress || io_rc > 0;
 }
 
-static int sg_build_udp_detail_response(const char* request, char* out, size_t out_cap) {
-    if (request == NULL || out == NULL || out_cap == 0) {
+static long long sg_tcp_run_pending_connections(long long max_bytes) {
+    int count = g_reactor->pending_count;
+    if (count == 0) {
         return 0;
     }
-    if (strncmp(request, "fkGetDetail,", 12) != 0) {
-        return 0;
+    long long progress = 0;
+    long long* handles = g_reactor->pending_handles;
+    g_reactor->pending_handles = NULL;
+    g_reactor->pending_count = 0;
+    g_reactor->pending_cap = 0;
+    for (int i = 0; i < count; i++) {
+        long long rc = sg_tcp_connection_resume(handles[i], max_bytes);
+        if (rc != 0) {
+            progress += 1;
+        }
     }
+    if (g_reactor->pending_handles == NULL) {
+        g_reactor->pending_handles = handles;
+        g_reactor->pending_cap = (count > 256 ? count : 256);
+    } else {
+        free(handles);
+    }
+    return progress;
+}
 
-    const char* requested_tag = request + 12;
-    char escaped_version[96];
-    char escaped_icon[768];
-    char escaped_description[768];
-    char escaped_tag[768];
-    sg_json_escape_copy(sg_server_detail_version(), escaped_version, sizeof(escaped_version));
-    sg_json_escape_copy(sg_server_detail_icon_url(), escaped_icon, sizeof(escaped_icon));
-    sg_json_escape_copy(sg_server_detail_description(), escaped_description, sizeof(escaped_description));
-    sg_json_escape_copy(requested_tag, escaped_tag, sizeof(escaped_tag));
-
-    int capacity = sg_parse_positive_env_i32("SENGOO_SERVER_CAPACITY", 100);
-    int online = sg_count_active_tcp_connections();
-    int written = snprintf(
-        out,
-        out_cap,
-        "[\"%s\",\"%s\",\"%s\",%d,%d,\"%s\"]",
-        escaped_version,
-        escaped_icon,
-        escaped_description,
-        capacity,
-        online,
-        escaped_tag
-    );
-    return written > 0 && written < (int)out_cap;
+static int sg_buffer_pool_stats_interval_ms(void) {
+    int value = sg_parse_positive_env_i32("SENGOO_BUFFER_POOL_STATS_MS", 60000);
+    if (value < 1000) {
+        value = 1000;
+    }
+    return value;
 }
 
-long long sengoo_sleep_ms(long long ms) {
-    if (ms < 0) {
-        ms = 0;
+static void sg_log_broadcast_stats(void) {
+    if (g_reactor->broadcast_count == 0) {
+        return;
     }
-#ifdef _WIN32
-    Sleep((DWORD)ms);
-#else
-    struct timespec req;
-    req.tv_sec = (time_t)(ms / 1000);
-    req.tv_nsec = (long)((ms % 1000) * 1000000L);
-    nanosleep(&req, NULL);
-#endif
-    return 1;
+    sg_logf(
+        "INFO",
+        "NET",
+        "tcp broadcast stats reactor=%d broadcasts=%lld bytes=%lld queued=%lld forwarded=%lld",
+        g_reactor->index,
+        g_reactor->broadcast_count,
+        g_reactor->broadcast_bytes,
+        g_reactor->broadcast_queued,
+        g_reactor->broadcast_forwarded
+    );
+    g_reactor->broadcast_count = 0;
+    g_reactor->broadcast_bytes = 0;
+    g_reactor->broadcast_queued = 0;
+    g_reactor->broadcast_forwarded = 0;
 }
 
-long long sengoo_tcp_listener_bind(long long port) {
-    if (!sg_port_valid(port)) {
-        sg_logf("ERROR", "NET", "tcp bind rejected invalid port=%lld", port);
-        return 0;
+static void sg_tick_buffer_pool_stats(void) {
+    long long now_ms = sg_monotonic_ms();
+    if (g_reactor->buffer_pool_stats_last_ms == 0) {
+        g_reactor->buffer_pool_stats_last_ms = now_ms;
+        return;
     }
-    if (!sg_net_init()) {
-        sg_logf("ERROR", "NET", "tcp bind failed network init error");
-        return 0;
+    if (now_ms - g_reactor->buffer_pool_stats_last_ms < (long long)sg_buffer_pool_stats_interval_ms()) {
+        return;
     }
+    g_reactor->buffer_pool_stats_last_ms = now_ms;
+    sg_log_broadcast_stats();
 
-    sg_socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (s == SG_INVALID_SOCKET) {
-        sg_logf("ERROR", "NET", "tcp socket create failed err=%d", sg_last_socket_error());
-        return 0;
+    long long borrow_total = 0;
+    long long bytes_in_use = 0;
+    long long bytes_cached = 0;
+    for (int i = 0; i < SG_BUFFER_CLASS_COUNT; i++) {
+        borrow_total += g_reactor->buffer_pool[i].borrow_total;
+        bytes_in_use += (long long)g_reactor->buffer_pool[i].borrowed_count * (long long)g_buffer_class_sizes[i];
+        bytes_cached += (long long)g_reactor->buffer_pool[i].free_count * (long long)g_buffer_class_sizes[i];
     }
-
-    int reuse = 1;
-    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, (int)sizeof(reuse));
-
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons((unsigned short)port);
-
-    if (bind(s, (struct sockaddr*)&addr, (int)sizeof(addr)) != 0) {
-        int err = sg_last_socket_error();
-        sg_close_socket(s);
-        sg_logf("ERROR", "NET", "tcp bind failed port=%lld err=%d", port, err);
-        return 0;
+    if (borrow_total == g_reactor->buffer_pool_stats_last_borrow_total) {
+        return;
     }
+    g_reactor->buffer_pool_stats_last_borrow_total = borrow_total;
+    sg_logf(
+        "INFO",
+        "NET",
+        "buffer pool reactor=%d conns=%d in_use=%lldB cached=%lldB 4k=%d/%d/%d 16k=%d/%d/%d 64k=%d/%d/%d",
+        g_reactor->index,
+        g_reactor->connections.active_count,
+        bytes_in_use,
+        bytes_cached,
+        g_reactor->buffer_pool[0].borrowed_count,
+        g_reactor->buffer_pool[0].free_count,
+        g_reactor->buffer_pool[0].peak_borrowed,
+        g_reactor->buffer_pool[1].borrowed_count,
+        g_reactor->buffer_pool[1].free_count,
+        g_reactor->buffer_pool[1].peak_borrowed,
+        g_reactor->buffer_pool[2].borrowed_count,
+        g_reactor->buffer_pool[2].free_count,
+        g_reactor->buffer_pool[2].peak_borrowed
+    );
+}
 
-    if (listen(s, 128) != 0) {
-        int err = sg_last_socket_error();
-        sg_close_socket(s);
-        sg_logf("ERROR", "NET", "tcp listen failed port=%lld err=%d", port, err);
+static long long sg_run_connection_timers(void) {
+    long long now_ms = sg_monotonic_ms();
+    long long closed = 0;
+    sg_timer* timer = NULL;
+    while ((timer = sg_timer_wheel_pop_expired(now_ms)) != NULL) {
+        long long handle = timer->owner;
+        sg_tcp_conn* conn = sg_tcp_conn_find(handle);
+        if (conn == NULL) {
+            continue;
+        }
+        if (timer->kind == SG_TCP_TIMER_LINGER) {
+            sg_logf("INFO", "NET", "tcp close linger expired handle=%lld queued=%u", handle, (unsigned)conn->out_bytes);
+            sg_tcp_conn_close(handle);
+            closed += 1;
+            continue;
+        }
+        if (conn->close_after_flush) {
+            continue;
+        }
+        if (timer->kind == SG_TCP_TIMER_SIGNUP) {
+            if (conn->auth_passed) {
+                continue;
+            }
+            long long age_ms = now_ms - conn->cold.accepted_at_ms;
+            sg_tcp_conn_close(handle);
+            closed += 1;
+            sg_logf(
+                "INFO",
+                "AUTH",
+                "signup timeout close conn=%lld age_ms=%lld timeout_ms=%d",
+                handle,
+                age_ms,
+                sg_auth_signup_timeout_ms()
+            );
+            continue;
+        }
+        if (timer->kind == SG_TCP_TIMER_IDLE) {
+            int idle_timeout_ms = sg_tcp_idle_timeout_ms();
+            if (idle_timeout_ms <= 0) {
+                continue;
+            }
+            long long idle_ms = now_ms - conn->cold.last_activity_ms;
+            if (idle_ms < (long long)idle_timeout_ms) {
+                sg_timer_arm(timer, handle, SG_TCP_TIMER_IDLE, conn->cold.last_activity_ms + idle_timeout_ms);
+                continue;
+            }
+            sg_tcp_conn_close(handle);
+            closed += 1;
+            sg_logf("INFO", "NET", "idle timeout close conn=%lld idle_ms=%lld timeout_ms=%d", handle, idle_ms, idle_timeout_ms);
+        }
+    }
+    return closed;
+}
+
+static int sg_tcp_broadcast_send(sg_tcp_conn* conn, sg_frame* frame) {
+    if (conn == NULL || !conn->auth_passed || conn->close_after_flush) {
         return 0;
     }
-
-    if (!sg_set_nonblocking(s)) {
+    long long conn_handle = conn->handle;
+    if (!sg_tcp_conn_send_frame(conn, frame)) {
         int err = sg_last_socket_error();
-        sg_close_socket(s);
-        sg_logf("ERROR", "NET", "tcp set nonblocking failed port=%lld err=%d", port, err);
+        sg_tcp_conn_close(conn_handle);
+        sg_logf("WARN", "NET", "tcp send failed handle=%lld err=%d", conn_handle, err);
         return 0;
     }
+    return 1;
+}
 
-    long long handle = 0;
-    if (!sg_store_socket(g_tcp_listeners, s, &handle)) {
-        sg_close_socket(s);
-        sg_logf("ERROR", "NET", "tcp listener table full port=%lld", port);
-        return 0;
+static int sg_tcp_broadcast_local(sg_frame* frame, long long only_handle) {
+    if (only_handle > 0) {
+        return sg_tcp_broadcast_send(sg_tcp_conn_find(only_handle), frame);
     }
-    sg_logf("INFO", "NET", "server is ready to listen on [0.0.0.0]:%lld", port);
-    sg_logf("INFO", "NET", "tcp listener bound port=%lld handle=%lld", port, handle);
-    return handle;
+    int queued = 0;
+    for (int i = 0; i < g_reactor->connections.high_water; i++) {
+        queued += sg_tcp_broadcast_send(sg_tcp_conn_at(i), frame);
+    }
+    return queued;
 }
 
-long long sengoo_tcp_listener_accept(long long listener_handle) {
-    sg_socket_entry* listener = sg_find_socket(g_tcp_listeners, listener_handle);
-    if (listener == NULL) {
-        sg_logf("WARN", "NET", "tcp accept invalid listener handle=%lld", listener_handle);
-        return -2;
+static void sg_reactor_stop_accept(void) {
+    if (g_reactor->accept_stopped) {
+        return;
     }
+    g_reactor->accept_stopped = 1;
+    sg_socket_entry* listener = sg_find_socket(&g_tcp_listeners, g_reactor->listener_handle);
+    if (listener != NULL) {
+        sg_poller_remove(listener->socket);
+    }
+}
 
-    struct sockaddr_in peer_addr;
-#ifdef _WIN32
-    int peer_len = (int)sizeof(peer_addr);
+static void sg_reactor_begin_drain(sg_frame* notice) {
+    if (g_reactor->draining) {
+        return;
+    }
+    g_reactor->draining = 1;
+    sg_reactor_stop_accept();
+    int noticed = (notice != NULL ? sg_tcp_broadcast_local(notice, 0) : 0);
+    int draining = 0;
+    for (int i = 0; i < g_reactor->connections.high_water; i++) {
+        sg_tcp_conn* conn = sg_tcp_conn_at(i);
+        if (conn == NULL) {
+            continue;
+        }
+        sg_tcp_conn_close_after_flush(conn->handle);
+        if (sg_tcp_conn_at(i) != NULL) {
+            draining += 1;
+        }
+    }
+    sg_logf("INFO", "NET", "tcp drain started reactor=%d noticed=%d flushing=%d", g_reactor->index, noticed, draining);
+}
+
+static long long sg_reactor_drain_mailbox(void) {
+#if SG_HAVE_REACTOR_THREADS
+    uint64_t signal_value = 0;
+    ssize_t got = read(g_reactor->wake_fd, &signal_value, sizeof(signal_value));
+    (void)got;
+    pthread_mutex_lock(&g_reactor->mailbox_lock);
+    sg_reactor_msg* msg = g_reactor->mailbox_head;
+    g_reactor->mailbox_head = NULL;
+    g_reactor->mailbox_tail = NULL;
+    pthread_mutex_unlock(&g_reactor->mailbox_lock);
+
+    long long handled = 0;
+    while (msg != NULL) {
+        sg_reactor_msg* next = msg->next;
+        if (msg->type == SG_REACTOR_MSG_KICK) {
+            int kicked = sg_kick_duplicate_local_sessions(msg->handle, msg->player_id, msg->player_name);
+            if (kicked > 0) {
+                sg_logf(
+                    "INFO",
+                    "AUTH",
+                    "duplicate session kicked name=%s player_id=%lld kicked=%d reactor=%d",
+                    msg->player_name,
+                    msg->player_id,
+                    kicked,
+                    g_reactor->index
+                );
+            }
+        } else if (msg->type == SG_REACTOR_MSG_CLOSE) {
+            if (sg_tcp_conn_close(msg->handle)) {
+                sg_logf("INFO", "NET", "tcp connection closed handle=%lld", msg->handle);
+            }
+        } else if (msg->type == SG_REACTOR_MSG_STOP) {
+            g_reactor->stopping = 1;
+        } else if (msg->type == SG_REACTOR_MSG_FRAME) {
+            sg_tcp_broadcast_local(msg->frame, msg->handle);
+        } else if (msg->type == SG_REACTOR_MSG_DRAIN) {
+            sg_reactor_begin_drain(msg->frame);
+        } else if (msg->type == SG_REACTOR_MSG_STOP_ACCEPT) {
+            sg_reactor_stop_accept();
+        }
+        sg_frame_release(msg->frame);
+        free(msg);
+        handled += 1;
+        msg = next;
+    }
+    return handled;
 #else
-    socklen_t peer_len = (socklen_t)sizeof(peer_addr);
+    return 0;
 #endif
+}
 
-    sg_socket_t conn = accept(listener->socket, (struct sockaddr*)&peer_addr, &peer_len);
-    if (conn == SG_INVALID_SOCKET) {
-        if (sg_would_block()) {
-            return 0;
+#if SG_HAVE_IO_URING
+static void sg_uring_update_recv(sg_tcp_conn* conn) {
+    if (conn->read_paused) {
+        if (conn->recv_state == SG_URING_RECV_ARMED) {
+            sg_uring_cancel(&g_reactor->uring, (SG_URING_OP_RECV << SG_URING_OP_SHIFT) | ((unsigned long long)conn->handle & SG_URING_TOKEN_MASK));
+            conn->recv_state = SG_URING_RECV_CANCELLING;
         }
-        sg_logf("WARN", "NET", "tcp accept failed listener=%lld err=%d", listener_handle, sg_last_socket_error());
-        return -3;
+        return;
     }
-
-    char peer_ip[64];
-    peer_ip[0] = '\0';
-#ifdef _WIN32
-    InetNtopA(AF_INET, &peer_addr.sin_addr, peer_ip, (DWORD)sizeof(peer_ip));
-#else
-    inet_ntop(AF_INET, &peer_addr.sin_addr, peer_ip, sizeof(peer_ip));
-#endif
-    if (peer_ip[0] == '\0') {
-        strcpy(peer_ip, "unknown");
+    if (conn->recv_state == SG_URING_RECV_IDLE) {
+        sg_uring_arm(g_reactor, conn->socket, conn->handle);
     }
+}
 
-    if (sg_is_ip_banned(peer_ip)) {
-        sg_send_errordlg_and_close(conn, "you have been banned!");
-        sg_close_socket(conn);
-        sg_logf("INFO", "AUTH", "connection refused by ip ban %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
+static long long sg_uring_ingest(sg_tcp_conn* conn, const unsigned char* data, size_t n) {
+    long long conn_handle = conn->handle;
+    if (conn->close_after_flush) {
         return 0;
     }
-    if (sg_is_ip_temp_banned(peer_ip)) {
-        sg_send_errordlg_and_close(conn, "you have been temporarily banned!");
-        sg_close_socket(conn);
-        sg_logf("INFO", "AUTH", "connection refused by temp ip ban %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
-        return 0;
+    size_t buffered = conn->stream_tail - conn->stream_head;
+    if (conn->input_pending && buffered + n > SG_TCP_STREAM_BUFFER_MAX) {
+        long long rc = sg_tcp_conn_process_input(conn, buffered, 0, 1);
+        if (rc < 0) {
+            return rc;
+        }
+        conn = sg_tcp_conn_find(conn_handle);
+        if (conn == NULL || conn->close_after_flush) {
+            return 0;
+        }
+        buffered = conn->stream_tail - conn->stream_head;
+    }
+    if (buffered + n > SG_TCP_STREAM_BUFFER_MAX) {
+        sg_logf("WARN", "PROTO", "tcp stream overflow handle=%lld buffered=%u", conn_handle, (unsigned)buffered);
+        sg_tcp_conn_close(conn_handle);
+        return -5;
+    }
+    size_t incoming = (conn->parse.need > buffered + n ? conn->parse.need - buffered : n);
+    if (!sg_tcp_conn_make_room(conn, incoming)) {
+        sg_logf("WARN", "NET", "tcp stream buffer alloc failed handle=%lld buffered=%u", conn_handle, (unsigned)buffered);
+        sg_tcp_conn_close(conn_handle);
+        return -6;
+    }
+    memcpy(conn->stream_data + conn->stream_tail, data, n);
+    conn->stream_tail += n;
+    if (conn->input_pending && conn->pending_queued) {
+        return (long long)n;
+    }
+    return sg_tcp_conn_process_input(conn, n, buffered == 0, 0);
+}
+
+static long long sg_uring_on_accept(long long listener_handle, int res, int more) {
+    long long progress = 0;
+    if (res >= 0 && g_reactor->accept_stopped) {
+        close(res);
+    } else if (res >= 0) {
+        struct sockaddr_in peer_addr;
+        socklen_t peer_len = (socklen_t)sizeof(peer_addr);
+        memset(&peer_addr, 0, sizeof(peer_addr));
+        if (getpeername(res, (struct sockaddr*)&peer_addr, &peer_len) != 0) {
+            int err = errno;
+            close(res);
+            if (err != ENOTCONN) {
+                sg_logf("WARN", "NET", "tcp accept peer lookup failed listener=%lld err=%d", listener_handle, err);
+            }
+        } else if (sg_tcp_admit_connection(listener_handle, res, &peer_addr, 1) > 0) {
+            progress = 1;
+        }
+    } else if (res != -ECANCELED) {
+        sg_logf("WARN", "NET", "tcp accept failed listener=%lld err=%d", listener_handle, -res);
     }
+    if (!more && res != -ECANCELED && !g_reactor->accept_stopped) {
+        sg_socket_entry* listener = sg_find_socket(&g_tcp_listeners, listener_handle);
+        if (listener != NULL) {
+            sg_uring_arm(g_reactor, listener->socket, listener_handle);
+        }
+    }
+    return progress;
+}
 
-    int capacity = sg_runtime_server_capacity();
-    int active_count = sg_count_active_tcp_connections();
-    if (active_count >= capacity) {
-        sg_send_errordlg_and_close(conn, "server is full!");
-        sg_close_socket(conn);
-        sg_logf(
-            "INFO",
-            "AUTH",
-            "connection refused by capacity %s:%d active=%d capacity=%d",
-            peer_ip,
-            (int)ntohs(peer_addr.sin_port),
-            active_count,
-            capacity
-        );
-        return 0;
+static long long sg_uring_on_recv(sg_uring* ring, long long conn_handle, const struct io_uring_cqe* cqe) {
+    int has_buffer = ((cqe->flags & IORING_CQE_F_BUFFER) != 0);
+    unsigned short bid = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    long long io_rc = 0;
+    sg_tcp_conn* conn = sg_tcp_conn_find(conn_handle);
+    if (conn != NULL) {
+        if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+            conn->recv_state = SG_URING_RECV_IDLE;
+        }
+        if (cqe->res > 0 && has_buffer) {
+            io_rc = sg_uring_ingest(conn, ring->buf_base + (size_t)bid * SG_URING_BUF_SIZE, (size_t)cqe->res);
+        } else if (cqe->res == 0) {
+            sg_tcp_conn_close(conn_handle);
+            sg_logf("INFO", "NET", "client disconnected (conn=%lld)", conn_handle);
+            io_rc = -3;
+        } else if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+            sg_tcp_conn_close(conn_handle);
+            sg_logf("WARN", "NET", "tcp recv failed handle=%lld err=%d", conn_handle, -cqe->res);
+            io_rc = -5;
+        }
+    }
+    if (has_buffer) {
+        sg_uring_buf_recycle(ring, bid);
     }
+    conn = sg_tcp_conn_find(conn_handle);
+    if (conn != NULL) {
+        sg_uring_update_recv(conn);
+    }
+    return io_rc != 0 ? 1 : 0;
+}
 
-    long long sync_bytes = sg_send_extension_sync_payload(conn);
-    if (sync_bytes > 0) {
-        sg_logf("INFO", "EXT", "extension sync -> %s:%d bytes=%lld", peer_ip, (int)ntohs(peer_addr.sin_port), sync_bytes);
-    } else if (sync_bytes < 0) {
-        sg_logf("WARN", "EXT", "extension sync send failed -> %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
+static long long sg_uring_on_send(sg_tcp_conn* conn, int res) {
+    conn->send_inflight = 0;
+    if (conn->handle == 0) {
+        g_reactor->send_orphans -= 1;
+        sg_tcp_conn_free_output(conn);
+        free(conn);
+        return 0;
     }
-    int network_delay_sent = 0;
-    if (sg_should_send_network_delay()) {
-        if (!sg_send_network_delay_test(conn)) {
-            sg_logf("WARN", "AUTH", "network delay test send failed -> %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
-        } else {
-            sg_logf("INFO", "AUTH", "network delay test -> %s:%d", peer_ip, (int)ntohs(peer_addr.sin_port));
-            network_delay_sent = 1;
+    long long conn_handle = conn->handle;
+    if (res < 0) {
+        if (res == -EINTR || res == -EAGAIN) {
+            sg_uring_queue_flush(conn);
+            return 0;
         }
+        sg_tcp_conn_close(conn_handle);
+        sg_logf("WARN", "NET", "tcp send failed handle=%lld err=%d", conn_handle, -res);
+        return 1;
     }
-
-    if (!sg_set_nonblocking(conn)) {
-        int err = sg_last_socket_error();
-        sg_close_socket(conn);
-        sg_logf("WARN", "NET", "tcp accept set nonblocking failed listener=%lld err=%d", listener_handle, err);
-        return -4;
+    sg_tcp_conn_consume_output(conn, (size_t)res);
+    if (conn->out_head != NULL) {
+        sg_uring_queue_flush(conn);
+    }
+    if (conn->close_after_flush) {
+        if (conn->out_head == NULL && !conn->write_shut) {
+            sg_tcp_conn_finish_flushed(conn_handle);
+        }
+        return 1;
+    }
+    if (conn->read_paused && conn->out_bytes <= g_tcp_send_low_watermark) {
+        conn->read_paused = 0;
+        sg_logf("INFO", "NET", "tcp send backpressure released handle=%lld queued=%u", conn_handle, (unsigned)conn->out_bytes);
+        sg_uring_update_recv(conn);
     }
+    return 1;
+}
 
-    long long handle = 0;
-    if (!sg_store_socket(g_tcp_connections, conn, &handle)) {
-        sg_close_socket(conn);
-        sg_logf("WARN", "NET", "tcp connection table full listener=%lld", listener_handle);
-        return -5;
+static long long sg_uring_on_poll(long long token, int res, int more) {
+    long long progress = 0;
+    if (token == SG_REACTOR_WAKE_TOKEN) {
+        progress = sg_reactor_drain_mailbox();
     }
-    if (!sg_tcp_stream_attach(handle)) {
-        sg_auth_state_detach(handle);
-        sg_remove_socket(g_tcp_connections, handle, 1);
-        sg_logf("WARN", "NET", "tcp stream table full listener=%lld conn=%lld", listener_handle, handle);
-        return -6;
+    if (more || res == -ECANCELED) {
+        return progress;
     }
-    if (!sg_auth_state_attach(handle)) {
-        sg_tcp_stream_detach(handle);
-        sg_remove_socket(g_tcp_connections, handle, 1);
-        sg_logf("WARN", "AUTH", "auth state table full listener=%lld conn=%lld", listener_handle, handle);
-        return -7;
+#if SG_HAVE_REACTOR_THREADS
+    if (token == SG_REACTOR_WAKE_TOKEN) {
+        sg_uring_arm(g_reactor, g_reactor->wake_fd, token);
+        return progress;
     }
-    sg_auth_state* auth_state = sg_auth_state_find(handle);
-    if (auth_state != NULL) {
-        auth_state->network_delay_sent = network_delay_sent;
+#endif
+    sg_socket_entry* sock = sg_find_socket(&g_udp_sockets, token);
+    if (sock != NULL) {
+        sg_uring_arm(g_reactor, sock->socket, token);
     }
+    return progress;
+}
 
-    sg_logf(
-        "INFO",
-        "NET",
-        "client %s:%d connected (conn=%lld listener=%lld)",
-        peer_ip,
-        (int)ntohs(peer_addr.sin_port),
-        handle,
-        listener_handle
-    );
+static long long sg_uring_reap(void) {
+    sg_uring* ring = &g_reactor->uring;
+    long long progress_count = 0;
+    unsigned int head = *ring->cq_head;
+    unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe cqe = ring->cqes[head & *ring->cq_mask];
+        head += 1;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        unsigned long long op = cqe.user_data >> SG_URING_OP_SHIFT;
+        long long token = (long long)(cqe.user_data & SG_URING_TOKEN_MASK);
+        int more = ((cqe.flags & IORING_CQE_F_MORE) != 0);
+        if (op == SG_URING_OP_ACCEPT) {
+            progress_count += sg_uring_on_accept(token, cqe.res, more);
+        } else if (op == SG_URING_OP_RECV) {
+            progress_count += sg_uring_on_recv(ring, token, &cqe);
+        } else if (op == SG_URING_OP_SEND) {
+            progress_count += sg_uring_on_send((sg_tcp_conn*)(uintptr_t)token, cqe.res);
+        } else if (op == SG_URING_OP_POLL) {
+            progress_count += sg_uring_on_poll(token, cqe.res, more);
+        }
+    }
+    return progress_count;
+}
 
-    return handle;
+static void sg_uring_submit_sends(void) {
+    sg_uring* ring = &g_reactor->uring;
+    for (int i = 0; i < ring->flush_count; i++) {
+        sg_tcp_conn* conn = sg_tcp_conn_find(ring->flush_handles[i]);
+        if (conn == NULL) {
+            continue;
+        }
+        conn->flush_queued = 0;
+        if (conn->send_inflight || conn->out_head == NULL) {
+            continue;
+        }
+        struct io_uring_sqe* sqe = sg_uring_sqe(ring);
+        if (sqe == NULL) {
+            break;
+        }
+        sg_out_chunk* chunk = conn->out_head;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn->socket;
+        sqe->addr = (unsigned long long)(uintptr_t)(chunk->base + chunk->offset);
+        sqe->len = (unsigned int)(chunk->len - chunk->offset);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = (SG_URING_OP_SEND << SG_URING_OP_SHIFT) | (unsigned long long)(uintptr_t)conn;
+        conn->send_inflight = 1;
+    }
+    ring->flush_count = 0;
+    sg_uring_submit(ring);
+}
+
+static long long sg_uring_wait(long long timeout_ms) {
+    sg_uring* ring = &g_reactor->uring;
+    unsigned int ready = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) - *ring->cq_head;
+    if (ready > 0 && ring->sq_unsubmitted == 0) {
+        return (long long)ready;
+    }
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (unsigned long long)(uintptr_t)&ts;
+    unsigned int min_complete = (ready > 0 || timeout_ms == 0 ? 0 : 1);
+    int rc = sg_uring_enter(ring, ring->sq_unsubmitted, min_complete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (rc >= 0) {
+        ring->sq_unsubmitted -= (unsigned int)rc;
+    } else if (errno != ETIME && errno != EINTR) {
+        sg_logf("WARN", "NET", "io_uring wait failed err=%d", errno);
+    }
+    return (long long)(__atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) - *ring->cq_head);
+}
+
+static void sg_uring_settle_sends(void) {
+    sg_uring* ring = &g_reactor->uring;
+    long long deadline_ms = sg_monotonic_ms() + SG_URING_SETTLE_MS;
+    while (g_reactor->send_orphans > 0 && sg_monotonic_ms() < deadline_ms) {
+        sg_uring_wait(10);
+        unsigned int head = *ring->cq_head;
+        unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe cqe = ring->cqes[head & *ring->cq_mask];
+            head += 1;
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+            unsigned long long op = cqe.user_data >> SG_URING_OP_SHIFT;
+            if (op == SG_URING_OP_SEND) {
+                sg_uring_on_send((sg_tcp_conn*)(uintptr_t)(cqe.user_data & SG_URING_TOKEN_MASK), cqe.res);
+            } else if (op == SG_URING_OP_ACCEPT && cqe.res >= 0) {
+                close(cqe.res);
+            } else if (op == SG_URING_OP_RECV && (cqe.flags & IORING_CQE_F_BUFFER) != 0) {
+                sg_uring_buf_recycle(ring, (unsigned short)(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+        }
+    }
+    if (g_reactor->send_orphans > 0) {
+        sg_logf("WARN", "NET", "io_uring sends still in flight after close orphans=%d", g_reactor->send_orphans);
+    }
 }
+#endif
 
-long long sengoo_tcp_connection_echo_once(long long conn_handle, long long max_bytes) {
-    sg_socket_entry* conn = sg_find_socket(g_tcp_connections, conn_handle);
-    if (conn == NULL) {
-        sg_logf("WARN", "NET", "tcp echo invalid connection handle=%lld", conn_handle);
+long long sengoo_tcp_runtime_step(long long listener_handle, long long max_bytes, long long max_accept_per_tick) {
+    sg_socket_entry* listener = sg_find_socket(&g_tcp_listeners, listener_handle);
+    if (listener == NULL) {
+        sg_logf("WARN", "NET", "tcp runtime step invalid listener handle=%lld", listener_handle);
         return -2;
     }
-
-    size_t cap = sg_buffer_size(max_bytes);
-    char* buffer = (char*)malloc(cap);
-    if (buffer == NULL) {
-        return -6;
+    (void)listener;
+    if (g_reactor->index == 0) {
+        sg_tick_extension_sync_refresh();
+        sg_handoff_tick();
     }
+    sg_tick_buffer_pool_stats();
+    g_reactor->tick_seq += 1;
 
-    int n = recv(conn->socket, buffer, (int)cap, 0);
-    if (n == 0) {
-        free(buffer);
-        sg_tcp_stream_detach(conn_handle);
-        sg_auth_state_detach(conn_handle);
-        sg_remove_socket(g_tcp_connections, conn_handle, 1);
-        sg_logf("INFO", "NET", "client disconnected (conn=%lld)", conn_handle);
-        return -3;
-    }
-    if (n < 0) {
-        if (sg_would_block()) {
-            free(buffer);
-            return 0;
-        }
-        int err = sg_last_socket_error();
-        free(buffer);
-        sg_tcp_stream_detach(conn_handle);
-        sg_auth_state_detach(conn_handle);
-        sg_remove_socket(g_tcp_connections, conn_handle, 1);
-        sg_logf("WARN", "NET", "tcp recv failed handle=%lld err=%d", conn_handle, err);
-        return -5;
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        long long uring_progress = sg_tcp_run_pending_connections(max_bytes);
+        uring_progress += sg_uring_reap();
+        uring_progress += sg_run_connection_timers();
+        sg_uring_submit_sends();
+        return uring_progress;
     }
+#endif
 
-    sg_tcp_stream_state* stream = sg_tcp_stream_find(conn_handle);
-    if (stream == NULL && !sg_tcp_stream_attach(conn_handle)) {
-        int sent_total = 0;
-        while (sent_total < n) {
-            int sent = send(conn->socket, buffer + sent_total, n - sent_total, 0);
-            if (sent <= 0) {
-                int err = sg_last_socket_error();
-                free(buffer);
-                sg_tcp_stream_detach(conn_handle);
-                sg_auth_state_detach(conn_handle);
-                sg_remove_socket(g_tcp_connections, conn_handle, 1);
-                sg_logf("WARN", "NET", "tcp send failed handle=%lld err=%d", conn_handle, err);
-                return -4;
+    long long accept_base = max_accept_per_tick;
+    if (accept_base <= 0) {
+        accept_base = 1;
+    } else if (accept_base > 128) {
+        accept_base = 128;
+    }
+    if (g_reactor->accept_budget < accept_base) {
+        g_reactor->accept_budget = accept_base;
+    }
+    long long accept_budget = g_reactor->accept_budget;
+
+    int listener_ready = 1;
+    int mailbox_ready = 0;
+    int ready_count = 0;
+#if SG_HAVE_EPOLL
+    if (g_io_backend == SG_IO_BACKEND_EPOLL) {
+        listener_ready = 0;
+        if (g_reactor->epoll_ready_pending) {
+            ready_count = g_reactor->epoll_ready_count;
+            g_reactor->epoll_ready_pending = 0;
+        } else {
+            ready_count = epoll_wait(g_reactor->epoll_fd, g_reactor->epoll_events, SG_EPOLL_EVENT_BATCH, 0);
+        }
+        if (ready_count < 0) {
+            if (errno != EINTR) {
+                sg_logf("WARN", "NET", "epoll wait failed err=%d", errno);
+            }
+            ready_count = 0;
+        }
+        for (int i = 0; i < ready_count; i++) {
+            long long token = (long long)g_reactor->epoll_events[i].data.u64;
+            if (token == listener_handle) {
+                listener_ready = 1;
+            } else if (token == SG_REACTOR_WAKE_TOKEN) {
+                mailbox_ready = 1;
             }
-            sent_total += sent;
         }
-        free(buffer);
-        sg_logf("INFO", "NET", "tcp echo fallback handle=%lld bytes=%d", conn_handle, n);
-        return (long long)n;
-    }
-    stream = sg_tcp_stream_find(conn_handle);
-    if (stream == NULL) {
-        free(buffer);
-        sg_tcp_stream_detach(conn_handle);
-        sg_auth_state_detach(conn_handle);
-        sg_remove_socket(g_tcp_connections, conn_handle, 1);
-        return -6;
     }
+#endif
 
-    int stream_was_empty = (stream->len == 0);
-    if (stream->len + (size_t)n > SG_TCP_STREAM_BUFFER_MAX) {
-        if (!stream_was_empty) {
-            free(buffer);
-            sg_logf("WARN", "PROTO", "tcp stream overflow handle=%lld buffered=%u incoming=%d", conn_handle, (unsigned)stream->len, n);
-            sg_tcp_stream_detach(conn_handle);
-            sg_auth_state_detach(conn_handle);
-            sg_remove_socket(g_tcp_connections, conn_handle, 1);
-            return -5;
+    long long progress_count = 0;
+    if (mailbox_ready) {
+        progress_count += sg_reactor_drain_mailbox();
+    }
+    long long accept_attempts = 0;
+    int accept_drained = 0;
+    while (listener_ready && !g_reactor->accept_stopped && accept_attempts < accept_budget) {
+        int would_block = 0;
+        long long accept_rc = sg_tcp_listener_accept_one(listener_handle, &would_block);
+        if (would_block) {
+            accept_drained = 1;
+            break;
+        }
+        accept_attempts += 1;
+        if (accept_rc > 0) {
+            progress_count += 1;
+            continue;
+        }
+        if (accept_rc == 0) {
+            continue;
+        }
+        if (accept_rc == -2) {
+            return -2;
+        }
+        accept_drained = 1;
+        break;
+    }
+    if (listener_ready && !g_reactor->accept_stopped && !accept_drained && accept_budget < SG_ACCEPT_BUDGET_MAX) {
+        g_reactor->accept_budget = accept_budget * 2;
+        if (g_reactor->accept_budget > SG_ACCEPT_BUDGET_MAX) {
+            g_reactor->accept_budget = SG_ACCEPT_BUDGET_MAX;
+        }
+        sg_logf("INFO", "NET", "tcp accept budget raised reactor=%d budget=%lld", g_reactor->index, g_reactor->accept_budget);
+    } else if (accept_drained && accept_budget > accept_base && accept_attempts < accept_budget / 4) {
+        g_reactor->accept_budget = accept_budget / 2;
+        if (g_reactor->accept_budget < accept_base) {
+            g_reactor->accept_budget = accept_base;
         }
-        stream->len = 0;
     }
-    memcpy(stream->data + stream->len, buffer, (size_t)n);
-    stream->len += (size_t)n;
 
-    int parsed_count = 0;
-    int parse_status = 0;
-    int close_requested = 0;
-    while (stream->len > 0) {
-        sg_cbor_wire_packet packet;
-        size_t consumed = 0;
-        int parse_rc = sg_cbor_parse_wire_packet(stream->data, stream->len, &packet, &consumed);
-        if (parse_rc == 1) {
-            if (consumed == 0 || consumed > stream->len) {
-                parse_status = -1;
-                break;
+    progress_count += sg_tcp_run_pending_connections(max_bytes);
+
+#if SG_HAVE_EPOLL
+    if (g_io_backend == SG_IO_BACKEND_EPOLL) {
+        int first_event = (ready_count > 0 ? (int)(g_reactor->tick_seq % ready_count) : 0);
+        for (int k = 0; k < ready_count; k++) {
+            int i = (first_event + k) % ready_count;
+            long long conn_handle = (long long)g_reactor->epoll_events[i].data.u64;
+            uint32_t events = g_reactor->epoll_events[i].events;
+            if (conn_handle == listener_handle || conn_handle == SG_REACTOR_WAKE_TOKEN) {
+                continue;
             }
-            int handle_rc = sg_handle_cbor_wire_packet(conn_handle, conn->socket, &packet);
-            if (handle_rc == -2) {
-                close_requested = 1;
-                parse_status = -2;
-                break;
+            sg_tcp_conn* conn = sg_tcp_conn_find(conn_handle);
+            if (conn == NULL) {
+                continue;
             }
-            if (handle_rc <= 0) {
-                parse_status = -1;
-                break;
+            int resume_read = 0;
+            if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0 && conn->out_head != NULL) {
+                long long flush_rc = sg_tcp_connection_flush(conn_handle);
+                if (flush_rc != 0) {
+                    progress_count += 1;
+                }
+                if (flush_rc < 0) {
+                    continue;
+                }
+                resume_read = (flush_rc > 0);
             }
-            if (consumed < stream->len) {
-                memmove(stream->data, stream->data + consumed, stream->len - consumed);
-                stream->len -= consumed;
-            } else {
-                stream->len = 0;
+            if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) == 0 && !resume_read) {
+                continue;
             }
-            parsed_count += 1;
+            long long io_rc = sg_tcp_connection_drain(conn_handle, max_bytes);
+            if (io_rc > 0) {
+                progress_count += 1;
+            } else if (io_rc == -3 || io_rc == -4 || io_rc == -5 || io_rc == -6) {
+                progress_count += 1;
+            }
+        }
+    }
+#endif
+    int scan_count = (g_io_backend == SG_IO_BACKEND_SCAN ? g_reactor->connections.high_water : 0);
+    int first_slot = (scan_count > 0 ? (int)(g_reactor->tick_seq % scan_count) : 0);
+    for (int k = 0; k < scan_count; k++) {
+        sg_tcp_conn* conn = sg_tcp_conn_at((first_slot + k) % scan_count);
+        if (conn == NULL) {
             continue;
         }
-        if (parse_rc == 0) {
-            parse_status = 1;
-            break;
+        long long conn_handle = conn->handle;
+        if (conn->out_head != NULL) {
+            long long flush_rc = sg_tcp_connection_flush(conn_handle);
+            if (flush_rc != 0) {
+                progress_count += 1;
+            }
+            if (flush_rc < 0) {
+                continue;
+            }
+        }
+        if (conn->input_pending) {
+            continue;
+        }
+        long long io_rc = sengoo_tcp_connection_echo_once(conn_handle, max_bytes);
+        if (io_rc > 0) {
+            progress_count += 1;
+        } else if (io_rc == -3 || io_rc == -4 || io_rc == -5 || io_rc == -6) {
+            progress_count += 1;
         }
-        parse_status = -1;
-        break;
     }
 
-    if (parsed_count > 0) {
-        free(buffer);
-        return (long long)n;
+    long long timeout_closed = sg_run_connection_timers();
+    if (timeout_closed > 0) {
+        progress_count += timeout_closed;
     }
 
-    if (parse_status == 1) {
-        free(buffer);
-        return 0;
+    return progress_count;
+}
+
+long long sengoo_tcp_connection_count(void) {
+    return (long long)SG_ATOMIC_LOAD(&g_tcp_active_total);
+}
+
+long long sengoo_tcp_connection_peak(void) {
+    return (long long)SG_ATOMIC_LOAD(&g_tcp_peak_total);
+}
+
+long long sengoo_tcp_outbound_queued_bytes(void) {
+    size_t total = 0;
+    for (int i = 0; i < g_reactor_count; i++) {
+        total += SG_ATOMIC_LOAD(&g_reactors[i].out_queued_bytes);
     }
+    return (long long)total;
+}
 
-    if (close_requested || parse_status == -2) {
-        free(buffer);
-        sg_tcp_stream_detach(conn_handle);
-        sg_auth_state_detach(conn_handle);
-        sg_remove_socket(g_tcp_connections, conn_handle, 1);
-        sg_logf("INFO", "AUTH", "connection closed by auth policy handle=%lld", conn_handle);
-        return -5;
+long long sengoo_tcp_outbound_high_watermark(void) {
+    sg_tcp_send_limits_init();
+    return (long long)g_tcp_send_high_watermark;
+}
+
+long long sengoo_tcp_outbound_low_watermark(void) {
+    sg_tcp_send_limits_init();
+    return (long long)g_tcp_send_low_watermark;
+}
+
+static long long sg_runtime_next_deadline_ms(void) {
+    long long deadline_ms = 0;
+    if (g_reactor->index == 0 && g_extension_sync_refresh_last_ms > 0) {
+        deadline_ms = g_extension_sync_refresh_last_ms + (long long)sg_extension_sync_refresh_interval_ms();
     }
+    long long timer_deadline_ms = sg_timer_wheel_next_expiry_ms();
+    if (timer_deadline_ms > 0 && (deadline_ms == 0 || timer_deadline_ms < deadline_ms)) {
+        deadline_ms = timer_deadline_ms;
+    }
+    return deadline_ms;
+}
 
-    if (!stream_was_empty) {
-        free(buffer);
-        sg_logf("WARN", "PROTO", "tcp stream malformed frame handle=%lld", conn_handle);
-        sg_tcp_stream_detach(conn_handle);
-        sg_auth_state_detach(conn_handle);
-        sg_remove_socket(g_tcp_connections, conn_handle, 1);
-        return -5;
+long long sengoo_runtime_wait(long long timeout_ms) {
+    if (timeout_ms < 0) {
+        timeout_ms = 0;
+    }
+    if (g_reactor->pending_count > 0) {
+        timeout_ms = 0;
+    }
+    long long deadline_ms = sg_runtime_next_deadline_ms();
+    if (deadline_ms > 0) {
+        long long until_deadline_ms = deadline_ms - sg_monotonic_ms();
+        if (until_deadline_ms < 0) {
+            until_deadline_ms = 0;
+        }
+        if (until_deadline_ms < timeout_ms) {
+            timeout_ms = until_deadline_ms;
+        }
     }
 
-    stream->len = 0;
-    if (!sg_send_all(conn->socket, (const unsigned char*)buffer, (size_t)n)) {
-        int err = sg_last_socket_error();
-        free(buffer);
-        sg_tcp_stream_detach(conn_handle);
-        sg_auth_state_detach(conn_handle);
-        sg_remove_socket(g_tcp_connections, conn_handle, 1);
-        sg_logf("WARN", "NET", "tcp send failed handle=%lld err=%d", conn_handle, err);
-        return -4;
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING) {
+        return sg_uring_wait(timeout_ms);
     }
+#endif
+#if SG_HAVE_EPOLL
+    if (g_io_backend == SG_IO_BACKEND_EPOLL) {
+        if (g_reactor->epoll_ready_pending) {
+            return (long long)g_reactor->epoll_ready_count;
+        }
+        int ready_count = epoll_wait(g_reactor->epoll_fd, g_reactor->epoll_events, SG_EPOLL_EVENT_BATCH, (int)timeout_ms);
+        if (ready_count < 0) {
+            if (errno != EINTR) {
+                sg_logf("WARN", "NET", "epoll wait failed err=%d", errno);
+            }
+            return 0;
+        }
+        g_reactor->epoll_ready_count = ready_count;
+        g_reactor->epoll_ready_pending = (ready_count > 0);
+        return (long long)ready_count;
+    }
+#endif
 
-    free(buffer);
-    sg_logf("INFO", "NET", "tcp echo handle=%lld bytes=%d", conn_handle, n);
-    return (long long)n;
+    long long tick_sleep_ms = sengoo_runtime_tick_sleep_ms();
+    if (timeout_ms > tick_sleep_ms) {
+        timeout_ms = tick_sleep_ms;
+    }
+    if (timeout_ms > 0) {
+        sengoo_sleep_ms(timeout_ms);
+    }
+    return 0;
 }
 
-static long long sg_close_expired_auth_connections(void) {
-    long long now_ms = sg_monotonic_ms();
-    int timeout_ms = sg_auth_signup_timeout_ms();
+static long long sg_reactor_close_connections(void) {
     long long closed = 0;
-
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (!g_tcp_connections[i].used) {
-            continue;
-        }
-        long long handle = g_tcp_connections[i].handle;
-        sg_auth_state* auth_state = sg_auth_state_find(handle);
-        if (auth_state == NULL || auth_state->auth_passed) {
-            continue;
-        }
-        if (auth_state->accepted_at_ms <= 0) {
+    for (int i = 0; i < g_reactor->connections.high_water; i++) {
+        sg_tcp_conn* conn = sg_tcp_conn_at(i);
+        if (conn == NULL) {
             continue;
         }
-        long long age_ms = now_ms - auth_state->accepted_at_ms;
-        if (age_ms < (long long)timeout_ms) {
-            continue;
+        if (sg_tcp_conn_close(conn->handle)) {
+            closed += 1;
         }
+    }
+#if SG_HAVE_IO_URING
+    if (g_io_backend == SG_IO_BACKEND_URING && g_reactor->send_orphans > 0) {
+        sg_uring_settle_sends();
+    }
+#endif
+    return closed;
+}
 
-        sg_remove_socket(g_tcp_connections, handle, 1);
-        sg_tcp_stream_detach(handle);
-        sg_auth_state_detach(handle);
-        closed += 1;
+#if SG_HAVE_REACTOR_THREADS
+static void* sg_reactor_thread_main(void* arg) {
+    sg_reactor* reactor = (sg_reactor*)arg;
+    g_reactor = reactor;
+    long long max_bytes = sengoo_runtime_max_packet_bytes();
+    long long max_accept_per_tick = sengoo_runtime_max_accept_per_tick();
+    long long idle_wait_ms = sengoo_runtime_idle_wait_ms();
+    sg_logf("INFO", "NET", "reactor %d started listener=%lld", reactor->index, reactor->listener_handle);
+    while (!reactor->stopping) {
+        long long step_rc = sengoo_tcp_runtime_step(reactor->listener_handle, max_bytes, max_accept_per_tick);
+        sengoo_runtime_wait(step_rc > 0 ? 0 : idle_wait_ms);
+    }
+    reactor->closed_on_stop = sg_reactor_close_connections();
+    sg_logf("INFO", "NET", "reactor %d stopped closed=%lld", reactor->index, reactor->closed_on_stop);
+    return NULL;
+}
+#endif
 
-        sg_logf(
-            "INFO",
-            "AUTH",
-            "signup timeout close conn=%lld age_ms=%lld timeout_ms=%d",
-            handle,
-            age_ms,
-            timeout_ms
-        );
+static long long sg_reactors_stop(void) {
+    long long closed = 0;
+#if SG_HAVE_REACTOR_THREADS
+    if (g_reactor_count <= 1) {
+        return 0;
     }
-
+    for (int i = 1; i < g_reactor_count; i++) {
+        sg_reactor_post(i, SG_REACTOR_MSG_STOP, 0, 0, NULL, NULL);
+    }
+    for (int i = 1; i < g_reactor_count; i++) {
+        sg_reactor* reactor = &g_reactors[i];
+        if (reactor->thread_started) {
+            pthread_join(reactor->thread, NULL);
+            reactor->thread_started = 0;
+            closed += reactor->closed_on_stop;
+        }
+        free(reactor->connections.slots);
+        free(reactor->pending_handles);
+        reactor->pending_handles = NULL;
+        reactor->pending_count = 0;
+        reactor->pending_cap = 0;
+        sg_reactor_poller_close(reactor);
+        sg_remove_socket(&g_tcp_listeners, reactor->listener_handle, 1);
+        sg_reactor_close_mailbox(reactor);
+    }
+    sg_poller_remove(g_reactors[0].wake_fd);
+    sg_reactor_close_mailbox(&g_reactors[0]);
+    g_reactor_count = 1;
+#endif
     return closed;
 }
 
-long long sengoo_tcp_runtime_step(long long listener_handle, long long max_bytes, long long max_accept_per_tick) {
-    sg_socket_entry* listener = sg_find_socket(g_tcp_listeners, listener_handle);
-    if (listener == NULL) {
-        sg_logf("WARN", "NET", "tcp runtime step invalid listener handle=%lld", listener_handle);
-        return -2;
+static long long sg_runtime_drain_connections(void) {
+    long long active = (long long)SG_ATOMIC_LOAD(&g_tcp_active_total);
+    if (active <= 0 || g_reactor->draining) {
+        return 0;
     }
-    (void)listener;
-    sg_tick_extension_sync_refresh();
-
-    long long accept_budget = max_accept_per_tick;
-    if (accept_budget <= 0) {
-        accept_budget = 1;
-    } else if (accept_budget > 128) {
-        accept_budget = 128;
+    int drain_ms = sg_parse_positive_env_i32("SENGOO_SHUTDOWN_DRAIN_MS", 3000);
+    if (g_shutdown_console_close && drain_ms > SG_CONSOLE_CLOSE_DRAIN_MS) {
+        drain_ms = SG_CONSOLE_CLOSE_DRAIN_MS;
     }
-
-    long long progress_count = 0;
-    for (long long i = 0; i < accept_budget; i++) {
-        long long accept_rc = sengoo_tcp_listener_accept(listener_handle);
-        if (accept_rc > 0) {
-            progress_count += 1;
-            continue;
+    const char* text = getenv("SENGOO_SHUTDOWN_MESSAGE");
+    if (text == NULL || text[0] == '\0') {
+        text = "server is shutting down";
+    }
+    sg_frame* notice = sg_frame_server_notification("ServerMessage", (const unsigned char*)text, strlen(text), 2);
+    for (int i = 0; i < g_reactor_count; i++) {
+        if (i != g_reactor->index) {
+            sg_reactor_post(i, SG_REACTOR_MSG_DRAIN, 0, 0, NULL, notice);
         }
-        if (accept_rc == 0) {
+    }
+    sg_reactor_begin_drain(notice);
+    sg_frame_release(notice);
+
+    long long started_ms = sg_monotonic_ms();
+    long long deadline_ms = started_ms + drain_ms;
+    long long max_bytes = sengoo_runtime_max_packet_bytes();
+    while (SG_ATOMIC_LOAD(&g_tcp_active_total) > 0) {
+        long long remaining_ms = deadline_ms - sg_monotonic_ms();
+        if (remaining_ms <= 0) {
             break;
         }
-        if (accept_rc == -2) {
-            return -2;
+        long long step_rc = sengoo_tcp_runtime_step(g_reactor->listener_handle, max_bytes, 1);
+        if (step_rc < 0) {
+            break;
         }
-        break;
+        sengoo_runtime_wait(step_rc > 0 ? 0 : (remaining_ms < 50 ? remaining_ms : 50));
+    }
+    long long remaining = (long long)SG_ATOMIC_LOAD(&g_tcp_active_total);
+    sg_logf(
+        "INFO",
+        "NET",
+        "tcp drain finished drained=%lld remaining=%lld elapsed_ms=%lld",
+        active - remaining,
+        remaining,
+        sg_monotonic_ms() - started_ms
+    );
+    return active - remaining;
+}
+
+static long long sg_command_count_total(int command_id) {
+    long long total = 0;
+    for (int i = 0; i < SG_MAX_REACTORS; i++) {
+        total += SG_ATOMIC_LOAD(&g_reactors[i].command_counts[command_id]);
     }
+    return total;
+}
 
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (!g_tcp_connections[i].used) {
+static void sg_log_command_counts(void) {
+    char line[1024];
+    size_t used = 0;
+    line[0] = '\0';
+    for (int i = 0; i < SG_COMMAND_COUNT && used < sizeof(line); i++) {
+        long long count = sg_command_count_total(i);
+        if (count <= 0) {
             continue;
         }
-        long long conn_handle = g_tcp_connections[i].handle;
-        long long io_rc = sengoo_tcp_connection_echo_once(conn_handle, max_bytes);
-        if (io_rc > 0) {
-            progress_count += 1;
-        } else if (io_rc == -3 || io_rc == -4 || io_rc == -5 || io_rc == -6) {
-            progress_count += 1;
+        int n = snprintf(line + used, sizeof(line) - used, " %s=%lld", i == SG_COMMAND_UNKNOWN ? "unknown" : g_command_names[i], count);
+        if (n < 0) {
+            break;
         }
+        used += (size_t)n;
     }
-
-    long long timeout_closed = sg_close_expired_auth_connections();
-    if (timeout_closed > 0) {
-        progress_count += timeout_closed;
+    if (used > 0) {
+        sg_logf("INFO", "PROTO", "command counts%s", line);
     }
-
-    return progress_count;
 }
 
 long long sengoo_tcp_connection_close_all(void) {
     sg_emit_extension_shutdown_hooks();
-    long long closed = 0;
-    for (int i = 0; i < SG_MAX_NET_HANDLES; i++) {
-        if (!g_tcp_connections[i].used) {
-            continue;
-        }
-        long long handle = g_tcp_connections[i].handle;
-        if (sg_remove_socket(g_tcp_connections, handle, 1)) {
-            sg_tcp_stream_detach(handle);
-            sg_auth_state_detach(handle);
-            closed += 1;
-        }
+    long long drained = sg_runtime_drain_connections();
+    long long closed = sg_reactors_stop();
+    closed += sg_reactor_close_connections();
+    sg_logf("INFO", "NET", "tcp close-all drained=%lld closed=%lld", drained, closed);
+    sg_log_command_counts();
+    sg_log_broadcast_stats();
+#ifdef _WIN32
+    if (g_shutdown_done_event != NULL) {
+        SetEvent(g_shutdown_done_event);
     }
-    sg_logf("INFO", "NET", "tcp close-all closed=%lld", closed);
-    return closed;
+#endif
+    return drained + closed;
+}
+
+long long sengoo_tcp_command_count(long long command_id) {
+    if (command_id < 0 || command_id >= SG_COMMAND_COUNT) {
+        return -1;
+    }
+    return sg_command_count_total((int)command_id);
+}
+
+long long sengoo_runtime_shutdown_requested(void) {
+    return g_shutdown_requested ? 1 : 0;
 }
 
 long long sengoo_tcp_connection_close(long long conn_handle) {
-    int ok = sg_remove_socket(g_tcp_connections, conn_handle, 1) ? 1 : 0;
+    int reactor_index = sg_handle_reactor(conn_handle);
+    if (!sg_handle_is_tcp_connection(conn_handle) || reactor_index >= g_reactor_count) {
+        sg_logf("WARN", "NET", "tcp connection close rejected invalid handle=%lld", conn_handle);
+        return 0;
+    }
+    if (reactor_index != g_reactor->index) {
+        if (!sg_reactor_post(reactor_index, SG_REACTOR_MSG_CLOSE, conn_handle, 0, NULL, NULL)) {
+            return 0;
+        }
+        sg_logf("INFO", "NET", "tcp connection close forwarded handle=%lld reactor=%d", conn_handle, reactor_index);
+        return 2;
+    }
+    int ok = sg_tcp_conn_close(conn_handle) ? 1 : 0;
     if (ok) {
-        sg_tcp_stream_detach(conn_handle);
-        sg_auth_state_detach(conn_handle);
         sg_logf("INFO", "NET", "tcp connection closed handle=%lld", conn_handle);
     } else {
         sg_logf("INFO", "NET", "tcp connection already closed handle=%lld", conn_handle);
@@ -4414,8 +8572,53 @@ long long sengoo_tcp_connection_close(long long conn_handle) {
     return ok;
 }
 
+long long sengoo_tcp_broadcast_notification(
+    const long long* handles,
+    long long handle_count,
+    const char* command,
+    const unsigned char* payload,
+    long long payload_len
+) {
+    if (command == NULL || payload_len < 0 || (payload_len > 0 && payload == NULL)) {
+        return -1;
+    }
+    sg_frame* frame = sg_frame_server_notification(command, payload, (size_t)payload_len, 2);
+    if (frame == NULL) {
+        sg_logf("WARN", "NET", "tcp broadcast encode failed command=%s bytes=%lld", command, payload_len);
+        return -1;
+    }
+    long long queued = 0;
+    long long forwarded = 0;
+    if (handles == NULL || handle_count <= 0) {
+        for (int i = 0; i < g_reactor_count; i++) {
+            if (i != g_reactor->index && sg_reactor_post(i, SG_REACTOR_MSG_FRAME, 0, 0, NULL, frame)) {
+                forwarded += 1;
+            }
+        }
+        queued += sg_tcp_broadcast_local(frame, 0);
+    } else {
+        for (long long i = 0; i < handle_count; i++) {
+            int reactor_index = sg_handle_reactor(handles[i]);
+            if (reactor_index >= 0 && reactor_index != g_reactor->index && reactor_index < g_reactor_count) {
+                if (sg_reactor_post(reactor_index, SG_REACTOR_MSG_FRAME, handles[i], 0, NULL, frame)) {
+                    forwarded += 1;
+                }
+                continue;
+            }
+            queued += sg_tcp_broadcast_local(frame, handles[i]);
+        }
+    }
+    g_reactor->broadcast_count += 1;
+    g_reactor->broadcast_bytes += (long long)frame->len;
+    g_reactor->broadcast_queued += queued;
+    g_reactor->broadcast_forwarded += forwarded;
+    sg_frame_release(frame);
+    return queued + forwarded;
+}
+
 long long sengoo_tcp_listener_close(long long listener_handle) {
-    int ok = sg_remove_socket(g_tcp_listeners, listener_handle, 1) ? 1 : 0;
+    sg_handoff_close();
+    int ok = sg_remove_socket(&g_tcp_listeners, listener_handle, 1) ? 1 : 0;
     if (ok) {
         sg_logf("INFO", "NET", "tcp listener closed handle=%lld", listener_handle);
     } else {
@@ -4424,22 +8627,16 @@ long long sengoo_tcp_listener_close(long long listener_handle) {
     return ok;
 }
 
-long long sengoo_udp_socket_bind(long long port) {
-    if (!sg_port_valid(port)) {
-        sg_logf("ERROR", "NET", "udp bind rejected invalid port=%lld", port);
-        return 0;
-    }
-    if (!sg_net_init()) {
-        sg_logf("ERROR", "NET", "udp bind failed network init error");
-        return 0;
-    }
-
+static sg_socket_t sg_udp_bind_socket(long long port) {
     sg_socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (s == SG_INVALID_SOCKET) {
         sg_logf("ERROR", "NET", "udp socket create failed err=%d", sg_last_socket_error());
-        return 0;
+        return SG_INVALID_SOCKET;
     }
 
+    int rcvbuf = sg_parse_positive_env_i32("SENGOO_UDP_RCVBUF_BYTES", 1024 * 1024);
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, (int)sizeof(rcvbuf));
+
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -4450,104 +8647,307 @@ long long sengoo_udp_socket_bind(long long port) {
         int err = sg_last_socket_error();
         sg_close_socket(s);
         sg_logf("ERROR", "NET", "udp bind failed port=%lld err=%d", port, err);
-        return 0;
+        return SG_INVALID_SOCKET;
     }
 
     if (!sg_set_nonblocking(s)) {
         int err = sg_last_socket_error();
         sg_close_socket(s);
         sg_logf("ERROR", "NET", "udp set nonblocking failed port=%lld err=%d", port, err);
+        return SG_INVALID_SOCKET;
+    }
+    return s;
+}
+
+long long sengoo_udp_socket_bind(long long port) {
+    if (!sg_port_valid(port)) {
+        sg_logf("ERROR", "NET", "udp bind rejected invalid port=%lld", port);
+        return 0;
+    }
+    if (!sg_net_init()) {
+        sg_logf("ERROR", "NET", "udp bind failed network init error");
+        return 0;
+    }
+
+    g_udp_detail_cache.ready = 0;
+
+    sg_socket_t s = sg_handoff_take_udp(port);
+    if (s == SG_INVALID_SOCKET) {
+        s = sg_udp_bind_socket(port);
+    }
+    if (s == SG_INVALID_SOCKET) {
         return 0;
     }
 
     long long handle = 0;
-    if (!sg_store_socket(g_udp_sockets, s, &handle)) {
+    if (!sg_store_socket(&g_udp_sockets, s, &handle)) {
         sg_close_socket(s);
         sg_logf("ERROR", "NET", "udp socket table full port=%lld", port);
         return 0;
     }
+    sg_poller_init();
+    if (!sg_poller_add(s, handle, 0)) {
+        int err = sg_last_socket_error();
+        sg_remove_socket(&g_udp_sockets, handle, 1);
+        sg_logf("ERROR", "NET", "udp socket poller register failed port=%lld err=%d", port, err);
+        return 0;
+    }
 
+    g_handoff.udp_handle = handle;
+    g_handoff.udp_port = port;
     sg_logf("INFO", "NET", "udp is ready to listen on [0.0.0.0]:%lld", port);
     sg_logf("INFO", "NET", "udp socket bound port=%lld handle=%lld", port, handle);
     return handle;
 }
 
+static int sg_udp_batch_reserve(long long max_bytes) {
+    sg_udp_batch* batch = &g_udp_batch;
+    if (batch->batch_size == 0) {
+        int value = sg_parse_positive_env_i32("SENGOO_UDP_BATCH_SIZE", 32);
+        if (value > SG_UDP_BATCH_MAX) {
+            value = SG_UDP_BATCH_MAX;
+        }
+        batch->batch_size = value;
+    }
+    size_t slot_cap = sg_buffer_size(max_bytes);
+    if (batch->recv_data != NULL && batch->recv_slot_cap == slot_cap && batch->recv_slot_count == batch->batch_size) {
+        return batch->batch_size;
+    }
+    char* data = (char*)realloc(batch->recv_data, (size_t)batch->batch_size * (slot_cap + 1));
+    if (data == NULL) {
+        return 0;
+    }
+    batch->recv_data = data;
+    batch->recv_slot_cap = slot_cap;
+    batch->recv_slot_count = batch->batch_size;
+    return batch->batch_size;
+}
+
+static char* sg_udp_batch_slot(int index) {
+    return g_udp_batch.recv_data + (size_t)index * (g_udp_batch.recv_slot_cap + 1);
+}
+
+static int sg_udp_prepare_reply(int index, int n) {
+    sg_udp_batch* batch = &g_udp_batch;
+    char* request = sg_udp_batch_slot(index);
+    request[n] = '\0';
+    if (n == 14 && memcmp(request, "fkDetectServer", 14) == 0) {
+        batch->reply_ptr[index] = "me";
+        batch->reply_len[index] = 2;
+        return SG_UDP_REPLY_DETECT;
+    }
+    size_t detail_len = sg_build_udp_detail_response(request, batch->reply_data[index], SG_UDP_REPLY_MAX);
+    if (detail_len > 0) {
+        batch->reply_ptr[index] = batch->reply_data[index];
+        batch->reply_len[index] = (int)detail_len;
+        return SG_UDP_REPLY_DETAIL;
+    }
+    batch->reply_ptr[index] = request;
+    batch->reply_len[index] = n;
+    return SG_UDP_REPLY_ECHO;
+}
+
+static int sg_udp_batch_recv(sg_socket_entry* sock, int budget, int* recv_lens, int* err_out) {
+    sg_udp_batch* batch = &g_udp_batch;
+    *err_out = 0;
+#if SG_HAVE_MMSG
+    for (int i = 0; i < budget; i++) {
+        batch->recv_iov[i].iov_base = sg_udp_batch_slot(i);
+        batch->recv_iov[i].iov_len = batch->recv_slot_cap;
+        memset(&batch->recv_msgs[i], 0, sizeof(batch->recv_msgs[i]));
+        batch->recv_msgs[i].msg_hdr.msg_name = &batch->peers[i];
+        batch->recv_msgs[i].msg_hdr.msg_namelen = (socklen_t)sizeof(batch->peers[i]);
+        batch->recv_msgs[i].msg_hdr.msg_iov = &batch->recv_iov[i];
+        batch->recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int count = recvmmsg(sock->socket, batch->recv_msgs, (unsigned int)budget, MSG_DONTWAIT, NULL);
+    if (count < 0) {
+        if (!sg_would_block() && errno != EINTR) {
+            *err_out = sg_last_socket_error();
+        }
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        recv_lens[i] = (int)batch->recv_msgs[i].msg_len;
+    }
+    return count;
+#else
+    int count = 0;
+    while (count < budget) {
+#ifdef _WIN32
+        int peer_len = (int)sizeof(batch->peers[count]);
+#else
+        socklen_t peer_len = (socklen_t)sizeof(batch->peers[count]);
+#endif
+        int n = recvfrom(
+            sock->socket,
+            sg_udp_batch_slot(count),
+            (int)batch->recv_slot_cap,
+            0,
+            (struct sockaddr*)&batch->peers[count],
+            &peer_len
+        );
+        if (n < 0) {
+            if (!sg_would_block() && count == 0) {
+                *err_out = sg_last_socket_error();
+            }
+            break;
+        }
+        recv_lens[count] = n;
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+static int sg_udp_batch_send(sg_socket_entry* sock, int count, long long* bytes_out, int* err_out) {
+    sg_udp_batch* batch = &g_udp_batch;
+    int sent_count = 0;
+    *bytes_out = 0;
+    *err_out = 0;
+#if SG_HAVE_MMSG
+    for (int i = 0; i < count; i++) {
+        batch->send_iov[i].iov_base = (void*)batch->reply_ptr[i];
+        batch->send_iov[i].iov_len = (size_t)batch->reply_len[i];
+        memset(&batch->send_msgs[i], 0, sizeof(batch->send_msgs[i]));
+        batch->send_msgs[i].msg_hdr.msg_name = &batch->peers[i];
+        batch->send_msgs[i].msg_hdr.msg_namelen = (socklen_t)sizeof(batch->peers[i]);
+        batch->send_msgs[i].msg_hdr.msg_iov = &batch->send_iov[i];
+        batch->send_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int offset = 0;
+    while (offset < count) {
+        int rc = sendmmsg(sock->socket, batch->send_msgs + offset, (unsigned int)(count - offset), MSG_DONTWAIT);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (sg_would_block()) {
+                break;
+            }
+            *err_out = sg_last_socket_error();
+            offset += 1;
+            continue;
+        }
+        for (int i = 0; i < rc; i++) {
+            *bytes_out += (long long)batch->send_msgs[offset + i].msg_len;
+        }
+        sent_count += rc;
+        offset += rc;
+    }
+#else
+    for (int i = 0; i < count; i++) {
+        int sent = sendto(
+            sock->socket,
+            batch->reply_ptr[i],
+            batch->reply_len[i],
+            0,
+            (struct sockaddr*)&batch->peers[i],
+            (int)sizeof(batch->peers[i])
+        );
+        if (sent < 0) {
+            if (sg_would_block()) {
+                break;
+            }
+            *err_out = sg_last_socket_error();
+            continue;
+        }
+        *bytes_out += (long long)sent;
+        sent_count += 1;
+    }
+#endif
+    return sent_count;
+}
+
 long long sengoo_udp_socket_echo_once(long long socket_handle, long long max_bytes) {
-    sg_socket_entry* sock = sg_find_socket(g_udp_sockets, socket_handle);
+    sg_socket_entry* sock = sg_find_socket(&g_udp_sockets, socket_handle);
     if (sock == NULL) {
         sg_logf("WARN", "NET", "udp echo invalid socket handle=%lld", socket_handle);
         return -2;
     }
 
-    size_t cap = sg_buffer_size(max_bytes);
-    char* buffer = (char*)malloc(cap + 1);
-    if (buffer == NULL) {
+    int budget = sg_udp_batch_reserve(max_bytes);
+    if (budget <= 0) {
         return -5;
     }
 
-    struct sockaddr_in peer_addr;
-#ifdef _WIN32
-    int peer_len = (int)sizeof(peer_addr);
-#else
-    socklen_t peer_len = (socklen_t)sizeof(peer_addr);
-#endif
-
-    int n = recvfrom(sock->socket, buffer, (int)cap, 0, (struct sockaddr*)&peer_addr, &peer_len);
-    if (n < 0) {
-        if (sg_would_block()) {
-            free(buffer);
-            return 0;
+    sg_udp_batch* batch = &g_udp_batch;
+    int recv_lens[SG_UDP_BATCH_MAX];
+    int recv_err = 0;
+    int count = sg_udp_batch_recv(sock, budget, recv_lens, &recv_err);
+    if (count == 0) {
+        if (recv_err != 0) {
+            sg_logf("WARN", "NET", "udp recv failed handle=%lld err=%d", socket_handle, recv_err);
+            return -4;
         }
-        int err = sg_last_socket_error();
-        free(buffer);
-        sg_logf("WARN", "NET", "udp recv failed handle=%lld err=%d", socket_handle, err);
-        return -4;
+        return 0;
     }
 
-    buffer[n] = '\0';
-    int sent = 0;
-    if (n == 14 && memcmp(buffer, "fkDetectServer", 14) == 0) {
-        sent = sendto(sock->socket, "me", 2, 0, (struct sockaddr*)&peer_addr, peer_len);
-        if (sent < 0) {
-            int err = sg_last_socket_error();
-            free(buffer);
-            sg_logf("WARN", "NET", "udp detect reply failed handle=%lld err=%d", socket_handle, err);
-            return -3;
+    int detect_count = 0;
+    int detail_count = 0;
+    int echo_count = 0;
+    for (int i = 0; i < count; i++) {
+        int kind = sg_udp_prepare_reply(i, recv_lens[i]);
+        if (kind == SG_UDP_REPLY_DETECT) {
+            detect_count += 1;
+        } else if (kind == SG_UDP_REPLY_DETAIL) {
+            detail_count += 1;
+        } else {
+            echo_count += 1;
         }
-        free(buffer);
-        sg_logf("INFO", "NET", "udp detect reply handle=%lld bytes=%d", socket_handle, sent);
-        return (long long)sent;
     }
 
-    char detail_json[2304];
-    if (sg_build_udp_detail_response(buffer, detail_json, sizeof(detail_json))) {
-        int detail_len = (int)strlen(detail_json);
-        sent = sendto(sock->socket, detail_json, detail_len, 0, (struct sockaddr*)&peer_addr, peer_len);
-        if (sent < 0) {
-            int err = sg_last_socket_error();
-            free(buffer);
-            sg_logf("WARN", "NET", "udp detail reply failed handle=%lld err=%d", socket_handle, err);
-            return -3;
-        }
-        free(buffer);
-        sg_logf("INFO", "NET", "udp detail reply handle=%lld bytes=%d", socket_handle, sent);
-        return (long long)sent;
-    }
+    long long sent_bytes = 0;
+    int send_err = 0;
+    int sent_count = sg_udp_batch_send(sock, count, &sent_bytes, &send_err);
+    int dropped = count - sent_count;
 
-    sent = sendto(sock->socket, buffer, n, 0, (struct sockaddr*)&peer_addr, peer_len);
-    free(buffer);
-    if (sent < 0) {
-        int err = sg_last_socket_error();
-        sg_logf("WARN", "NET", "udp send failed handle=%lld err=%d", socket_handle, err);
+    batch->batch_total += 1;
+    batch->recv_total += count;
+    batch->reply_total += sent_count;
+    batch->drop_total += dropped;
+    if (count > batch->peak_batch) {
+        batch->peak_batch = count;
+    }
+    if (send_err != 0) {
+        sg_logf("WARN", "NET", "udp send failed handle=%lld err=%d dropped=%d", socket_handle, send_err, dropped);
+    }
+    sg_logf(
+        "INFO",
+        "NET",
+        "udp batch handle=%lld recv=%d detect=%d detail=%d echo=%d sent=%d dropped=%d bytes=%lld batches=%lld recv_total=%lld reply_total=%lld drop_total=%lld peak=%d",
+        socket_handle,
+        count,
+        detect_count,
+        detail_count,
+        echo_count,
+        sent_count,
+        dropped,
+        sent_bytes,
+        batch->batch_total,
+        batch->recv_total,
+        batch->reply_total,
+        batch->drop_total,
+        batch->peak_batch
+    );
+    if (sent_count == 0 && send_err != 0) {
         return -3;
     }
-    sg_logf("INFO", "NET", "udp echo handle=%lld bytes=%d", socket_handle, n);
-    return (long long)n;
+    return sent_bytes > 0 ? sent_bytes : (long long)count;
 }
 
 long long sengoo_udp_socket_close(long long socket_handle) {
-    int ok = sg_remove_socket(g_udp_sockets, socket_handle, 1) ? 1 : 0;
+    int ok = sg_remove_socket(&g_udp_sockets, socket_handle, 1) ? 1 : 0;
     if (ok) {
+        int remaining = 0;
+        for (int i = 0; i < g_udp_sockets.high_water; i++) {
+            remaining += g_udp_sockets.entries[i].used;
+        }
+        if (remaining == 0) {
+            free(g_udp_batch.recv_data);
+            g_udp_batch.recv_data = NULL;
+            g_udp_batch.recv_slot_count = 0;
+        }
         sg_logf("INFO", "NET", "udp socket closed handle=%lld", socket_handle);
     } else {
         sg_logf("WARN", "NET", "udp socket close miss handle=%lld", socket_handle);
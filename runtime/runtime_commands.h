@@ -0,0 +1,31 @@
+/* Generated by scripts/generate_runtime_command_table.ps1; do not edit. */
+#ifndef SG_RUNTIME_COMMANDS_H
+#define SG_RUNTIME_COMMANDS_H
+
+#define SG_COMMAND_HASH_SEED 2166136261u
+#define SG_COMMAND_HASH_SLOTS 8
+
+enum {
+    SG_COMMAND_UNKNOWN = 0,
+    SG_COMMAND_SETUP = 1,
+    SG_COMMAND_PING = 2,
+    SG_COMMAND_BYE = 3,
+    SG_COMMAND_COUNT = 4
+};
+
+static const char* const g_command_names[SG_COMMAND_COUNT] = {
+    "",
+    "Setup",
+    "ping",
+    "bye"
+};
+
+static const unsigned char g_command_name_lengths[SG_COMMAND_COUNT] = {
+    0, 5, 4, 3
+};
+
+static const unsigned char g_command_hash_slots[SG_COMMAND_HASH_SLOTS] = {
+    0, 1, 2, 0, 3, 0, 0, 0
+};
+
+#endif
@@ -0,0 +1,143 @@
+param(
+  [Parameter(Mandatory = $false)]
+  [string[]]$Commands = @(
+    "Setup",
+    "ping",
+    "bye"
+  ),
+
+  [Parameter(Mandatory = $false)]
+  [string]$OutputPath = "runtime/runtime_commands.h",
+
+  [Parameter(Mandatory = $false)]
+  [int]$MaxSeedAttempts = 1000000
+)
+
+$ErrorActionPreference = "Stop"
+Set-StrictMode -Version Latest
+
+$FnvOffset = [uint64]2166136261
+$FnvPrime = [uint64]16777619
+$Mask32 = [uint64]4294967295
+
+function Ensure-ParentDir([string]$path) {
+  $parent = Split-Path -Parent $path
+  if (-not [string]::IsNullOrWhiteSpace($parent) -and -not (Test-Path $parent)) {
+    New-Item -ItemType Directory -Path $parent -Force | Out-Null
+  }
+}
+
+function Get-CommandHash([byte[]]$bytes, [uint64]$seed) {
+  $h = $seed
+  foreach ($b in $bytes) {
+    $h = (($h -bxor [uint64]$b) * $FnvPrime) -band $Mask32
+  }
+  return ($h -bxor ($h -shr 15)) -band $Mask32
+}
+
+function Get-EnumName([string]$command) {
+  $snake = [regex]::Replace($command, '([a-z0-9])([A-Z])', '$1_$2')
+  return "SG_COMMAND_" + $snake.ToUpperInvariant()
+}
+
+if ($Commands.Count -eq 0) {
+  throw "Commands must not be empty"
+}
+if ($Commands.Count -gt 255) {
+  throw "Commands must fit in an 8-bit slot table"
+}
+$unique = @($Commands | Select-Object -Unique)
+if ($unique.Count -ne $Commands.Count) {
+  throw "Commands must be unique"
+}
+
+$encoded = @()
+foreach ($command in $Commands) {
+  $bytes = [System.Text.Encoding]::UTF8.GetBytes($command)
+  if ($bytes.Length -eq 0 -or $bytes.Length -gt 255) {
+    throw "command length out of range: $command"
+  }
+  $encoded += ,$bytes
+}
+
+$slotCount = 1
+while ($slotCount -lt ($Commands.Count * 2)) {
+  $slotCount *= 2
+}
+$slotMask = [uint64]($slotCount - 1)
+
+$seed = $null
+$slots = $null
+for ($attempt = 0; $attempt -lt $MaxSeedAttempts; $attempt++) {
+  $candidate = ($FnvOffset + [uint64]$attempt) -band $Mask32
+  $table = New-Object 'int[]' $slotCount
+  $ok = $true
+  for ($i = 0; $i -lt $encoded.Count; $i++) {
+    $slot = [int]((Get-CommandHash $encoded[$i] $candidate) -band $slotMask)
+    if ($table[$slot] -ne 0) {
+      $ok = $false
+      break
+    }
+    $table[$slot] = $i + 1
+  }
+  if ($ok) {
+    $seed = $candidate
+    $slots = $table
+    break
+  }
+}
+if ($null -eq $seed) {
+  throw "no collision-free seed found within $MaxSeedAttempts attempts"
+}
+
+$lines = New-Object 'System.Collections.Generic.List[string]'
+$lines.Add("/* Generated by scripts/generate_runtime_command_table.ps1; do not edit. */")
+$lines.Add("#ifndef SG_RUNTIME_COMMANDS_H")
+$lines.Add("#define SG_RUNTIME_COMMANDS_H")
+$lines.Add("")
+$lines.Add(("#define SG_COMMAND_HASH_SEED {0}u" -f $seed))
+$lines.Add(("#define SG_COMMAND_HASH_SLOTS {0}" -f $slotCount))
+$lines.Add("")
+$lines.Add("enum {")
+$lines.Add("    SG_COMMAND_UNKNOWN = 0,")
+for ($i = 0; $i -lt $Commands.Count; $i++) {
+  $lines.Add(("    {0} = {1}," -f (Get-EnumName $Commands[$i]), ($i + 1)))
+}
+$lines.Add(("    SG_COMMAND_COUNT = {0}" -f ($Commands.Count + 1)))
+$lines.Add("};")
+$lines.Add("")
+$lines.Add("static const char* const g_command_names[SG_COMMAND_COUNT] = {")
+$lines.Add('    "",')
+for ($i = 0; $i -lt $Commands.Count; $i++) {
+  $suffix = if ($i -eq $Commands.Count - 1) { "" } else { "," }
+  $lines.Add(('    "{0}"{1}' -f $Commands[$i], $suffix))
+}
+$lines.Add("};")
+$lines.Add("")
+$lengths = @("0") + @($encoded | ForEach-Object { [string]$_.Length })
+$lines.Add("static const unsigned char g_command_name_lengths[SG_COMMAND_COUNT] = {")
+$lines.Add("    " + ($lengths -join ", "))
+$lines.Add("};")
+$lines.Add("")
+$lines.Add("static const unsigned char g_command_hash_slots[SG_COMMAND_HASH_SLOTS] = {")
+for ($row = 0; $row -lt $slotCount; $row += 16) {
+  $end = [Math]::Min($row + 16, $slotCount)
+  $cells = @()
+  for ($i = $row; $i -lt $end; $i++) {
+    $cells += [string]$slots[$i]
+  }
+  $suffix = if ($end -eq $slotCount) { "" } else { "," }
+  $lines.Add("    " + ($cells -join ", ") + $suffix)
+}
+$lines.Add("};")
+$lines.Add("")
+$lines.Add("#endif")
+
+Ensure-ParentDir $OutputPath
+$text = ($lines -join "`n") + "`n"
+[System.IO.File]::WriteAllText($OutputPath, $text, (New-Object System.Text.UTF8Encoding($false)))
+
+Write-Output "COMMAND_TABLE_OK=True"
+Write-Output ("COMMAND_TABLE_SEED={0}" -f $seed)
+Write-Output ("COMMAND_TABLE_SLOTS={0}" -f $slotCount)
+Write-Output ("COMMAND_TABLE_PATH={0}" -f (Resolve-Path $OutputPath).Path)
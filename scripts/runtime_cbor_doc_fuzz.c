@@ -0,0 +1,504 @@
+#include "runtime.c"
+
+#define SG_FUZZ_BUF_MAX 65536
+
+static unsigned long long g_fuzz_rng = 0x9e3779b97f4a7c15ULL;
+
+static unsigned long long sg_fuzz_rand(void) {
+    g_fuzz_rng ^= g_fuzz_rng << 13;
+    g_fuzz_rng ^= g_fuzz_rng >> 7;
+    g_fuzz_rng ^= g_fuzz_rng << 17;
+    return g_fuzz_rng;
+}
+
+static unsigned long long sg_fuzz_mix(unsigned long long h, unsigned long long v) {
+    return (h ^ v) * 1099511628211ULL;
+}
+
+static int sg_fuzz_doc_parse(sg_cbor_arena* arena, const unsigned char* data, size_t len, sg_cbor_node** root, size_t* consumed) {
+    sg_cbor_doc_reader reader;
+    reader.data = data;
+    reader.len = len;
+    reader.idx = 0;
+    reader.arena = arena;
+    *root = NULL;
+    int rc = sg_cbor_doc_read_item(&reader, 0, root);
+    *consumed = reader.idx;
+    return rc;
+}
+
+static int sg_fuzz_ref_length(const unsigned char* data, size_t len, size_t* idx, int ai, unsigned long long* out) {
+    static const int widths[4] = { 1, 2, 4, 8 };
+    if (ai < 24) {
+        *out = (unsigned long long)ai;
+        return 1;
+    }
+    if (ai > 27) {
+        return -1;
+    }
+    int width = widths[ai - 24];
+    if (len - *idx < (size_t)width) {
+        return 0;
+    }
+    unsigned long long value = 0;
+    for (int i = 0; i < width; i++) {
+        value = (value << 8) | data[*idx + (size_t)i];
+    }
+    *idx += (size_t)width;
+    *out = value;
+    return 1;
+}
+
+static int sg_fuzz_ref_item(const unsigned char* data, size_t len, size_t* idx, int depth, size_t* nodes, size_t max_nodes) {
+    if (depth > SG_CBOR_DOC_MAX_DEPTH) {
+        return -1;
+    }
+    if (*idx >= len) {
+        return 0;
+    }
+    if (*nodes >= max_nodes) {
+        return -1;
+    }
+    *nodes += 1;
+    int major = data[*idx] >> 5;
+    int ai = data[*idx] & 0x1f;
+    *idx += 1;
+    unsigned long long arg = 0;
+    if (major == 7) {
+        if (ai >= 28) {
+            return -1;
+        }
+        if (ai == 24 || ai >= 25) {
+            int rc = sg_fuzz_ref_length(data, len, idx, ai, &arg);
+            if (rc <= 0) {
+                return rc;
+            }
+            if (ai == 24 && arg < 32) {
+                return -1;
+            }
+        }
+        return 1;
+    }
+    int indefinite = (ai == 31);
+    if (indefinite && major != 4 && major != 5) {
+        return -1;
+    }
+    if (!indefinite) {
+        int rc = sg_fuzz_ref_length(data, len, idx, ai, &arg);
+        if (rc <= 0) {
+            return rc;
+        }
+    }
+    size_t remaining = len - *idx;
+    if (major <= 1) {
+        return arg > (unsigned long long)LLONG_MAX ? -1 : 1;
+    }
+    if (major <= 3) {
+        if (arg > (unsigned long long)remaining) {
+            return 0;
+        }
+        *idx += (size_t)arg;
+        return 1;
+    }
+    if (major == 6) {
+        return sg_fuzz_ref_item(data, len, idx, depth + 1, nodes, max_nodes);
+    }
+    if (!indefinite && (arg > (unsigned long long)remaining || (major == 5 && arg > (unsigned long long)(remaining / 2)))) {
+        return 0;
+    }
+    unsigned long long want = (major == 5 ? arg * 2 : arg);
+    unsigned long long items = 0;
+    for (;;) {
+        if (indefinite) {
+            if (*idx >= len) {
+                return 0;
+            }
+            if (data[*idx] == 0xff) {
+                *idx += 1;
+                break;
+            }
+        } else if (items >= want) {
+            break;
+        }
+        int rc = sg_fuzz_ref_item(data, len, idx, depth + 1, nodes, max_nodes);
+        if (rc <= 0) {
+            return rc;
+        }
+        items += 1;
+    }
+    if (major == 5 && (items & 1u) != 0) {
+        return -1;
+    }
+    return 1;
+}
+
+static size_t sg_fuzz_put_head(unsigned char* out, int major, unsigned long long value) {
+    size_t idx = 0;
+    sg_cbor_write_type_and_len(out, 16, &idx, major, value);
+    return idx;
+}
+
+static unsigned long long sg_fuzz_hash_tree(const sg_cbor_node* node, unsigned long long h, size_t* count) {
+    for (; node != NULL; node = node->next) {
+        *count += 1;
+        h = sg_fuzz_mix(h, (unsigned long long)node->kind);
+        switch (node->kind) {
+            case SG_CBOR_NODE_INT:
+            case SG_CBOR_NODE_BOOL:
+            case SG_CBOR_NODE_SIMPLE:
+                h = sg_fuzz_mix(h, (unsigned long long)node->int_value);
+                break;
+            case SG_CBOR_NODE_BYTES:
+            case SG_CBOR_NODE_TEXT:
+                h = sg_fuzz_mix(h, (unsigned long long)node->len);
+                for (size_t i = 0; i < node->len; i++) {
+                    h = sg_fuzz_mix(h, node->ptr[i]);
+                }
+                break;
+            case SG_CBOR_NODE_ARRAY:
+            case SG_CBOR_NODE_MAP:
+                h = sg_fuzz_mix(h, (unsigned long long)node->len);
+                break;
+            case SG_CBOR_NODE_TAG:
+                h = sg_fuzz_mix(h, node->tag);
+                break;
+            default:
+                break;
+        }
+        h = sg_fuzz_hash_tree(node->child, h, count);
+    }
+    return h;
+}
+
+static size_t sg_fuzz_gen_item(unsigned char* out, size_t cap, int depth, int max_depth, unsigned long long* h, size_t* nodes) {
+    if (cap < 64) {
+        out[0] = 0xf6;
+        *nodes += 1;
+        *h = sg_fuzz_mix(*h, SG_CBOR_NODE_NULL);
+        return 1;
+    }
+    int pick = (int)(sg_fuzz_rand() % (depth < max_depth ? 10 : 6));
+    size_t n = 0;
+    *nodes += 1;
+    switch (pick) {
+        case 0: {
+            unsigned long long value = sg_fuzz_rand() >> (sg_fuzz_rand() % 64);
+            value &= (unsigned long long)LLONG_MAX;
+            int negative = (int)(sg_fuzz_rand() & 1);
+            n = sg_fuzz_put_head(out, negative ? 1 : 0, value);
+            *h = sg_fuzz_mix(*h, SG_CBOR_NODE_INT);
+            *h = sg_fuzz_mix(*h, (unsigned long long)(negative ? -1 - (long long)value : (long long)value));
+            return n;
+        }
+        case 1:
+        case 2: {
+            size_t len = (size_t)(sg_fuzz_rand() % 40);
+            int major = pick == 1 ? 2 : 3;
+            n = sg_fuzz_put_head(out, major, len);
+            *h = sg_fuzz_mix(*h, (unsigned long long)(major == 2 ? SG_CBOR_NODE_BYTES : SG_CBOR_NODE_TEXT));
+            *h = sg_fuzz_mix(*h, (unsigned long long)len);
+            for (size_t i = 0; i < len; i++) {
+                out[n + i] = (unsigned char)sg_fuzz_rand();
+                *h = sg_fuzz_mix(*h, out[n + i]);
+            }
+            return n + len;
+        }
+        case 3: {
+            static const unsigned char simple[] = { 0xf4, 0xf5, 0xf6, 0xf7 };
+            unsigned char head = simple[sg_fuzz_rand() % 4];
+            out[0] = head;
+            if (head == 0xf4 || head == 0xf5) {
+                *h = sg_fuzz_mix(*h, SG_CBOR_NODE_BOOL);
+                *h = sg_fuzz_mix(*h, head == 0xf5 ? 1ULL : 0ULL);
+            } else {
+                *h = sg_fuzz_mix(*h, head == 0xf6 ? SG_CBOR_NODE_NULL : SG_CBOR_NODE_UNDEFINED);
+            }
+            return 1;
+        }
+        case 4: {
+            int widths[3] = { 2, 4, 8 };
+            int which = (int)(sg_fuzz_rand() % 3);
+            out[0] = (unsigned char)(0xf9 + which);
+            for (int i = 0; i < widths[which]; i++) {
+                out[1 + i] = (unsigned char)sg_fuzz_rand();
+            }
+            *h = sg_fuzz_mix(*h, SG_CBOR_NODE_FLOAT);
+            return (size_t)(1 + widths[which]);
+        }
+        case 5: {
+            unsigned long long value = 32 + sg_fuzz_rand() % 224;
+            out[0] = 0xf8;
+            out[1] = (unsigned char)value;
+            *h = sg_fuzz_mix(*h, SG_CBOR_NODE_SIMPLE);
+            *h = sg_fuzz_mix(*h, value);
+            return 2;
+        }
+        case 6: {
+            unsigned long long tag = sg_fuzz_rand() % 100000;
+            n = sg_fuzz_put_head(out, 6, tag);
+            *h = sg_fuzz_mix(*h, SG_CBOR_NODE_TAG);
+            *h = sg_fuzz_mix(*h, tag);
+            return n + sg_fuzz_gen_item(out + n, cap - n, depth + 1, max_depth, h, nodes);
+        }
+        default: {
+            int is_map = (pick == 9);
+            int indefinite = (int)(sg_fuzz_rand() % 3 == 0);
+            size_t count = (size_t)(sg_fuzz_rand() % 6);
+            size_t items = is_map ? count * 2 : count;
+            if (indefinite) {
+                out[n++] = is_map ? 0xbf : 0x9f;
+            } else {
+                n = sg_fuzz_put_head(out, is_map ? 5 : 4, count);
+            }
+            *h = sg_fuzz_mix(*h, (unsigned long long)(is_map ? SG_CBOR_NODE_MAP : SG_CBOR_NODE_ARRAY));
+            *h = sg_fuzz_mix(*h, (unsigned long long)count);
+            for (size_t i = 0; i < items; i++) {
+                size_t room = cap - n - 1 - (items - i - 1);
+                n += sg_fuzz_gen_item(out + n, room, depth + 1, max_depth, h, nodes);
+            }
+            if (indefinite) {
+                out[n++] = 0xff;
+            }
+            return n;
+        }
+    }
+}
+
+static long long g_fuzz_fails = 0;
+
+static void sg_fuzz_fail(const char* what, long long detail) {
+    if (g_fuzz_fails < 10) {
+        printf("FUZZ_MISMATCH %s detail=%lld\n", what, detail);
+    }
+    g_fuzz_fails += 1;
+}
+
+static int sg_fuzz_check(const unsigned char* data, size_t len, size_t max_nodes) {
+    sg_cbor_node inline_nodes[8];
+    sg_cbor_arena arena;
+    sg_cbor_arena_init(&arena, inline_nodes, sizeof(inline_nodes) / sizeof(inline_nodes[0]), max_nodes);
+    sg_cbor_node* root = NULL;
+    size_t consumed = 0;
+    int rc = sg_fuzz_doc_parse(&arena, data, len, &root, &consumed);
+    size_t ref_idx = 0;
+    size_t ref_nodes = 0;
+    int ref_rc = sg_fuzz_ref_item(data, len, &ref_idx, 0, &ref_nodes, max_nodes);
+    if (rc != ref_rc) {
+        sg_fuzz_fail("rc", (long long)rc * 10 + ref_rc);
+    } else if (rc == 1 && (consumed != ref_idx || arena.node_count != ref_nodes)) {
+        sg_fuzz_fail("extent", (long long)consumed - (long long)ref_idx);
+    }
+    sg_cbor_arena_release(&arena);
+    return rc;
+}
+
+static void sg_fuzz_depth(long long* cases) {
+    unsigned char buf[128];
+    for (int depth = 0; depth <= SG_CBOR_DOC_MAX_DEPTH + 8; depth++) {
+        for (int variant = 0; variant < 3; variant++) {
+            size_t n = 0;
+            for (int i = 0; i < depth; i++) {
+                buf[n++] = variant == 0 ? 0x81 : (variant == 1 ? 0x9f : 0xc1);
+            }
+            buf[n++] = 0x00;
+            if (variant == 1) {
+                for (int i = 0; i < depth; i++) {
+                    buf[n++] = 0xff;
+                }
+            }
+            int rc = sg_fuzz_check(buf, n, SG_CBOR_DOC_MAX_NODES);
+            int expect = depth <= SG_CBOR_DOC_MAX_DEPTH ? 1 : -1;
+            if (rc != expect) {
+                sg_fuzz_fail("depth", depth * 10 + variant);
+            }
+            *cases += 1;
+        }
+    }
+}
+
+static void sg_fuzz_node_limit(long long* cases) {
+    unsigned char buf[4096];
+    for (size_t items = 0; items < 300; items += 7) {
+        for (size_t limit = 1; limit < 320; limit += 13) {
+            size_t n = sg_fuzz_put_head(buf, 4, items);
+            for (size_t i = 0; i < items; i++) {
+                buf[n++] = (unsigned char)(i % 24);
+            }
+            int rc = sg_fuzz_check(buf, n, limit);
+            int expect = (items + 1 <= limit) ? 1 : -1;
+            if (rc != expect) {
+                sg_fuzz_fail("node_limit", (long long)(items * 1000 + limit));
+            }
+            *cases += 1;
+        }
+    }
+}
+
+static void sg_fuzz_random(long long rounds, long long* cases, long long* truncations) {
+    static unsigned char buf[SG_FUZZ_BUF_MAX];
+    for (long long it = 0; it < rounds; it++) {
+        unsigned long long expect_hash = 14695981039346656037ULL;
+        size_t expect_nodes = 0;
+        int max_depth = (int)(sg_fuzz_rand() % (SG_CBOR_DOC_MAX_DEPTH + 4));
+        size_t n = sg_fuzz_gen_item(buf, 8192, 0, max_depth, &expect_hash, &expect_nodes);
+
+        sg_cbor_node inline_nodes[16];
+        sg_cbor_arena arena;
+        sg_cbor_arena_init(&arena, inline_nodes, 16, SG_CBOR_DOC_MAX_NODES);
+        sg_cbor_node* root = NULL;
+        size_t consumed = 0;
+        int rc = sg_fuzz_doc_parse(&arena, buf, n, &root, &consumed);
+        int expect_rc = (max_depth <= SG_CBOR_DOC_MAX_DEPTH && expect_nodes <= SG_CBOR_DOC_MAX_NODES) ? 1 : rc;
+        if (rc != expect_rc || (rc == 1 && consumed != n)) {
+            sg_fuzz_fail("valid", (long long)it);
+        } else if (rc == 1) {
+            size_t count = 0;
+            unsigned long long hash = sg_fuzz_hash_tree(root, 14695981039346656037ULL, &count);
+            if (hash != expect_hash || count != expect_nodes) {
+                sg_fuzz_fail("tree", (long long)it);
+            }
+        }
+        sg_cbor_arena_release(&arena);
+        sg_fuzz_check(buf, n, SG_CBOR_DOC_MAX_NODES);
+        *cases += 1;
+
+        size_t cut = (size_t)(sg_fuzz_rand() % n);
+        int cut_rc = sg_fuzz_check(buf, cut, SG_CBOR_DOC_MAX_NODES);
+        if (rc == 1 && cut > 0 && cut_rc == 1) {
+            sg_fuzz_fail("truncation", (long long)cut);
+        }
+        *truncations += 1;
+
+        int mode = (int)(sg_fuzz_rand() % 3);
+        if (mode == 0) {
+            buf[sg_fuzz_rand() % n] = (unsigned char)sg_fuzz_rand();
+        } else if (mode == 1) {
+            for (int k = 0; k < 4; k++) {
+                buf[sg_fuzz_rand() % n] ^= (unsigned char)(1u << (sg_fuzz_rand() % 8));
+            }
+        } else {
+            size_t extra = (size_t)(sg_fuzz_rand() % 16);
+            for (size_t i = 0; i < extra; i++) {
+                buf[n + i] = (unsigned char)sg_fuzz_rand();
+            }
+            n += extra;
+        }
+        sg_fuzz_check(buf, n, 1 + (size_t)(sg_fuzz_rand() % SG_CBOR_DOC_MAX_NODES));
+        *cases += 1;
+    }
+}
+
+static int sg_fuzz_ref_setup(const unsigned char* payload, size_t len, sg_setup_fields* out) {
+    memset(out, 0, sizeof(*out));
+    if (len == 0 || (payload[0] >> 5) != 4) {
+        return 0;
+    }
+    size_t idx = 1;
+    unsigned long long count = ULLONG_MAX;
+    if ((payload[0] & 0x1f) != 31 && (sg_cbor_read_length_by_ai(payload, len, &idx, payload[0] & 0x1f, &count) <= 0 || count < 5)) {
+        return 0;
+    }
+    char* texts[5] = { out->name, out->password, out->md5, out->version, out->uuid };
+    size_t caps[5] = { sizeof(out->name), sizeof(out->password), sizeof(out->md5), sizeof(out->version), sizeof(out->uuid) };
+    for (int i = 0; i < 5; i++) {
+        int major = 0;
+        const unsigned char* ptr = NULL;
+        size_t field_len = 0;
+        if (sg_cbor_read_bytes_like(payload, len, &idx, &major, &ptr, &field_len) <= 0) {
+            return 0;
+        }
+        if (i == 1) {
+            if (field_len > sizeof(out->password_raw)) {
+                return 0;
+            }
+            out->password_major = major;
+            memcpy(out->password_raw, ptr, field_len);
+            out->password_raw_len = field_len;
+        }
+        sg_copy_token_to_cstr(ptr, field_len, texts[i], caps[i]);
+    }
+    return out->name[0] != '\0' && out->version[0] != '\0';
+}
+
+static void sg_fuzz_setup(long long rounds, long long* cases, long long* extended) {
+    static unsigned char buf[SG_FUZZ_BUF_MAX];
+    for (long long it = 0; it < rounds; it++) {
+        size_t fields = 5 + (size_t)(sg_fuzz_rand() % 4);
+        if (sg_fuzz_rand() % 8 == 0) {
+            fields = (size_t)(sg_fuzz_rand() % 5);
+        }
+        size_t n = sg_fuzz_put_head(buf, 4, fields);
+        for (size_t i = 0; i < fields; i++) {
+            if (i < 5) {
+                size_t len = (size_t)(sg_fuzz_rand() % 24);
+                if (i == 1 && sg_fuzz_rand() % 16 == 0) {
+                    len = 200 + (size_t)(sg_fuzz_rand() % 400);
+                }
+                n += sg_fuzz_put_head(buf + n, (sg_fuzz_rand() & 1) ? 3 : 2, len);
+                for (size_t k = 0; k < len; k++) {
+                    buf[n + k] = (unsigned char)('a' + sg_fuzz_rand() % 26);
+                }
+                n += len;
+            } else {
+                unsigned long long unused_hash = 0;
+                size_t unused_nodes = 0;
+                n += sg_fuzz_gen_item(buf + n, 4096, 0, 24, &unused_hash, &unused_nodes);
+            }
+        }
+        int mode = (int)(sg_fuzz_rand() % 4);
+        if (mode == 1) {
+            n = (size_t)(sg_fuzz_rand() % n) + 1;
+        } else if (mode == 2) {
+            buf[sg_fuzz_rand() % n] = (unsigned char)sg_fuzz_rand();
+        }
+
+        sg_setup_fields got;
+        sg_setup_fields want;
+        int rc = sg_parse_setup_payload(buf, n, &got);
+        int ref_rc = sg_fuzz_ref_setup(buf, n, &want);
+        if (rc != ref_rc) {
+            sg_fuzz_fail("setup_rc", (long long)rc * 10 + ref_rc);
+        } else if (rc && (strcmp(got.name, want.name) != 0
+            || strcmp(got.password, want.password) != 0
+            || strcmp(got.md5, want.md5) != 0
+            || strcmp(got.version, want.version) != 0
+            || strcmp(got.uuid, want.uuid) != 0
+            || got.password_major != want.password_major
+            || got.password_raw_len != want.password_raw_len
+            || memcmp(got.password_raw, want.password_raw, want.password_raw_len) != 0)) {
+            sg_fuzz_fail("setup_fields", (long long)it);
+        }
+        if (rc && fields > 5) {
+            *extended += 1;
+        }
+        *cases += 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    long long rounds = (argc > 1 ? atoll(argv[1]) : 200000);
+    if (rounds < 0) {
+        printf("usage: runtime_cbor_doc_fuzz [rounds]\n");
+        return 2;
+    }
+
+    long long depth_cases = 0;
+    long long limit_cases = 0;
+    long long random_cases = 0;
+    long long truncation_cases = 0;
+    long long setup_cases = 0;
+    long long setup_extended = 0;
+    sg_fuzz_depth(&depth_cases);
+    sg_fuzz_node_limit(&limit_cases);
+    sg_fuzz_random(rounds, &random_cases, &truncation_cases);
+    sg_fuzz_setup(rounds, &setup_cases, &setup_extended);
+
+    printf("FUZZ_DEPTH_CASES=%lld\n", depth_cases);
+    printf("FUZZ_NODE_LIMIT_CASES=%lld\n", limit_cases);
+    printf("FUZZ_RANDOM_CASES=%lld\n", random_cases);
+    printf("FUZZ_TRUNCATION_CASES=%lld\n", truncation_cases);
+    printf("FUZZ_SETUP_CASES=%lld\n", setup_cases);
+    printf("FUZZ_SETUP_EXTRA_FIELDS_ACCEPTED=%lld\n", setup_extended);
+    printf("FUZZ_FAILS=%lld\n", g_fuzz_fails);
+    return g_fuzz_fails != 0 ? 1 : 0;
+}
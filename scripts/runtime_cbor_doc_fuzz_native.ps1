@@ -0,0 +1,116 @@
+param(
+  [Parameter(Mandatory = $false)]
+  [string]$CompilerPath = "clang",
+
+  [Parameter(Mandatory = $false)]
+  [string]$DriverPath = "scripts/runtime_cbor_doc_fuzz.c",
+
+  [Parameter(Mandatory = $false)]
+  [string]$BinaryPath = ".tmp/runtime_host/runtime_cbor_doc_fuzz",
+
+  [Parameter(Mandatory = $false)]
+  [long]$Rounds = 200000,
+
+  [Parameter(Mandatory = $false)]
+  [switch]$Sanitize,
+
+  [Parameter(Mandatory = $false)]
+  [string]$OutputPath = ".tmp/runtime_host/runtime_cbor_doc_fuzz_native_report.json"
+)
+
+$ErrorActionPreference = "Stop"
+Set-StrictMode -Version Latest
+
+function Ensure-ParentDir([string]$path) {
+  $parent = Split-Path -Parent $path
+  if (-not [string]::IsNullOrWhiteSpace($parent) -and -not (Test-Path $parent)) {
+    New-Item -ItemType Directory -Path $parent -Force | Out-Null
+  }
+}
+
+if ($null -eq (Get-Command $CompilerPath -ErrorAction SilentlyContinue)) {
+  throw "C compiler not found: $CompilerPath"
+}
+if (-not (Test-Path $DriverPath)) {
+  throw "fuzz driver not found: $DriverPath"
+}
+if ($Rounds -lt 0) {
+  throw "Rounds must be >= 0"
+}
+
+$isWindowsHost = [System.Environment]::OSVersion.Platform -eq [System.PlatformID]::Win32NT
+$effectiveBinaryPath = if ($isWindowsHost -and -not $BinaryPath.EndsWith(".exe")) { "$BinaryPath.exe" } else { $BinaryPath }
+Ensure-ParentDir $effectiveBinaryPath
+
+$compileArgs = @("-O1", "-g", "-I", "runtime", "-o", $effectiveBinaryPath, $DriverPath)
+if ($Sanitize) {
+  $compileArgs += "-fsanitize=address,undefined"
+}
+if ($isWindowsHost) {
+  $compileArgs += "-lws2_32"
+} else {
+  $compileArgs += "-pthread"
+}
+& $CompilerPath @compileArgs
+if ($LASTEXITCODE -ne 0) {
+  throw "fuzz driver build failed: $DriverPath"
+}
+
+$lines = & $effectiveBinaryPath $Rounds
+$exitCode = $LASTEXITCODE
+
+$values = @{}
+$mismatches = New-Object 'System.Collections.Generic.List[string]'
+foreach ($line in $lines) {
+  $text = [string]$line
+  if ($text.StartsWith("FUZZ_MISMATCH")) {
+    $mismatches.Add($text)
+    continue
+  }
+  $eq = $text.IndexOf("=")
+  if ($eq -gt 0) {
+    $values[$text.Substring(0, $eq)] = $text.Substring($eq + 1)
+  }
+}
+
+function Get-FuzzValue([string]$key) {
+  if ($values.ContainsKey($key)) {
+    return $values[$key]
+  }
+  return $null
+}
+
+$fails = Get-FuzzValue "FUZZ_FAILS"
+$pass = ($exitCode -eq 0) `
+  -and ($null -ne $fails) `
+  -and ([long]$fails -eq 0)
+
+$report = [ordered]@{
+  generated_at_utc = (Get-Date).ToUniversalTime().ToString("o")
+  pass = $pass
+  compiler = $CompilerPath
+  driver_path = (Resolve-Path $DriverPath).Path
+  sanitize = [bool]$Sanitize
+  exit_code = $exitCode
+  rounds = $Rounds
+  cases = [ordered]@{
+    depth = Get-FuzzValue "FUZZ_DEPTH_CASES"
+    node_limit = Get-FuzzValue "FUZZ_NODE_LIMIT_CASES"
+    random = Get-FuzzValue "FUZZ_RANDOM_CASES"
+    truncation = Get-FuzzValue "FUZZ_TRUNCATION_CASES"
+    setup = Get-FuzzValue "FUZZ_SETUP_CASES"
+    setup_extra_fields_accepted = Get-FuzzValue "FUZZ_SETUP_EXTRA_FIELDS_ACCEPTED"
+  }
+  fails = $fails
+  mismatches = @($mismatches)
+}
+
+Ensure-ParentDir $OutputPath
+$report | ConvertTo-Json -Depth 8 | Set-Content -Path $OutputPath -Encoding UTF8
+
+Write-Output ("CBOR_DOC_FUZZ_NATIVE_OK={0}" -f $pass)
+Write-Output ("CBOR_DOC_FUZZ_NATIVE_REPORT={0}" -f (Resolve-Path $OutputPath).Path)
+
+if (-not $pass) {
+  exit 1
+}
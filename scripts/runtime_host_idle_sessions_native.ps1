@@ -0,0 +1,184 @@
+param(
+  [Parameter(Mandatory = $false)]
+  [string]$BinaryPath = "release/native/windows-x64/bin/freekill-asio-sengoo-runtime.exe",
+
+  [Parameter(Mandatory = $false)]
+  [int]$Sessions = 10000,
+
+  [Parameter(Mandatory = $false)]
+  [int]$HoldSeconds = 30,
+
+  [Parameter(Mandatory = $false)]
+  [int]$ConnectBatchSize = 500,
+
+  [Parameter(Mandatory = $false)]
+  [int]$ConnectTimeoutMs = 5000,
+
+  [Parameter(Mandatory = $false)]
+  [int]$GreetingTimeoutMs = 10000,
+
+  [Parameter(Mandatory = $false)]
+  [int]$IoThreads = 1,
+
+  [Parameter(Mandatory = $false)]
+  [string]$OutputPath = ".tmp/runtime_host/runtime_host_idle_sessions_native_report.json",
+
+  [Parameter(Mandatory = $false)]
+  [int]$ProbeTcpPort = 9527,
+
+  [Parameter(Mandatory = $false)]
+  [int]$WarmupMilliseconds = 1500
+)
+
+$ErrorActionPreference = "Stop"
+Set-StrictMode -Version Latest
+
+function Ensure-ParentDir([string]$path) {
+  $parent = Split-Path -Parent $path
+  if (-not [string]::IsNullOrWhiteSpace($parent) -and -not (Test-Path $parent)) {
+    New-Item -ItemType Directory -Path $parent -Force | Out-Null
+  }
+}
+
+function Test-SessionAlive([System.Net.Sockets.TcpClient]$client) {
+  if (-not $client.Connected) {
+    return $false
+  }
+  $socket = $client.Client
+  if ($socket.Poll(0, [System.Net.Sockets.SelectMode]::SelectRead) -and $socket.Available -eq 0) {
+    return $false
+  }
+  return $true
+}
+
+if (-not (Test-Path $BinaryPath)) {
+  throw "native runtime binary not found: $BinaryPath"
+}
+if ($Sessions -le 0) {
+  throw "Sessions must be > 0"
+}
+if ($HoldSeconds -le 0) {
+  throw "HoldSeconds must be > 0"
+}
+
+$env:SENGOO_TCP_PORT = [string]$ProbeTcpPort
+$env:SENGOO_SERVER_CAPACITY = [string]($Sessions + 64)
+$env:SENGOO_IO_THREADS = [string]$IoThreads
+$env:SENGOO_AUTH_SIGNUP_TIMEOUT_MS = [string][Math]::Min(3600000, ($HoldSeconds + 120) * 1000)
+
+$proc = Start-Process -FilePath $BinaryPath -PassThru
+Start-Sleep -Milliseconds $WarmupMilliseconds
+$proc.Refresh()
+
+$bootExited = $proc.HasExited
+$bootExitCode = if ($bootExited) { [int]$proc.ExitCode } else { 0 }
+
+$clients = New-Object 'System.Collections.Generic.List[System.Net.Sockets.TcpClient]'
+$connected = 0
+$greeted = 0
+$aliveAtEnd = 0
+$connectMs = 0.0
+$greetingMs = 0.0
+$peakWorkingSetBytes = 0
+$aliveUntilEnd = -not $bootExited
+
+if (-not $bootExited) {
+  $watch = [System.Diagnostics.Stopwatch]::StartNew()
+  $offset = 0
+  while ($offset -lt $Sessions) {
+    $batch = [Math]::Min($ConnectBatchSize, $Sessions - $offset)
+    $tasks = New-Object 'System.Collections.Generic.List[System.Threading.Tasks.Task]'
+    for ($i = 0; $i -lt $batch; $i++) {
+      $client = New-Object System.Net.Sockets.TcpClient
+      $clients.Add($client) | Out-Null
+      $tasks.Add($client.ConnectAsync("127.0.0.1", $ProbeTcpPort)) | Out-Null
+    }
+    try {
+      [System.Threading.Tasks.Task]::WaitAll($tasks.ToArray(), $ConnectTimeoutMs) | Out-Null
+    } catch {
+    }
+    $offset += $batch
+  }
+  $watch.Stop()
+  $connectMs = [double]$watch.Elapsed.TotalMilliseconds
+  $connected = @($clients | Where-Object { $_.Connected }).Count
+
+  $watch = [System.Diagnostics.Stopwatch]::StartNew()
+  while ($watch.Elapsed.TotalMilliseconds -lt $GreetingTimeoutMs) {
+    $greeted = @($clients | Where-Object { $_.Connected -and $_.Client.Available -gt 0 }).Count
+    if ($greeted -ge $connected) {
+      break
+    }
+    Start-Sleep -Milliseconds 200
+  }
+  $watch.Stop()
+  $greetingMs = [double]$watch.Elapsed.TotalMilliseconds
+
+  $hold = [System.Diagnostics.Stopwatch]::StartNew()
+  while ($hold.Elapsed.TotalSeconds -lt $HoldSeconds) {
+    $proc.Refresh()
+    if ($proc.HasExited) {
+      $aliveUntilEnd = $false
+      break
+    }
+    $peakWorkingSetBytes = [Math]::Max($peakWorkingSetBytes, [long]$proc.WorkingSet64)
+    Start-Sleep -Milliseconds 1000
+  }
+  $hold.Stop()
+
+  $aliveAtEnd = @($clients | Where-Object { Test-SessionAlive $_ }).Count
+}
+
+foreach ($client in $clients) {
+  $client.Dispose()
+}
+
+$proc.Refresh()
+if (-not $proc.HasExited) {
+  Stop-Process -Id $proc.Id -Force
+}
+
+$pass = (-not $bootExited) `
+  -and $aliveUntilEnd `
+  -and ($connected -eq $Sessions) `
+  -and ($greeted -eq $Sessions) `
+  -and ($aliveAtEnd -eq $Sessions)
+
+$report = [ordered]@{
+  generated_at_utc = (Get-Date).ToUniversalTime().ToString("o")
+  pass = $pass
+  binary_path = (Resolve-Path $BinaryPath).Path
+  sessions = $Sessions
+  hold_seconds = $HoldSeconds
+  io_threads = $IoThreads
+  boot = [ordered]@{
+    exited_during_warmup = $bootExited
+    warmup_exit_code = $bootExitCode
+    warmup_ms = $WarmupMilliseconds
+  }
+  probe = [ordered]@{
+    tcp_port = $ProbeTcpPort
+    connect_batch_size = $ConnectBatchSize
+    connect_timeout_ms = $ConnectTimeoutMs
+    greeting_timeout_ms = $GreetingTimeoutMs
+  }
+  metrics = [ordered]@{
+    connected = $connected
+    greeted = $greeted
+    alive_at_end = $aliveAtEnd
+    connect_ms = $connectMs
+    greeting_ms = $greetingMs
+    peak_working_set_bytes = $peakWorkingSetBytes
+    alive_until_end = $aliveUntilEnd
+  }
+}
+
+Ensure-ParentDir $OutputPath
+$report | ConvertTo-Json -Depth 8 | Set-Content -Path $OutputPath -Encoding UTF8
+
+Write-Output ("IDLE_SESSIONS_NATIVE_OK={0}" -f $pass)
+Write-Output ("IDLE_SESSIONS_NATIVE_REPORT={0}" -f (Resolve-Path $OutputPath).Path)
+
+if (-not $pass) {
+  exit 1
+}
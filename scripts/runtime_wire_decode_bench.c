@@ -0,0 +1,261 @@
+#include "runtime.c"
+
+static unsigned long long g_bench_rng = 88172645463325252ULL;
+
+static unsigned long long sg_bench_rand(void) {
+    g_bench_rng ^= g_bench_rng << 13;
+    g_bench_rng ^= g_bench_rng >> 7;
+    g_bench_rng ^= g_bench_rng << 17;
+    return g_bench_rng;
+}
+
+static long long sg_bench_now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (long long)((double)now.QuadPart * 1000000000.0 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + (long long)ts.tv_nsec;
+#endif
+}
+
+static size_t sg_bench_put_int(unsigned char* out, long long value) {
+    size_t idx = 0;
+    if (value < 0) {
+        sg_cbor_write_type_and_len(out, 16, &idx, 1, (unsigned long long)(-1 - value));
+    } else {
+        sg_cbor_write_type_and_len(out, 16, &idx, 0, (unsigned long long)value);
+    }
+    return idx;
+}
+
+static size_t sg_bench_put_bytes(unsigned char* out, int major, const unsigned char* data, size_t len) {
+    size_t idx = 0;
+    sg_cbor_write_type_and_len(out, 16, &idx, major, (unsigned long long)len);
+    if (len > 0) {
+        memcpy(out + idx, data, len);
+    }
+    return idx + len;
+}
+
+static long long sg_bench_random_int(void) {
+    switch (sg_bench_rand() % 5) {
+        case 0:
+            return (long long)(sg_bench_rand() % 24);
+        case 1:
+            return (long long)(sg_bench_rand() % 256);
+        case 2:
+            return (long long)(sg_bench_rand() % 65536);
+        case 3:
+            return (long long)(sg_bench_rand() % 4000000000ULL);
+        default: {
+            long long value = (long long)(sg_bench_rand() >> 1);
+            return (sg_bench_rand() & 1) ? value : -value;
+        }
+    }
+}
+
+static size_t sg_bench_random_frame(unsigned char* out) {
+    unsigned char scratch[700];
+    size_t n = 0;
+    int six = (int)(sg_bench_rand() & 1);
+    out[n++] = six ? 0x86 : 0x84;
+    n += sg_bench_put_int(out + n, sg_bench_random_int());
+    n += sg_bench_put_int(out + n, sg_bench_random_int());
+    for (int field = 0; field < 2; field++) {
+        size_t len = 0;
+        if (field == 0) {
+            len = (size_t)(sg_bench_rand() % 20);
+        } else {
+            len = (size_t)(sg_bench_rand() % 5 == 0 ? sg_bench_rand() % 700 : sg_bench_rand() % 60);
+        }
+        for (size_t i = 0; i < len; i++) {
+            scratch[i] = (unsigned char)sg_bench_rand();
+        }
+        n += sg_bench_put_bytes(out + n, (sg_bench_rand() & 1) ? 2 : 3, scratch, len);
+    }
+    if (six) {
+        n += sg_bench_put_int(out + n, sg_bench_random_int());
+        n += sg_bench_put_int(out + n, sg_bench_random_int());
+    }
+    return n;
+}
+
+static int sg_bench_same(int ra, int rb, const sg_cbor_wire_packet* a, const sg_cbor_wire_packet* b, size_t ca, size_t cb) {
+    if (ra != rb) {
+        return 0;
+    }
+    if (ra != 1) {
+        return 1;
+    }
+    return ca == cb
+        && a->request_id == b->request_id
+        && a->packet_type == b->packet_type
+        && a->command_major == b->command_major
+        && a->command_ptr == b->command_ptr
+        && a->command_len == b->command_len
+        && a->payload_major == b->payload_major
+        && a->payload_ptr == b->payload_ptr
+        && a->payload_len == b->payload_len
+        && a->field_count == b->field_count
+        && a->timeout == b->timeout
+        && a->timestamp == b->timestamp;
+}
+
+static long long sg_bench_parity(long long cases) {
+    static unsigned char buf[4096];
+    long long fails = 0;
+    long long complete = 0;
+    long long partial = 0;
+    long long invalid = 0;
+    for (long long it = 0; it < cases; it++) {
+        size_t n = sg_bench_random_frame(buf);
+        size_t extra = (size_t)(sg_bench_rand() % 24);
+        for (size_t i = 0; i < extra; i++) {
+            buf[n + i] = (unsigned char)sg_bench_rand();
+        }
+        size_t total = n + extra;
+        int mode = (int)(sg_bench_rand() % 4);
+        if (mode == 1) {
+            buf[sg_bench_rand() % total] = (unsigned char)sg_bench_rand();
+        } else if (mode == 2) {
+            total = (size_t)(sg_bench_rand() % (total + 1));
+        } else if (mode == 3) {
+            for (int k = 0; k < 3; k++) {
+                buf[sg_bench_rand() % total] ^= (unsigned char)(1u << (sg_bench_rand() % 8));
+            }
+        }
+        sg_cbor_wire_packet a;
+        sg_cbor_wire_packet b;
+        memset(&a, 0, sizeof(a));
+        memset(&b, 0, sizeof(b));
+        size_t ca = 0;
+        size_t cb = 0;
+        int ra = sg_cbor_parse_wire_packet(buf, total, &a, &ca);
+        int rb = sg_cbor_parse_wire_packet_fast(buf, total, &b, &cb, NULL);
+        if (!sg_bench_same(ra, rb, &a, &b, ca, cb)) {
+            if (fails < 5) {
+                printf("PARITY_MISMATCH generic=%d fast=%d len=%u\n", ra, rb, (unsigned)total);
+            }
+            fails += 1;
+        }
+        if (ra == 1) {
+            complete += 1;
+        } else if (ra == 0) {
+            partial += 1;
+        } else {
+            invalid += 1;
+        }
+    }
+    printf("PARITY_CASES=%lld\n", cases);
+    printf("PARITY_FAILS=%lld\n", fails);
+    printf("PARITY_COMPLETE=%lld\n", complete);
+    printf("PARITY_PARTIAL=%lld\n", partial);
+    printf("PARITY_INVALID=%lld\n", invalid);
+    return fails;
+}
+
+static size_t sg_bench_build_stream(unsigned char* stream, size_t cap, int* frames_out) {
+    static const char* commands[] = { "PushRequest", "Heartbeat", "Setup", "NetworkDelayTest", "Chat", "EnterRoom", "PlayCard" };
+    unsigned char payload[600];
+    memset(payload, 'x', sizeof(payload));
+    size_t used = 0;
+    int frames = 0;
+    while (used + 1024 < cap) {
+        unsigned char* out = stream + used;
+        size_t n = 0;
+        int six = (sg_bench_rand() % 3) != 0;
+        out[n++] = six ? 0x86 : 0x84;
+        n += sg_bench_put_int(out + n, (long long)(sg_bench_rand() % (1u << (sg_bench_rand() % 31))));
+        n += sg_bench_put_int(out + n, (sg_bench_rand() & 1) ? 0x0104 : 0x0201);
+        const char* command = commands[sg_bench_rand() % 7];
+        n += sg_bench_put_bytes(out + n, 2, (const unsigned char*)command, strlen(command));
+        size_t payload_len = (size_t)(sg_bench_rand() % 5 == 0 ? sg_bench_rand() % 600 : sg_bench_rand() % 40);
+        n += sg_bench_put_bytes(out + n, 2, payload, payload_len);
+        if (six) {
+            n += sg_bench_put_int(out + n, (sg_bench_rand() & 1) ? 30000 : 15);
+            n += sg_bench_put_int(out + n, 1760000000000LL + frames);
+        }
+        used += n;
+        frames += 1;
+    }
+    *frames_out = frames;
+    return used;
+}
+
+static double sg_bench_decode(const unsigned char* stream, size_t used, int frames, int passes, int fast) {
+    long long checksum = 0;
+    long long decoded = 0;
+    long long started_ns = sg_bench_now_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        size_t offset = 0;
+        while (offset < used) {
+            sg_cbor_wire_packet packet;
+            size_t consumed = 0;
+            int rc = fast
+                ? sg_cbor_parse_wire_packet_fast(stream + offset, used - offset, &packet, &consumed, NULL)
+                : sg_cbor_parse_wire_packet(stream + offset, used - offset, &packet, &consumed);
+            if (rc != 1) {
+                break;
+            }
+            checksum += packet.request_id + (long long)packet.payload_len;
+            offset += consumed;
+            decoded += 1;
+        }
+    }
+    long long elapsed_ns = sg_bench_now_ns() - started_ns;
+    if (decoded != (long long)frames * passes) {
+        printf("BENCH_DECODE_SHORT decoded=%lld expected=%lld\n", decoded, (long long)frames * passes);
+        return -1.0;
+    }
+    if (checksum == 42) {
+        printf("BENCH_CHECKSUM=%lld\n", checksum);
+    }
+    return (double)elapsed_ns / (double)decoded;
+}
+
+int main(int argc, char** argv) {
+    long long cases = (argc > 1 ? atoll(argv[1]) : 2000000);
+    size_t stream_bytes = (size_t)(argc > 2 ? atoll(argv[2]) : 131072);
+    int passes = (argc > 3 ? atoi(argv[3]) : 20);
+    int rounds = (argc > 4 ? atoi(argv[4]) : 15);
+    if (cases < 0 || stream_bytes < 4096 || passes <= 0 || rounds <= 0) {
+        printf("usage: runtime_wire_decode_bench [cases] [stream_bytes>=4096] [passes] [rounds]\n");
+        return 2;
+    }
+
+    long long fails = sg_bench_parity(cases);
+
+    unsigned char* stream = (unsigned char*)malloc(stream_bytes);
+    if (stream == NULL) {
+        return 2;
+    }
+    int frames = 0;
+    size_t used = sg_bench_build_stream(stream, stream_bytes, &frames);
+    double best_generic = 0.0;
+    double best_fast = 0.0;
+    for (int round = 0; round < rounds; round++) {
+        double generic_ns = sg_bench_decode(stream, used, frames, passes, 0);
+        double fast_ns = sg_bench_decode(stream, used, frames, passes, 1);
+        if (generic_ns < 0.0 || fast_ns < 0.0) {
+            free(stream);
+            return 1;
+        }
+        if (round == 0 || generic_ns < best_generic) {
+            best_generic = generic_ns;
+        }
+        if (round == 0 || fast_ns < best_fast) {
+            best_fast = fast_ns;
+        }
+    }
+    free(stream);
+    printf("BENCH_FRAMES=%d\n", frames);
+    printf("BENCH_STREAM_BYTES=%u\n", (unsigned)used);
+    printf("BENCH_GENERIC_NS_PER_FRAME=%.2f\n", best_generic);
+    printf("BENCH_FAST_NS_PER_FRAME=%.2f\n", best_fast);
+    return fails != 0 ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+param(
+  [Parameter(Mandatory = $false)]
+  [string]$CompilerPath = "clang",
+
+  [Parameter(Mandatory = $false)]
+  [string]$DriverPath = "scripts/runtime_wire_decode_bench.c",
+
+  [Parameter(Mandatory = $false)]
+  [string]$BinaryPath = ".tmp/runtime_host/runtime_wire_decode_bench",
+
+  [Parameter(Mandatory = $false)]
+  [long]$ParityCases = 2000000,
+
+  [Parameter(Mandatory = $false)]
+  [int]$StreamBytes = 131072,
+
+  [Parameter(Mandatory = $false)]
+  [int]$Passes = 20,
+
+  [Parameter(Mandatory = $false)]
+  [int]$Rounds = 15,
+
+  [Parameter(Mandatory = $false)]
+  [double]$MinSpeedup = 1.0,
+
+  [Parameter(Mandatory = $false)]
+  [string]$OutputPath = ".tmp/runtime_host/runtime_wire_decode_bench_native_report.json"
+)
+
+$ErrorActionPreference = "Stop"
+Set-StrictMode -Version Latest
+
+function Ensure-ParentDir([string]$path) {
+  $parent = Split-Path -Parent $path
+  if (-not [string]::IsNullOrWhiteSpace($parent) -and -not (Test-Path $parent)) {
+    New-Item -ItemType Directory -Path $parent -Force | Out-Null
+  }
+}
+
+if ($null -eq (Get-Command $CompilerPath -ErrorAction SilentlyContinue)) {
+  throw "C compiler not found: $CompilerPath"
+}
+if (-not (Test-Path $DriverPath)) {
+  throw "bench driver not found: $DriverPath"
+}
+if ($ParityCases -lt 0) {
+  throw "ParityCases must be >= 0"
+}
+if ($StreamBytes -lt 4096) {
+  throw "StreamBytes must be >= 4096"
+}
+
+$isWindowsHost = [System.Environment]::OSVersion.Platform -eq [System.PlatformID]::Win32NT
+$effectiveBinaryPath = if ($isWindowsHost -and -not $BinaryPath.EndsWith(".exe")) { "$BinaryPath.exe" } else { $BinaryPath }
+Ensure-ParentDir $effectiveBinaryPath
+
+$compileArgs = @("-O2", "-I", "runtime", "-o", $effectiveBinaryPath, $DriverPath)
+if ($isWindowsHost) {
+  $compileArgs += "-lws2_32"
+} else {
+  $compileArgs += "-pthread"
+}
+& $CompilerPath @compileArgs
+if ($LASTEXITCODE -ne 0) {
+  throw "bench driver build failed: $DriverPath"
+}
+
+$lines = & $effectiveBinaryPath $ParityCases $StreamBytes $Passes $Rounds
+$exitCode = $LASTEXITCODE
+
+$values = @{}
+$mismatches = New-Object 'System.Collections.Generic.List[string]'
+foreach ($line in $lines) {
+  $text = [string]$line
+  if ($text.StartsWith("PARITY_MISMATCH")) {
+    $mismatches.Add($text)
+    continue
+  }
+  $eq = $text.IndexOf("=")
+  if ($eq -gt 0) {
+    $values[$text.Substring(0, $eq)] = $text.Substring($eq + 1)
+  }
+}
+
+function Get-BenchValue([string]$key) {
+  if ($values.ContainsKey($key)) {
+    return $values[$key]
+  }
+  return $null
+}
+
+$parityFails = Get-BenchValue "PARITY_FAILS"
+$genericNs = Get-BenchValue "BENCH_GENERIC_NS_PER_FRAME"
+$fastNs = Get-BenchValue "BENCH_FAST_NS_PER_FRAME"
+$speedup = $null
+if ($null -ne $genericNs -and $null -ne $fastNs -and [double]$fastNs -gt 0) {
+  $speedup = [Math]::Round([double]$genericNs / [double]$fastNs, 3)
+}
+
+$pass = ($exitCode -eq 0) `
+  -and ($null -ne $parityFails) `
+  -and ([long]$parityFails -eq 0) `
+  -and ($null -ne $speedup) `
+  -and ($speedup -gt $MinSpeedup)
+
+$report = [ordered]@{
+  generated_at_utc = (Get-Date).ToUniversalTime().ToString("o")
+  pass = $pass
+  compiler = $CompilerPath
+  driver_path = (Resolve-Path $DriverPath).Path
+  exit_code = $exitCode
+  parity = [ordered]@{
+    cases = Get-BenchValue "PARITY_CASES"
+    fails = $parityFails
+    complete = Get-BenchValue "PARITY_COMPLETE"
+    partial = Get-BenchValue "PARITY_PARTIAL"
+    invalid = Get-BenchValue "PARITY_INVALID"
+    mismatches = @($mismatches)
+  }
+  bench = [ordered]@{
+    frames = Get-BenchValue "BENCH_FRAMES"
+    stream_bytes = Get-BenchValue "BENCH_STREAM_BYTES"
+    passes = $Passes
+    rounds = $Rounds
+    generic_ns_per_frame = $genericNs
+    fast_ns_per_frame = $fastNs
+    speedup = $speedup
+    min_speedup = $MinSpeedup
+  }
+}
+
+Ensure-ParentDir $OutputPath
+$report | ConvertTo-Json -Depth 8 | Set-Content -Path $OutputPath -Encoding UTF8
+
+Write-Output ("WIRE_DECODE_BENCH_NATIVE_OK={0}" -f $pass)
+Write-Output ("WIRE_DECODE_BENCH_NATIVE_REPORT={0}" -f (Resolve-Path $OutputPath).Path)
+
+if (-not $pass) {
+  exit 1
+}